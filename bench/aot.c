@@ -0,0 +1,119 @@
+/* Compare the interpreted pump with the parser generated ahead-of-time from
+ * the same grammar, on random bc statements. */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "../include/grammar.h"
+#include "../include/rdesc.h"
+#include "../src/common.h"
+
+#include "../examples/grammar/bc.h"
+#include "../tests/lib/bc_fuzzer.c"
+
+#include "lib/bench.h"
+
+#include "bc_aot.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+#define STATEMENT_COUNT 4096
+#define MAX_TOKENS 256
+#define ROUNDS 8
+
+
+static uint16_t statements[STATEMENT_COUNT][MAX_TOKENS];
+static size_t total_tokens;
+
+
+static void generate_statements(void)
+{
+	for (size_t s = 0; s < STATEMENT_COUNT; s++) {
+		struct bc_grammar_generator g = BC_DEFAULT_GENERATOR;
+		size_t len = 0;
+		uint16_t tk;
+
+		while ((tk = bc_fuzzer_next_tk(&g)) != TK_ENDSYM &&
+		       len < MAX_TOKENS - 2) {
+			g.group_start_p *= 0.9;
+
+			statements[s][len++] = tk;
+		}
+
+		statements[s][len++] = TK_ENDSYM;
+		statements[s][len] = TK_NOTOKEN;
+
+		total_tokens += len;
+	}
+}
+
+/* Parses all statements and returns elapsed nanoseconds. */
+static uint64_t parse_all(struct rdesc *p,
+			  int (*start)(struct rdesc *, uint16_t),
+			  enum rdesc_result (*pump)(struct rdesc *, uint16_t,
+						    void *),
+			  void (*reset)(struct rdesc *))
+{
+	uint64_t start_ns = bench_now_ns();
+
+	for (size_t s = 0; s < STATEMENT_COUNT; s++) {
+		enum rdesc_result res = RDESC_CONTINUE;
+
+		unwrap(start(p, NT_STMT));
+
+		for (const uint16_t *tk = statements[s]; *tk != TK_NOTOKEN; tk++)
+			res = pump(p, *tk, NULL);
+
+		rdesc_assert(res == RDESC_READY, "could not match grammar");
+
+		reset(p);
+	}
+
+	return bench_now_ns() - start_ns;
+}
+
+
+int main(void)
+{
+	struct rdesc_grammar grammar;
+	struct rdesc interpreted, compiled;
+	uint64_t t_interpreted = UINT64_MAX, t_compiled = UINT64_MAX;
+
+	srand(0);
+	generate_statements();
+
+	unwrap(rdesc_grammar_init(&grammar,
+				  BC_NT_COUNT, BC_NT_VARIANT_COUNT, BC_NT_BODY_LENGTH,
+				  (struct rdesc_grammar_symbol *) bc));
+
+	unwrap(rdesc_init(&interpreted, &grammar, 0, NULL));
+	unwrap(bc_init(&compiled, 0, NULL));
+
+	/* Best of rounds, alternating to even out frequency scaling. */
+	for (int r = 0; r < ROUNDS; r++) {
+		uint64_t t;
+
+		t = parse_all(&interpreted, rdesc_start, rdesc_pump, rdesc_reset);
+		if (t < t_interpreted)
+			t_interpreted = t;
+
+		t = parse_all(&compiled, bc_start, bc_pump, bc_reset);
+		if (t < t_compiled)
+			t_compiled = t;
+	}
+
+	printf("%zu statements, %zu tokens\n", (size_t) STATEMENT_COUNT,
+	       total_tokens);
+	printf("%12s %12s %12s\n", "", "ms", "ns/token");
+	printf("%12s %12.2f %12.1f\n", "interpreted",
+	       t_interpreted / 1e6, (double) t_interpreted / total_tokens);
+	printf("%12s %12.2f %12.1f\n", "compiled",
+	       t_compiled / 1e6, (double) t_compiled / total_tokens);
+
+	rdesc_destroy(&interpreted);
+	bc_destroy(&compiled);
+	rdesc_grammar_destroy(&grammar);
+}
@@ -0,0 +1,197 @@
+/* Compare getting the CST of a balanced tree of over a million nodes by
+ * parsing its tokens with getting it by opening a saved CST file, both
+ * followed by a walk over the tree. */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "../include/cst_file.h"
+#include "../include/cst_macros.h"
+#include "../include/grammar.h"
+#include "../include/rdesc.h"
+#include "../include/rule_macros.h"
+#include "../src/common.h"
+
+#include "lib/bench.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+#define TREE_NT_COUNT 1
+#define TREE_NT_VARIANT_COUNT 3
+#define TREE_NT_BODY_LENGTH 5
+
+/* Every level doubles the number of leaves. */
+#define DEPTH 18
+#define MAX_TOKENS ((3 << DEPTH) + 1)
+#define ROUNDS 8
+
+enum tree_tk {
+	TK_TREE_NOTOKEN,
+	TK_TREE_LPAREN, TK_TREE_RPAREN, TK_TREE_NUM, TK_TREE_END,
+};
+
+enum tree_nt {
+	NT_TREE,
+};
+
+static const struct rdesc_grammar_symbol
+tree[TREE_NT_COUNT][TREE_NT_VARIANT_COUNT][TREE_NT_BODY_LENGTH] = {
+	/* <tree> ::= */ r(
+		TK(TREE_LPAREN), NT(TREE), NT(TREE), TK(TREE_RPAREN)
+	alt	TK(TREE_NUM)
+	),
+};
+
+
+static uint16_t tks[MAX_TOKENS];
+static uint32_t seminfos[MAX_TOKENS];
+static size_t token_count;
+
+static char path[] = "/tmp/rdesc_bench_cst_XXXXXX";
+
+/* Sum of token seminfo, so that no walk can be optimized out. */
+static size_t checksum;
+
+
+static void generate_tree(int depth)
+{
+	if (depth == 0) {
+		seminfos[token_count] = rand();
+		tks[token_count++] = TK_TREE_NUM;
+
+		return;
+	}
+
+	tks[token_count++] = TK_TREE_LPAREN;
+	generate_tree(depth - 1);
+	generate_tree(depth - 1);
+	tks[token_count++] = TK_TREE_RPAREN;
+}
+
+static void walk(const struct rdesc_cst *cst, struct rdesc_node *n)
+{
+	if (rtype(n) == RDESC_TOKEN) {
+		uint32_t seminfo;
+
+		/* Seminfo follows the token id in the tape, unaligned. */
+		memcpy(&seminfo, rcst_seminfo(cst, n), sizeof(seminfo));
+		checksum += seminfo;
+
+		return;
+	}
+
+	for (uint16_t i = 0; i < rchild_count(n); i++)
+		walk(cst, rcst_child(cst, n, i));
+}
+
+/* Parses the tokens into a detached CST and walks it. */
+static uint64_t parse(struct rdesc *p)
+{
+	struct rdesc_cst cst;
+	size_t consumed;
+
+	checksum = 0;
+
+	uint64_t start_ns = bench_now_ns();
+
+	unwrap(rdesc_start(p, NT_TREE));
+	rdesc_assert(rdesc_pump_many(p, tks, seminfos, token_count,
+				     &consumed) == RDESC_READY,
+		     "could not match grammar");
+	unwrap(rdesc_take_cst(p, &cst));
+	walk(&cst, rdesc_cst_root(&cst));
+	rdesc_cst_destroy(&cst);
+
+	uint64_t elapsed = bench_now_ns() - start_ns;
+
+	rdesc_reset(p);
+
+	return elapsed;
+}
+
+/* Opens the saved CST and walks it. */
+static uint64_t open_saved(void)
+{
+	struct rdesc_cst cst;
+
+	checksum = 0;
+
+	uint64_t start_ns = bench_now_ns();
+
+	unwrap(rdesc_cst_open(&cst, path));
+	walk(&cst, rdesc_cst_root(&cst));
+	rdesc_cst_close(&cst);
+
+	return bench_now_ns() - start_ns;
+}
+
+
+int main(void)
+{
+	struct rdesc_grammar grammar;
+	struct rdesc p;
+	struct rdesc_cst cst;
+	struct stat st;
+	size_t consumed, parsed_checksum;
+	uint64_t best_parse = UINT64_MAX, best_open = UINT64_MAX;
+	int fd = mkstemp(path);
+	FILE *out = fdopen(fd, "wb");
+
+	rdesc_assert(out != NULL, "could not create temporary file");
+
+	srand(0);
+
+	generate_tree(DEPTH);
+	tks[token_count++] = TK_TREE_END;
+
+	unwrap(rdesc_grammar_init(&grammar,
+				  TREE_NT_COUNT, TREE_NT_VARIANT_COUNT,
+				  TREE_NT_BODY_LENGTH,
+				  (struct rdesc_grammar_symbol *) tree));
+	unwrap(rdesc_init(&p, &grammar, sizeof(uint32_t), NULL));
+
+	unwrap(rdesc_start(&p, NT_TREE));
+	rdesc_assert(rdesc_pump_many(&p, tks, seminfos, token_count,
+				     &consumed) == RDESC_READY,
+		     "could not match grammar");
+	unwrap(rdesc_take_cst(&p, &cst));
+	unwrap(rdesc_cst_save(&cst, out));
+	fclose(out);
+	rdesc_cst_destroy(&cst);
+	rdesc_reset(&p);
+
+	/* Best of rounds, alternating to even out frequency scaling. The file
+	 * stays in the page cache after the first round. */
+	for (int r = 0; r < ROUNDS; r++) {
+		uint64_t t = parse(&p);
+
+		if (t < best_parse)
+			best_parse = t;
+
+		parsed_checksum = checksum;
+
+		t = open_saved();
+
+		if (t < best_open)
+			best_open = t;
+
+		rdesc_assert(checksum == parsed_checksum, "checksum mismatch");
+	}
+
+	stat(path, &st);
+	unlink(path);
+
+	printf("depth %d, %zu tokens, file %zu KiB\n", DEPTH, token_count,
+	       (size_t) st.st_size / 1024);
+	printf("%12s %12.2f ms\n", "parse", best_parse / 1e6);
+	printf("%12s %12.2f ms\n", "open", best_open / 1e6);
+
+	rdesc_destroy(&p);
+	rdesc_grammar_destroy(&grammar);
+}
@@ -0,0 +1,203 @@
+/* Compare parsing a program of 50k tokens again after a one-token edit with
+ * editing the tape of the parser that matched it, for edits at the start,
+ * the middle and the end of the program. */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "../include/grammar.h"
+#include "../include/rdesc.h"
+#include "../include/rule_macros.h"
+#include "../src/common.h"
+
+#include "lib/bench.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+#define PROGRAM_NT_COUNT 5
+#define PROGRAM_NT_VARIANT_COUNT 4
+#define PROGRAM_NT_BODY_LENGTH 5
+
+#define MIN_TOKENS 50000
+#define MAX_TOKENS (MIN_TOKENS + 256)
+#define ROUNDS 16
+
+/* Exceeds the size of the CST, so that all of it can be memoized. */
+#define MEMORY_LIMIT (64 * 1024 * 1024)
+
+enum program_tk {
+	TK_NOTOKEN,
+	TK_ID, TK_NUM, TK_ASSIGN, TK_PLUS, TK_LPAREN, TK_RPAREN, TK_SEMI,
+	TK_END,
+};
+
+enum program_nt {
+	NT_PROGRAM, NT_STMTS, NT_STMT, NT_EXPR, NT_ATOM,
+};
+
+static const struct rdesc_grammar_symbol
+program[PROGRAM_NT_COUNT][PROGRAM_NT_VARIANT_COUNT][PROGRAM_NT_BODY_LENGTH] = {
+	/* <program> ::= */ r(
+		NT(STMTS), TK(END)
+	),
+	/* <stmts> ::= */ r(
+		NT(STMT), NT(STMTS)
+	alt	EPSILON
+	),
+	/* <stmt> ::= */ r(
+		TK(ID), TK(ASSIGN), NT(EXPR), TK(SEMI)
+	alt	NT(EXPR), TK(SEMI)
+	),
+	/* <expr> ::= */ r(
+		NT(ATOM), TK(PLUS), NT(EXPR)
+	alt	NT(ATOM)
+	),
+	/* <atom> ::= */ r(
+		TK(ID)
+	alt	TK(NUM)
+	alt	TK(LPAREN), NT(EXPR), TK(RPAREN)
+	),
+};
+
+
+static uint16_t tks[MAX_TOKENS];
+static size_t token_count;
+
+
+static void generate_expr(int depth);
+
+static void generate_atom(int depth)
+{
+	if (depth > 0 && rand() % 4 == 0) {
+		tks[token_count++] = TK_LPAREN;
+		generate_expr(depth - 1);
+		tks[token_count++] = TK_RPAREN;
+	} else {
+		tks[token_count++] = rand() % 2 ? TK_ID : TK_NUM;
+	}
+}
+
+static void generate_expr(int depth)
+{
+	generate_atom(depth);
+
+	while (rand() % 2) {
+		tks[token_count++] = TK_PLUS;
+		generate_atom(depth);
+	}
+}
+
+static void generate_program(void)
+{
+	while (token_count < MIN_TOKENS) {
+		if (rand() % 2) {
+			tks[token_count++] = TK_ID;
+			tks[token_count++] = TK_ASSIGN;
+		}
+
+		generate_expr(3);
+		tks[token_count++] = TK_SEMI;
+	}
+
+	tks[token_count++] = TK_END;
+}
+
+/* Returns the first operand at or after the position, which stays valid as
+ * either a name or a number. */
+static size_t operand_at(size_t position)
+{
+	while ((tks[position] != TK_ID && tks[position] != TK_NUM) ||
+	       tks[position + 1] == TK_ASSIGN)
+		position++;
+
+	return position;
+}
+
+/* Parses the edited program from scratch. */
+static uint64_t reparse(struct rdesc *p)
+{
+	size_t consumed;
+
+	uint64_t start_ns = bench_now_ns();
+
+	unwrap(rdesc_start(p, NT_PROGRAM));
+	rdesc_assert(rdesc_pump_many(p, tks, NULL, token_count, &consumed) ==
+		     RDESC_READY, "could not match grammar");
+
+	uint64_t elapsed = bench_now_ns() - start_ns;
+
+	rdesc_reset(p);
+
+	return elapsed;
+}
+
+/* Replaces the edited token in the tape of the parser, and matches it. */
+static uint64_t edit(struct rdesc *p, size_t position)
+{
+	uint64_t start_ns = bench_now_ns();
+
+	unwrap(rdesc_reparse(p, NT_PROGRAM, position, 1, &tks[position], NULL,
+			     1));
+	rdesc_assert(rdesc_resume(p) == RDESC_READY,
+		     "could not match grammar");
+
+	return bench_now_ns() - start_ns;
+}
+
+
+int main(void)
+{
+	struct rdesc_grammar grammar;
+	struct rdesc plain, incremental;
+	size_t consumed;
+
+	srand(0);
+	generate_program();
+
+	unwrap(rdesc_grammar_init(&grammar,
+				  PROGRAM_NT_COUNT, PROGRAM_NT_VARIANT_COUNT,
+				  PROGRAM_NT_BODY_LENGTH,
+				  (struct rdesc_grammar_symbol *) program));
+
+	unwrap(rdesc_init(&plain, &grammar, 0, NULL));
+	unwrap(rdesc_init(&incremental, &grammar, 0, NULL));
+	unwrap(rdesc_memoize(&incremental, MEMORY_LIMIT));
+
+	unwrap(rdesc_start(&incremental, NT_PROGRAM));
+	rdesc_assert(rdesc_pump_many(&incremental, tks, NULL, token_count,
+				     &consumed) == RDESC_READY,
+		     "could not match grammar");
+
+	printf("%zu tokens\n", token_count);
+	printf("%8s %16s %16s\n", "edit at", "reparse (us)", "edit (us)");
+
+	for (int at = 0; at < 3; at++) {
+		size_t position = operand_at(at * (token_count - 16) / 2);
+		uint64_t best_reparse = UINT64_MAX, best_edit = UINT64_MAX;
+
+		/* Best of rounds, every round swaps a name and a number. */
+		for (int r = 0; r < ROUNDS; r++) {
+			tks[position] = tks[position] == TK_ID ? TK_NUM : TK_ID;
+
+			uint64_t t = reparse(&plain);
+
+			if (t < best_reparse)
+				best_reparse = t;
+
+			t = edit(&incremental, position);
+
+			if (t < best_edit)
+				best_edit = t;
+		}
+
+		printf("%8zu %16.1f %16.1f\n", position, best_reparse / 1e3,
+		       best_edit / 1e3);
+	}
+
+	rdesc_destroy(&plain);
+	rdesc_destroy(&incremental);
+	rdesc_grammar_destroy(&grammar);
+}
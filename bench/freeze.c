@@ -0,0 +1,215 @@
+/* Compare an analysis pass reading only ids and child ranges over detached
+ * CSTs of a bc stream, walking the CST nodes, walking frozen CSTs, and
+ * scanning the ids of frozen CSTs. */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "../include/cst_macros.h"
+#include "../include/freeze.h"
+#include "../include/grammar.h"
+#include "../include/rdesc.h"
+#include "../include/stack.h"
+#include "../src/common.h"
+
+#include "../examples/grammar/bc.h"
+#include "../tests/lib/bc_fuzzer.c"
+
+#include "lib/bench.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+#define STREAM_LENGTH (1 << 20)
+#define MAX_TOKENS 256
+#define MAX_STATEMENTS (STREAM_LENGTH / 2)
+#define ROUNDS 8
+
+/* Histogram of node ids, tokens after nonterminals. */
+#define HISTOGRAM_SIZE (BC_NT_COUNT + BC_TK_COUNT)
+
+
+static uint16_t tks[STREAM_LENGTH];
+static size_t token_count;
+
+static struct rdesc_cst csts[MAX_STATEMENTS];
+static struct rdesc_frozen_cst frozen[MAX_STATEMENTS];
+static size_t cst_count;
+
+static size_t histogram[HISTOGRAM_SIZE];
+
+
+static void generate_stream(void)
+{
+	while (token_count + MAX_TOKENS <= STREAM_LENGTH) {
+		struct bc_grammar_generator g = BC_DEFAULT_GENERATOR;
+		size_t len = 0;
+		uint16_t tk;
+
+		while ((tk = bc_fuzzer_next_tk(&g)) != TK_ENDSYM &&
+		       len < MAX_TOKENS - 1) {
+			g.group_start_p *= 0.9;
+
+			tks[token_count + len++] = tk;
+		}
+
+		/* Drop statements cut at the length limit. */
+		if (tk != TK_ENDSYM)
+			continue;
+
+		tks[token_count + len++] = TK_ENDSYM;
+
+		token_count += len;
+	}
+}
+
+static void consume(struct rdesc *p, struct rdesc_node *root, void *ctx)
+{
+	(void) root;
+	(void) ctx;
+
+	unwrap(rdesc_take_cst(p, &csts[cst_count]));
+	unwrap(rdesc_cst_freeze(&csts[cst_count], &frozen[cst_count]));
+
+	cst_count++;
+}
+
+static void count_cst(const struct rdesc_cst *cst, struct rdesc_node *n)
+{
+	if (rtype(n) == RDESC_TOKEN) {
+		histogram[BC_NT_COUNT + rid(n)]++;
+
+		return;
+	}
+
+	histogram[rid(n)]++;
+
+	for (uint16_t i = 0; i < rchild_count(n); i++)
+		count_cst(cst, rcst_child(cst, n, i));
+}
+
+static void count_frozen(const struct rdesc_frozen_cst *f, uint32_t n)
+{
+	if (rfrozen_type(f, n) == RDESC_TOKEN) {
+		histogram[BC_NT_COUNT + rfrozen_id(f, n)]++;
+
+		return;
+	}
+
+	histogram[rfrozen_id(f, n)]++;
+
+	for (uint16_t i = 0; i < rfrozen_child_count(f, n); i++)
+		count_frozen(f, rfrozen_child(f, n, i));
+}
+
+static void scan_frozen(const struct rdesc_frozen_cst *f)
+{
+	for (size_t n = 0; n < rfrozen_node_count(f); n++)
+		histogram[rfrozen_type(f, n) == RDESC_TOKEN ?
+			  BC_NT_COUNT + rfrozen_id(f, n) : rfrozen_id(f, n)]++;
+}
+
+enum mode {
+	MODE_CST, MODE_FROZEN, MODE_SCAN,
+	MODE_COUNT,
+};
+
+static const char *const mode_names[MODE_COUNT] = {
+	"cst", "frozen", "scan",
+};
+
+/* Counts node ids of every tree and returns elapsed nanoseconds. */
+static uint64_t analyze(enum mode mode)
+{
+	for (size_t i = 0; i < HISTOGRAM_SIZE; i++)
+		histogram[i] = 0;
+
+	uint64_t start_ns = bench_now_ns();
+
+	for (size_t i = 0; i < cst_count; i++) {
+		switch (mode) {
+		case MODE_CST:
+			count_cst(&csts[i], rdesc_cst_root(&csts[i]));
+			break;
+
+		case MODE_FROZEN:
+			count_frozen(&frozen[i], 0);
+			break;
+
+		case MODE_SCAN:
+			scan_frozen(&frozen[i]);
+			break;
+
+		default: unreachable();
+		}
+	}
+
+	uint64_t elapsed = bench_now_ns() - start_ns;
+
+	/* Every statement ends with TK_ENDSYM. */
+	rdesc_assert(histogram[BC_NT_COUNT + TK_ENDSYM] == cst_count,
+		     "histogram mismatch");
+
+	return elapsed;
+}
+
+
+int main(void)
+{
+	struct rdesc_grammar grammar;
+	struct rdesc p;
+	size_t consumed, node_count = 0, cst_bytes = 0, frozen_bytes = 0;
+	uint64_t best[MODE_COUNT];
+
+	srand(0);
+
+	generate_stream();
+
+	unwrap(rdesc_grammar_init(&grammar,
+				  BC_NT_COUNT, BC_NT_VARIANT_COUNT, BC_NT_BODY_LENGTH,
+				  (struct rdesc_grammar_symbol *) bc));
+	unwrap(rdesc_init(&p, &grammar, 0, NULL));
+
+	unwrap(rdesc_stream(&p, NT_STMT, consume, NULL));
+	rdesc_assert(rdesc_pump_many(&p, tks, NULL, token_count,
+				     &consumed) == RDESC_CONTINUE,
+		     "could not match grammar");
+
+	for (size_t i = 0; i < cst_count; i++) {
+		node_count += rfrozen_node_count(&frozen[i]);
+		cst_bytes += rdesc_stack_len(csts[i].nodes) * sizeof_node(p);
+		frozen_bytes += rfrozen_node_count(&frozen[i]) *
+			(2 * sizeof(uint32_t) + 3 * sizeof(uint16_t));
+	}
+
+	for (int m = 0; m < MODE_COUNT; m++)
+		best[m] = UINT64_MAX;
+
+	/* Best of rounds, alternating to even out frequency scaling. */
+	for (int r = 0; r < ROUNDS; r++) {
+		for (int m = 0; m < MODE_COUNT; m++) {
+			uint64_t t = analyze(m);
+
+			if (t < best[m])
+				best[m] = t;
+		}
+	}
+
+	printf("%zu statements, %zu nodes, cst %zu KiB, frozen %zu KiB\n",
+	       cst_count, node_count, cst_bytes / 1024, frozen_bytes / 1024);
+	printf("%12s %12s %12s\n", "", "ms", "ns/node");
+
+	for (int m = 0; m < MODE_COUNT; m++)
+		printf("%12s %12.2f %12.2f\n", mode_names[m], best[m] / 1e6,
+		       (double) best[m] / node_count);
+
+	for (size_t i = 0; i < cst_count; i++) {
+		rdesc_frozen_destroy(&frozen[i]);
+		rdesc_cst_destroy(&csts[i]);
+	}
+
+	rdesc_destroy(&p);
+	rdesc_grammar_destroy(&grammar);
+}
@@ -0,0 +1,172 @@
+/* Compare walking a balanced tree of over a million CST nodes recursively
+ * with walking it using iterators in every order. */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "../include/cst_macros.h"
+#include "../include/grammar.h"
+#include "../include/iter.h"
+#include "../include/rdesc.h"
+#include "../include/rule_macros.h"
+#include "../src/common.h"
+
+#include "lib/bench.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+
+#define TREE_NT_COUNT 1
+#define TREE_NT_VARIANT_COUNT 3
+#define TREE_NT_BODY_LENGTH 5
+
+/* Every level doubles the number of leaves. */
+#define DEPTH 18
+#define MAX_TOKENS ((3 << DEPTH) + 1)
+#define ROUNDS 8
+
+enum tree_tk {
+	TK_TREE_NOTOKEN,
+	TK_TREE_LPAREN, TK_TREE_RPAREN, TK_TREE_NUM, TK_TREE_END,
+};
+
+enum tree_nt {
+	NT_TREE,
+};
+
+static const struct rdesc_grammar_symbol
+tree[TREE_NT_COUNT][TREE_NT_VARIANT_COUNT][TREE_NT_BODY_LENGTH] = {
+	/* <tree> ::= */ r(
+		TK(TREE_LPAREN), NT(TREE), NT(TREE), TK(TREE_RPAREN)
+	alt	TK(TREE_NUM)
+	),
+};
+
+
+static uint16_t tks[MAX_TOKENS];
+static size_t token_count;
+
+/* Sum of node ids, so that no walk can be optimized out. */
+static size_t checksum;
+
+
+static void generate_tree(int depth)
+{
+	if (depth == 0) {
+		tks[token_count++] = TK_TREE_NUM;
+
+		return;
+	}
+
+	tks[token_count++] = TK_TREE_LPAREN;
+	generate_tree(depth - 1);
+	generate_tree(depth - 1);
+	tks[token_count++] = TK_TREE_RPAREN;
+}
+
+static void walk(struct rdesc *p, struct rdesc_node *n)
+{
+	checksum += rid(n);
+
+	if (rtype(n) == RDESC_NONTERMINAL)
+		for (uint16_t i = 0; i < rchild_count(n); i++)
+			walk(p, rchild(p, n, i));
+}
+
+enum mode {
+	MODE_RECURSIVE, MODE_PREORDER, MODE_POSTORDER, MODE_LEAVES,
+	MODE_COUNT,
+};
+
+static const char *const mode_names[MODE_COUNT] = {
+	"recursive", "preorder", "postorder", "leaves",
+};
+
+/* Walks the CST and returns elapsed nanoseconds. */
+static uint64_t traverse(struct rdesc *p, enum mode mode)
+{
+	struct rdesc_iter it;
+	struct rdesc_node *n;
+
+	checksum = 0;
+
+	uint64_t start_ns = bench_now_ns();
+
+	switch (mode) {
+	case MODE_RECURSIVE:
+		walk(p, rdesc_root(p));
+		break;
+
+	case MODE_PREORDER:
+	case MODE_POSTORDER:
+	case MODE_LEAVES:
+		rdesc_iter_init(&it, p, NULL, mode - MODE_PREORDER);
+
+		while ((n = rdesc_iter_next(&it)) != NULL)
+			checksum += rid(n);
+		break;
+
+	default: unreachable();
+	}
+
+	return bench_now_ns() - start_ns;
+}
+
+
+int main(void)
+{
+	struct rdesc_grammar grammar;
+	struct rdesc p;
+	struct rdesc_iter it;
+	size_t consumed, node_count = 0, visited[MODE_COUNT];
+	uint64_t best[MODE_COUNT];
+
+	generate_tree(DEPTH);
+	tks[token_count++] = TK_TREE_END;
+
+	unwrap(rdesc_grammar_init(&grammar,
+				  TREE_NT_COUNT, TREE_NT_VARIANT_COUNT,
+				  TREE_NT_BODY_LENGTH,
+				  (struct rdesc_grammar_symbol *) tree));
+	unwrap(rdesc_init(&p, &grammar, 0, NULL));
+
+	unwrap(rdesc_start(&p, NT_TREE));
+	rdesc_assert(rdesc_pump_many(&p, tks, NULL, token_count,
+				     &consumed) == RDESC_READY,
+		     "could not match grammar");
+
+	rdesc_iter_init(&it, &p, NULL, RDESC_PREORDER);
+	while (rdesc_iter_next(&it) != NULL)
+		node_count++;
+
+	for (int m = 0; m < MODE_COUNT; m++)
+		best[m] = UINT64_MAX;
+
+	/* Best of rounds, alternating to even out frequency scaling. */
+	for (int r = 0; r < ROUNDS; r++) {
+		for (int m = 0; m < MODE_COUNT; m++) {
+			uint64_t t = traverse(&p, m);
+
+			if (t < best[m])
+				best[m] = t;
+
+			visited[m] = checksum;
+		}
+	}
+
+	/* Pre-order and post-order visit the same nodes. */
+	rdesc_assert(visited[MODE_RECURSIVE] == visited[MODE_PREORDER] &&
+		     visited[MODE_PREORDER] == visited[MODE_POSTORDER],
+		     "traversal mismatch");
+
+	printf("depth %d, %zu nodes\n", DEPTH, node_count);
+	printf("%12s %12s %12s\n", "", "ms", "ns/node");
+
+	for (int m = 0; m < MODE_COUNT; m++)
+		printf("%12s %12.2f %12.2f\n", mode_names[m], best[m] / 1e6,
+		       (double) best[m] / node_count);
+
+	rdesc_destroy(&p);
+	rdesc_grammar_destroy(&grammar);
+}
@@ -0,0 +1,278 @@
+/* Compare matching left-associative expressions with a right-recursive
+ * rewrite of the grammar, whose CSTs are rotated by rdesc_flip_left, with the
+ * directly left-recursive grammar matched natively. The CST nodes reachable
+ * from the root, and the nodes on the CST stack, including the continuation
+ * and epsilon nodes the rotation orphans, are reported per token. */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "../include/cst_macros.h"
+#include "../include/grammar.h"
+#include "../include/rdesc.h"
+#include "../include/rule_macros.h"
+#include "../include/stack.h"
+#include "../include/util.h"
+#include "../src/common.h"
+
+#include "lib/bench.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+#define EXPR_NT_VARIANT_COUNT 3
+#define EXPR_NT_BODY_LENGTH 4
+
+#define STREAM_LENGTH (1 << 18)
+#define MAX_TOKENS 256
+#define ROUNDS 8
+
+enum expr_tk {
+	TK_NOTOKEN,
+	TK_NUM, TK_PLUS, TK_MINUS, TK_STAR, TK_LPAREN, TK_RPAREN, TK_SEMI,
+};
+
+enum native_nt {
+	NT_STMT, NT_EXPR, NT_TERM, NT_ADDOP, NT_FACTOR,
+	NATIVE_NT_COUNT,
+};
+
+enum rewritten_nt {
+	NT_R_STMT, NT_R_EXPR, NT_R_EXPR_REST, NT_R_TERM, NT_R_TERM_REST,
+	NT_R_ADDOP, NT_R_FACTOR,
+	REWRITTEN_NT_COUNT,
+};
+
+static const struct rdesc_grammar_symbol
+native[NATIVE_NT_COUNT][EXPR_NT_VARIANT_COUNT][EXPR_NT_BODY_LENGTH] = {
+	/* <stmt> ::= */ r(
+		NT(EXPR), TK(SEMI)
+	),
+	/* <expr> ::= */ r(
+		NT(EXPR), NT(ADDOP), NT(TERM)
+	alt	NT(TERM)
+	),
+	/* <term> ::= */ r(
+		NT(TERM), TK(STAR), NT(FACTOR)
+	alt	NT(FACTOR)
+	),
+	/* <addop> ::= */ r(
+		TK(PLUS)
+	alt	TK(MINUS)
+	),
+	/* <factor> ::= */ r(
+		TK(NUM)
+	alt	TK(LPAREN), NT(EXPR), TK(RPAREN)
+	),
+};
+
+static const struct rdesc_grammar_symbol
+rewritten[REWRITTEN_NT_COUNT][EXPR_NT_VARIANT_COUNT][EXPR_NT_BODY_LENGTH] = {
+	/* <stmt> ::= */ r(
+		NT(R_EXPR), TK(SEMI)
+	),
+	/* <expr>, <expr_rest> ::= */
+	rrr(R_EXPR, (NT(R_TERM)), (NT(R_ADDOP), NT(R_TERM))),
+	/* <term>, <term_rest> ::= */
+	rrr(R_TERM, (NT(R_FACTOR)), (TK(STAR), NT(R_FACTOR))),
+	/* <addop> ::= */ r(
+		TK(PLUS)
+	alt	TK(MINUS)
+	),
+	/* <factor> ::= */ r(
+		TK(NUM)
+	alt	TK(LPAREN), NT(R_EXPR), TK(RPAREN)
+	),
+};
+
+
+static uint16_t tks[STREAM_LENGTH];
+static size_t token_count, statement_count;
+
+static size_t reachable_count, stack_count, consumed_count;
+
+
+static void generate_expr(int depth);
+
+static void generate_factor(int depth)
+{
+	if (depth > 0 && rand() % 8 == 0) {
+		tks[token_count++] = TK_LPAREN;
+		generate_expr(depth - 1);
+		tks[token_count++] = TK_RPAREN;
+	} else {
+		tks[token_count++] = TK_NUM;
+	}
+}
+
+static void generate_term(int depth)
+{
+	generate_factor(depth);
+
+	while (rand() % 4 == 0) {
+		tks[token_count++] = TK_STAR;
+		generate_factor(depth);
+	}
+}
+
+/* Expressions are long lists of terms, which are the spines rotated. */
+static void generate_expr(int depth)
+{
+	generate_term(depth);
+
+	while (rand() % 8 != 0) {
+		tks[token_count++] = rand() % 2 ? TK_PLUS : TK_MINUS;
+		generate_term(depth);
+	}
+}
+
+static void generate_stream(void)
+{
+	while (token_count + MAX_TOKENS <= STREAM_LENGTH) {
+		size_t start = token_count;
+
+		generate_expr(2);
+
+		/* Drop statements exceeding the length limit. */
+		if (token_count - start >= MAX_TOKENS) {
+			token_count = start;
+
+			continue;
+		}
+
+		tks[token_count++] = TK_SEMI;
+		statement_count++;
+	}
+}
+
+static size_t count_nodes(struct rdesc *p, struct rdesc_node *n)
+{
+	size_t count = 1;
+
+	if (rtype(n) == RDESC_NONTERMINAL)
+		for (uint16_t i = 0; i < rchild_count(n); i++)
+			count += count_nodes(p, rchild(p, n, i));
+
+	return count;
+}
+
+/* Rotates the nested lists first, as the rotation renames continuation nodes
+ * of a list to its head. */
+static void flip_all(struct rdesc *p, struct rdesc_node *n)
+{
+	for (uint16_t i = 0; i < rchild_count(n); i++) {
+		struct rdesc_node *child = rchild(p, n, i);
+
+		if (rtype(child) == RDESC_TOKEN)
+			continue;
+
+		flip_all(p, child);
+
+		if (rid(child) == NT_R_EXPR || rid(child) == NT_R_TERM)
+			rdesc_flip_left(p, n, i);
+	}
+}
+
+static void consume(struct rdesc *p, struct rdesc_node *root, void *ctx)
+{
+	bool flip = *(bool *) ctx;
+
+	if (flip)
+		flip_all(p, root);
+
+	consumed_count++;
+}
+
+static void count_consume(struct rdesc *p, struct rdesc_node *root,
+			  void *ctx)
+{
+	consume(p, root, ctx);
+
+	reachable_count += count_nodes(p, root);
+	stack_count += rdesc_stack_len(p->cst_stack);
+}
+
+/* Streams the statements and returns elapsed nanoseconds. */
+static uint64_t parse(struct rdesc *p, bool flip,
+		      void (*consumer)(struct rdesc *, struct rdesc_node *,
+				       void *))
+{
+	uint64_t start_ns = bench_now_ns();
+	size_t consumed;
+
+	consumed_count = 0;
+
+	unwrap(rdesc_stream(p, NT_STMT, consumer, &flip));
+	rdesc_assert(rdesc_pump_many(p, tks, NULL, token_count, &consumed) ==
+		     RDESC_CONTINUE, "stream is interrupted");
+
+	uint64_t elapsed = bench_now_ns() - start_ns;
+
+	rdesc_assert(consumed_count == statement_count,
+		     "statement count mismatch");
+	rdesc_reset(p);
+
+	return elapsed;
+}
+
+
+int main(void)
+{
+	struct rdesc_grammar native_grammar, rewritten_grammar;
+	struct rdesc rotated, grown;
+	uint64_t best_rotated = UINT64_MAX, best_grown = UINT64_MAX;
+
+	srand(0);
+	generate_stream();
+
+	unwrap(rdesc_grammar_init(&native_grammar, NATIVE_NT_COUNT,
+				  EXPR_NT_VARIANT_COUNT, EXPR_NT_BODY_LENGTH,
+				  (struct rdesc_grammar_symbol *) native));
+	unwrap(rdesc_grammar_init(&rewritten_grammar, REWRITTEN_NT_COUNT,
+				  EXPR_NT_VARIANT_COUNT, EXPR_NT_BODY_LENGTH,
+				  (struct rdesc_grammar_symbol *) rewritten));
+
+	unwrap(rdesc_init(&rotated, &rewritten_grammar, 0, NULL));
+	unwrap(rdesc_init(&grown, &native_grammar, 0, NULL));
+
+	printf("%zu statements, %zu tokens\n", statement_count, token_count);
+	printf("%-24s %12s %16s %16s\n", "", "ns/token", "reachable/token",
+	       "stack/token");
+
+	/* Best of rounds, alternating to even out frequency scaling. */
+	for (int r = 0; r < ROUNDS; r++) {
+		uint64_t t = parse(&rotated, true, consume);
+
+		if (t < best_rotated)
+			best_rotated = t;
+
+		t = parse(&grown, false, consume);
+
+		if (t < best_grown)
+			best_grown = t;
+	}
+
+	reachable_count = stack_count = 0;
+	parse(&rotated, true, count_consume);
+
+	printf("%-24s %12.1f %16.2f %16.2f\n", "rrr + rdesc_flip_left",
+	       (double) best_rotated / token_count,
+	       (double) reachable_count / token_count,
+	       (double) stack_count / token_count);
+
+	reachable_count = stack_count = 0;
+	parse(&grown, false, count_consume);
+
+	printf("%-24s %12.1f %16.2f %16.2f\n", "left recursion",
+	       (double) best_grown / token_count,
+	       (double) reachable_count / token_count,
+	       (double) stack_count / token_count);
+
+	rdesc_destroy(&rotated);
+	rdesc_destroy(&grown);
+	rdesc_grammar_destroy(&native_grammar);
+	rdesc_grammar_destroy(&rewritten_grammar);
+}
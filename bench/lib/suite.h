@@ -0,0 +1,45 @@
+/**
+ * @file suite.h
+ * @brief Grammars and inputs of the benchmark suite.
+ *
+ * Grammars are defined in separate translation units, since their token and
+ * nonterminal enumerations share names.
+ */
+
+#ifndef SUITE_H
+#define SUITE_H
+
+#include "../../include/grammar.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/** @brief A grammar and a generator of deterministic input for it. */
+struct suite_grammar {
+	/** @brief Name of the grammar in the reports. */
+	const char *name;
+
+	/** @brief Initializes the grammar, returns non-zero on failure. */
+	int (*init)(struct rdesc_grammar *grammar);
+
+	/** @brief Symbol each statement of the input matches. */
+	uint16_t start_symbol;
+
+	/**
+	 * @brief Fills `tks` with at most `max` tokens of whole statements, the
+	 * same on every call after `srand` with the same seed. Returns the
+	 * number of tokens and stores the number of statements.
+	 */
+	size_t (*generate)(uint16_t *tks, size_t max, size_t *statement_count);
+};
+
+
+/** @brief Arithmetic expressions of `examples/grammar/bc.h`. */
+extern const struct suite_grammar suite_bc;
+
+/** @brief Statements of `examples/grammar/boolean_algebra.h`. */
+extern const struct suite_grammar suite_balg;
+
+
+#endif
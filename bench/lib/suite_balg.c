@@ -0,0 +1,104 @@
+/* Boolean algebra statements picked from templates, with occasional blocks
+ * of nested statements. */
+
+#include "../../include/grammar.h"
+
+#include "../../examples/grammar/boolean_algebra.h"
+
+#include "suite.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+
+#define BLOCK_LENGTH 16
+
+#define TEMPLATE_COUNT (sizeof(templates) / sizeof(templates[0]))
+
+/* x = a | !b; */
+static const uint16_t asgn[] = {
+	TK_IDENT, TK_EQ, TK_IDENT, TK_PIPE, TK_EXCL, TK_IDENT, TK_SEMI, 0,
+};
+
+/* x, y = (a & b) | 1, c; */
+static const uint16_t multi_asgn[] = {
+	TK_IDENT, TK_COMMA, TK_IDENT, TK_EQ,
+	TK_LPAREN, TK_IDENT, TK_AMP, TK_IDENT, TK_RPAREN, TK_PIPE, TK_TRUE,
+	TK_COMMA, TK_IDENT, TK_SEMI, 0,
+};
+
+/* f(a, (b = 1)); */
+static const uint16_t call[] = {
+	TK_IDENT, TK_LPAREN, TK_IDENT, TK_COMMA,
+	TK_LPAREN, TK_IDENT, TK_EQ, TK_TRUE, TK_RPAREN, TK_RPAREN, TK_SEMI, 0,
+};
+
+static const uint16_t *const templates[] = { asgn, multi_asgn, call };
+
+
+static int init(struct rdesc_grammar *grammar)
+{
+	return rdesc_grammar_init(grammar,
+				  BALG_NT_COUNT, BALG_NT_VARIANT_COUNT,
+				  BALG_NT_BODY_LENGTH,
+				  (struct rdesc_grammar_symbol *) balg);
+}
+
+static bool push(uint16_t *tks, size_t max, size_t *token_count,
+		 const uint16_t *t)
+{
+	size_t len = 0;
+
+	while (t[len] != 0)
+		len++;
+
+	if (*token_count + len > max)
+		return false;
+
+	for (size_t i = 0; i < len; i++)
+		tks[(*token_count)++] = t[i];
+
+	return true;
+}
+
+static size_t generate(uint16_t *tks, size_t max, size_t *statement_count)
+{
+	static const uint16_t lcurly[] = { TK_LCURLY, 0 };
+	static const uint16_t rcurly[] = { TK_RCURLY, 0 };
+	size_t token_count = 0;
+
+	*statement_count = 0;
+
+	while (true) {
+		size_t start = token_count;
+		bool pushed;
+
+		if (rand() % 8 != 0) {
+			pushed = push(tks, max, &token_count,
+				      templates[rand() % TEMPLATE_COUNT]);
+		} else {
+			pushed = push(tks, max, &token_count, lcurly);
+
+			for (int i = 0; i < BLOCK_LENGTH && pushed; i++)
+				pushed = push(tks, max, &token_count,
+					      templates[rand() % TEMPLATE_COUNT]);
+
+			pushed = pushed && push(tks, max, &token_count, rcurly);
+		}
+
+		if (!pushed)
+			return start;
+
+		(*statement_count)++;
+	}
+}
+
+
+const struct suite_grammar suite_balg = {
+	.name = "balg",
+	.init = init,
+	.start_symbol = NT_STMT,
+	.generate = generate,
+};
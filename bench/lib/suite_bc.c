@@ -0,0 +1,62 @@
+/* Random bc statements from the fuzzer, which backtrack heavily. */
+
+#include "../../include/grammar.h"
+
+#include "../../examples/grammar/bc.h"
+#include "../../tests/lib/bc_fuzzer.c"
+
+#include "suite.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+#define MAX_STATEMENT_TOKENS 256
+
+
+static int init(struct rdesc_grammar *grammar)
+{
+	return rdesc_grammar_init(grammar,
+				  BC_NT_COUNT, BC_NT_VARIANT_COUNT,
+				  BC_NT_BODY_LENGTH,
+				  (struct rdesc_grammar_symbol *) bc);
+}
+
+static size_t generate(uint16_t *tks, size_t max, size_t *statement_count)
+{
+	size_t token_count = 0;
+
+	*statement_count = 0;
+
+	while (token_count + MAX_STATEMENT_TOKENS <= max) {
+		struct bc_grammar_generator g = BC_DEFAULT_GENERATOR;
+		size_t len = 0;
+		uint16_t tk;
+
+		while ((tk = bc_fuzzer_next_tk(&g)) != TK_ENDSYM &&
+		       len < MAX_STATEMENT_TOKENS - 1) {
+			g.group_start_p *= 0.9;
+
+			tks[token_count + len++] = tk;
+		}
+
+		/* Drop statements cut at the length limit. */
+		if (tk != TK_ENDSYM)
+			continue;
+
+		tks[token_count + len++] = TK_ENDSYM;
+
+		token_count += len;
+		(*statement_count)++;
+	}
+
+	return token_count;
+}
+
+
+const struct suite_grammar suite_bc = {
+	.name = "bc",
+	.init = init,
+	.start_symbol = NT_STMT,
+	.generate = generate,
+};
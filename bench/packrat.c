@@ -0,0 +1,115 @@
+/* Compare the plain backtracking pump with packrat memoization on a grammar
+ * whose alternatives share prefixes. Each alternative of <expr> re-derives
+ * the same <atom> at the same position, so nested groups are exponential
+ * without memoization. */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "../include/grammar.h"
+#include "../include/rdesc.h"
+#include "../include/rule_macros.h"
+#include "../src/common.h"
+
+#include "lib/bench.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+
+#define PATH_NT_COUNT 3
+#define PATH_NT_VARIANT_COUNT 4
+#define PATH_NT_BODY_LENGTH 4
+
+/* Depth after which the plain pump is no longer measured. */
+#define PLAIN_MAX_DEPTH 13
+#define MAX_DEPTH 256
+
+enum path_tk {
+	TK_NOTOKEN,
+	TK_NUM, TK_PLUS, TK_MINUS,
+	TK_LPAREN, TK_RPAREN, TK_SEMI,
+};
+
+enum path_nt {
+	NT_STMT, NT_EXPR, NT_ATOM,
+};
+
+static const struct rdesc_grammar_symbol
+path[PATH_NT_COUNT][PATH_NT_VARIANT_COUNT][PATH_NT_BODY_LENGTH] = {
+	/* <stmt> ::= */ r(
+		NT(EXPR), TK(SEMI)
+	),
+	/* <expr> ::= */ r(
+		NT(ATOM), TK(PLUS), NT(EXPR)
+	alt	NT(ATOM), TK(MINUS), NT(EXPR)
+	alt	NT(ATOM)
+	),
+	/* <atom> ::= */ r(
+		TK(LPAREN), NT(EXPR), TK(RPAREN)
+	alt	TK(NUM)
+	),
+};
+
+
+/* Parses "((...(1)...));" and returns elapsed nanoseconds. */
+static uint64_t parse_nested(struct rdesc *p, size_t depth)
+{
+	uint64_t start = bench_now_ns();
+	enum rdesc_result res;
+
+	unwrap(rdesc_start(p, NT_STMT));
+
+	for (size_t i = 0; i < depth; i++)
+		rdesc_assert(rdesc_pump(p, TK_LPAREN, NULL) == RDESC_CONTINUE,);
+
+	rdesc_assert(rdesc_pump(p, TK_NUM, NULL) == RDESC_CONTINUE,);
+
+	for (size_t i = 0; i < depth; i++)
+		rdesc_assert(rdesc_pump(p, TK_RPAREN, NULL) == RDESC_CONTINUE,);
+
+	res = rdesc_pump(p, TK_SEMI, NULL);
+	rdesc_assert(res == RDESC_READY, "could not match grammar");
+
+	uint64_t elapsed = bench_now_ns() - start;
+
+	rdesc_reset(p);
+
+	return elapsed;
+}
+
+
+int main(void)
+{
+	struct rdesc_grammar grammar;
+	struct rdesc plain, memoized;
+
+	unwrap(rdesc_grammar_init(&grammar,
+				  PATH_NT_COUNT, PATH_NT_VARIANT_COUNT,
+				  PATH_NT_BODY_LENGTH,
+				  (struct rdesc_grammar_symbol *) path));
+
+	unwrap(rdesc_init(&plain, &grammar, 0, NULL));
+	unwrap(rdesc_init(&memoized, &grammar, 0, NULL));
+	unwrap(rdesc_memoize(&memoized, 16 * 1024 * 1024));
+
+	printf("%8s %16s %16s\n", "depth", "plain (us)", "packrat (us)");
+
+	for (size_t depth = 1; depth <= MAX_DEPTH; depth *= 2) {
+		for (size_t d = depth; d < depth * 2 && d <= MAX_DEPTH;
+		     d += (depth + 3) / 4) {
+			printf("%8zu ", d);
+
+			if (d <= PLAIN_MAX_DEPTH)
+				printf("%16.1f ", parse_nested(&plain, d) / 1e3);
+			else
+				printf("%16s ", "-");
+
+			printf("%16.1f\n", parse_nested(&memoized, d) / 1e3);
+		}
+	}
+
+	rdesc_destroy(&plain);
+	rdesc_destroy(&memoized);
+	rdesc_grammar_destroy(&grammar);
+}
@@ -0,0 +1,158 @@
+/* Parse one token array of random bc statements with rdesc_parse_parallel,
+ * from one thread up to the number of online processors, and with a single
+ * parser matching the statements one after another. Statements end with
+ * TK_ENDSYM, which is the separator of the split. */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "../include/grammar.h"
+#include "../include/parallel.h"
+#include "../include/pool.h"
+#include "../include/rdesc.h"
+#include "../src/common.h"
+
+#include "../examples/grammar/bc.h"
+#include "../tests/lib/bc_fuzzer.c"
+
+#include "lib/bench.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+
+#define STATEMENT_COUNT 16384
+#define MAX_STATEMENT_TOKENS 256
+#define MAX_TOKENS (STATEMENT_COUNT * MAX_STATEMENT_TOKENS)
+#define ROUNDS 3
+
+#define MAX_THREADS 64
+
+
+static uint16_t tks[MAX_TOKENS];
+static size_t token_count;
+
+static const uint16_t separators[] = { TK_ENDSYM };
+
+
+static void generate_input(void)
+{
+	for (size_t s = 0; s < STATEMENT_COUNT; s++) {
+		struct bc_grammar_generator g = BC_DEFAULT_GENERATOR;
+		size_t len = 0;
+		uint16_t tk;
+
+		while ((tk = bc_fuzzer_next_tk(&g)) != TK_ENDSYM &&
+		       len < MAX_STATEMENT_TOKENS - 1) {
+			g.group_start_p *= 0.9;
+
+			tks[token_count++] = tk;
+			len++;
+		}
+
+		tks[token_count++] = TK_ENDSYM;
+	}
+}
+
+/* Parses the statements one after another and returns elapsed
+ * nanoseconds. */
+static uint64_t parse_sequential(struct rdesc *p)
+{
+	uint64_t start_ns = bench_now_ns();
+	size_t position = 0, consumed;
+
+	while (position < token_count) {
+		unwrap(rdesc_start(p, NT_STMT));
+
+		rdesc_assert(rdesc_pump_many(p, &tks[position], NULL,
+					     token_count - position,
+					     &consumed) == RDESC_READY,
+			     "could not match grammar");
+
+		position += consumed;
+		rdesc_clear(p);
+	}
+
+	return bench_now_ns() - start_ns;
+}
+
+/* Parses the statements in parallel and returns elapsed nanoseconds. */
+static uint64_t parse_parallel(struct rdesc_pool *pool, size_t threads)
+{
+	struct rdesc_cst_list list;
+	uint64_t start_ns = bench_now_ns(), elapsed;
+
+	rdesc_assert(rdesc_parse_parallel(pool, NT_STMT, tks, NULL, token_count,
+					  separators, 1, threads, &list,
+					  NULL) == RDESC_READY,
+		     "could not match grammar");
+
+	elapsed = bench_now_ns() - start_ns;
+
+	rdesc_assert(list.count == STATEMENT_COUNT, "statements are lost");
+	rdesc_cst_list_destroy(&list);
+
+	return elapsed;
+}
+
+
+int main(void)
+{
+	struct rdesc_grammar grammar;
+	struct rdesc_pool pool;
+	struct rdesc p;
+	uint64_t sequential = UINT64_MAX;
+	long online = sysconf(_SC_NPROCESSORS_ONLN);
+	size_t max_threads = online > 0 ? (size_t) online : 1;
+
+	if (max_threads > MAX_THREADS)
+		max_threads = MAX_THREADS;
+
+	srand(0);
+	generate_input();
+
+	unwrap(rdesc_grammar_init(&grammar,
+				  BC_NT_COUNT, BC_NT_VARIANT_COUNT, BC_NT_BODY_LENGTH,
+				  (struct rdesc_grammar_symbol *) bc));
+	unwrap(rdesc_init(&p, &grammar, 0, NULL));
+	unwrap(rdesc_pool_init(&pool, max_threads, &grammar, 0, NULL, NULL));
+
+	for (int r = 0; r < ROUNDS; r++) {
+		uint64_t t = parse_sequential(&p);
+
+		if (t < sequential)
+			sequential = t;
+	}
+
+	printf("%zu statements, %zu tokens, %zu processors\n",
+	       (size_t) STATEMENT_COUNT, token_count, max_threads);
+	printf("%8s %12s %12s %12s\n", "threads", "ms", "Mtk/s", "speedup");
+	printf("%8s %12.2f %12.2f %12.2f\n", "seq", sequential / 1e6,
+	       token_count * 1e3 / sequential, 1.0);
+
+	for (size_t threads = 1;; threads *= 2) {
+		uint64_t best = UINT64_MAX;
+
+		if (threads > max_threads)
+			threads = max_threads;
+
+		for (int r = 0; r < ROUNDS; r++) {
+			uint64_t t = parse_parallel(&pool, threads);
+
+			if (t < best)
+				best = t;
+		}
+
+		printf("%8zu %12.2f %12.2f %12.2f\n", threads, best / 1e6,
+		       token_count * 1e3 / best, (double) sequential / best);
+
+		if (threads == max_threads)
+			break;
+	}
+
+	rdesc_pool_destroy(&pool);
+	rdesc_destroy(&p);
+	rdesc_grammar_destroy(&grammar);
+}
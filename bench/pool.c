@@ -0,0 +1,180 @@
+/* Parse random bc statements from a growing number of threads, up to the
+ * number of online processors, sharing one grammar. Each statement is a
+ * request: it is parsed either with a parser acquired from a pool, or with a
+ * parser initialized and destroyed for it. Throughput with the pool should
+ * scale with the threads, as acquire and release take no locks. */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "../include/grammar.h"
+#include "../include/pool.h"
+#include "../include/rdesc.h"
+#include "../src/common.h"
+
+#include "../examples/grammar/bc.h"
+#include "../tests/lib/bc_fuzzer.c"
+
+#include "lib/bench.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+
+#define STATEMENT_COUNT 4096
+#define MAX_TOKENS 256
+#define ROUNDS 3
+
+#define MAX_THREADS 256
+
+
+static uint16_t statements[STATEMENT_COUNT][MAX_TOKENS];
+static size_t total_tokens;
+
+static struct rdesc_grammar grammar;
+static struct rdesc_pool pool;
+
+struct worker {
+	pthread_t thread;
+	size_t offset, stride;
+	bool pooled;
+};
+
+
+static void generate_statements(void)
+{
+	for (size_t s = 0; s < STATEMENT_COUNT; s++) {
+		struct bc_grammar_generator g = BC_DEFAULT_GENERATOR;
+		size_t len = 0;
+		uint16_t tk;
+
+		while ((tk = bc_fuzzer_next_tk(&g)) != TK_ENDSYM &&
+		       len < MAX_TOKENS - 2) {
+			g.group_start_p *= 0.9;
+
+			statements[s][len++] = tk;
+		}
+
+		statements[s][len++] = TK_ENDSYM;
+		statements[s][len] = TK_NOTOKEN;
+
+		total_tokens += len;
+	}
+}
+
+static void parse(struct rdesc *p, size_t s)
+{
+	enum rdesc_result res = RDESC_CONTINUE;
+
+	unwrap(rdesc_start(p, NT_STMT));
+
+	for (const uint16_t *tk = statements[s]; *tk != TK_NOTOKEN; tk++)
+		res = rdesc_pump(p, *tk, NULL);
+
+	rdesc_assert(res == RDESC_READY, "could not match grammar");
+}
+
+static void *work(void *arg)
+{
+	struct worker *w = arg;
+
+	for (size_t s = w->offset; s < STATEMENT_COUNT; s += w->stride) {
+		struct rdesc *p, fresh;
+
+		if (w->pooled) {
+			while ((p = rdesc_pool_acquire(&pool)) == NULL)
+				;
+
+			parse(p, s);
+			rdesc_pool_release(&pool, p);
+		} else {
+			unwrap(rdesc_init(&fresh, &grammar, 0, NULL));
+
+			parse(&fresh, s);
+			rdesc_destroy(&fresh);
+		}
+	}
+
+	return NULL;
+}
+
+/* Parses all statements with the threads and returns elapsed nanoseconds. */
+static uint64_t parse_all(size_t thread_count, bool pooled)
+{
+	struct worker workers[MAX_THREADS];
+	uint64_t start_ns = bench_now_ns();
+
+	for (size_t t = 0; t < thread_count; t++) {
+		workers[t].offset = t;
+		workers[t].stride = thread_count;
+		workers[t].pooled = pooled;
+
+		rdesc_assert(pthread_create(&workers[t].thread, NULL, work,
+					    &workers[t]) == 0,
+			     "could not create thread");
+	}
+
+	for (size_t t = 0; t < thread_count; t++)
+		pthread_join(workers[t].thread, NULL);
+
+	return bench_now_ns() - start_ns;
+}
+
+
+int main(void)
+{
+	long online = sysconf(_SC_NPROCESSORS_ONLN);
+	size_t max_threads = online > 0 ? (size_t) online : 1;
+
+	if (max_threads > MAX_THREADS)
+		max_threads = MAX_THREADS;
+
+	srand(0);
+	generate_statements();
+
+	unwrap(rdesc_grammar_init(&grammar,
+				  BC_NT_COUNT, BC_NT_VARIANT_COUNT, BC_NT_BODY_LENGTH,
+				  (struct rdesc_grammar_symbol *) bc));
+
+	printf("%zu statements, %zu tokens, %zu processors\n",
+	       (size_t) STATEMENT_COUNT, total_tokens, max_threads);
+	printf("%8s %14s %14s %14s\n",
+	       "threads", "pool Mtk/s", "init Mtk/s", "speedup");
+
+	for (size_t threads = 1;; threads *= 2) {
+		uint64_t pooled = UINT64_MAX, fresh = UINT64_MAX;
+
+		if (threads > max_threads)
+			threads = max_threads;
+
+		unwrap(rdesc_pool_init(&pool, threads, &grammar, 0, NULL,
+				       NULL));
+
+		for (int r = 0; r < ROUNDS; r++) {
+			uint64_t t = parse_all(threads, true);
+
+			if (t < pooled)
+				pooled = t;
+
+			t = parse_all(threads, false);
+
+			if (t < fresh)
+				fresh = t;
+		}
+
+		printf("%8zu %14.2f %14.2f %14.2f\n", threads,
+		       total_tokens * 1e3 / pooled, total_tokens * 1e3 / fresh,
+		       (double) fresh / pooled);
+
+		rdesc_pool_destroy(&pool);
+
+		if (threads == max_threads)
+			break;
+	}
+
+	rdesc_grammar_destroy(&grammar);
+}
@@ -0,0 +1,203 @@
+/* Compare pumping tokens one at a time, as examples/bc_interactive.c does,
+ * with pumping blocks of tokens with `rdesc_pump_many`. Streams of random bc
+ * statements backtrack heavily, a list grammar that never backtracks shows
+ * the per-call overhead. */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "../include/grammar.h"
+#include "../include/rdesc.h"
+#include "../include/rule_macros.h"
+#include "../src/common.h"
+
+#include "../examples/grammar/bc.h"
+#include "../tests/lib/bc_fuzzer.c"
+
+#include "lib/bench.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+#define STREAM_LENGTH (1 << 18)
+#define MAX_TOKENS 256
+#define ROUNDS 8
+
+#define LIST_NT_COUNT 2
+#define LIST_NT_VARIANT_COUNT 3
+#define LIST_NT_BODY_LENGTH 4
+
+#define LIST_LENGTH 16
+
+enum list_tk {
+	TK_LIST_NOTOKEN,
+	TK_LIST_NUM, TK_LIST_COMMA, TK_LIST_SEMI,
+};
+
+enum list_nt {
+	NT_LIST, NT_LIST_REST,
+};
+
+static const struct rdesc_grammar_symbol
+list[LIST_NT_COUNT][LIST_NT_VARIANT_COUNT][LIST_NT_BODY_LENGTH] = {
+	/* <list> ::= */ r(
+		TK(LIST_NUM), NT(LIST_REST)
+	),
+	/* <list_rest> ::= */ r(
+		TK(LIST_COMMA), TK(LIST_NUM), NT(LIST_REST)
+	alt	TK(LIST_SEMI)
+	),
+};
+
+
+static uint16_t tks[STREAM_LENGTH];
+/* Semantic information of bc tokens is a string pointer. */
+static const char *seminfos[STREAM_LENGTH];
+static size_t token_count, statement_count;
+
+
+static void generate_bc_stream(void)
+{
+	while (token_count + MAX_TOKENS <= STREAM_LENGTH) {
+		struct bc_grammar_generator g = BC_DEFAULT_GENERATOR;
+		size_t len = 0;
+		uint16_t tk;
+
+		while ((tk = bc_fuzzer_next_tk(&g)) != TK_ENDSYM &&
+		       len < MAX_TOKENS - 1) {
+			g.group_start_p *= 0.9;
+
+			tks[token_count + len++] = tk;
+		}
+
+		/* Drop statements cut at the length limit. */
+		if (tk != TK_ENDSYM)
+			continue;
+
+		tks[token_count + len++] = TK_ENDSYM;
+
+		token_count += len;
+		statement_count++;
+	}
+}
+
+static void generate_list_stream(void)
+{
+	token_count = statement_count = 0;
+
+	while (token_count + LIST_LENGTH * 2 <= STREAM_LENGTH) {
+		tks[token_count++] = TK_LIST_NUM;
+
+		for (int i = 1; i < LIST_LENGTH; i++) {
+			tks[token_count++] = TK_LIST_COMMA;
+			tks[token_count++] = TK_LIST_NUM;
+		}
+
+		tks[token_count++] = TK_LIST_SEMI;
+		statement_count++;
+	}
+}
+
+/* Parses the stream token by token and returns elapsed nanoseconds. */
+static uint64_t parse_one_by_one(struct rdesc *p, uint16_t start_symbol)
+{
+	uint64_t start_ns = bench_now_ns();
+	size_t cur = 0;
+
+	while (cur < token_count) {
+		enum rdesc_result res;
+
+		unwrap(rdesc_start(p, start_symbol));
+
+		do {
+			res = rdesc_pump(p, tks[cur], &seminfos[cur]);
+			cur++;
+		} while (res == RDESC_CONTINUE);
+
+		rdesc_assert(res == RDESC_READY, "could not match grammar");
+		rdesc_reset(p);
+	}
+
+	return bench_now_ns() - start_ns;
+}
+
+/* Parses the stream in a single block and returns elapsed nanoseconds. */
+static uint64_t parse_batched(struct rdesc *p, uint16_t start_symbol)
+{
+	uint64_t start_ns = bench_now_ns();
+	size_t cur = 0;
+
+	while (cur < token_count) {
+		enum rdesc_result res;
+		size_t consumed;
+
+		unwrap(rdesc_start(p, start_symbol));
+
+		res = rdesc_pump_many(p, &tks[cur], &seminfos[cur],
+				      token_count - cur, &consumed);
+		cur += consumed;
+
+		rdesc_assert(res == RDESC_READY, "could not match grammar");
+		rdesc_reset(p);
+	}
+
+	return bench_now_ns() - start_ns;
+}
+
+
+static void compare(const char *name, struct rdesc_grammar *grammar,
+		    uint16_t start_symbol)
+{
+	struct rdesc p;
+	uint64_t t_single = UINT64_MAX, t_batched = UINT64_MAX;
+
+	unwrap(rdesc_init(&p, grammar, sizeof(char *), NULL));
+
+	/* Best of rounds, alternating to even out frequency scaling. */
+	for (int r = 0; r < ROUNDS; r++) {
+		uint64_t t;
+
+		t = parse_one_by_one(&p, start_symbol);
+		if (t < t_single)
+			t_single = t;
+
+		t = parse_batched(&p, start_symbol);
+		if (t < t_batched)
+			t_batched = t;
+	}
+
+	printf("%s: %zu statements, %zu tokens\n", name, statement_count,
+	       token_count);
+	printf("%12s %12s %12s\n", "", "ms", "ns/token");
+	printf("%12s %12.2f %12.1f\n", "one by one",
+	       t_single / 1e6, (double) t_single / token_count);
+	printf("%12s %12.2f %12.1f\n", "batched",
+	       t_batched / 1e6, (double) t_batched / token_count);
+
+	rdesc_destroy(&p);
+}
+
+
+int main(void)
+{
+	struct rdesc_grammar grammar;
+
+	srand(0);
+
+	generate_bc_stream();
+	unwrap(rdesc_grammar_init(&grammar,
+				  BC_NT_COUNT, BC_NT_VARIANT_COUNT, BC_NT_BODY_LENGTH,
+				  (struct rdesc_grammar_symbol *) bc));
+	compare("bc", &grammar, NT_STMT);
+	rdesc_grammar_destroy(&grammar);
+
+	generate_list_stream();
+	unwrap(rdesc_grammar_init(&grammar,
+				  LIST_NT_COUNT, LIST_NT_VARIANT_COUNT,
+				  LIST_NT_BODY_LENGTH,
+				  (struct rdesc_grammar_symbol *) list));
+	compare("list", &grammar, NT_LIST);
+	rdesc_grammar_destroy(&grammar);
+}
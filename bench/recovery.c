@@ -0,0 +1,231 @@
+/* Compare validating a stream of statements, some of which are damaged, by
+ * resetting the parser and restarting it after the semicolon of each broken
+ * statement, with panic-mode recovery at semicolons, for increasing ratios of
+ * broken statements. Statements are short and parsed without much
+ * backtracking, so restart costs are not hidden. */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "../include/grammar.h"
+#include "../include/rdesc.h"
+#include "../include/rule_macros.h"
+#include "../src/common.h"
+
+#include "lib/bench.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+#define STMT_NT_COUNT 3
+#define STMT_NT_VARIANT_COUNT 4
+#define STMT_NT_BODY_LENGTH 5
+
+#define STREAM_LENGTH (1 << 18)
+#define MAX_TOKENS 64
+#define ROUNDS 8
+
+enum stmt_tk {
+	TK_NOTOKEN,
+	TK_ID, TK_NUM, TK_ASSIGN, TK_PLUS, TK_LPAREN, TK_RPAREN, TK_SEMI,
+};
+
+enum stmt_nt {
+	NT_STMT, NT_EXPR, NT_ATOM,
+};
+
+static const struct rdesc_grammar_symbol
+stmt[STMT_NT_COUNT][STMT_NT_VARIANT_COUNT][STMT_NT_BODY_LENGTH] = {
+	/* <stmt> ::= */ r(
+		TK(ID), TK(ASSIGN), NT(EXPR), TK(SEMI)
+	alt	NT(EXPR), TK(SEMI)
+	),
+	/* <expr> ::= */ r(
+		NT(ATOM), TK(PLUS), NT(EXPR)
+	alt	NT(ATOM)
+	),
+	/* <atom> ::= */ r(
+		TK(ID)
+	alt	TK(NUM)
+	alt	TK(LPAREN), NT(EXPR), TK(RPAREN)
+	),
+};
+
+
+static uint16_t generated[STREAM_LENGTH], tks[STREAM_LENGTH];
+static size_t token_count, statement_count, consumed_count;
+
+
+static void generate_expr(int depth);
+
+static void generate_atom(int depth)
+{
+	if (depth > 0 && rand() % 4 == 0) {
+		generated[token_count++] = TK_LPAREN;
+		generate_expr(depth - 1);
+		generated[token_count++] = TK_RPAREN;
+	} else {
+		generated[token_count++] = rand() % 2 ? TK_ID : TK_NUM;
+	}
+}
+
+static void generate_expr(int depth)
+{
+	generate_atom(depth);
+
+	while (rand() % 2) {
+		generated[token_count++] = TK_PLUS;
+		generate_atom(depth);
+	}
+}
+
+static void generate_stream(void)
+{
+	while (token_count + MAX_TOKENS <= STREAM_LENGTH) {
+		size_t start = token_count;
+
+		if (rand() % 2) {
+			generated[token_count++] = TK_ID;
+			generated[token_count++] = TK_ASSIGN;
+		}
+
+		generate_expr(2);
+
+		/* Drop statements exceeding the length limit. */
+		if (token_count - start >= MAX_TOKENS) {
+			token_count = start;
+
+			continue;
+		}
+
+		generated[token_count++] = TK_SEMI;
+		statement_count++;
+	}
+}
+
+/* Replaces a token other than the semicolon in each broken statement, which
+ * may still match. Statements are broken with the probability of `ratio`. */
+static void damage(double ratio)
+{
+	size_t start = 0;
+
+	for (size_t i = 0; i < token_count; i++) {
+		tks[i] = generated[i];
+
+		if (generated[i] != TK_SEMI)
+			continue;
+
+		if (rand() < ratio * RAND_MAX)
+			tks[start + rand() % (i - start)] =
+				1 + rand() % (TK_SEMI - 1);
+
+		start = i + 1;
+	}
+}
+
+static void consume(struct rdesc *p, struct rdesc_node *root, void *ctx)
+{
+	(void) p;
+	(void) root;
+	(void) ctx;
+
+	consumed_count++;
+}
+
+/* Parses the stream, and returns elapsed nanoseconds. Without recovery, the
+ * parser is reset after a broken statement, and restarted after its end
+ * symbol. */
+static uint64_t parse(struct rdesc *p, bool recover)
+{
+	uint64_t start_ns = bench_now_ns();
+	size_t cur = 0, consumed;
+
+	consumed_count = 0;
+
+	while (cur < token_count) {
+		unwrap(rdesc_stream(p, NT_STMT, consume, NULL));
+
+		if (rdesc_pump_many(p, &tks[cur], NULL, token_count - cur,
+				    &consumed) ==
+		    RDESC_CONTINUE)
+			break;
+
+		rdesc_assert(!recover, "could not recover");
+
+		/* The broken statement is counted, as it is consumed. */
+		for (cur += consumed - 1; tks[cur] != TK_SEMI; cur++)
+			;
+
+		cur++;
+		consumed_count++;
+
+		rdesc_reset(p);
+	}
+
+	uint64_t elapsed = bench_now_ns() - start_ns;
+
+	rdesc_assert(consumed_count == statement_count,
+		     "statement count mismatch");
+	rdesc_reset(p);
+
+	return elapsed;
+}
+
+
+int main(void)
+{
+	static const double ratios[] = { 0, 0.001, 0.01, 0.1, 0.5 };
+	static const struct rdesc_sync sync = {
+		.nt_id = NT_STMT, .tk_id = TK_SEMI, .consumed = true,
+	};
+
+	struct rdesc_grammar grammar;
+	struct rdesc restarted, recovered;
+
+	srand(0);
+	generate_stream();
+
+	unwrap(rdesc_grammar_init(&grammar,
+				  STMT_NT_COUNT, STMT_NT_VARIANT_COUNT,
+				  STMT_NT_BODY_LENGTH,
+				  (struct rdesc_grammar_symbol *) stmt));
+
+	unwrap(rdesc_init(&restarted, &grammar, 0, NULL));
+	unwrap(rdesc_init(&recovered, &grammar, 0, NULL));
+	unwrap(rdesc_recover(&recovered, &sync, 1));
+
+	printf("%zu statements, %zu tokens\n", statement_count, token_count);
+	printf("%8s %20s %20s\n", "broken", "restart (ns/token)",
+	       "recover (ns/token)");
+
+	for (size_t i = 0; i < sizeof(ratios) / sizeof(ratios[0]); i++) {
+		uint64_t best_restart = UINT64_MAX, best_recover = UINT64_MAX;
+
+		damage(ratios[i]);
+
+		/* Best of rounds, alternating to even out frequency
+		 * scaling. */
+		for (int r = 0; r < ROUNDS; r++) {
+			uint64_t t = parse(&restarted, false);
+
+			if (t < best_restart)
+				best_restart = t;
+
+			t = parse(&recovered, true);
+
+			if (t < best_recover)
+				best_recover = t;
+		}
+
+		printf("%7.1f%% %20.1f %20.1f\n", ratios[i] * 100,
+		       (double) best_restart / token_count,
+		       (double) best_recover / token_count);
+	}
+
+	rdesc_destroy(&restarted);
+	rdesc_destroy(&recovered);
+	rdesc_grammar_destroy(&grammar);
+}
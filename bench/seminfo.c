@@ -0,0 +1,114 @@
+/* Parse random bc statements with growing seminfo sizes. Backtracking rewinds
+ * the token tape instead of copying tokens, so the time per token should
+ * barely depend on the seminfo size. */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "../include/grammar.h"
+#include "../include/rdesc.h"
+#include "../src/common.h"
+
+#include "../examples/grammar/bc.h"
+#include "../tests/lib/bc_fuzzer.c"
+
+#include "lib/bench.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+#define STATEMENT_COUNT 4096
+#define MAX_TOKENS 256
+#define ROUNDS 4
+
+#define MAX_SEMINFO_SIZE 256
+
+
+static uint16_t statements[STATEMENT_COUNT][MAX_TOKENS];
+static size_t total_tokens;
+
+static uint8_t seminfo[MAX_SEMINFO_SIZE];
+
+
+static void generate_statements(void)
+{
+	for (size_t s = 0; s < STATEMENT_COUNT; s++) {
+		struct bc_grammar_generator g = BC_DEFAULT_GENERATOR;
+		size_t len = 0;
+		uint16_t tk;
+
+		while ((tk = bc_fuzzer_next_tk(&g)) != TK_ENDSYM &&
+		       len < MAX_TOKENS - 2) {
+			g.group_start_p *= 0.9;
+
+			statements[s][len++] = tk;
+		}
+
+		statements[s][len++] = TK_ENDSYM;
+		statements[s][len] = TK_NOTOKEN;
+
+		total_tokens += len;
+	}
+}
+
+/* Parses all statements and returns elapsed nanoseconds. */
+static uint64_t parse_all(struct rdesc *p)
+{
+	uint64_t start_ns = bench_now_ns();
+
+	for (size_t s = 0; s < STATEMENT_COUNT; s++) {
+		enum rdesc_result res = RDESC_CONTINUE;
+
+		unwrap(rdesc_start(p, NT_STMT));
+
+		for (const uint16_t *tk = statements[s]; *tk != TK_NOTOKEN; tk++)
+			res = rdesc_pump(p, *tk, seminfo);
+
+		rdesc_assert(res == RDESC_READY, "could not match grammar");
+
+		rdesc_reset(p);
+	}
+
+	return bench_now_ns() - start_ns;
+}
+
+
+int main(void)
+{
+	struct rdesc_grammar grammar;
+
+	srand(0);
+	generate_statements();
+
+	unwrap(rdesc_grammar_init(&grammar,
+				  BC_NT_COUNT, BC_NT_VARIANT_COUNT, BC_NT_BODY_LENGTH,
+				  (struct rdesc_grammar_symbol *) bc));
+
+	printf("%zu statements, %zu tokens\n", (size_t) STATEMENT_COUNT,
+	       total_tokens);
+	printf("%12s %12s %12s\n", "seminfo", "ms", "ns/token");
+
+	for (size_t size = 0; size <= MAX_SEMINFO_SIZE;
+	     size = size ? size * 2 : 8) {
+		struct rdesc p;
+		uint64_t best = UINT64_MAX;
+
+		unwrap(rdesc_init(&p, &grammar, size, NULL));
+
+		for (int r = 0; r < ROUNDS; r++) {
+			uint64_t t = parse_all(&p);
+
+			if (t < best)
+				best = t;
+		}
+
+		printf("%12zu %12.2f %12.1f\n", size,
+		       best / 1e6, (double) best / total_tokens);
+
+		rdesc_destroy(&p);
+	}
+
+	rdesc_grammar_destroy(&grammar);
+}
@@ -0,0 +1,239 @@
+/* Compare parsing a stream of statements by resetting and starting the parser
+ * for each statement, by only starting it, and in streaming mode with tokens
+ * pumped one by one or in a single block. Statements of the list grammar are
+ * tiny, so restart costs dominate. */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "../include/grammar.h"
+#include "../include/rdesc.h"
+#include "../include/rule_macros.h"
+#include "../src/common.h"
+
+#include "../examples/grammar/bc.h"
+#include "../tests/lib/bc_fuzzer.c"
+
+#include "lib/bench.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+#define STREAM_LENGTH (1 << 18)
+#define MAX_TOKENS 256
+#define ROUNDS 8
+
+#define LIST_NT_COUNT 2
+#define LIST_NT_VARIANT_COUNT 3
+#define LIST_NT_BODY_LENGTH 4
+
+#define LIST_LENGTH 4
+
+enum list_tk {
+	TK_LIST_NOTOKEN,
+	TK_LIST_NUM, TK_LIST_COMMA, TK_LIST_SEMI,
+};
+
+enum list_nt {
+	NT_LIST, NT_LIST_REST,
+};
+
+static const struct rdesc_grammar_symbol
+list[LIST_NT_COUNT][LIST_NT_VARIANT_COUNT][LIST_NT_BODY_LENGTH] = {
+	/* <list> ::= */ r(
+		TK(LIST_NUM), NT(LIST_REST)
+	),
+	/* <list_rest> ::= */ r(
+		TK(LIST_COMMA), TK(LIST_NUM), NT(LIST_REST)
+	alt	TK(LIST_SEMI)
+	),
+};
+
+enum mode {
+	MODE_RESET, MODE_START, MODE_STREAM, MODE_STREAM_BATCHED,
+	MODE_COUNT,
+};
+
+static const char *const mode_names[MODE_COUNT] = {
+	"reset", "start", "stream", "batched",
+};
+
+
+static uint16_t tks[STREAM_LENGTH];
+/* Semantic information of bc tokens is a string pointer. */
+static const char *seminfos[STREAM_LENGTH];
+static size_t token_count, statement_count, consumed_count;
+
+
+static void generate_bc_stream(void)
+{
+	while (token_count + MAX_TOKENS <= STREAM_LENGTH) {
+		struct bc_grammar_generator g = BC_DEFAULT_GENERATOR;
+		size_t len = 0;
+		uint16_t tk;
+
+		while ((tk = bc_fuzzer_next_tk(&g)) != TK_ENDSYM &&
+		       len < MAX_TOKENS - 1) {
+			g.group_start_p *= 0.9;
+
+			tks[token_count + len++] = tk;
+		}
+
+		/* Drop statements cut at the length limit. */
+		if (tk != TK_ENDSYM)
+			continue;
+
+		tks[token_count + len++] = TK_ENDSYM;
+
+		token_count += len;
+		statement_count++;
+	}
+}
+
+static void generate_list_stream(void)
+{
+	token_count = statement_count = 0;
+
+	while (token_count + LIST_LENGTH * 2 <= STREAM_LENGTH) {
+		tks[token_count++] = TK_LIST_NUM;
+
+		for (int i = 1; i < LIST_LENGTH; i++) {
+			tks[token_count++] = TK_LIST_COMMA;
+			tks[token_count++] = TK_LIST_NUM;
+		}
+
+		tks[token_count++] = TK_LIST_SEMI;
+		statement_count++;
+	}
+}
+
+static void consume(struct rdesc *p, struct rdesc_node *root, void *ctx)
+{
+	(void) p;
+	(void) root;
+	(void) ctx;
+
+	consumed_count++;
+}
+
+/* Parses the stream in the given mode and returns elapsed nanoseconds. */
+static uint64_t parse(struct rdesc *p, uint16_t start_symbol, enum mode mode)
+{
+	uint64_t start_ns = bench_now_ns();
+	enum rdesc_result res;
+	size_t cur = 0;
+
+	consumed_count = 0;
+
+	switch (mode) {
+	case MODE_RESET:
+	case MODE_START:
+		while (cur < token_count) {
+			unwrap(rdesc_start(p, start_symbol));
+
+			do {
+				res = rdesc_pump(p, tks[cur], &seminfos[cur]);
+				cur++;
+			} while (res == RDESC_CONTINUE);
+
+			rdesc_assert(res == RDESC_READY,
+				     "could not match grammar");
+			consume(p, rdesc_root(p), NULL);
+
+			if (mode == MODE_RESET)
+				rdesc_reset(p);
+		}
+
+		break;
+
+	case MODE_STREAM:
+		unwrap(rdesc_stream(p, start_symbol, consume, NULL));
+
+		for (; cur < token_count; cur++) {
+			res = rdesc_pump(p, tks[cur], &seminfos[cur]);
+
+			rdesc_assert(res == RDESC_CONTINUE,
+				     "could not match grammar");
+		}
+
+		break;
+
+	case MODE_STREAM_BATCHED:
+		unwrap(rdesc_stream(p, start_symbol, consume, NULL));
+
+		res = rdesc_pump_many(p, tks, seminfos, token_count, &cur);
+
+		rdesc_assert(res == RDESC_CONTINUE, "could not match grammar");
+
+		break;
+
+	default: unreachable();
+	}
+
+	uint64_t elapsed = bench_now_ns() - start_ns;
+
+	rdesc_assert(consumed_count == statement_count,
+		     "statement count mismatch");
+	rdesc_reset(p);
+
+	return elapsed;
+}
+
+
+static void compare(const char *name, struct rdesc_grammar *grammar,
+		    uint16_t start_symbol)
+{
+	struct rdesc p;
+	uint64_t best[MODE_COUNT];
+
+	unwrap(rdesc_init(&p, grammar, sizeof(char *), NULL));
+
+	for (int m = 0; m < MODE_COUNT; m++)
+		best[m] = UINT64_MAX;
+
+	/* Best of rounds, alternating to even out frequency scaling. */
+	for (int r = 0; r < ROUNDS; r++) {
+		for (int m = 0; m < MODE_COUNT; m++) {
+			uint64_t t = parse(&p, start_symbol, m);
+
+			if (t < best[m])
+				best[m] = t;
+		}
+	}
+
+	printf("%s: %zu statements, %zu tokens\n", name, statement_count,
+	       token_count);
+	printf("%12s %12s %12s %14s\n", "", "ms", "ns/token", "ns/statement");
+
+	for (int m = 0; m < MODE_COUNT; m++)
+		printf("%12s %12.2f %12.1f %14.1f\n", mode_names[m],
+		       best[m] / 1e6, (double) best[m] / token_count,
+		       (double) best[m] / statement_count);
+
+	rdesc_destroy(&p);
+}
+
+
+int main(void)
+{
+	struct rdesc_grammar grammar;
+
+	srand(0);
+
+	generate_bc_stream();
+	unwrap(rdesc_grammar_init(&grammar,
+				  BC_NT_COUNT, BC_NT_VARIANT_COUNT, BC_NT_BODY_LENGTH,
+				  (struct rdesc_grammar_symbol *) bc));
+	compare("bc", &grammar, NT_STMT);
+	rdesc_grammar_destroy(&grammar);
+
+	generate_list_stream();
+	unwrap(rdesc_grammar_init(&grammar,
+				  LIST_NT_COUNT, LIST_NT_VARIANT_COUNT,
+				  LIST_NT_BODY_LENGTH,
+				  (struct rdesc_grammar_symbol *) list));
+	compare("list", &grammar, NT_LIST);
+	rdesc_grammar_destroy(&grammar);
+}
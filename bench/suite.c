@@ -0,0 +1,306 @@
+/* End-to-end parse throughput of deterministic bc and boolean algebra inputs,
+ * for comparing builds across commits. Each workload runs in its own process,
+ * so that its peak RSS is its own, and reports tokens per second, time per
+ * pump call, CST node bytes per token, peak RSS, and backtracking.
+ *
+ * Usage: suite [--json]
+ *
+ * Reports a table by default, a JSON object with `--json`. */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "../include/grammar.h"
+#include "../include/rdesc.h"
+#include "../include/stack.h"
+#include "../src/common.h"
+
+#include "lib/bench.h"
+#include "lib/suite.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+
+#define STREAM_LENGTH (1 << 18)
+#define ROUNDS 5
+#define SEED 0
+
+#define MEMO_LIMIT (16 * 1024 * 1024)
+
+#define WORKLOAD_COUNT (sizeof(workloads) / sizeof(workloads[0]))
+
+
+enum mode {
+	/* rdesc_pump for each token. */
+	PUMP,
+	/* rdesc_pump_many for each statement. */
+	PUMP_MANY,
+	/* rdesc_pump_many, with failed derivations memoized. */
+	MEMOIZE,
+};
+
+struct workload {
+	const char *name;
+	const struct suite_grammar *grammar;
+	enum mode mode;
+};
+
+struct result {
+	size_t tokens, statements;
+
+	/* Calls to the pump function of the workload in a round. */
+	size_t calls;
+
+	/* Fastest round. */
+	uint64_t ns;
+
+	/* Sum of the CST node bytes of the statements. */
+	size_t cst_bytes;
+
+	struct rdesc_stats stats;
+
+	/* Peak resident set size of the workload process in kilobytes. */
+	long max_rss;
+};
+
+
+static const struct workload workloads[] = {
+	{ "bc/pump", &suite_bc, PUMP },
+	{ "bc/pump_many", &suite_bc, PUMP_MANY },
+	{ "bc/memoize", &suite_bc, MEMOIZE },
+	{ "balg/pump", &suite_balg, PUMP },
+	{ "balg/pump_many", &suite_balg, PUMP_MANY },
+};
+
+static uint16_t tks[STREAM_LENGTH];
+
+
+/* Parses the statement at `cur`, adds the CST node bytes to the result and
+ * returns the number of tokens consumed. */
+static size_t parse_statement(struct rdesc *p, const struct workload *w,
+			      size_t cur, size_t token_count,
+			      struct result *res)
+{
+	enum rdesc_result r;
+	size_t consumed = 0;
+
+	unwrap(rdesc_start(p, w->grammar->start_symbol));
+
+	if (w->mode == PUMP) {
+		do {
+			r = rdesc_pump(p, tks[cur + consumed++], NULL);
+			res->calls++;
+		} while (r == RDESC_CONTINUE && cur + consumed < token_count);
+	} else {
+		r = rdesc_pump_many(p, &tks[cur], NULL, token_count - cur,
+				    &consumed);
+		res->calls++;
+	}
+
+	rdesc_assert(r == RDESC_READY, "could not match grammar");
+
+	res->cst_bytes += rdesc_stack_len(p->cst_stack) * sizeof_node(*p);
+
+	rdesc_reset(p);
+
+	return consumed;
+}
+
+/* Parses every statement and returns elapsed nanoseconds. */
+static uint64_t parse_round(struct rdesc *p, const struct workload *w,
+			    size_t token_count, struct result *res)
+{
+	uint64_t start_ns = bench_now_ns();
+	size_t cur = 0;
+
+	while (cur < token_count)
+		cur += parse_statement(p, w, cur, token_count, res);
+
+	return bench_now_ns() - start_ns;
+}
+
+static void run(const struct workload *w, struct result *res)
+{
+	struct rdesc_grammar grammar;
+	struct rdesc_stats before;
+	struct rusage usage;
+	struct rdesc p;
+
+	memset(res, 0, sizeof(*res));
+	res->ns = UINT64_MAX;
+
+	srand(SEED);
+	res->tokens = w->grammar->generate(tks, STREAM_LENGTH,
+					   &res->statements);
+
+	unwrap(w->grammar->init(&grammar));
+	unwrap(rdesc_init(&p, &grammar, 0, NULL));
+
+	if (w->mode == MEMOIZE)
+		unwrap(rdesc_memoize(&p, MEMO_LIMIT));
+
+	for (int r = 0; r < ROUNDS; r++) {
+		struct result round = { 0 };
+		uint64_t t;
+
+		rdesc_read_stats(&p, &before);
+		t = parse_round(&p, w, res->tokens, &round);
+
+		if (t < res->ns)
+			res->ns = t;
+
+		/* Rounds parse the same input, counters of the first one
+		 * are reported. */
+		if (r == 0) {
+			rdesc_read_stats(&p, &res->stats);
+			res->stats.backtracks -= before.backtracks;
+			res->stats.rewound_tokens -= before.rewound_tokens;
+
+			res->calls = round.calls;
+			res->cst_bytes = round.cst_bytes;
+		}
+	}
+
+	rdesc_destroy(&p);
+	rdesc_grammar_destroy(&grammar);
+
+	getrusage(RUSAGE_SELF, &usage);
+	res->max_rss = usage.ru_maxrss;
+}
+
+/* Runs the workload in a child process, returns non-zero if it fails. */
+static int run_isolated(const struct workload *w, struct result *res)
+{
+	int fds[2], status;
+	ssize_t n;
+	pid_t pid;
+
+	if (pipe(fds))
+		return 1;
+
+	pid = fork();
+
+	if (pid < 0) {
+		close(fds[0]);
+		close(fds[1]);
+
+		return 1;
+	}
+
+	if (pid == 0) {
+		close(fds[0]);
+		run(w, res);
+
+		n = write(fds[1], res, sizeof(*res));
+		_exit(n == (ssize_t) sizeof(*res) ? 0 : 1);
+	}
+
+	close(fds[1]);
+	n = read(fds[0], res, sizeof(*res));
+	close(fds[0]);
+
+	if (waitpid(pid, &status, 0) != pid)
+		return 1;
+
+	return n != (ssize_t) sizeof(*res) ||
+		!WIFEXITED(status) || WEXITSTATUS(status) != 0;
+}
+
+static void print_table_header(void)
+{
+	printf("%zu rounds, best round is timed, counters are of one round\n\n",
+	       (size_t) ROUNDS);
+	printf("%-16s %9s %9s %9s %9s %10s %11s %10s\n",
+	       "workload", "tokens", "Mtok/s", "ns/pump", "CST B/tk",
+	       "RSS KiB", "backtracks", "rewound/tk");
+}
+
+static void print_table_row(const struct workload *w,
+			    const struct result *res)
+{
+	printf("%-16s %9zu %9.2f %9.1f %9.1f %10ld %11zu %10.2f\n",
+	       w->name, res->tokens, res->tokens * 1e3 / res->ns,
+	       (double) res->ns / res->calls,
+	       (double) res->cst_bytes / res->tokens, res->max_rss,
+	       res->stats.backtracks,
+	       (double) res->stats.rewound_tokens / res->tokens);
+}
+
+static void print_json(const struct workload *w, const struct result *res,
+		       bool first)
+{
+	printf("%s    {\n"
+	       "      \"name\": \"%s\",\n"
+	       "      \"tokens\": %zu,\n"
+	       "      \"statements\": %zu,\n"
+	       "      \"pump_calls\": %zu,\n"
+	       "      \"ns\": %llu,\n"
+	       "      \"tokens_per_second\": %.0f,\n"
+	       "      \"ns_per_pump\": %.2f,\n"
+	       "      \"cst_bytes_per_token\": %.2f,\n"
+	       "      \"peak_rss_kib\": %ld,\n"
+	       "      \"backtracks\": %zu,\n"
+	       "      \"rewound_tokens\": %zu\n"
+	       "    }",
+	       first ? "" : ",\n", w->name, res->tokens, res->statements,
+	       res->calls, (unsigned long long) res->ns,
+	       res->tokens * 1e9 / res->ns,
+	       (double) res->ns / res->calls,
+	       (double) res->cst_bytes / res->tokens, res->max_rss,
+	       res->stats.backtracks, res->stats.rewound_tokens);
+}
+
+
+int main(int argc, char **argv)
+{
+	bool json = false, first = true;
+	int failed = 0;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--json") == 0) {
+			json = true;
+		} else {
+			fprintf(stderr, "usage: %s [--json]\n", argv[0]);
+
+			return 2;
+		}
+	}
+
+	if (json)
+		printf("{\n  \"rounds\": %d,\n  \"workloads\": [\n", ROUNDS);
+	else
+		print_table_header();
+
+	for (size_t i = 0; i < WORKLOAD_COUNT; i++) {
+		const struct workload *w = &workloads[i];
+		struct result res;
+
+		if (run_isolated(w, &res)) {
+			fprintf(stderr, "%s: workload failed\n", w->name);
+			failed = 1;
+
+			continue;
+		}
+
+		if (json)
+			print_json(w, &res, first);
+		else
+			print_table_row(w, &res);
+
+		first = false;
+		fflush(stdout);
+	}
+
+	if (json)
+		printf("\n  ]\n}\n");
+
+	return failed;
+}
@@ -0,0 +1,107 @@
+/* Generated by rdesc_dump_grammar, do not edit. */
+
+#include "grammar.h"
+
+#include <stdint.h>
+
+
+static const uint32_t balg_variants[18] = {
+	0, 2, 3, 4, 6, 7, 9, 10, 12, 14, 19, 23,
+	25, 26, 27, 29, 30, 32,
+};
+
+static const uint32_t balg_bodies[33] = {
+	0, 1, 2, 3, 7, 8, 8, 10, 13, 13, 15, 18,
+	18, 20, 21, 24, 27, 28, 29, 30, 31, 33, 35, 38,
+	40, 40, 43, 45, 48, 48, 50, 53, 53,
+};
+
+static const uint16_t balg_symbols[53] = {
+	/* 0 */
+	 1,
+	 2,
+	/* 1 */
+	 3,
+	/* 2 */
+	 3, 7, RDESC_SYMBOL_NONTERMINAL | 3, 8,
+	/* 3 */
+	 RDESC_SYMBOL_NONTERMINAL | 15,
+	 /* E */
+	/* 4 */
+	 RDESC_SYMBOL_NONTERMINAL | 6, RDESC_SYMBOL_NONTERMINAL | 5,
+	/* 5 */
+	 4, RDESC_SYMBOL_NONTERMINAL | 6, RDESC_SYMBOL_NONTERMINAL | 5,
+	 /* E */
+	/* 6 */
+	 RDESC_SYMBOL_NONTERMINAL | 8, RDESC_SYMBOL_NONTERMINAL | 7,
+	/* 7 */
+	 5, RDESC_SYMBOL_NONTERMINAL | 8, RDESC_SYMBOL_NONTERMINAL | 7,
+	 /* E */
+	/* 8 */
+	 6, RDESC_SYMBOL_NONTERMINAL | 9,
+	 RDESC_SYMBOL_NONTERMINAL | 9,
+	/* 9 */
+	 7, RDESC_SYMBOL_NONTERMINAL | 4, 8,
+	 7, RDESC_SYMBOL_NONTERMINAL | 12, 8,
+	 RDESC_SYMBOL_NONTERMINAL | 0,
+	 RDESC_SYMBOL_NONTERMINAL | 1,
+	 RDESC_SYMBOL_NONTERMINAL | 2,
+	/* 10 */
+	 13,
+	 RDESC_SYMBOL_NONTERMINAL | 2, 13,
+	 RDESC_SYMBOL_NONTERMINAL | 12, 13,
+	 9, RDESC_SYMBOL_NONTERMINAL | 11, 10,
+	/* 11 */
+	 RDESC_SYMBOL_NONTERMINAL | 10, RDESC_SYMBOL_NONTERMINAL | 11,
+	 /* E */
+	/* 12 */
+	 RDESC_SYMBOL_NONTERMINAL | 13, 11, RDESC_SYMBOL_NONTERMINAL | 15,
+	/* 13 */
+	 RDESC_SYMBOL_NONTERMINAL | 1, RDESC_SYMBOL_NONTERMINAL | 14,
+	/* 14 */
+	 12, RDESC_SYMBOL_NONTERMINAL | 1, RDESC_SYMBOL_NONTERMINAL | 14,
+	 /* E */
+	/* 15 */
+	 RDESC_SYMBOL_NONTERMINAL | 4, RDESC_SYMBOL_NONTERMINAL | 16,
+	/* 16 */
+	 12, RDESC_SYMBOL_NONTERMINAL | 4, RDESC_SYMBOL_NONTERMINAL | 16,
+	 /* E */
+};
+
+static const uint16_t balg_child_caps[17] = {
+	2, 2, 4, 2, 2, 3, 2, 3, 2, 3, 3, 2,
+	3, 2, 3, 2, 3,
+};
+
+static const uint16_t balg_variant_child_caps[49] = {
+	1, 1, 2, 1, 2, 4, 2, 1, 0, 2, 2, 2,
+	3, 0, 2, 2, 2, 3, 0, 2, 2, 1, 2, 3,
+	3, 1, 1, 1, 2, 1, 2, 2, 3, 2, 2, 0,
+	2, 3, 2, 2, 2, 3, 0, 2, 2, 2, 3, 0,
+	2,
+};
+
+static const uint8_t balg_first_sets[98] = {
+	0x02, 0x00, 0x04, 0x00, 0x00, 0x00, 0x08, 0x00, 0x00, 0x00, 0x08, 0x00,
+	0x00, 0x00, 0xce, 0x00, 0x01, 0x00, 0x00, 0x00, 0xce, 0x00, 0x00, 0x00,
+	0x10, 0x00, 0x01, 0x00, 0x00, 0x00, 0xce, 0x00, 0x00, 0x00, 0x20, 0x00,
+	0x01, 0x00, 0x00, 0x00, 0x40, 0x00, 0x8e, 0x00, 0x00, 0x00, 0x80, 0x00,
+	0x80, 0x00, 0x06, 0x00, 0x08, 0x00, 0x08, 0x00, 0x00, 0x00, 0x00, 0x20,
+	0x08, 0x00, 0x08, 0x00, 0x00, 0x02, 0x00, 0x00, 0x08, 0x22, 0x01, 0x00,
+	0x00, 0x00, 0x08, 0x00, 0x00, 0x00, 0x08, 0x00, 0x00, 0x00, 0x00, 0x10,
+	0x01, 0x00, 0x00, 0x00, 0xce, 0x00, 0x00, 0x00, 0x00, 0x10, 0x01, 0x00,
+	0x00, 0x00,
+};
+
+static const struct rdesc_grammar balg_aot_grammar = {
+	.variants = balg_variants,
+	.bodies = balg_bodies,
+	.symbols = balg_symbols,
+	.nt_count = 17,
+	.child_caps = balg_child_caps,
+	.variant_child_caps = balg_variant_child_caps,
+	.tk_count = 14,
+	.first_sets = balg_first_sets,
+};
+
+const struct rdesc_grammar *const balg_grammar = &balg_aot_grammar;
@@ -0,0 +1,20 @@
+/* Generated by rdesc_dump_grammar, do not edit. */
+
+#ifndef RDESC_GRAMMAR_balg_H
+#define RDESC_GRAMMAR_balg_H
+
+#include "grammar.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern const struct rdesc_grammar *const balg_grammar;
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif
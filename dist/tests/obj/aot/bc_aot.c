@@ -0,0 +1,91 @@
+/* Generated by rdesc_dump_c, do not edit. */
+
+#include "grammar.h"
+
+#include <stdint.h>
+
+
+static const uint32_t bc_variants[13] = {
+	0, 3, 4, 5, 7, 9, 10, 12, 14, 15, 18, 21,
+	22,
+};
+
+static const uint32_t bc_bodies[23] = {
+	0, 1, 3, 6, 8, 10, 13, 13, 14, 15, 17, 20,
+	20, 21, 22, 24, 25, 26, 26, 27, 30, 34, 36,
+};
+
+static const uint16_t bc_symbols[36] = {
+	/* 0 */
+	 1,
+	 2, 1,
+	 1, 2, 1,
+	/* 1 */
+	 RDESC_SYMBOL_NONTERMINAL | 9, RDESC_SYMBOL_NONTERMINAL | 0,
+	/* 2 */
+	 RDESC_SYMBOL_NONTERMINAL | 5, RDESC_SYMBOL_NONTERMINAL | 3,
+	/* 3 */
+	 RDESC_SYMBOL_NONTERMINAL | 4, RDESC_SYMBOL_NONTERMINAL | 5, RDESC_SYMBOL_NONTERMINAL | 3,
+	 /* E */
+	/* 4 */
+	 4,
+	 3,
+	/* 5 */
+	 RDESC_SYMBOL_NONTERMINAL | 8, RDESC_SYMBOL_NONTERMINAL | 6,
+	/* 6 */
+	 RDESC_SYMBOL_NONTERMINAL | 7, RDESC_SYMBOL_NONTERMINAL | 8, RDESC_SYMBOL_NONTERMINAL | 6,
+	 /* E */
+	/* 7 */
+	 5,
+	 6,
+	/* 8 */
+	 RDESC_SYMBOL_NONTERMINAL | 9, RDESC_SYMBOL_NONTERMINAL | 10,
+	/* 9 */
+	 3,
+	 4,
+	 /* E */
+	/* 10 */
+	 RDESC_SYMBOL_NONTERMINAL | 1,
+	 7, RDESC_SYMBOL_NONTERMINAL | 2, 8,
+	 7, RDESC_SYMBOL_NONTERMINAL | 2, 8, 10,
+	/* 11 */
+	 RDESC_SYMBOL_NONTERMINAL | 2, 9,
+};
+
+static const uint16_t bc_child_caps[12] = {
+	3, 2, 2, 3, 2, 2, 3, 2, 2, 2, 4, 2,
+};
+
+static const uint16_t bc_variant_child_caps[34] = {
+	1, 2, 3, 2, 2, 2, 2, 2, 3, 0, 2, 1,
+	1, 2, 2, 2, 3, 0, 2, 1, 1, 2, 2, 2,
+	1, 1, 0, 2, 1, 3, 4, 2, 2, 2,
+};
+
+static const uint8_t bc_first_sets[68] = {
+	0x02, 0x00, 0x04, 0x00, 0x02, 0x00, 0x00, 0x00, 0x1e, 0x00, 0x00, 0x00,
+	0x9e, 0x00, 0x00, 0x00, 0x18, 0x00, 0x01, 0x00, 0x00, 0x00, 0x10, 0x00,
+	0x08, 0x00, 0x00, 0x00, 0x9e, 0x00, 0x00, 0x00, 0x60, 0x00, 0x01, 0x00,
+	0x00, 0x00, 0x20, 0x00, 0x40, 0x00, 0x00, 0x00, 0x9e, 0x00, 0x00, 0x00,
+	0x08, 0x00, 0x10, 0x00, 0x01, 0x00, 0x00, 0x00, 0x1e, 0x00, 0x80, 0x00,
+	0x80, 0x00, 0x00, 0x00, 0x9e, 0x00, 0x00, 0x00,
+};
+
+static const struct rdesc_grammar bc_aot_grammar = {
+	.variants = bc_variants,
+	.bodies = bc_bodies,
+	.symbols = bc_symbols,
+	.nt_count = 12,
+	.child_caps = bc_child_caps,
+	.variant_child_caps = bc_variant_child_caps,
+	.tk_count = 11,
+	.first_sets = bc_first_sets,
+};
+
+const struct rdesc_grammar *const bc_grammar = &bc_aot_grammar;
+
+
+#define RDESC_AOT_GRAMMAR bc_aot_grammar
+#define RDESC_AOT_NAME(name) bc_ ## name
+
+#include "rdesc.c"
@@ -0,0 +1,25 @@
+/* Generated by rdesc_dump_c, do not edit. */
+
+#ifndef RDESC_AOT_bc_H
+#define RDESC_AOT_bc_H
+
+#include "grammar.h"
+#include "rdesc.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern const struct rdesc_grammar *const bc_grammar;
+
+#ifdef __cplusplus
+}
+#endif
+
+#define RDESC_AOT_NAME(name) bc_ ## name
+#include "aot.h"
+#undef RDESC_AOT_NAME
+
+
+#endif
@@ -53,7 +53,15 @@ void program(struct exblex *lex, struct rdesc *p)
 			}
 
 			if (pump_res == RDESC_NOMATCH) {
-				printf("SYNTAX ERROR!\n");
+				uint16_t expected[BC_TK_COUNT];
+				size_t count = rdesc_expected_tokens(
+					p, expected, BC_TK_COUNT);
+
+				printf("SYNTAX ERROR! Expected one of:");
+				for (size_t i = 0; i < count; i++)
+					printf(" %c", bc_tks[expected[i]]);
+				printf("\n");
+
 				rdesc_reset(p);
 
 				break;
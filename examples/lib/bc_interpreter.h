@@ -43,14 +43,14 @@ static inline double bc_interpreter(struct rdesc *p, struct rdesc_node *n)
 	case NT_UNSIGNED_NUM:
 		switch (v) {
 		case 0:
-			decimal_part = rseminfo(rchild(p, n, 0));
+			decimal_part = rseminfo(p, rchild(p, n, 0));
 
 			converted = strtod(*decimal_part, NULL);
 
 			free(*decimal_part);
 			return converted;
 		case 1:
-			floating_part = rseminfo(rchild(p, n, 1));
+			floating_part = rseminfo(p, rchild(p, n, 1));
 
 			converted = strtod(*floating_part, NULL) /
 					   bc_pow10(strlen(*floating_part));
@@ -58,8 +58,8 @@ static inline double bc_interpreter(struct rdesc *p, struct rdesc_node *n)
 			free(*floating_part);
 			return converted;
 		default:
-			decimal_part = rseminfo(rchild(p, n, 0));
-			floating_part = rseminfo(rchild(p, n, 2));
+			decimal_part = rseminfo(p, rchild(p, n, 0));
+			floating_part = rseminfo(p, rchild(p, n, 2));
 
 			converted = strtod(*decimal_part, NULL) +
 					   strtod(*floating_part, NULL) /
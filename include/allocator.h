@@ -0,0 +1,43 @@
+/**
+ * @file allocator.h
+ * @brief Memory allocator interface.
+ *
+ * Parsers, grammars and stacks allocate all of their memory through the
+ * allocator given at their initialization, which lets them use arenas or
+ * allocators local to a thread. Passing NULL selects the `malloc` family of
+ * the C library.
+ */
+
+#ifndef RDESC_ALLOCATOR_H
+#define RDESC_ALLOCATOR_H
+
+#include <stddef.h>
+
+
+/**
+ * @brief Memory allocator with a user context.
+ *
+ * Sizes of the blocks are passed back on resize and free, so an allocator
+ * does not need to keep track of them.
+ */
+struct rdesc_allocator {
+	/** @brief Allocates `size` bytes, returns NULL on failure. */
+	void *(*alloc)(void *ctx, size_t size);
+
+	/**
+	 * @brief Resizes the block of `old_size` bytes at `ptr` to `size`
+	 * bytes, preserving its contents.
+	 *
+	 * Returns NULL and leaves the block as is on failure.
+	 */
+	void *(*realloc)(void *ctx, void *ptr, size_t old_size, size_t size);
+
+	/** @brief Frees the block of `size` bytes at `ptr`, never NULL. */
+	void (*free)(void *ctx, void *ptr, size_t size);
+
+	/** @brief User context passed to the callbacks. */
+	void *ctx;
+};
+
+
+#endif
@@ -0,0 +1,101 @@
+/**
+ * @file aot.h
+ * @brief Parser API of a grammar compiled ahead of time.
+ *
+ * Declares the functions `rdesc_dump_c` generates for a grammar, named with
+ * `RDESC_AOT_NAME(name)`, which shall be defined before including this
+ * header. Headers generated by `rdesc_dump_c` define it to prefix the names
+ * of their grammar, `bc_ ## name` for the `bc` prefix, and include this
+ * header once per grammar.
+ *
+ * The functions are those of `rdesc.h` with the same names. `init` and
+ * `init_with_allocator` take no grammar, parsers run the compiled one.
+ */
+
+#ifndef RDESC_AOT_NAME
+#error "RDESC_AOT_NAME shall be defined before including aot.h"
+#endif
+
+#include "allocator.h"
+#include "detail.h"
+#include "rdesc.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int RDESC_AOT_NAME(init)(struct rdesc *parser,
+			 size_t seminfo_size,
+			 void (*token_destroyer)(uint16_t id, void *seminfo)) _rdesc_wur;
+
+int RDESC_AOT_NAME(init_with_allocator)(struct rdesc *parser,
+					size_t seminfo_size,
+					void (*token_destroyer)(uint16_t id, void *seminfo),
+					const struct rdesc_allocator *allocator) _rdesc_wur;
+
+void RDESC_AOT_NAME(destroy)(struct rdesc *parser);
+
+int RDESC_AOT_NAME(start)(struct rdesc *parser, uint16_t start_symbol) _rdesc_wur;
+
+int RDESC_AOT_NAME(reparse)(struct rdesc *parser,
+			    uint16_t start_symbol,
+			    size_t position,
+			    size_t removed,
+			    const uint16_t *ids,
+			    const void *seminfos,
+			    size_t inserted) _rdesc_wur;
+
+int RDESC_AOT_NAME(stream)(struct rdesc *parser,
+			   uint16_t start_symbol,
+			   void (*consumer)(struct rdesc *parser,
+					    struct rdesc_node *root,
+					    void *ctx),
+			   void *ctx) _rdesc_wur;
+
+void RDESC_AOT_NAME(reset)(struct rdesc *parser);
+
+void RDESC_AOT_NAME(clear)(struct rdesc *parser);
+
+enum rdesc_result RDESC_AOT_NAME(pump)(struct rdesc *parser,
+				       uint16_t id,
+				       void *seminfo) _rdesc_wur;
+
+static inline enum rdesc_result RDESC_AOT_NAME(resume)(struct rdesc *parser)
+{ return RDESC_AOT_NAME(pump)(parser, 0, NULL); } _rdesc_wur
+
+enum rdesc_result RDESC_AOT_NAME(pump_many)(struct rdesc *parser,
+					    const uint16_t *ids,
+					    const void *seminfos,
+					    size_t n,
+					    size_t *consumed) _rdesc_wur;
+
+int RDESC_AOT_NAME(memoize)(struct rdesc *parser, size_t memory_limit) _rdesc_wur;
+
+int RDESC_AOT_NAME(seminfo_sizes)(struct rdesc *parser, const size_t *sizes) _rdesc_wur;
+
+int RDESC_AOT_NAME(recover)(struct rdesc *parser,
+			    const struct rdesc_sync *syncs,
+			    size_t count) _rdesc_wur;
+
+struct rdesc_node *RDESC_AOT_NAME(root)(struct rdesc *parser);
+
+size_t RDESC_AOT_NAME(error_position)(const struct rdesc *parser);
+
+void RDESC_AOT_NAME(read_stats)(const struct rdesc *parser, struct rdesc_stats *stats);
+
+size_t RDESC_AOT_NAME(expected_tokens)(const struct rdesc *parser,
+				       uint16_t *ids, size_t max);
+
+int RDESC_AOT_NAME(take_cst)(struct rdesc *parser, struct rdesc_cst *cst) _rdesc_wur;
+
+struct rdesc_node *RDESC_AOT_NAME(cst_root)(const struct rdesc_cst *cst);
+
+void RDESC_AOT_NAME(cst_destroy)(struct rdesc_cst *cst);
+
+#ifdef __cplusplus
+}
+#endif
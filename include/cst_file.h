@@ -0,0 +1,71 @@
+/**
+ * @file cst_file.h
+ * @brief Binary files of concrete syntax trees.
+ *
+ * A CST file holds a detached CST in the layout of its stacks. Nodes refer
+ * to each other and to their tokens by index, so the file is read back by
+ * mapping it into memory, without deserializing its nodes.
+ *
+ * Seminfo is saved byte by byte. Trees whose seminfo holds pointers cannot be
+ * read back in another process.
+ *
+ * Files are only read back by a library built for the same word size, byte
+ * order and `COMPACT_INDEX` flag.
+ */
+
+#ifndef RDESC_CST_FILE_H
+#define RDESC_CST_FILE_H
+
+#include <stdio.h>
+
+struct rdesc_cst;  /* defined in rdesc.h */
+
+
+/** @brief Version of the CST file format, bumped on layout changes. */
+#define RDESC_CST_FILE_VERSION 1
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Writes a CST detached with `rdesc_take_cst` to a file.
+ *
+ * @param cst CST to save.
+ * @param out Binary output file stream.
+ *
+ * @return Non-zero value if writing fails.
+ */
+int rdesc_cst_save(const struct rdesc_cst *cst, FILE *out);
+
+/**
+ * @brief Maps a file written by `rdesc_cst_save` as a read-only CST.
+ *
+ * The CST can be read with `cst_macros.h` as a detached one. It holds no
+ * token destroyer and SHALL be closed with `rdesc_cst_close` instead of
+ * `rdesc_cst_destroy`.
+ *
+ * The file is validated so that the CST macros stay within the mapping:
+ * sizes of the stacks, child, parent and token indices, child counts, and
+ * offsets of packed seminfo. Each node is reached once from the root. Seminfo
+ * is read with the sizes of the parser that saved the tree.
+ *
+ * @param cst CST to initialize.
+ * @param path Path of the file.
+ *
+ * @return Non-zero value if the file cannot be mapped, it is not a valid CST
+ *         file of this version and build, or validating it runs out of
+ *         memory.
+ */
+int rdesc_cst_open(struct rdesc_cst *cst, const char *path);
+
+/** @brief Unmaps a CST opened by `rdesc_cst_open`. */
+void rdesc_cst_close(struct rdesc_cst *cst);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif
@@ -19,24 +19,57 @@
 #include <stddef.h>
 
 struct rdesc;  /* defined in rdesc.h */
+struct rdesc_cst;  /* defined in rdesc.h */
 
 
 /** @cond */
 #define _rdesc_priv_node_deref(node) (*(struct _rdesc_priv_node *) (node))
 
-/* Returns index of parent of the node, or `SIZE_MAX` if the node is root. */
+/* Returns index of parent of the node, or `(_rdesc_priv_idx_t) -1` if the
+ * node is root. */
 #define _rdesc_priv_parent_idx(node) _rdesc_priv_node_deref(node).parent
 
+/* Third argument, which selects a macro by the number of arguments before
+ * it. */
+#define _rdesc_priv_third(a, b, c, ...) c
+
+#define _rdesc_priv_tape_seminfo_of(p, tk_node) \
+	_rdesc_priv_tape_seminfo(p, _rdesc_priv_node_deref(tk_node).n.tk.index)
+
+/* One-argument `rseminfo` of earlier versions, which cannot find the tape.
+ * Fails to compile with the name of the field in the diagnostic. */
+#define _rdesc_priv_seminfo_without_parser(tk_node) \
+	((void *) sizeof(struct { \
+		int rseminfo_takes_the_parser_as_its_first_argument : -1; \
+	}))
+
 /* Returns index of the child in stack. */
 #define _rdesc_priv_child_idx(nt_node, child_index) \
-	(*(size_t *) (&((uint8_t *) ((struct _rdesc_priv_node *) nt_node + 1)) \
-		[(child_index) * sizeof(size_t)]))
+	(*(_rdesc_priv_idx_t *) \
+	 (&((uint8_t *) ((struct _rdesc_priv_node *) nt_node + 1)) \
+		[(child_index) * sizeof(_rdesc_priv_idx_t)]))
 
 #ifdef __cplusplus
 extern "C"
 #endif
 struct rdesc_node *_rdesc_priv_cst_illegal_access(const struct rdesc *parser,
 						  size_t index);
+
+#ifdef __cplusplus
+extern "C"
+#endif
+void *_rdesc_priv_tape_seminfo(const struct rdesc *parser, size_t index);
+
+#ifdef __cplusplus
+extern "C"
+#endif
+struct rdesc_node *_rdesc_priv_cst_node(const struct rdesc_cst *cst,
+					size_t index);
+
+#ifdef __cplusplus
+extern "C"
+#endif
+void *_rdesc_priv_cst_seminfo(const struct rdesc_cst *cst, size_t index);
 /** @endcond */
 
 
@@ -59,9 +92,22 @@ struct rdesc_node *_rdesc_priv_cst_illegal_access(const struct rdesc *parser,
 /** @brief Returns the 15-bit identifier for underlying token/nonterminal. */
 #define rid(node) _rdesc_priv_node_deref(node).n.nt.id
 
-/** @brief Returns a reference to token's seminfo field */
-#define rseminfo(tk_node) \
-	((void *) &_rdesc_priv_node_deref(tk_node).n.tk.seminfo)
+/**
+ * @brief Returns a reference to token's seminfo field, `rseminfo(p,
+ * tk_node)`.
+ *
+ * Seminfo lives in the parser's token tape, not in the node. The reference is
+ * valid only until the next pump, `rdesc_start` or `rdesc_reset` call, copy
+ * the seminfo to keep it longer. NULL if a cut has released the token, see
+ * `CUT`.
+ *
+ * @note Migration: earlier versions took the node alone, `rseminfo(tk_node)`,
+ *       and the reference lived as long as the node. Pass the parser first,
+ *       as `rchild` takes it. The one-argument form fails to compile.
+ */
+#define rseminfo(...) \
+	_rdesc_priv_third(__VA_ARGS__, _rdesc_priv_tape_seminfo_of, \
+			  _rdesc_priv_seminfo_without_parser, )(__VA_ARGS__)
 
 /** @brief Returns id of nonterminal variant that is matched. */
 #define rvariant(nt_node) \
@@ -75,6 +121,21 @@ struct rdesc_node *_rdesc_priv_cst_illegal_access(const struct rdesc *parser,
 #define rchild(p, nt_node, child_idx) \
 	_rdesc_priv_cst_illegal_access(p, _rdesc_priv_child_idx(nt_node, child_idx))
 
+/** @brief `rparent` for a CST detached with `rdesc_take_cst`. */
+#define rcst_parent(cst, node) \
+	_rdesc_priv_cst_node(cst, _rdesc_priv_parent_idx(node))
+
+/**
+ * @brief `rseminfo` for a CST detached with `rdesc_take_cst`, the reference
+ * is valid until the CST is destroyed.
+ */
+#define rcst_seminfo(cst, tk_node) \
+	_rdesc_priv_cst_seminfo(cst, _rdesc_priv_node_deref(tk_node).n.tk.index)
+
+/** @brief `rchild` for a CST detached with `rdesc_take_cst`. */
+#define rcst_child(cst, nt_node, child_idx) \
+	_rdesc_priv_cst_node(cst, _rdesc_priv_child_idx(nt_node, child_idx))
+
 #else
 #undef RDESC_CST_MACROS
 
@@ -92,4 +153,10 @@ struct rdesc_node *_rdesc_priv_cst_illegal_access(const struct rdesc *parser,
 
 #undef rchild
 
+#undef rcst_parent
+
+#undef rcst_seminfo
+
+#undef rcst_child
+
 #endif
@@ -20,6 +20,16 @@ void _rdesc_priv_dummy_declaration(void);
 #endif
 
 
+/* Type of CST stack indexes stored in nodes. RDESC_COMPACT_INDEX flag makes
+ * them 32-bit, which limits the CST to 4G stack elements. The largest value
+ * marks the parent of the root. */
+#ifdef RDESC_COMPACT_INDEX
+typedef uint32_t _rdesc_priv_idx_t;
+#else
+typedef size_t _rdesc_priv_idx_t;
+#endif
+
+
 /* These structs are private and should only be accessed via the provided
  * CST macros. */
 
@@ -30,7 +40,17 @@ struct _rdesc_priv_tk {
 	uint16_t id : 15  /* Token identifier (0 reserved, 1-32767 valid). */;
 
 	uint32_t seminfo  /* Semantic info starts here and extends into
-			   * the flexible array member in _rdesc_priv_node. */;
+			   * the rest of the token tape element. If token ids
+			   * have their own seminfo sizes, offset of the
+			   * seminfo in the packed seminfo buffer. */;
+};
+
+struct _rdesc_priv_tk_node {
+	uint16_t _pad : 1;
+	uint16_t id : 15;
+
+	uint32_t index  /* Position of the token in the parser's tape, 32-bit
+			 * to keep nodes as small as nonterminals. */;
 };
 
 struct _rdesc_priv_nt {
@@ -42,15 +62,14 @@ struct _rdesc_priv_nt {
 };
 
 struct _rdesc_priv_node {
-	/* ALSO CHANGE sizeof_node macro for any change in this struct. */
-	size_t parent  /* Index of parent. */;
+	_rdesc_priv_idx_t parent  /* Index of parent. */;
 	uint16_t unwind_size  /* Previous node's unwind size (for backward
 		               * navigation on the stack). */;
 
 	union {
 		uint16_t ty : 1  /* 0 for token and 1 for nonterminal. */;
 
-		struct _rdesc_priv_tk tk;
+		struct _rdesc_priv_tk_node tk;
 		struct _rdesc_priv_nt nt;
 	} n;
 };
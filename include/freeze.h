@@ -0,0 +1,138 @@
+/**
+ * @file freeze.h
+ * @brief Struct-of-arrays copy of a concrete syntax tree.
+ *
+ * Nodes of the CST are variable-sized records holding their type, id,
+ * variant, parent and child list together. A frozen CST keeps each field in
+ * its own array, so that passes reading a few fields, such as ids and child
+ * ranges, touch only those arrays.
+ *
+ * Nodes of a frozen CST are `uint32_t` indexes in breadth-first order, the
+ * root is 0. Children of a node have consecutive indexes.
+ */
+
+#ifndef RDESC_FREEZE_H
+#define RDESC_FREEZE_H
+
+#include "allocator.h"
+#include "detail.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct rdesc;  /* defined in rdesc.h */
+struct rdesc_cst;  /* defined in rdesc.h */
+
+
+/** @brief Parent index of the root of a frozen CST. */
+#define RDESC_FROZEN_NONE UINT32_MAX
+
+/**
+ * @brief Concrete syntax tree in struct-of-arrays layout, created by
+ * `rdesc_freeze` or `rdesc_cst_freeze`.
+ *
+ * Token nodes refer to their position in the token tape of the tree they are
+ * frozen from, which holds their seminfo.
+ */
+struct rdesc_frozen_cst {
+	/** @cond */
+
+	size_t node_count;
+
+	/* Index of the parent, RDESC_FROZEN_NONE for the root. */
+	uint32_t *parents;
+
+	/* Index of the first child of nonterminals, tape position of
+	 * tokens. */
+	uint32_t *links;
+
+	/* Id of the node, with the highest bit set for nonterminals. */
+	uint16_t *ids;
+
+	/* Matched variant of nonterminals, 0 for tokens. */
+	uint16_t *variants;
+
+	/* Number of children of nonterminals, 0 for tokens. */
+	uint16_t *child_counts;
+
+	const struct rdesc_allocator *allocator;
+
+	/** @endcond */
+};
+
+
+/** @cond */
+#ifdef __cplusplus
+extern "C"
+#endif
+void *_rdesc_priv_tape_seminfo(const struct rdesc *parser, size_t index);
+
+#ifdef __cplusplus
+extern "C"
+#endif
+void *_rdesc_priv_cst_seminfo(const struct rdesc_cst *cst, size_t index);
+/** @endcond */
+
+
+/** @brief Returns the number of nodes in the frozen CST. */
+#define rfrozen_node_count(frozen) ((frozen)->node_count)
+
+/** @brief Returns node type (RDESC_TOKEN or RDESC_NONTERMINAL). */
+#define rfrozen_type(frozen, n) ((frozen)->ids[n] >> 15)
+
+/** @brief Returns the 15-bit identifier for underlying token/nonterminal. */
+#define rfrozen_id(frozen, n) ((frozen)->ids[n] & 0x7fff)
+
+/** @brief Returns id of nonterminal variant that is matched. */
+#define rfrozen_variant(frozen, n) ((frozen)->variants[n])
+
+/** @brief Returns number of child nodes. */
+#define rfrozen_child_count(frozen, n) ((frozen)->child_counts[n])
+
+/** @brief Returns child of the node by its index. */
+#define rfrozen_child(frozen, n, child_idx) ((frozen)->links[n] + (child_idx))
+
+/** @brief Returns parent of the node, or `RDESC_FROZEN_NONE` for the root. */
+#define rfrozen_parent(frozen, n) ((frozen)->parents[n])
+
+/**
+ * @brief Returns a reference to token's seminfo field, for a CST frozen from
+ * the parser. Valid as long as `rseminfo` is.
+ */
+#define rfrozen_seminfo(p, frozen, tk_n) \
+	_rdesc_priv_tape_seminfo(p, (frozen)->links[tk_n])
+
+/** @brief `rfrozen_seminfo` for a CST frozen from a detached CST. */
+#define rfrozen_cst_seminfo(cst, frozen, tk_n) \
+	_rdesc_priv_cst_seminfo(cst, (frozen)->links[tk_n])
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Copies the CST matched last by the parser into struct-of-arrays
+ * layout.
+ *
+ * The frozen CST is allocated with the parser's allocator, and is independent
+ * of the parser except for the seminfo of its tokens.
+ *
+ * @return Non-zero value if memory allocation fails.
+ */
+int rdesc_freeze(const struct rdesc *parser,
+		 struct rdesc_frozen_cst *frozen) _rdesc_wur;
+
+/** @brief `rdesc_freeze` for a CST detached with `rdesc_take_cst`. */
+int rdesc_cst_freeze(const struct rdesc_cst *cst,
+		     struct rdesc_frozen_cst *frozen) _rdesc_wur;
+
+/** @brief Frees memory of a frozen CST. */
+void rdesc_frozen_destroy(struct rdesc_frozen_cst *frozen);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif
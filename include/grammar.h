@@ -12,43 +12,151 @@
 #ifndef RDESC_GRAMMAR_H
 #define RDESC_GRAMMAR_H
 
+#include "allocator.h"
 #include "detail.h"
 
+#include <stdbool.h>
 #include <stdint.h>
 
 
 /**
  * @brief Grammar definition.
  *
- * The production rules are dimensioned as a 3D array where variants are tried
- * in order:
- * - [nt_count][nt_variant_count][nt_body_length]
+ * Production rules are stored in compressed sparse row form: the variants of
+ * each nonterminal are consecutive production bodies, and the symbols of each
+ * body are consecutive packed symbols, see `RDESC_SYMBOL_NONTERMINAL`.
+ * Variants are tried in order.
+ *
+ * Tables derived from the rules have a row for each variant and an
+ * end-of-construct row after the variants of each nonterminal, at
+ * `variants[nt_id] + nt_id + variant`.
+ *
+ * An initialized grammar is never written to; parsers only read it. A grammar
+ * may be shared by parsers in any number of threads without synchronization,
+ * provided its initialization happens before, and its destruction after, the
+ * parsers use it. A parser itself is used by one thread at a time, see
+ * `pool.h` for handing parsers between threads.
  */
 struct rdesc_grammar {
-	/** @brief Grammar production rules. */
-	const struct rdesc_grammar_symbol *rules;
+	/**
+	 * @brief Index of the first body of each nonterminal in `bodies`,
+	 * dimensioned as [nt_count + 1]. The nonterminal `n` has
+	 * `variants[n + 1] - variants[n]` variants.
+	 */
+	const uint32_t *variants;
+
+	/**
+	 * @brief Index of the first symbol of each body in `symbols`,
+	 * dimensioned as [variants[nt_count] + 1]. The body `b` has
+	 * `bodies[b + 1] - bodies[b]` symbols.
+	 */
+	const uint32_t *bodies;
+
+	/**
+	 * @brief Packed symbols of the bodies. If the rules contain cuts, a
+	 * copy with cuts removed.
+	 */
+	const uint16_t *symbols;
 
 	/** @brief Total number of nonterminals. */
 	uint16_t nt_count;
 
 	/**
-	 * @brief Maximum number of variants, used to segment the production
-	 * rules array into a 3D array.
+	 * @brief Dense production rules the grammar is initialized from with
+	 * `rdesc_grammar_init`, NULL for sparse rules. The grammar does not
+	 * read them after the initialization, the pointer is valid as long as
+	 * the caller keeps the rules.
+	 */
+	const struct rdesc_grammar_symbol *rules;
+
+	/**
+	 * @brief Maximum number of variants of the dense rules, used to
+	 * segment `rules` into a 3D array. 0 for sparse rules.
 	 */
 	uint16_t nt_variant_count;
 
-	/** @brief Maximum length of a production body (symbols per variant). */
+	/**
+	 * @brief Maximum length of a production body of the dense rules
+	 * (symbols per variant). 0 for sparse rules.
+	 */
 	uint16_t nt_body_length;
 
+	/**
+	 * @brief Whether the three arrays above are allocated by the grammar,
+	 * converted from dense rules or copied with cuts removed.
+	 */
+	bool owns_rules;
+
 	/**
 	 * @brief Array of child capacities for each nonterminal.
 	 *
-	 * Specifies maximum children for each nonterminal's matched variants,
-	 * used for CST stack memory allocation.
+	 * Specifies maximum children for each nonterminal's matched variants.
 	 */
-	uint16_t *child_caps;
+	const uint16_t *child_caps;
+
+	/**
+	 * @brief Body length of each row.
+	 *
+	 * A nonterminal reserves the child capacity of the variant it is at,
+	 * used for CST stack memory allocation. Variants of a left-recursive
+	 * nonterminal share the capacity of the longest one, as its match
+	 * grows in place.
+	 */
+	const uint16_t *variant_child_caps;
+
+	/**
+	 * @brief Number of bits in a FIRST set, one more than the largest
+	 * token id in the grammar.
+	 */
+	uint16_t tk_count;
+
+	/**
+	 * @brief FIRST sets of each row, `(tk_count + 7) / 8` bytes each.
+	 *
+	 * Bit `n` is set if the variant can start with the token `n`. As
+	 * token id 0 is reserved, bit 0 marks variants that can match empty
+	 * input. Used for skipping variants that cannot match the next token.
+	 */
+	const uint8_t *first_sets;
+
+	/**
+	 * @brief FIRST sets of the symbols after the leading nonterminal of
+	 * directly left-recursive bodies, dimensioned as `first_sets`. NULL
+	 * if the grammar has no left recursion.
+	 *
+	 * A left-recursive body is never descended into, its FIRST set in
+	 * `first_sets` is empty. Instead, once its nonterminal has matched,
+	 * the match grows into the body if the next token is in this set.
+	 * Bit 0 of the set of the first variant marks the nonterminals that
+	 * have a left-recursive body.
+	 */
+	const uint8_t *grow_sets;
+
+	/**
+	 * @brief Number of symbols before the cut in each row. `UINT16_MAX`
+	 * for bodies without a cut, NULL if the grammar has no cut.
+	 */
+	const uint16_t *cuts;
+
+	/** @brief Allocator of the tables above. */
+	const struct rdesc_allocator *allocator;
 };
 
+/**
+ * @brief Bit of packed symbols marking nonterminals. The rest of the bits hold
+ * the token or nonterminal id.
+ */
+#define RDESC_SYMBOL_NONTERMINAL 0x8000
+
+/** @brief Packed symbol of a cut, see `CUT` in `rule_macros.h`. */
+#define RDESC_SYMBOL_CUT 0xffff
+
+/**
+ * @brief Maximum number of nonterminals. Nonterminal id 0x7fff is reserved, as
+ * its packed symbol is `RDESC_SYMBOL_CUT`.
+ */
+#define RDESC_NONTERMINAL_COUNT_MAX 0x7fff
+
 /** @brief Symbol type discriminator for `rdesc_grammar_symbol`. */
 enum rdesc_grammar_symbol_type {
 	RDESC_TOKEN,
@@ -75,13 +183,66 @@ struct rdesc_grammar_symbol {
 extern "C" {
 #endif
 
-/** @brief Initializes a grammar struct. */
+/**
+ * @brief Initializes a grammar struct from dense production rules, as defined
+ * with `rule_macros.h`, dimensioned as
+ * [nonterminal_count][nonterminal_variant_count][nonterminal_body_length].
+ *
+ * The rules are converted into the sparse form, which the parsers use. They
+ * are not read after the call, see `rules`.
+ *
+ * Returns non-zero if allocation fails, if the rules are malformed, or if the
+ * α of a left-recursive body, `A → A α`, may match no token. Rules are
+ * malformed if there are more than `RDESC_NONTERMINAL_COUNT_MAX`
+ * nonterminals, a symbol id is out of range, or a body contains more than one
+ * cut.
+ */
 int rdesc_grammar_init(struct rdesc_grammar *grammar,
 		       uint16_t nonterminal_count,
 		       uint16_t nonterminal_variant_count,
 		       uint16_t nonterminal_body_length,
 		       const struct rdesc_grammar_symbol *production_rules) _rdesc_wur;
 
+/**
+ * @brief `rdesc_grammar_init` with a custom allocator.
+ *
+ * `allocator` is used for the tables derived from the rules, NULL selects
+ * libc `malloc`. It must outlive the grammar.
+ */
+int rdesc_grammar_init_with_allocator(struct rdesc_grammar *grammar,
+				      uint16_t nonterminal_count,
+				      uint16_t nonterminal_variant_count,
+				      uint16_t nonterminal_body_length,
+				      const struct rdesc_grammar_symbol *production_rules,
+				      const struct rdesc_allocator *allocator) _rdesc_wur;
+
+/**
+ * @brief Initializes a grammar struct from production rules in sparse form,
+ * see `struct rdesc_grammar` for the arrays, which must outlive the grammar.
+ *
+ * Symbols are packed, a body may contain one `RDESC_SYMBOL_CUT`. Rules with
+ * cuts are copied without them. `rdesc_dump_sparse` converts dense rules into
+ * this form.
+ *
+ * Returns non-zero on the errors of `rdesc_grammar_init`, or if the offsets
+ * in `variants` and `bodies` decrease, `variants` does not start at 0, or a
+ * body has `UINT16_MAX` symbols or more.
+ */
+int rdesc_grammar_init_sparse(struct rdesc_grammar *grammar,
+			      uint16_t nonterminal_count,
+			      const uint32_t *variants,
+			      const uint32_t *bodies,
+			      const uint16_t *symbols) _rdesc_wur;
+
+/** @brief `rdesc_grammar_init_sparse` with a custom allocator, see
+ * `rdesc_grammar_init_with_allocator`. */
+int rdesc_grammar_init_sparse_with_allocator(struct rdesc_grammar *grammar,
+					     uint16_t nonterminal_count,
+					     const uint32_t *variants,
+					     const uint32_t *bodies,
+					     const uint16_t *symbols,
+					     const struct rdesc_allocator *allocator) _rdesc_wur;
+
 /** @brief Frees resources allocated by the grammar. */
 void rdesc_grammar_destroy(struct rdesc_grammar *grammar);
 
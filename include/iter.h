@@ -0,0 +1,103 @@
+/**
+ * @file iter.h
+ * @brief Non-recursive CST traversal.
+ *
+ * Iterators walk a CST through the parent and child indexes stored in its
+ * nodes. They use constant memory and no recursion, so that any depth of
+ * nesting can be traversed.
+ *
+ * An iterator keeps the path to its node for the nearest `RDESC_ITER_FRAMES`
+ * ancestors, so that stepping to a sibling or climbing to a parent reads no
+ * parent index. Only ancestors deeper than that are found through parent
+ * indexes, by searching the child list of their parents.
+ */
+
+#ifndef RDESC_ITER_H
+#define RDESC_ITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct rdesc;  /* defined in rdesc.h */
+struct rdesc_cst;  /* defined in rdesc.h */
+struct rdesc_node;
+
+
+/** @brief Order in which an iterator visits nodes. */
+enum rdesc_iter_order {
+	/** Parents before their children. */
+	RDESC_PREORDER,
+	/** Children before their parents. */
+	RDESC_POSTORDER,
+	/** Tokens only, in input order. */
+	RDESC_LEAVES,
+};
+
+/** @brief Number of ancestors an iterator keeps on its path. */
+#define RDESC_ITER_FRAMES 32
+
+/** @brief Iterator over a subtree of a CST. */
+struct rdesc_iter {
+	/** @cond */
+
+	/* First node of the CST stack, which does not move while the CST is
+	 * unchanged. */
+	struct rdesc_node *nodes;
+
+	enum rdesc_iter_order order;
+
+	/* CST stack indexes of the subtree root and of the node returned
+	 * next, which is SIZE_MAX once the iteration ends. */
+	size_t root;
+	size_t next;
+
+	/* Ring of the ancestors of the last node returned: CST stack index of
+	 * each ancestor and the position of the path in its child list. `top`
+	 * is the parent, `cached` is the number of ancestors kept. */
+	size_t frames[RDESC_ITER_FRAMES];
+	uint16_t positions[RDESC_ITER_FRAMES];
+	unsigned top, cached;
+
+	/** @endcond */
+};
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Initializes an iterator over the subtree of `root` in the parser's
+ * CST.
+ *
+ * The iterator is valid as long as the CST is not changed, that is until the
+ * next pump, `rdesc_start` or `rdesc_reset` call.
+ *
+ * @param iter Iterator to initialize.
+ * @param parser Parser holding the CST.
+ * @param root Root of the subtree, NULL for the root of the CST.
+ * @param order Order of the traversal.
+ */
+void rdesc_iter_init(struct rdesc_iter *iter,
+		     const struct rdesc *parser,
+		     struct rdesc_node *root,
+		     enum rdesc_iter_order order);
+
+/** @brief `rdesc_iter_init` for a CST detached with `rdesc_take_cst`. */
+void rdesc_cst_iter_init(struct rdesc_iter *iter,
+			 const struct rdesc_cst *cst,
+			 struct rdesc_node *root,
+			 enum rdesc_iter_order order);
+
+/**
+ * @brief Returns the next node of the traversal, or NULL after the last
+ * node.
+ */
+struct rdesc_node *rdesc_iter_next(struct rdesc_iter *iter);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif
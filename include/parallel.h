@@ -0,0 +1,107 @@
+/**
+ * @file parallel.h
+ * @brief Parsing a token array of many matches with several threads.
+ *
+ * Inputs such as a file of statements consist of consecutive matches of the
+ * start symbol. `rdesc_parse_parallel` splits the tokens into chunks after
+ * separator tokens, such as statement terminators, and parses the chunks on
+ * parsers of a pool at the same time.
+ *
+ * A separator does not necessarily end a match: a `;` may be nested in a
+ * block. Chunk boundaries are therefore speculative. The chunks are joined in
+ * order afterwards, and a chunk is kept only if the matches before it end
+ * exactly at its start. Otherwise, tokens from the end of the last kept match
+ * are parsed again on the calling thread until a match ends at the start of a
+ * later chunk.
+ *
+ * Requires the `pool` feature, and POSIX threads.
+ */
+
+#ifndef RDESC_PARALLEL_H
+#define RDESC_PARALLEL_H
+
+#include "allocator.h"
+#include "detail.h"
+#include "rdesc.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct rdesc_pool;  /* defined in pool.h */
+
+
+/** @brief CSTs of consecutive matches, in input order. */
+struct rdesc_cst_list {
+	/** @brief Detached trees, see `rdesc_take_cst`. */
+	struct rdesc_cst *csts;
+
+	/** @brief Number of trees. */
+	size_t count;
+
+	/** @cond */
+
+	size_t cap;
+	const struct rdesc_allocator *allocator;
+
+	/** @endcond */
+};
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Parses the tokens as consecutive matches of the start symbol with
+ * at most `thread_count` threads, including the calling one.
+ *
+ * Each thread acquires a parser from the pool for the duration of the call.
+ * The calling thread needs one, other threads that find the pool exhausted
+ * leave their share of the work to the rest. The CSTs equal those a single
+ * parser produces when matching the tokens one after another.
+ *
+ * Tokens of speculative parses are discarded, so the parsers of the pool
+ * cannot have a token destroyer. The start symbol should not match empty
+ * input.
+ *
+ * @param pool Pool of the parsers, which may be used by other threads too.
+ * @param start_symbol Start symbol of each match.
+ * @param ids Identifiers of the tokens, none of which may be 0.
+ * @param seminfos Array of `n` semantic informations, each of
+ *        `seminfo_size` bytes of the pool's parsers. NULL is acceptable.
+ * @param n Number of tokens.
+ * @param separators Tokens after which a chunk may start.
+ * @param separator_count Number of separator tokens.
+ * @param thread_count Maximum number of threads.
+ * @param list List receiving the CSTs of the matches before the first failure.
+ *        Destroy with `rdesc_cst_list_destroy` unless `RDESC_ENOMEM` is
+ *        returned.
+ * @param error_position Receives the index of the token no variant could
+ *        continue with after `RDESC_NOMATCH`, or the first token of the
+ *        unfinished match if the tokens run out. May be NULL.
+ *
+ * @return `RDESC_READY` if all tokens are matched, `RDESC_CONTINUE` if the
+ *         tokens end inside an unfinished match, `RDESC_NOMATCH` if a match
+ *         fails, or `RDESC_ENOMEM` if memory allocation fails or every
+ *         parser of the pool is acquired.
+ */
+enum rdesc_result rdesc_parse_parallel(struct rdesc_pool *pool,
+				       uint16_t start_symbol,
+				       const uint16_t *ids,
+				       const void *seminfos,
+				       size_t n,
+				       const uint16_t *separators,
+				       size_t separator_count,
+				       size_t thread_count,
+				       struct rdesc_cst_list *list,
+				       size_t *error_position) _rdesc_wur;
+
+/** @brief Destroys the CSTs of the list and frees it. */
+void rdesc_cst_list_destroy(struct rdesc_cst_list *list);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif
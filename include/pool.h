@@ -0,0 +1,107 @@
+/**
+ * @file pool.h
+ * @brief Fixed set of parsers shared by threads.
+ *
+ * A pool initializes its parsers once, and hands them out to threads with
+ * `rdesc_pool_acquire` and takes them back with `rdesc_pool_release`, without
+ * locks. Parsers keep their buffers between acquisitions, so that a request
+ * does not pay for `rdesc_init` and `rdesc_destroy`, nor for growing the
+ * buffers again after a similar request.
+ *
+ * All parsers of a pool share the grammar, which is read-only once
+ * initialized (see `rdesc_grammar`). The allocator is called from every
+ * thread using the pool, it must be thread-safe; the default `malloc` family
+ * is.
+ *
+ * Acquire and release use the `__atomic` builtins of GCC and Clang.
+ */
+
+#ifndef RDESC_POOL_H
+#define RDESC_POOL_H
+
+#include "allocator.h"
+#include "detail.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct rdesc;  /* defined in rdesc.h */
+struct rdesc_grammar;  /* defined in grammar.h */
+
+
+/** @brief Pool of parsers initialized with the same grammar. */
+struct rdesc_pool {
+	/** @cond */
+
+	/* Parsers of the pool, each followed by its acquired flag. */
+	struct _rdesc_priv_pool_slot *slots;
+	size_t size;
+
+	/* Slot the next acquisition starts looking at, incremented by each
+	 * acquisition to spread threads over the slots. */
+	size_t next;
+
+	const struct rdesc_allocator *allocator;
+
+	/** @endcond */
+};
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Initializes `size` parsers as `rdesc_init` does.
+ *
+ * Parsers may be configured (e.g. with `rdesc_memoize` or `rdesc_recover`)
+ * after they are acquired, the configuration persists across acquisitions.
+ *
+ * @param pool Pool to initialize, not used concurrently until this returns.
+ * @param size Number of parsers, at most as many threads acquire parsers at
+ *        the same time.
+ * @param allocator Allocator of the pool and its parsers, NULL for libc
+ *        `malloc` (must be thread-safe and outlive the pool).
+ *
+ * @return Non-zero value if memory allocation fails.
+ */
+int rdesc_pool_init(struct rdesc_pool *pool,
+		    size_t size,
+		    const struct rdesc_grammar *grammar,
+		    size_t seminfo_size,
+		    void (*token_destroyer)(uint16_t id, void *seminfo),
+		    const struct rdesc_allocator *allocator) _rdesc_wur;
+
+/**
+ * @brief Destroys the parsers and frees the pool.
+ *
+ * No parser of the pool should be acquired.
+ */
+void rdesc_pool_destroy(struct rdesc_pool *pool);
+
+/**
+ * @brief Takes a parser not acquired by another thread. Safe to call from any
+ * number of threads.
+ *
+ * The parser is owned by the calling thread until it is released, and is not
+ * in a parse.
+ *
+ * @return The parser, or NULL if every parser is acquired.
+ */
+struct rdesc *rdesc_pool_acquire(struct rdesc_pool *pool);
+
+/**
+ * @brief Resets the parser as `rdesc_clear` does, keeping its buffers, and
+ * returns it to the pool.
+ *
+ * The CST of the parser, and seminfo of its tokens, are no longer valid.
+ * Detach the tree with `rdesc_take_cst` before releasing to keep it.
+ */
+void rdesc_pool_release(struct rdesc_pool *pool, struct rdesc *parser);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif
@@ -10,8 +10,10 @@
 #ifndef RDESC_H
 #define RDESC_H
 
+#include "allocator.h"
 #include "detail.h"
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
 
@@ -37,6 +39,38 @@ enum rdesc_result {
 	RDESC_NOMATCH = 2,
 };
 
+/** @brief Opaque CST (Concrete Syntax Tree) node. */
+struct rdesc_node;
+
+/** @brief Synchronization token of a nonterminal, see `rdesc_recover`. */
+struct rdesc_sync {
+	/** @brief Nonterminal that recovers at the token. */
+	uint16_t nt_id;
+	/** @brief Token the skipped tokens end at. */
+	uint16_t tk_id;
+	/**
+	 * @brief Whether the token belongs to the error node, as a statement
+	 * terminator does. Otherwise, as a closing brace, it is left to the
+	 * symbols after the nonterminal.
+	 */
+	bool consumed;
+};
+
+/** @brief Work counters of a parser, see `rdesc_read_stats`. */
+struct rdesc_stats {
+	/**
+	 * @brief Number of times the parser has backtracked to retry a
+	 * nonterminal with its next variant.
+	 */
+	size_t backtracks;
+
+	/**
+	 * @brief Number of tokens rewound by backtracking, which are pumped
+	 * again from the token tape.
+	 */
+	size_t rewound_tokens;
+};
+
 /** @brief Recursive descent parser state. */
 struct rdesc {
 	/** @cond */
@@ -47,6 +81,10 @@ struct rdesc {
 	/* Size in bytes allocated for each token's semantic information. */
 	size_t seminfo_size;
 
+	/* Seminfo size of each token id, NULL if every token has
+	 * `seminfo_size` bytes. Set via `rdesc_seminfo_sizes`. */
+	const size_t *seminfo_sizes;
+
 	/* - Error Recovery -
 	 *
 	 * Extra space for holding a token in case of memory allocation error.
@@ -59,22 +97,97 @@ struct rdesc {
 	size_t cur  /* (current) Nonterminal being expanded; may not be
 		     * the top element. */;
 	uint16_t top_unwind  /* Stack's top node's unwind distance. */;
+	size_t position  /* Number of tokens in the CST, that is the position
+			  * of the next token in the input. */;
+	size_t farthest  /* Position after the farthest token the match has
+			  * examined. */;
+	size_t cut  /* Number of CST stack elements committed by a cut, which
+		     * backtracking cannot remove. */;
+	size_t released  /* Number of tokens a cut has released, positions
+			  * are relative to the first token after them. */;
+	size_t released_nodes  /* Number of CST stack elements whose tokens
+				* are released. */;
+
+	/* - Diagnostics - */
+	size_t error_position  /* Position after the farthest token a symbol
+				* has failed at, 0 if none has failed. */;
+	uint8_t *expected  /* Bitset of the tokens expected at that position,
+			    * of `(tk_count + 7) / 8` bytes. Allocated on the
+			    * first start. */;
+
+	/* - Panic Mode -
+	 *
+	 * Synchronization token sets of each nonterminal set via
+	 * `rdesc_recover`, NULL if recovery is disabled. */
+	uint8_t *syncs;
+	size_t skip_end  /* Tokens before this position are skipped by the
+			  * open error node, regardless of synchronization
+			  * tokens. */;
+
+	/* Allocator of the parser's buffers. */
+	const struct rdesc_allocator *allocator;
 
 	/* Destructor method for tokens the parser owns. */
 	void (*token_destroyer)(uint16_t, void *);
 
-	/* Token stack used to store tokens temporarily during nonterminal
-	 * backtracking. */
-	struct rdesc_stack *token_stack;
+	/* Append-only token tape holding every token of the parse in input
+	 * order. Token nodes in the CST refer to their tape position, tokens
+	 * from `position` on are not consumed yet. Backtracking rewinds
+	 * `position` instead of moving tokens out of the CST. */
+	struct rdesc_stack *tape;
+
+	/* Seminfo of the tokens in the tape packed back to back, if token ids
+	 * have their own seminfo sizes. Tape elements then hold the offset of
+	 * their seminfo instead of the seminfo itself. NULL otherwise. */
+	struct rdesc_stack *seminfos;
 
 	/* Underlying concrete syntax tree. */
 	struct rdesc_stack *cst_stack;
 
+	/* Packrat memoization table, NULL unless enabled via
+	 * `rdesc_memoize`. */
+	struct rdesc_memo *memo;
+
+	/* - Streaming -
+	 *
+	 * Callback receiving each CST matched in streaming mode, NULL if the
+	 * parser is not streaming. The parser restarts at `start_symbol` after
+	 * calling it. */
+	void (*consumer)(struct rdesc *, struct rdesc_node *, void *);
+	void *consumer_ctx;
+	uint16_t start_symbol;
+
+	/* Counters since the initialization. */
+	struct rdesc_stats stats;
+
 	/** @endcond */
 };
 
-/** @brief Opaque CST (Concrete Syntax Tree) node. */
-struct rdesc_node;
+/**
+ * @brief Concrete syntax tree detached from its parser by `rdesc_take_cst`.
+ *
+ * Nodes are accessed with the `rcst_*` macros in cst_macros.h, in place of
+ * the macros taking the parser.
+ */
+struct rdesc_cst {
+	/** @cond */
+
+	/* Nodes of the tree, in the layout of the parser's CST stack. */
+	struct rdesc_stack *nodes;
+
+	/* Tokens of the tree, referred by token nodes. */
+	struct rdesc_stack *tape;
+
+	/* Packed seminfo of the tokens, NULL if it is held in the tape. */
+	struct rdesc_stack *seminfos;
+
+	void (*token_destroyer)(uint16_t, void *);
+
+	/* Allocator of the parser the tree is taken from. */
+	const struct rdesc_allocator *allocator;
+
+	/** @endcond */
+};
 
 
 #ifdef __cplusplus
@@ -96,6 +209,18 @@ int rdesc_init(struct rdesc *parser,
 	       size_t seminfo_size,
 	       void (*token_destroyer)(uint16_t id, void *seminfo)) _rdesc_wur;
 
+/**
+ * @brief `rdesc_init` with a custom allocator.
+ *
+ * @param allocator Allocator for the parser's buffers, including the
+ *        memoization table, NULL for libc `malloc` (must outlive parser).
+ */
+int rdesc_init_with_allocator(struct rdesc *parser,
+			      const struct rdesc_grammar *grammar,
+			      size_t seminfo_size,
+			      void (*token_destroyer)(uint16_t id, void *seminfo),
+			      const struct rdesc_allocator *allocator) _rdesc_wur;
+
 /**
  * @brief Frees memory allocated by the parser and destroys the parser instance.
  */
@@ -108,20 +233,106 @@ void rdesc_destroy(struct rdesc *parser);
  */
 int rdesc_start(struct rdesc *parser, uint16_t start_symbol) _rdesc_wur;
 
+/**
+ * @brief Replaces tokens in the tape and starts matching the start symbol
+ * over the whole edited tape, grafting memoized subtrees of the current CST.
+ *
+ * The tape holds the tokens of the current or the last match, followed by
+ * the tokens pumped after it. `removed` tokens at `position` are destroyed
+ * and `inserted` tokens take their place. `rdesc_resume` then matches the
+ * whole tape.
+ *
+ * Subtrees of the CST that neither contain an edited token nor examined one
+ * as lookahead are memoized at their positions in the edited tape, so that
+ * the match grafts them instead of deriving them again. The memory limit
+ * should exceed the size of the CST.
+ *
+ * @note This is not incremental parsing. Grafting copies subtrees node by
+ *       node, so a reparse still takes time linear in the size of the tape
+ *       and the CST. It saves the descent into rules and the backtracking
+ *       of the unedited subtrees, not the walk over them.
+ *
+ * @param parser Parser instance with memoization enabled, which should not be
+ *        streaming.
+ * @param start_symbol Nonterminal the edited tape matches.
+ * @param position Tape position of the first removed token.
+ * @param removed Number of tokens to remove.
+ * @param ids Identifiers of the inserted tokens, none of which may be 0.
+ * @param seminfos Array of `inserted` semantic informations, each of
+ *        `seminfo_size` bytes. NULL is acceptable.
+ * @param inserted Number of tokens to insert.
+ *
+ * @return Non-zero value if memory allocation fails. The tape and the CST are
+ *         left as they were, and the edit can be retried.
+ */
+int rdesc_reparse(struct rdesc *parser,
+		  uint16_t start_symbol,
+		  size_t position,
+		  size_t removed,
+		  const uint16_t *ids,
+		  const void *seminfos,
+		  size_t inserted) _rdesc_wur;
+
+/**
+ * @brief Starts a stream of matches of the start symbol.
+ *
+ * Each time the start symbol matches, the parser calls `consumer` with the
+ * CST and restarts at the start symbol on its own, keeping its buffers and
+ * the tokens after the match. Pumping continues with the next statement, so
+ * `rdesc_pump` and `rdesc_pump_many` return `RDESC_READY` never, and a single
+ * `rdesc_pump_many` call can parse many statements.
+ *
+ * The CST and seminfo of its tokens are valid until `consumer` returns, the
+ * consumer owns the tokens. `consumer` shall not call other functions with
+ * the parser, except the ones accessing the CST and `rdesc_take_cst`.
+ *
+ * The stream ends with `RDESC_NOMATCH` or `rdesc_reset`. If restarting fails,
+ * `RDESC_ENOMEM` is returned and `rdesc_resume` retries.
+ *
+ * @param parser Parser instance, which should not be in a parse.
+ * @param start_symbol Nonterminal each statement of the stream matches.
+ * @param consumer Callback receiving the parser, the root of the CST and
+ *        `ctx`.
+ * @param ctx Context pointer passed to `consumer`.
+ *
+ * @return Non-zero value if memory allocation fails.
+ */
+int rdesc_stream(struct rdesc *parser,
+		 uint16_t start_symbol,
+		 void (*consumer)(struct rdesc *parser,
+				  struct rdesc_node *root,
+				  void *ctx),
+		 void *ctx) _rdesc_wur;
+
 /**
  * @brief Resets the parser to its initial state.
  */
 void rdesc_reset(struct rdesc *parser);
 
+/**
+ * @brief Resets the parser as `rdesc_reset` does, keeping its buffers for
+ * the next parse.
+ *
+ * Buffers are not shrunk until `rdesc_reset`, neither by this call nor by
+ * the parses after it. Use between parses of similar inputs, to avoid
+ * growing the buffers again, as `rdesc_pool_release` does.
+ */
+void rdesc_clear(struct rdesc *parser);
+
 /**
  * @brief Drives the parsing process, the pump.
  *
  * As the central engine of the parser, it consumes tokens from either the
- * internal backtracking stack or the provided id.
+ * token tape, which holds tokens rewound by backtracking, or the provided id.
+ *
+ * A nonterminal with a directly left-recursive variant, `A → A α`, grows its
+ * match while the next token can start α, so it completes one token after
+ * its last one. A left-recursive start symbol is `RDESC_READY` after that
+ * token, which is kept for the next match.
  *
  * @param parser Pointer to the parser instance.
  * @param id **15-bit** identifier of the next token to consume.
- *        - **ID 0 is reserved** for resuming from the backtrack stack. This
+ *        - **ID 0 is reserved** for resuming from the token tape. This
  *          occurs after start symbol changes or memory allocation error
  *          retries.
  * @param seminfo Extra semantic information for the token.
@@ -142,13 +353,117 @@ enum rdesc_result rdesc_pump(struct rdesc *parser,
  *
  * Resumes using either:
  * - The saved token from a previous ENOMEM error, or
- * - A token from the backtrack stack
+ * - Tokens rewound in the token tape
  *
  * This is equivalent to `rdesc_pump(parser, 0, NULL)`.
  */
 static inline enum rdesc_result rdesc_resume(struct rdesc *parser)
 { return rdesc_pump(parser, 0, NULL); } _rdesc_wur
 
+/**
+ * @brief Pumps an array of tokens in a single call.
+ *
+ * Resumes the parser first, as in `rdesc_resume`, and then consumes tokens
+ * in order until the parse ends with `RDESC_READY`, `RDESC_NOMATCH` or
+ * `RDESC_ENOMEM`, or the array runs out. Produces the same result as
+ * pumping the tokens one by one, without the per-call overhead.
+ *
+ * The parser owns the consumed tokens, including the one pumped last
+ * regardless of the result. The rest of the array can be provided after the
+ * next `rdesc_start`, or after `RDESC_ENOMEM`, in the next call.
+ *
+ * @param parser Pointer to the parser instance.
+ * @param ids Identifiers of the tokens, none of which may be 0.
+ * @param seminfos Array of `n` semantic informations, each of
+ *        `seminfo_size` bytes. NULL is acceptable.
+ * @param n Number of tokens in the arrays.
+ * @param consumed Number of tokens consumed from the arrays.
+ *
+ * @return The current status of the parse operation. `RDESC_CONTINUE` means
+ *         all tokens are consumed.
+ *
+ * @warning Raises an error if the parser is not started.
+ */
+enum rdesc_result rdesc_pump_many(struct rdesc *parser,
+				  const uint16_t *ids,
+				  const void *seminfos,
+				  size_t n,
+				  size_t *consumed) _rdesc_wur;
+
+/**
+ * @brief Enables packrat memoization.
+ *
+ * Results of nonterminal expansions are remembered by (nonterminal, token
+ * position). When backtracking retries a nonterminal at a position it was
+ * already tried at, the memoized subtree is grafted into the CST or the
+ * expansion is rejected at once, instead of being derived again. This bounds
+ * the work done on grammars with shared prefixes that otherwise backtrack
+ * exponentially.
+ *
+ * The table is direct-mapped, colliding entries evict each other. Matched
+ * subtrees are copied into the table, when they exceed `memory_limit` older
+ * snapshots are evicted in clock order. Memoization is best-effort: a failed
+ * snapshot allocation is not reported.
+ *
+ * @param parser Parser instance, which should not be in a parse.
+ * @param memory_limit Upper bound for bytes used by the table and the
+ *        snapshots. 0 disables memoization.
+ *
+ * @return Non-zero value if memory allocation fails.
+ */
+int rdesc_memoize(struct rdesc *parser, size_t memory_limit) _rdesc_wur;
+
+/**
+ * @brief Gives each token id its own seminfo size.
+ *
+ * Seminfo of tokens is packed back to back in a separate buffer, so tokens
+ * without semantic information take no space for it. `seminfo_size` of the
+ * parser remains the largest size, and the stride of the `seminfos` array of
+ * `rdesc_pump_many`.
+ *
+ * @param parser Parser instance, which should not be in a parse and should
+ *        not hold tokens.
+ * @param sizes Seminfo size of each token id, indexed by id, none larger than
+ *        `seminfo_size` (must outlive parser). NULL gives every token
+ *        `seminfo_size` bytes.
+ *
+ * @return Non-zero value if memory allocation fails, the parser is left as
+ *         is.
+ */
+int rdesc_seminfo_sizes(struct rdesc *parser, const size_t *sizes) _rdesc_wur;
+
+/**
+ * @brief Enables panic-mode error recovery at synchronization tokens.
+ *
+ * When all variants of a nonterminal having synchronization tokens have
+ * failed, it is matched as an error node instead of backtracking into the
+ * nonterminals containing it. The node skips the tokens from its start
+ * position up to `rdesc_error_position`, and then until one of its
+ * synchronization tokens. The match continues after it, and the tokens and
+ * the CST are kept. Backtracking cannot remove the error node and the nodes
+ * before it, as if a cut were after it.
+ *
+ * An error node is at the variant after the last variant of its nonterminal,
+ * where the end-of-construct row of the production rules is. Its children are
+ * the first and the last token it has skipped, or the only one.
+ *
+ * A nonterminal does not recover if it would skip no token, that is, if it
+ * fails at a synchronization token that is not consumed. Backtracking then
+ * continues as usual. Nor does it recover at a token none of its variants can
+ * start with, as it is not entered there.
+ *
+ * @param parser Parser instance, which should not be in a parse.
+ * @param syncs Array of `count` nonterminal and synchronization token pairs.
+ *        A nonterminal may have many tokens.
+ * @param count Number of pairs. 0 disables recovery.
+ *
+ * @return Non-zero value if memory allocation fails, the parser is left as
+ *         is.
+ */
+int rdesc_recover(struct rdesc *parser,
+		  const struct rdesc_sync *syncs,
+		  size_t count) _rdesc_wur;
+
 /**
  * @brief Returns the root of the CST.
  *
@@ -156,6 +471,64 @@ static inline enum rdesc_result rdesc_resume(struct rdesc *parser)
  */
 struct rdesc_node *rdesc_root(struct rdesc *parser);
 
+/**
+ * @brief Returns the tape position of the token the match has failed at.
+ *
+ * Symbols of the match fail at various tokens while the parser backtracks,
+ * the farthest of them is reported. After `RDESC_NOMATCH`, it is the number
+ * of tokens of the statement before the token no variant could continue
+ * with. Valid until the next start.
+ */
+size_t rdesc_error_position(const struct rdesc *parser);
+
+/**
+ * @brief Reads the work counters of the parser.
+ *
+ * Counters accumulate from `rdesc_init`, and are not cleared by
+ * `rdesc_reset`. Differences between two reads measure the work in between.
+ */
+void rdesc_read_stats(const struct rdesc *parser, struct rdesc_stats *stats);
+
+/**
+ * @brief Lists the tokens that are expected at `rdesc_error_position`.
+ *
+ * The list holds each token some failed symbol could start with at that
+ * position, in ascending order of ids. Subtrees grafted from a CST of
+ * `rdesc_reparse` do not add the tokens they have expected.
+ *
+ * @param parser Parser instance whose match has failed.
+ * @param ids Array receiving at most `max` token ids.
+ * @param max Size of the array.
+ *
+ * @return Number of the expected tokens, which may exceed `max`.
+ */
+size_t rdesc_expected_tokens(const struct rdesc *parser,
+			     uint16_t *ids, size_t max);
+
+/**
+ * @brief Moves the CST matched last out of the parser.
+ *
+ * The tree and its tokens, together with the token destroyer, are moved into
+ * `cst` without copying, and the parser continues with fresh buffers. Tokens
+ * left after the match stay in the parser for the next `rdesc_start`. The
+ * tree stays valid until `rdesc_cst_destroy`, independently of the parser.
+ *
+ * May be called after `RDESC_READY`, or by the consumer of a stream.
+ *
+ * @return Non-zero value if memory allocation fails, the parser is left as
+ *         is.
+ */
+int rdesc_take_cst(struct rdesc *parser, struct rdesc_cst *cst) _rdesc_wur;
+
+/** @brief Returns the root of a detached CST. */
+struct rdesc_node *rdesc_cst_root(const struct rdesc_cst *cst);
+
+/**
+ * @brief Destroys tokens of a detached CST with its token destroyer and frees
+ * its memory.
+ */
+void rdesc_cst_destroy(struct rdesc_cst *cst);
+
 #ifdef __cplusplus
 }
 #endif
@@ -40,6 +40,8 @@
 #define EOB -1
 /** @brief Integer representing EOC (end-of-construct). */
 #define EOC -2
+/** @brief Integer representing EOP (end-of-prefix), see `CUT`. */
+#define EOP -3
 
 /** @cond */
 /** sentinel struct for the end of a rule's body */
@@ -59,6 +61,27 @@
  */
 #define EPSILON SEOB
 
+/**
+ * @brief Cut operator, commits the parse to the prefix of the body before it.
+ *
+ * Once the symbols before the cut match, the nonterminal is committed to
+ * its variant: if the rest of the body fails, or backtracking later reaches
+ * the symbols before the cut, the nonterminal fails as a whole, without
+ * retrying its later variants or any alternative of the symbols before the
+ * cut. Nonterminals containing it backtrack as usual.
+ *
+ * When no nonterminal of the parse can be retried any more, the parse is
+ * committed: the tokens matched so far are passed to the token destroyer
+ * and dropped from the tape, while their nodes stay in the CST with no
+ * seminfo. A list committing at each item, as `r(NT(STMT), CUT, NT(STMTS))
+ * alt EPSILON` does, keeps only the tokens of its last item in the tape,
+ * however long the input is.
+ *
+ * `r(TK(LET), CUT, NT(IDENT), TK(EQ), NT(EXPR))` commits to a let
+ * statement once `let` is seen. A body may contain at most one cut.
+ */
+#define CUT { .ty = RDESC_SENTINEL, .id = EOP }
+
 
 /**
  * @brief Macro to define a grammar rule. Adds end-of-body and construct
@@ -105,6 +128,10 @@
  * ```
  *
  *
+ * The parser also accepts the directly left-recursive rule itself, see
+ * `rlr`, and derives a left-leaning CST without the `A'` nodes, the ε
+ * matches and the `rdesc_flip_left` pass.
+ *
  * @param head The base nonterminal.
  * @param base The initial production sequence (beta).
  * @param suffix The repeating production sequence (alpha).
@@ -113,6 +140,29 @@
 	r(_rdesc_priv_trim_paren base, NT(POSTFIX_NT_REST(head))), \
 	ropt(_rdesc_priv_trim_paren suffix, NT(POSTFIX_NT_REST(head)))
 
+/**
+ * @brief Defines a left-recursive list rule in place of `rrr`, with the same
+ * parameters.
+ *
+ * `rlr(A, (β), (α))` is equivalent to:
+ * ```c
+ * A → A α / β
+ * ```
+ *
+ * The match of A grows as each α completes, into the CST `rdesc_flip_left`
+ * rotates the one of `rrr` into, without a rotation pass. Unlike `rrr`, it
+ * defines one nonterminal: remove A' from the nonterminals of the grammar
+ * when replacing `rrr`.
+ *
+ * @param head The list nonterminal.
+ * @param base The initial production sequence (beta).
+ * @param suffix The repeating production sequence (alpha), which shall
+ *        consume a token.
+ */
+#define rlr(head, base, suffix) \
+	r(NT(head), _rdesc_priv_trim_paren suffix \
+	  alt _rdesc_priv_trim_paren base)
+
 /**
  * @brief Separates grammar alternatives (variant separator).
  *
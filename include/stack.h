@@ -20,6 +20,9 @@
 #ifndef RDESC_STACK_H
 #define RDESC_STACK_H
 
+#include "allocator.h"
+
+#include <stdbool.h>
 #include <stddef.h>
 
 struct rdesc_stack;
@@ -36,6 +39,16 @@ struct rdesc_stack;
  */
 void rdesc_stack_init(struct rdesc_stack **stack, size_t element_size);
 
+/**
+ * @brief `rdesc_stack_init` with a custom allocator.
+ *
+ * @param allocator Allocator for the stack's memory, NULL for libc
+ *        `malloc`. Must outlive the stack.
+ */
+void rdesc_stack_init_with_allocator(struct rdesc_stack **stack,
+				     size_t element_size,
+				     const struct rdesc_allocator *allocator);
+
 /**
  * @brief Frees all memory allocated by the stack.
  *
@@ -92,13 +105,21 @@ void *rdesc_stack_push(struct rdesc_stack **stack, void *element);
  * @brief Pops multiple elements from the stack, and returns pointer to the
  *        element that was at the bottom of the popped range.
  *
- *
  * @note This may trigger realloc. The stack implementation should handle
  *       allocation errors and hide them from upper layers.
  * @note If count is 0, this is a no-op and returns current top.
  */
 void *rdesc_stack_multipop(struct rdesc_stack **stack, size_t count);
 
+/**
+ * @brief Sets whether popping keeps the capacity of the stack.
+ *
+ * A retaining stack is shrunk only by `rdesc_stack_reset`, for stacks that
+ * are filled to a similar length repeatedly. Stacks do not retain after
+ * initialization.
+ */
+void rdesc_stack_retain(struct rdesc_stack *stack, bool retain);
+
 /**
  * @brief Removes and returns the top element from the stack.
  *
@@ -114,5 +135,49 @@ void *rdesc_stack_top(struct rdesc_stack *stack);
 /** @brief Returns the current number of elements in the stack. */
 size_t rdesc_stack_len(const struct rdesc_stack *stack);
 
+/**
+ * @brief Returns the size in bytes of the relocatable image of the stack.
+ *
+ * An image holds the elements of the stack in a form that can be read back
+ * from any address, such as a memory-mapped file. Image sizes are multiples
+ * of 16, so that images written back to back stay aligned.
+ *
+ * @note Images are only required by the `cst_file` feature.
+ */
+size_t rdesc_stack_image_size(const struct rdesc_stack *stack);
+
+/**
+ * @brief Writes the relocatable image of the stack.
+ *
+ * @param stack Stack to write.
+ * @param write Callback writing `size` bytes of the image at `data`, returns
+ *              non-zero value if writing fails.
+ * @param ctx User context passed to `write`.
+ *
+ * @return Non-zero value if writing fails.
+ */
+int rdesc_stack_write_image(const struct rdesc_stack *stack,
+			    int (*write)(const void *data, size_t size,
+					 void *ctx),
+			    void *ctx);
+
+/**
+ * @brief Returns a read-only stack viewing an image written by
+ * `rdesc_stack_write_image`.
+ *
+ * The view is neither copied nor owned, it is valid as long as the image is.
+ * It SHALL NOT be modified or destroyed.
+ *
+ * @param image Image to view, aligned to 16 bytes.
+ * @param size Number of bytes readable from the image.
+ * @param element_size Set to the size of the elements of the image.
+ * @param image_size Set to the size of the image.
+ *
+ * @return NULL if the image is malformed or exceeds `size`.
+ */
+struct rdesc_stack *rdesc_stack_view_image(void *image, size_t size,
+					   size_t *element_size,
+					   size_t *image_size);
+
 
 #endif
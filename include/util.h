@@ -36,6 +36,7 @@ void rdesc_dump_cst(FILE *out,
  * @brief Dumps the grammar in BNF format.
  *
  * Prints all production rules in human-readable BNF format. (e.g.`A ::= B / C`)
+ * Cuts are printed as `^`.
  *
  * @param out Output file stream.
  * @param grammar Underlying grammar struct.
@@ -49,6 +50,72 @@ void rdesc_dump_bnf(FILE *out,
 		    const char *const tk_names[],
                     const char *const nt_names[]);
 
+/**
+ * @brief Dumps the grammar as C source of a parser specialized to it.
+ *
+ * The source holds the grammar as constant tables and compiles the pump
+ * against them, so that the compiler folds grammar dimensions, child
+ * capacities and sentinel checks into it. The generated parser produces the
+ * same CST as `rdesc_pump`, which can be read with `cst_macros.h`.
+ *
+ * Functions of the generated parser are `<prefix>_init`, `<prefix>_pump` and
+ * so on, with the same signatures as their `rdesc_*` counterparts, except
+ * `<prefix>_init` which takes no grammar and initializes the parser with the
+ * compiled one.
+ *
+ * The source includes `rdesc.c`, rdesc's `src` and `include` directories
+ * should be in the include path while compiling it. See `RDESC_AOT_RULE` in
+ * rdesc.mk.
+ *
+ * @param source_out Output file stream for the C source.
+ * @param header_out Output file stream for the header declaring the parser.
+ * @param grammar Underlying grammar struct.
+ * @param prefix Identifier prefix of the generated parser.
+ */
+void rdesc_dump_c(FILE *source_out,
+		  FILE *header_out,
+		  const struct rdesc_grammar *grammar,
+		  const char *prefix);
+
+/**
+ * @brief Dumps the grammar as C source of a constant grammar.
+ *
+ * Unlike `rdesc_dump_c`, only the grammar is generated: its rules, child
+ * capacities, FIRST sets and cuts as constant tables, and
+ * `<prefix>_grammar` pointing to a `struct rdesc_grammar` referring to them.
+ * The grammar is used with `rdesc_init` directly; it is neither initialized
+ * nor destroyed, and holds no heap memory.
+ *
+ * Only `grammar.h` is included by the source. See `RDESC_GRAMMAR_RULE` in
+ * rdesc.mk.
+ *
+ * @param source_out Output file stream for the C source.
+ * @param header_out Output file stream for the header declaring the grammar.
+ * @param grammar Underlying grammar struct.
+ * @param prefix Identifier prefix of the generated grammar.
+ */
+void rdesc_dump_grammar(FILE *source_out,
+			FILE *header_out,
+			const struct rdesc_grammar *grammar,
+			const char *prefix);
+
+/**
+ * @brief Dumps the production rules of the grammar as C source of the arrays
+ * `rdesc_grammar_init_sparse` accepts.
+ *
+ * Converts rules defined with `rule_macros.h` into the sparse form, which
+ * spends no memory on the padding of the dense table. The source defines
+ * `<prefix>_variants`, `<prefix>_bodies` and `<prefix>_symbols`, the
+ * nonterminal count is one less than the length of `<prefix>_variants`.
+ *
+ * @param out Output file stream.
+ * @param grammar Underlying grammar struct.
+ * @param prefix Identifier prefix of the arrays.
+ */
+void rdesc_dump_sparse(FILE *out,
+		       const struct rdesc_grammar *grammar,
+		       const char *prefix);
+
 /**
  * @brief Rotates a right-recursive concrete syntax tree into a left-recursive
  * form.
@@ -76,6 +143,10 @@ void rdesc_dump_bnf(FILE *out,
  * and only if all nonterminals complete their bodies; this condition cannot be
  * met if the start symbol (the root) is a recursive nonterminal.
  *
+ * Directly left-recursive rules are matched natively into the left-leaning
+ * form, without the `A'` nodes or a rotation. Replacing `rrr` with `rlr`,
+ * and removing `A'`, gives the same CST without this pass.
+ *
  * @param parser Pointer to the rdesc parser instance.
  * @param parent The parent node of the subtree root being rotated.
  * @param child_index The index of the target node (A) within the parent's
@@ -3,12 +3,12 @@
 # configuration variables and can be modified or used outside of this Makefile
 # (e.g. set via environment variables).
 
-# Select features from 'stack', 'flip_left', 'dump_cst', 'dump_bnf' or use 'full'.
+# Select features from 'stack', 'flip_left', 'freeze', 'iter', 'cst_file',
+# 'dump_cst', 'dump_bnf', 'dump_c', 'pool', 'parallel' or use 'full'.
 RDESC_FEATURES ?= stack flip_left
 # release, debug, or test
 RDESC_MODE ?= release
-# Available flags: 'ASSERTIONS', or use 'full' (currently only one flag
-# available, but in future new flags for extra checks may implemented)
+# Available flags: 'ASSERTIONS', 'COMPACT_INDEX', or use 'full'.
 RDESC_FLAGS ?= ASSERTIONS
 
 # Directory containing rdesc source files.
@@ -29,14 +29,22 @@ RDESC ?= $(rdesc_TARGET_DIR)/librdesc.a
 # Variables below this line are private.
 # -----------------------------------------------------------------------------
 # Object files linked regardless of MODE or FEATURES
-rdesc_OBJ_MANDATORY := rdesc grammar
+rdesc_OBJ_MANDATORY := rdesc grammar memo allocator
 # Object files linked if MODE is set to 'test'
 rdesc_OBJ_TEST := test_instruments
 
-rdesc_ALL_FEATURES := stack flip_left dump_cst dump_bnf
-rdesc_ALL_FLAGS := ASSERTIONS
+rdesc_ALL_FEATURES := stack flip_left freeze iter cst_file dump_cst dump_bnf dump_c \
+	pool parallel
+rdesc_ALL_FLAGS := ASSERTIONS COMPACT_INDEX
+# Flags changing the layout of public structs, which code including the
+# headers must be compiled with.
+rdesc_ABI_FLAGS := COMPACT_INDEX
 
-rdesc_CFLAGS_COMMON := -std=c99 -Wall -Wextra -pedantic -fPIC \
+# Link programs using RDESC with RDESC_LDLIBS, which adds POSIX threads for
+# the 'parallel' feature.
+RDESC_LDLIBS := $(if $(filter parallel full,$(RDESC_FEATURES)),-pthread)
+
+rdesc_CFLAGS_COMMON := -std=c99 -Wall -Wextra -pedantic -fPIC $(RDESC_LDLIBS) \
 			$(foreach f,\
 				$(if $(filter $(RDESC_FLAGS),full),\
 					$(rdesc_ALL_FLAGS),\
@@ -46,6 +54,13 @@ rdesc_CFLAGS_COMMON := -std=c99 -Wall -Wextra -pedantic -fPIC \
 					$(rdesc_ALL_FEATURES),\
 					$(RDESC_FEATURES)),-DRDESC_$f)
 
+# Compile code including rdesc headers with RDESC_PUBLIC_CFLAGS.
+RDESC_PUBLIC_CFLAGS := $(foreach f,\
+				$(filter $(rdesc_ABI_FLAGS),\
+					$(if $(filter $(RDESC_FLAGS),full),\
+						$(rdesc_ALL_FLAGS),\
+						$(RDESC_FLAGS))),-DRDESC_$f)
+
 rdesc_CFLAGS_release := $(rdesc_CFLAGS_COMMON) -O2
 rdesc_CFLAGS_debug := $(rdesc_CFLAGS_COMMON) -O0 -g3
 rdesc_CFLAGS_test := $(rdesc_CFLAGS_COMMON) -O0 -g3 --coverage -fprofile-arcs -DTEST_INSTRUMENTS
@@ -74,7 +89,7 @@ $(RDESC): $(rdesc_OBJS)
 	$(AR) rcs $@ $^
 
 $(RDESC_SO): $(rdesc_OBJS)
-	$(CC) $(CFLAGS) -shared -o $@ $^
+	$(CC) $(CFLAGS) -shared -o $@ $^ $(RDESC_LDLIBS)
 
 $(rdesc_OBJ_DIR)/%.o: $(rdesc_SRC_DIR)/%.c | $(rdesc_OBJ_DIR)
 	$(CC) $(CFLAGS) -MMD -MP -c $< -o $@
@@ -83,4 +98,46 @@ $(rdesc_OBJ_DIR):
 	$(rdesc_MKDIR) $@
 
 
+# - Ahead-of-time Grammar Compiler -
+# $(eval $(call RDESC_AOT_RULE,name,header)) adds a rule generating name_aot.c
+# and name_aot.h in RDESC_AOT_DIR: a parser with name_* functions, specialized
+# to the production table `name` declared in the header. Compile name_aot.c
+# with RDESC_AOT_CFLAGS, which follow the current RDESC_MODE, and link it
+# against RDESC.
+RDESC_AOT_DIR ?= $(rdesc_DIST_DIR)/aot
+RDESC_AOT_CFLAGS := $(rdesc_CFLAGS) \
+	-I$(RDESC_INCLUDE_DIR) -I$(rdesc_SRC_DIR) -I$(RDESC_AOT_DIR)
+
+rdesc_AOT_SRCS := $(RDESC_DIR)/tools/rdesc_aot.c \
+	$(rdesc_SRC_DIR)/allocator.c $(rdesc_SRC_DIR)/grammar.c \
+	$(rdesc_SRC_DIR)/dump_c.c
+
+define RDESC_AOT_RULE
+$(RDESC_AOT_DIR)/$1_aot.h: $(RDESC_AOT_DIR)/$1_aot.c
+
+$(RDESC_AOT_DIR)/$1_aot.c: $2 $(rdesc_AOT_SRCS)
+	$(rdesc_MKDIR) $(RDESC_AOT_DIR)
+	$(CC) -std=c99 -DRDESC_AOT_HEADER='"$(abspath $2)"' \
+		-DRDESC_AOT_RULES=$1 $(rdesc_AOT_SRCS) -o $(RDESC_AOT_DIR)/$1.aot
+	$(RDESC_AOT_DIR)/$1.aot $1 \
+		$(RDESC_AOT_DIR)/$1_aot.c $(RDESC_AOT_DIR)/$1_aot.h
+endef
+
+# $(eval $(call RDESC_GRAMMAR_RULE,name,header)) adds a rule generating
+# name_grammar.c and name_grammar.h in RDESC_AOT_DIR: the constant grammar
+# `name_grammar` of the production table `name`, used with rdesc_init without
+# initialization. Compile name_grammar.c with RDESC_AOT_CFLAGS.
+define RDESC_GRAMMAR_RULE
+$(RDESC_AOT_DIR)/$1_grammar.h: $(RDESC_AOT_DIR)/$1_grammar.c
+
+$(RDESC_AOT_DIR)/$1_grammar.c: $2 $(rdesc_AOT_SRCS)
+	$(rdesc_MKDIR) $(RDESC_AOT_DIR)
+	$(CC) -std=c99 -DRDESC_AOT_HEADER='"$(abspath $2)"' \
+		-DRDESC_AOT_RULES=$1 $(rdesc_AOT_SRCS) \
+		-o $(RDESC_AOT_DIR)/$1_grammar.aot
+	$(RDESC_AOT_DIR)/$1_grammar.aot -g $1 \
+		$(RDESC_AOT_DIR)/$1_grammar.c $(RDESC_AOT_DIR)/$1_grammar.h
+endef
+
+
 -include $(rdesc_OBJS:.o=.d)
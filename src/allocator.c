@@ -0,0 +1,36 @@
+#include "../include/allocator.h"
+#include "allocator.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+
+
+static void *libc_alloc(void *ctx, size_t size)
+{
+	(void) ctx;
+
+	return malloc(size);
+}
+
+static void *libc_realloc(void *ctx, void *ptr, size_t old_size, size_t size)
+{
+	(void) ctx;
+	(void) old_size;
+
+	return realloc(ptr, size);
+}
+
+static void libc_free(void *ctx, void *ptr, size_t size)
+{
+	(void) ctx;
+	(void) size;
+
+	free(ptr);
+}
+
+const struct rdesc_allocator rdesc_libc_allocator = {
+	.alloc = libc_alloc,
+	.realloc = libc_realloc,
+	.free = libc_free,
+	.ctx = NULL,
+};
@@ -0,0 +1,16 @@
+/* Allocator resolution shared by the parser, grammar and stack. */
+
+#ifndef RDESC_PRIV_ALLOCATOR_H
+#define RDESC_PRIV_ALLOCATOR_H
+
+#include "../include/allocator.h"
+
+
+/* Allocator used if none is given, forwards to the libc `malloc` family. */
+extern const struct rdesc_allocator rdesc_libc_allocator;
+
+#define allocator_or_libc(allocator) \
+	((allocator) != NULL ? (allocator) : &rdesc_libc_allocator)
+
+
+#endif
@@ -60,16 +60,84 @@
 /** @brief Macro highlights type casts. */
 #define cast(t, exp) ((t) (exp))
 
-/** @brief Internal macro for casting symbol table pointer to 3D array type. */
-#define productions(grammar) \
-	(*cast(const struct rdesc_grammar_symbol (*) \
-		[(grammar).nt_count][(grammar).nt_variant_count][(grammar).nt_body_length], \
-	      (grammar).rules))
+/** @brief Internal macro for the number of variants of a nonterminal. */
+#define variant_count(grammar, nt_id) \
+	((grammar).variants[(nt_id) + 1] - (grammar).variants[nt_id])
 
+/** @brief Internal macro for the index of a production body in `bodies`. */
+#define body_index(grammar, nt_id, variant) \
+	((size_t) (grammar).variants[nt_id] + (variant))
 
-/** @brief Size of a token node for parser (including its seminfo field). */
+/** @brief Internal macro for the symbols of a production body. */
+#define body_of(grammar, nt_id, variant) \
+	(&(grammar).symbols[(grammar).bodies[body_index(grammar, nt_id, \
+							 variant)]])
+
+/** @brief Internal macro for the number of symbols in a production body. */
+#define body_length(grammar, nt_id, variant) \
+	((grammar).bodies[body_index(grammar, nt_id, variant) + 1] - \
+	 (grammar).bodies[body_index(grammar, nt_id, variant)])
+
+/**
+ * @brief Internal macro for the row of a production body in the tables
+ * derived from the rules, which have an end-of-construct row after the
+ * variants of each nonterminal.
+ */
+#define row_of(grammar, nt_id, variant) \
+	(body_index(grammar, nt_id, variant) + (nt_id))
+
+/** @brief Internal macro for the number of rows in the derived tables. */
+#define row_count(grammar) \
+	((size_t) (grammar).variants[(grammar).nt_count] + (grammar).nt_count)
+
+/** @brief Tests whether a packed symbol is a nonterminal. */
+#define is_nt_symbol(sym) ((sym) & RDESC_SYMBOL_NONTERMINAL)
+
+/** @brief Token or nonterminal id of a packed symbol. */
+#define symbol_id(sym) ((uint16_t) ((sym) & ~RDESC_SYMBOL_NONTERMINAL))
+
+/** @brief Internal macro for the FIRST set bitset of a production body. */
+#define first_set(grammar, nt_id, variant) \
+	(&(grammar).first_sets[row_of(grammar, nt_id, variant) * \
+			       (((grammar).tk_count + 7) / 8)])
+
+/** @brief Internal macro for the grow set of a production body. */
+#define grow_set(grammar, nt_id, variant) \
+	(&(grammar).grow_sets[row_of(grammar, nt_id, variant) * \
+			      (((grammar).tk_count + 7) / 8)])
+
+/** @brief Internal macro for the cut position of a production body. */
+#define cut_of(grammar, nt_id, variant) \
+	((grammar).cuts[row_of(grammar, nt_id, variant)])
+
+/** @brief Internal tape index of a token a cut has released. */
+#define RELEASED_TOKEN UINT32_MAX
+
+/** @brief Internal macro for the child capacity of a production body. */
+#define variant_child_cap(grammar, nt_id, variant) \
+	((grammar).variant_child_caps[row_of(grammar, nt_id, variant)])
+
+/**
+ * @brief Internal macro testing whether a production body starts with its own
+ * nonterminal, that is, directly left-recursive.
+ */
+#define is_left_recursive(grammar, nt_id, variant) \
+	(body_length(grammar, nt_id, variant) > 0 && \
+	 body_of(grammar, nt_id, variant)[0] == \
+	 (RDESC_SYMBOL_NONTERMINAL | (nt_id)))
+
+/** @brief Tests the bit of the token id in a FIRST set. */
+#define in_first_set(set, tk_id) (((set)[(tk_id) / 8] >> ((tk_id) % 8)) & 1)
+
+
+/**
+ * @brief Size of a token node for parser (including its seminfo field). With
+ * per token seminfo sizes, the seminfo field holds the offset of the packed
+ * seminfo.
+ */
 #define sizeof_tk(p) \
-	(sizeof(tk_t) /* token struct size */ \
+	((p).seminfos != NULL ? sizeof(tk_t) : \
+	 sizeof(tk_t) /* token struct size */ \
 	 - sizeof(uint32_t) /* minus dummy seminfo field size */ \
 	 + (p).seminfo_size /* plus parser's seminfo size */)
 
@@ -79,19 +147,24 @@
  */
 #define sizeof_nt(child_cap) \
 	(sizeof(nt_t) /* nonterminal struct size */ \
-	 + sizeof(size_t) * child_cap /* plus the space required for child
-				       * pointer list */)
+	 + sizeof(_rdesc_priv_idx_t) * child_cap /* plus the space required for
+						  * child pointer list */)
+
+/**
+ * @brief Size of a node that can be used interchangeably as either a token or
+ * a nonterminal (without child list). Token nodes refer to their seminfo in
+ * the tape, so it does not depend on the parser's seminfo size.
+ */
+#define sizeof_node(p) sizeof(node_t)
+
 
 /**
- * @brief Minimum size of a node that can be used interchangeably as either a
- * token (with seminfo) or a nonterminal (without child list).
+ * @brief Widens an index stored in a node to `size_t`, the parent index of
+ * the root becomes `SIZE_MAX`.
  */
-#define sizeof_node(p) \
-	((sizeof(size_t) + sizeof(uint16_t)) /* sizeof parent poiner +
-					      * sizeof element's offset */ \
-	 + (sizeof_tk(p) > sizeof_nt(0) ? /* plus the bigger node variant */ \
-		sizeof_tk(p) : \
-		sizeof_nt(0)))
+#define widen_idx(idx) \
+	((_rdesc_priv_idx_t) (idx) == (_rdesc_priv_idx_t) -1 ? \
+	 SIZE_MAX : (size_t) (idx))
 
 
 /** @cond */
@@ -0,0 +1,290 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "../include/allocator.h"
+#include "../include/cst_file.h"
+#include "../include/cst_macros.h"
+#include "../include/grammar.h"
+#include "../include/rdesc.h"
+#include "../include/stack.h"
+#include "allocator.h"
+#include "common.h"
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+#define CST_FILE_MAGIC "rdescCST"
+
+/* Written in native byte order, to detect files of another one. */
+#define BYTE_ORDER_MARK 0x01020304u
+
+/* The tape is followed by the packed seminfo buffer. */
+#define FLAG_PACKED_SEMINFO 1u
+
+/* Header of a CST file, which is followed by images of the node stack, the
+ * tape and the packed seminfo buffer. Its size keeps the images 16-byte
+ * aligned. */
+struct cst_file_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t byte_order;
+
+	/* Sizes of the types the images are laid out with. */
+	uint8_t word_size;
+	uint8_t index_size;
+	uint16_t flags;
+	uint32_t _reserved;
+
+	/* Size of the whole file. */
+	uint64_t size;
+};
+
+
+/* Writes image bytes to the output file stream in `ctx`. */
+static int write_file(const void *data, size_t size, void *ctx)
+{
+	return fwrite(data, 1, size, ctx) != size;
+}
+
+int rdesc_cst_save(const struct rdesc_cst *cst, FILE *out)
+{
+	struct cst_file_header header;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, CST_FILE_MAGIC, sizeof(header.magic));
+	header.version = RDESC_CST_FILE_VERSION;
+	header.byte_order = BYTE_ORDER_MARK;
+	header.word_size = sizeof(size_t);
+	header.index_size = sizeof(_rdesc_priv_idx_t);
+	header.flags = cst->seminfos != NULL ? FLAG_PACKED_SEMINFO : 0;
+	header.size = sizeof(header) +
+		rdesc_stack_image_size(cst->nodes) +
+		rdesc_stack_image_size(cst->tape) +
+		(cst->seminfos != NULL ?
+		 rdesc_stack_image_size(cst->seminfos) : 0);
+
+	if (fwrite(&header, sizeof(header), 1, out) != 1 ||
+	    rdesc_stack_write_image(cst->nodes, write_file, out) ||
+	    rdesc_stack_write_image(cst->tape, write_file, out) ||
+	    (cst->seminfos != NULL &&
+	     rdesc_stack_write_image(cst->seminfos, write_file, out)))
+		return 1;
+
+	return fflush(out) != 0;
+}
+
+static int valid_header(const struct cst_file_header *header, size_t size)
+{
+	return memcmp(header->magic, CST_FILE_MAGIC,
+		      sizeof(header->magic)) == 0 &&
+		header->version == RDESC_CST_FILE_VERSION &&
+		header->byte_order == BYTE_ORDER_MARK &&
+		header->word_size == sizeof(size_t) &&
+		header->index_size == sizeof(_rdesc_priv_idx_t) &&
+		(header->flags & ~FLAG_PACKED_SEMINFO) == 0 &&
+		header->size == size;
+}
+
+/* Views the image at `*offset` of the mapping if its elements are of
+ * `element_size` bytes, or of at least `min_element_size` bytes if
+ * `element_size` is zero, and moves the offset past it. */
+static struct rdesc_stack *view_image(uint8_t *mapping, size_t size,
+				      size_t *offset, size_t element_size,
+				      size_t min_element_size)
+{
+	size_t image_element_size, image_size;
+	struct rdesc_stack *s = rdesc_stack_view_image(mapping + *offset,
+						       size - *offset,
+						       &image_element_size,
+						       &image_size);
+
+	if (s == NULL ||
+	    (element_size != 0 && image_element_size != element_size) ||
+	    image_element_size < min_element_size)
+		return NULL;
+
+	*offset += image_size;
+
+	return s;
+}
+
+/* Returns whether the packed seminfo offsets of the tokens are in order and
+ * within the buffer, so that the seminfo of a token ends where the next one
+ * starts. */
+static bool valid_seminfo_offsets(const struct rdesc_cst *cst)
+{
+	size_t offset = 0;
+
+	for (size_t i = 0; i < rdesc_stack_len(cst->tape); i++) {
+		tk_t *tk = rdesc_stack_at(cst->tape, i);
+
+		if (tk->seminfo < offset ||
+		    tk->seminfo > rdesc_stack_len(cst->seminfos))
+			return false;
+
+		offset = tk->seminfo;
+	}
+
+	return true;
+}
+
+/* Walks the tree from the root, and returns whether each node is reached
+ * once, from a parent its parent index refers to. Child lists shall fit in
+ * the node stack and token nodes shall refer to the tape. Flipped trees do
+ * not keep children after their parents, so that nodes are marked as
+ * reached instead. */
+static bool valid_tree(const struct rdesc_cst *cst)
+{
+	const struct rdesc_allocator *allocator = allocator_or_libc(NULL);
+	size_t len = rdesc_stack_len(cst->nodes),
+	       tape_len = rdesc_stack_len(cst->tape),
+	       pending_len = 0;
+
+	/* Nodes are reached once, at most `len` of them are pending. */
+	size_t *pending = allocator->alloc(allocator->ctx,
+					   len * sizeof(size_t));
+	bool *reached = allocator->alloc(allocator->ctx, len * sizeof(bool));
+
+	if (pending == NULL || reached == NULL) {
+		if (pending != NULL)
+			allocator->free(allocator->ctx, pending,
+					len * sizeof(size_t));
+		if (reached != NULL)
+			allocator->free(allocator->ctx, reached,
+					len * sizeof(bool));
+
+		return false;
+	}
+
+	for (size_t i = 0; i < len; i++)
+		reached[i] = false;
+
+	node_t *root = rdesc_stack_at(cst->nodes, 0);
+	bool valid = widen_idx(_rdesc_priv_parent_idx(root)) == SIZE_MAX;
+	reached[0] = true;
+	pending[pending_len++] = 0;
+
+	while (valid && pending_len > 0) {
+		size_t idx = pending[--pending_len];
+		node_t *n = rdesc_stack_at(cst->nodes, idx);
+
+		if (rtype(n) == RDESC_TOKEN) {
+			valid = n->n.tk.index < tape_len ||
+				n->n.tk.index == RELEASED_TOKEN;
+
+			continue;
+		}
+
+		/* Child indices are held in the elements after the node. */
+		if (rchild_count(n) > (len - 1 - idx) * sizeof(node_t) /
+		    sizeof(_rdesc_priv_idx_t)) {
+			valid = false;
+
+			break;
+		}
+
+		for (uint16_t i = 0; valid && i < rchild_count(n); i++) {
+			size_t child_idx = widen_idx(_rdesc_priv_child_idx(n, i));
+
+			valid = child_idx < len && !reached[child_idx] &&
+				widen_idx(_rdesc_priv_parent_idx(
+					rdesc_stack_at(cst->nodes,
+						       child_idx))) == idx;
+
+			if (valid) {
+				reached[child_idx] = true;
+				pending[pending_len++] = child_idx;
+			}
+		}
+	}
+
+	allocator->free(allocator->ctx, pending, len * sizeof(size_t));
+	allocator->free(allocator->ctx, reached, len * sizeof(bool));
+
+	return valid;
+}
+
+/* Maps the CST stacks onto the images in the mapping, returns non-zero value
+ * if they are malformed. */
+static int view_cst(struct rdesc_cst *cst, uint8_t *mapping, size_t size)
+{
+	const struct cst_file_header *header =
+		cast(const struct cst_file_header *, mapping);
+	bool packed = header->flags & FLAG_PACKED_SEMINFO;
+	size_t offset = sizeof(*header);
+
+	cst->nodes = view_image(mapping, size, &offset, sizeof(node_t), 0);
+
+	/* Tokens of a tape holding seminfo are at least their id. */
+	cst->tape = packed ?
+		view_image(mapping, size, &offset, sizeof(tk_t), 0) :
+		view_image(mapping, size, &offset, 0,
+			   sizeof(tk_t) - sizeof(uint32_t));
+	cst->seminfos = packed ? view_image(mapping, size, &offset, 1, 0) :
+		NULL;
+
+	/* A tree has at least its root. */
+	if (cst->nodes == NULL || rdesc_stack_len(cst->nodes) == 0 ||
+	    cst->tape == NULL || (packed && cst->seminfos == NULL) ||
+	    offset != size)
+		return 1;
+
+	return (packed && !valid_seminfo_offsets(cst)) || !valid_tree(cst);
+}
+
+int rdesc_cst_open(struct rdesc_cst *cst, const char *path)
+{
+	struct rdesc_cst opened;
+	struct stat st;
+	void *mapping;
+	int fd = open(path, O_RDONLY);
+
+	if (fd < 0)
+		return 1;
+
+	if (fstat(fd, &st) != 0 ||
+	    (size_t) st.st_size < sizeof(struct cst_file_header)) {
+		close(fd);
+
+		return 1;
+	}
+
+	mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	/* The mapping outlives its file descriptor. */
+	close(fd);
+
+	if (mapping == MAP_FAILED)
+		return 1;
+
+	if (!valid_header(mapping, st.st_size) ||
+	    view_cst(&opened, mapping, st.st_size)) {
+		munmap(mapping, st.st_size);
+
+		return 1;
+	}
+
+	opened.token_destroyer = NULL;
+	opened.allocator = allocator_or_libc(NULL);
+
+	*cst = opened;
+
+	return 0;
+}
+
+void rdesc_cst_close(struct rdesc_cst *cst)
+{
+	/* The node stack image follows the file header at the start of the
+	 * mapping, which holds the size of the mapping. */
+	struct cst_file_header *header =
+		cast(struct cst_file_header *, cst->nodes) - 1;
+
+	munmap(header, header->size);
+}
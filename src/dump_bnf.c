@@ -1,38 +1,42 @@
 #include "../include/grammar.h"
-#include "../include/rule_macros.h"
 #include "../include/util.h"
 #include "common.h"
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 
 
-static void print_rule(const struct rdesc_grammar *grammar,
-		       const struct rdesc_grammar_symbol *rule,
+static void print_rule(const uint16_t *body, uint16_t len, uint16_t cut,
 		       const char *const nt_names[],
 		       const char *const tk_names[],
 		       FILE *out)
 {
-	for (uint16_t i = 0; i < grammar->nt_body_length; i++) {
-		if (rule[i].id == EOB) {
-			if (i == 0)
+	for (uint16_t i = 0; i <= len; i++) {
+		if (i == cut)
+			fputs(i ? " ^" : "^", out);
+
+		if (i == len) {
+			if (i == 0 && cut != 0)
 				putc('E', out);
 
 			break;
 		}
 
-		if (i)
+		if (i || cut == 0)
 			putc(' ', out);
 
+		bool is_token = !is_nt_symbol(body[i]);
 		const char *name = (
-			rule[i].ty == RDESC_TOKEN ? tk_names : nt_names
-		)[rule[i].id];
-		const char *fstr = rule[i].ty == RDESC_TOKEN ? (
+			is_token ? tk_names : nt_names
+		)[symbol_id(body[i])];
+		const char *fstr = is_token ? (
 			name[0] == '@' ? "%s" : "\"%s\""
 		) : "<%s>";
 
-		if (name[0] == '@' && rule[i].ty == RDESC_TOKEN)
+		if (name[0] == '@' && is_token)
 			name++;
 
 		fprintf(out, fstr, name);
@@ -52,14 +56,18 @@ void rdesc_dump_bnf(FILE *out,
 		fprintf(out, "<%s> ::= ", nt_names[nt_id]);
 		int padding = strlen(nt_names[nt_id]);
 
-		for (int variant_id = 0;
-		     productions(*grammar)[nt_id][variant_id][0].id != EOC;
+		for (uint32_t variant_id = 0;
+		     variant_id < variant_count(*grammar, nt_id);
 		     variant_id++) {
 			if (variant_id != 0)
 				printf("\n %*s    / ", padding, "");
 
-			print_rule(grammar, productions(*grammar)[nt_id][variant_id],
-				   nt_names, tk_names, out);
+			uint16_t cut = grammar->cuts != NULL ?
+				cut_of(*grammar, nt_id, variant_id) : UINT16_MAX;
+
+			print_rule(body_of(*grammar, nt_id, variant_id),
+				   body_length(*grammar, nt_id, variant_id),
+				   cut, nt_names, tk_names, out);
 		}
 
 		putc('\n', out);
@@ -0,0 +1,312 @@
+#include "../include/grammar.h"
+#include "../include/util.h"
+#include "common.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+
+/* Number of array elements printed per line. */
+#define ELEMS_PER_LINE 12
+
+/* Prints an array of 32-bit offsets. */
+static void print_offsets(const char *prefix, const char *name,
+			  const uint32_t *offsets, size_t size, FILE *out)
+{
+	fprintf(out, "static const uint32_t %s_%s[%zu] = {",
+		prefix, name, size);
+
+	for (size_t i = 0; i < size; i++)
+		fprintf(out, "%s%u,", i % ELEMS_PER_LINE ? " " : "\n\t",
+			(unsigned) offsets[i]);
+
+	fputs("\n};\n\n", out);
+}
+
+static void print_symbol(uint16_t sym, FILE *out)
+{
+	if (is_nt_symbol(sym))
+		fprintf(out, " RDESC_SYMBOL_NONTERMINAL | %d,", symbol_id(sym));
+	else
+		fprintf(out, " %d,", sym);
+}
+
+/* Prints the rules in sparse form. With `with_cuts`, cuts are put back into
+ * the bodies, so that the rules can be initialized again. */
+static void print_rules(const struct rdesc_grammar *grammar,
+			const char *prefix, bool with_cuts, FILE *out)
+{
+	size_t body_count = grammar->variants[grammar->nt_count];
+	bool cuts = with_cuts && grammar->cuts != NULL;
+	size_t cut_count = 0;
+
+	print_offsets(prefix, "variants", grammar->variants,
+		      (size_t) grammar->nt_count + 1, out);
+
+	fprintf(out, "static const uint32_t %s_bodies[%zu] = {",
+		prefix, body_count + 1);
+
+	for (uint16_t nt_id = 0; nt_id < grammar->nt_count; nt_id++)
+		for (uint32_t variant = 0;
+		     variant < variant_count(*grammar, nt_id); variant++) {
+			size_t b = body_index(*grammar, nt_id, variant);
+
+			fprintf(out, "%s%u,", b % ELEMS_PER_LINE ? " " : "\n\t",
+				(unsigned) (grammar->bodies[b] + cut_count));
+
+			cut_count += cuts &&
+				cut_of(*grammar, nt_id, variant) != UINT16_MAX;
+		}
+
+	fprintf(out, "%s%u,\n};\n\n",
+		body_count % ELEMS_PER_LINE ? " " : "\n\t",
+		(unsigned) (grammar->bodies[body_count] + cut_count));
+
+	fprintf(out, "static const uint16_t %s_symbols[%zu] = {\n",
+		prefix, grammar->bodies[body_count] + cut_count);
+
+	for (uint16_t nt_id = 0; nt_id < grammar->nt_count; nt_id++) {
+		fprintf(out, "\t/* %d */\n", nt_id);
+
+		for (uint32_t variant = 0;
+		     variant < variant_count(*grammar, nt_id); variant++) {
+			const uint16_t *body = body_of(*grammar, nt_id,
+						       variant);
+			uint16_t len = body_length(*grammar, nt_id, variant);
+			uint16_t cut = cuts ? cut_of(*grammar, nt_id, variant) :
+				UINT16_MAX;
+
+			fputs("\t", out);
+
+			for (uint16_t i = 0; i <= len; i++) {
+				if (i == cut)
+					fputs(" RDESC_SYMBOL_CUT,", out);
+
+				if (i < len)
+					print_symbol(body[i], out);
+			}
+
+			fputs(len == 0 && cut == UINT16_MAX ? " /* E */\n" :
+			      "\n", out);
+		}
+	}
+
+	fputs("};\n\n", out);
+}
+
+static void print_child_caps(const struct rdesc_grammar *grammar,
+			     const char *prefix, FILE *out)
+{
+	fprintf(out, "static const uint16_t %s_child_caps[%d] = {",
+		prefix, grammar->nt_count);
+
+	for (uint16_t nt_id = 0; nt_id < grammar->nt_count; nt_id++)
+		fprintf(out, "%s%d,", nt_id % ELEMS_PER_LINE ? " " : "\n\t",
+			grammar->child_caps[nt_id]);
+
+	fputs("\n};\n\n", out);
+}
+
+static void print_variant_child_caps(const struct rdesc_grammar *grammar,
+				     const char *prefix, FILE *out)
+{
+	size_t size = row_count(*grammar);
+
+	fprintf(out, "static const uint16_t %s_variant_child_caps[%zu] = {",
+		prefix, size);
+
+	for (size_t i = 0; i < size; i++)
+		fprintf(out, "%s%d,", i % ELEMS_PER_LINE ? " " : "\n\t",
+			grammar->variant_child_caps[i]);
+
+	fputs("\n};\n\n", out);
+}
+
+/* Prints a table of bitsets dimensioned as the FIRST sets. */
+static void print_sets(const struct rdesc_grammar *grammar,
+		       const char *prefix, const char *name,
+		       const uint8_t *sets, FILE *out)
+{
+	size_t size = row_count(*grammar) * ((grammar->tk_count + 7) / 8);
+
+	fprintf(out, "static const uint8_t %s_%s[%zu] = {",
+		prefix, name, size);
+
+	for (size_t i = 0; i < size; i++)
+		fprintf(out, "%s0x%02x,", i % ELEMS_PER_LINE ? " " : "\n\t",
+			sets[i]);
+
+	fputs("\n};\n\n", out);
+}
+
+static void print_cuts(const struct rdesc_grammar *grammar,
+		       const char *prefix, FILE *out)
+{
+	size_t size = row_count(*grammar);
+
+	fprintf(out, "static const uint16_t %s_cuts[%zu] = {", prefix, size);
+
+	for (size_t i = 0; i < size; i++)
+		fprintf(out, "%s%d,", i % ELEMS_PER_LINE ? " " : "\n\t",
+			grammar->cuts[i]);
+
+	fputs("\n};\n\n", out);
+}
+
+static void print_header(const char *prefix, FILE *out)
+{
+	fprintf(out,
+		"/* Generated by rdesc_dump_c, do not edit. */\n"
+		"\n"
+		"#ifndef RDESC_AOT_%s_H\n"
+		"#define RDESC_AOT_%s_H\n"
+		"\n"
+		"#include \"grammar.h\"\n"
+		"#include \"rdesc.h\"\n"
+		"\n"
+		"\n"
+		"#ifdef __cplusplus\n"
+		"extern \"C\" {\n"
+		"#endif\n"
+		"\n"
+		"extern const struct rdesc_grammar *const %s_grammar;\n"
+		"\n"
+		"#ifdef __cplusplus\n"
+		"}\n"
+		"#endif\n"
+		"\n"
+		"#define RDESC_AOT_NAME(name) %s_ ## name\n"
+		"#include \"aot.h\"\n"
+		"#undef RDESC_AOT_NAME\n"
+		"\n"
+		"\n"
+		"#endif\n",
+		prefix, prefix, prefix, prefix);
+}
+
+/* Prints the grammar as constant tables, `<prefix>_aot_grammar` referring to
+ * them, and `<prefix>_grammar` pointing to it. */
+static void print_grammar(const struct rdesc_grammar *grammar,
+			  const char *prefix, FILE *out)
+{
+	fputs("#include \"grammar.h\"\n"
+	      "\n"
+	      "#include <stdint.h>\n"
+	      "\n"
+	      "\n", out);
+
+	print_rules(grammar, prefix, false, out);
+	print_child_caps(grammar, prefix, out);
+	print_variant_child_caps(grammar, prefix, out);
+	print_sets(grammar, prefix, "first_sets", grammar->first_sets, out);
+
+	if (grammar->grow_sets != NULL)
+		print_sets(grammar, prefix, "grow_sets", grammar->grow_sets,
+			   out);
+
+	if (grammar->cuts != NULL)
+		print_cuts(grammar, prefix, out);
+
+	fprintf(out,
+		"static const struct rdesc_grammar %s_aot_grammar = {\n"
+		"\t.variants = %s_variants,\n"
+		"\t.bodies = %s_bodies,\n"
+		"\t.symbols = %s_symbols,\n"
+		"\t.nt_count = %d,\n"
+		"\t.child_caps = %s_child_caps,\n"
+		"\t.variant_child_caps = %s_variant_child_caps,\n"
+		"\t.tk_count = %d,\n"
+		"\t.first_sets = %s_first_sets,\n",
+		prefix, prefix, prefix, prefix, grammar->nt_count,
+		prefix, prefix, grammar->tk_count, prefix);
+
+	if (grammar->grow_sets != NULL)
+		fprintf(out, "\t.grow_sets = %s_grow_sets,\n", prefix);
+
+	if (grammar->cuts != NULL)
+		fprintf(out, "\t.cuts = %s_cuts,\n", prefix);
+
+	fprintf(out,
+		"};\n"
+		"\n"
+		"const struct rdesc_grammar *const %s_grammar = "
+		"&%s_aot_grammar;\n",
+		prefix, prefix);
+}
+
+static void print_grammar_header(const char *prefix, FILE *out)
+{
+	fprintf(out,
+		"/* Generated by rdesc_dump_grammar, do not edit. */\n"
+		"\n"
+		"#ifndef RDESC_GRAMMAR_%s_H\n"
+		"#define RDESC_GRAMMAR_%s_H\n"
+		"\n"
+		"#include \"grammar.h\"\n"
+		"\n"
+		"\n"
+		"#ifdef __cplusplus\n"
+		"extern \"C\" {\n"
+		"#endif\n"
+		"\n"
+		"extern const struct rdesc_grammar *const %s_grammar;\n"
+		"\n"
+		"#ifdef __cplusplus\n"
+		"}\n"
+		"#endif\n"
+		"\n"
+		"\n"
+		"#endif\n",
+		prefix, prefix, prefix);
+}
+
+void rdesc_dump_c(FILE *source_out,
+		  FILE *header_out,
+		  const struct rdesc_grammar *grammar,
+		  const char *prefix)
+{
+	fputs("/* Generated by rdesc_dump_c, do not edit. */\n"
+	      "\n", source_out);
+
+	print_grammar(grammar, prefix, source_out);
+
+	fprintf(source_out,
+		"\n"
+		"\n"
+		"#define RDESC_AOT_GRAMMAR %s_aot_grammar\n"
+		"#define RDESC_AOT_NAME(name) %s_ ## name\n"
+		"\n"
+		"#include \"rdesc.c\"\n",
+		prefix, prefix);
+
+	print_header(prefix, header_out);
+}
+
+void rdesc_dump_grammar(FILE *source_out,
+			FILE *header_out,
+			const struct rdesc_grammar *grammar,
+			const char *prefix)
+{
+	fputs("/* Generated by rdesc_dump_grammar, do not edit. */\n"
+	      "\n", source_out);
+
+	print_grammar(grammar, prefix, source_out);
+	print_grammar_header(prefix, header_out);
+}
+
+void rdesc_dump_sparse(FILE *out,
+		       const struct rdesc_grammar *grammar,
+		       const char *prefix)
+{
+	fputs("/* Generated by rdesc_dump_sparse, do not edit. */\n"
+	      "\n"
+	      "#include \"grammar.h\"\n"
+	      "\n"
+	      "#include <stdint.h>\n"
+	      "\n"
+	      "\n", out);
+
+	print_rules(grammar, prefix, true, out);
+}
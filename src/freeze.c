@@ -0,0 +1,138 @@
+#include "../include/allocator.h"
+#include "../include/cst_macros.h"
+#include "../include/freeze.h"
+#include "../include/grammar.h"
+#include "../include/rdesc.h"
+#include "../include/stack.h"
+#include "common.h"
+#include "test_instruments.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+/* Size in bytes of the arrays of a frozen CST, allocated as a single block. */
+#define arrays_size(node_count) \
+	((node_count) * (2 * sizeof(uint32_t) + 3 * sizeof(uint16_t)))
+
+/* Highest bit of ids marks nonterminals. */
+#define NONTERMINAL_BIT 0x8000
+
+
+/* Counts the nodes of the tree. The walk is depth-first through parent links,
+ * which needs no memory besides the tree. */
+static size_t count_nodes(struct rdesc_stack *nodes)
+{
+	size_t count = 0, idx = 0;
+
+	while (true) {
+		node_t *n = rdesc_stack_at(nodes, idx);
+
+		count++;
+
+		if (rtype(n) == RDESC_NONTERMINAL && rchild_count(n) > 0) {
+			idx = _rdesc_priv_child_idx(n, 0);
+
+			continue;
+		}
+
+		/* Climb until a node has a next sibling. */
+		while (true) {
+			size_t parent_idx = widen_idx(_rdesc_priv_parent_idx(n));
+
+			if (parent_idx == SIZE_MAX)
+				return count;
+
+			node_t *parent = rdesc_stack_at(nodes, parent_idx);
+			uint16_t i = 0;
+
+			while (_rdesc_priv_child_idx(parent, i) != idx)
+				i++;
+
+			if (i + 1 < rchild_count(parent)) {
+				idx = _rdesc_priv_child_idx(parent, i + 1);
+
+				break;
+			}
+
+			idx = parent_idx;
+			n = parent;
+		}
+	}
+}
+
+static int freeze(struct rdesc_stack *nodes,
+		  const struct rdesc_allocator *allocator,
+		  struct rdesc_frozen_cst *f)
+{
+	runtime_assertion(rdesc_stack_len(nodes) > 0, "no CST is matched");
+	runtime_assertion(rdesc_stack_len(nodes) < RDESC_FROZEN_NONE,
+			  "CST exceeds 32-bit frozen index");
+
+	size_t count = count_nodes(nodes);
+	uint8_t *block = xmalloc(allocator, arrays_size(count));
+
+	if (block == NULL)
+		return 1;
+
+	f->node_count = count;
+	f->allocator = allocator;
+
+	f->parents = cast(uint32_t *, block);
+	f->links = f->parents + count;
+	f->ids = cast(uint16_t *, f->links + count);
+	f->variants = f->ids + count;
+	f->child_counts = f->variants + count;
+
+	/* Breadth-first order, children of a node are queued together. Links
+	 * of queued nodes hold their CST stack index until they are
+	 * visited. */
+	f->parents[0] = RDESC_FROZEN_NONE;
+	f->links[0] = 0;
+
+	uint32_t next = 1;
+
+	for (uint32_t i = 0; i < count; i++) {
+		node_t *n = rdesc_stack_at(nodes, f->links[i]);
+
+		if (rtype(n) == RDESC_TOKEN) {
+			f->ids[i] = rid(n);
+			f->variants[i] = 0;
+			f->child_counts[i] = 0;
+			f->links[i] = _rdesc_priv_node_deref(n).n.tk.index;
+
+			continue;
+		}
+
+		f->ids[i] = rid(n) | NONTERMINAL_BIT;
+		f->variants[i] = rvariant(n);
+		f->child_counts[i] = rchild_count(n);
+		f->links[i] = next;
+
+		for (uint16_t c = 0; c < rchild_count(n); c++) {
+			f->parents[next] = i;
+			f->links[next] = _rdesc_priv_child_idx(n, c);
+			next++;
+		}
+	}
+
+	return 0;
+}
+
+int rdesc_freeze(const struct rdesc *p, struct rdesc_frozen_cst *frozen)
+{
+	return freeze(p->cst_stack, p->allocator, frozen);
+}
+
+int rdesc_cst_freeze(const struct rdesc_cst *cst,
+		     struct rdesc_frozen_cst *frozen)
+{
+	return freeze(cst->nodes, cst->allocator, frozen);
+}
+
+void rdesc_frozen_destroy(struct rdesc_frozen_cst *frozen)
+{
+	xfree(frozen->allocator, frozen->parents,
+	      arrays_size(frozen->node_count));
+}
@@ -1,55 +1,654 @@
+#include "../include/allocator.h"
 #include "../include/grammar.h"
 #include "../include/rule_macros.h"
+#include "allocator.h"
 #include "common.h"
 #include "test_instruments.h"
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 
-/* tight coupled with: tests/integration/error_recovery.c:main
- * Check grammar initialization fail tests after a change in this function. */
+/* Sizes in bytes of the tables allocated for the grammar. */
+#define variants_size(grammar) \
+	(sizeof(uint32_t) * ((size_t) (grammar).nt_count + 1))
+#define bodies_size(grammar) \
+	(sizeof(uint32_t) * ((size_t) (grammar).variants[(grammar).nt_count] + 1))
+#define symbols_size(grammar) \
+	(sizeof(uint16_t) * \
+	 (grammar).bodies[(grammar).variants[(grammar).nt_count]])
+#define child_caps_size(grammar) \
+	(sizeof(uint16_t) * (grammar).nt_count)
+#define variant_child_caps_size(grammar) \
+	(sizeof(uint16_t) * row_count(grammar))
+#define first_sets_size(grammar) \
+	(row_count(grammar) * (((grammar).tk_count + 7) / 8))
+#define cuts_size(grammar) \
+	(sizeof(uint16_t) * row_count(grammar))
+
+/* Symbol of dense rules, dimensioned as
+ * [nt_count][variant_count][body_length]. */
+#define dense_symbol(rules, nt_variant_count, body_length, nt_id, variant, i) \
+	((rules)[((size_t) (nt_id) * (nt_variant_count) + (variant)) * \
+		 (body_length) + (i)])
+
+#define is_cut(sym) ((sym).ty == RDESC_SENTINEL && (sym).id == EOP)
+
+/* Row of a FIRST or grow set table that is being computed. Tables of the
+ * grammar are constant once initialized. */
+#define set_row(grammar, sets, nt_id, variant) \
+	(&(sets)[row_of(grammar, nt_id, variant) * \
+		 (((grammar).tk_count + 7) / 8)])
+
+
+/* Adds FIRST set of the nonterminal to `set`. Returns true if the set has
+ * changed. */
+static bool merge_first_set(const struct rdesc_grammar *grammar,
+			    uint8_t *set, uint16_t nt_id)
+{
+	size_t set_size = (grammar->tk_count + 7) / 8;
+	bool changed = false;
+
+	for (uint32_t variant = 0; variant < variant_count(*grammar, nt_id);
+	     variant++) {
+		const uint8_t *sub = first_set(*grammar, nt_id, variant);
+
+		for (size_t i = 0; i < set_size; i++) {
+			/* Nullability of the nonterminal does not imply
+			 * nullability of the body it is in. */
+			uint8_t bits = set[i] | (i == 0 ? sub[i] & ~1 : sub[i]);
+
+			if (bits != set[i]) {
+				set[i] = bits;
+				changed = true;
+			}
+		}
+	}
+
+	return changed;
+}
+
+/* Returns true if any variant of the nonterminal can match empty input. */
+static bool is_nullable(const struct rdesc_grammar *grammar, uint16_t nt_id)
+{
+	for (uint32_t variant = 0; variant < variant_count(*grammar, nt_id);
+	     variant++)
+		if (in_first_set(first_set(*grammar, nt_id, variant), 0))
+			return true;
+
+	return false;
+}
+
+/* Adds FIRST set of the `len` symbols in the body to `set`, with bit 0 if all
+ * of them can match empty input. Returns true if the set has changed. */
+static bool merge_body_first_set(const struct rdesc_grammar *grammar,
+				 uint8_t *set,
+				 const uint16_t *body, size_t len)
+{
+	bool changed = false, nullable = true;
+
+	for (size_t i = 0; nullable && i < len; i++) {
+		uint16_t id = symbol_id(body[i]);
+
+		if (!is_nt_symbol(body[i])) {
+			if (!in_first_set(set, id)) {
+				set[id / 8] |= 1 << (id % 8);
+				changed = true;
+			}
+
+			nullable = false;
+		} else {
+			changed |= merge_first_set(grammar, set, id);
+
+			nullable = is_nullable(grammar, id);
+		}
+	}
+
+	if (nullable && !in_first_set(set, 0)) {
+		set[0] |= 1;
+		changed = true;
+	}
+
+	return changed;
+}
+
+/* Computes FIRST sets and nullability of the production bodies by iterating
+ * until a fixed point is reached. */
+static void compute_first_sets(const struct rdesc_grammar *grammar,
+			       uint8_t *first_sets)
+{
+	bool changed;
+
+	do {
+		changed = false;
+
+		for (uint16_t nt_id = 0; nt_id < grammar->nt_count; nt_id++)
+			for (uint32_t variant = 0;
+			     variant < variant_count(*grammar, nt_id);
+			     variant++)
+				changed |= merge_body_first_set(
+					grammar,
+					set_row(*grammar, first_sets, nt_id,
+						variant),
+					body_of(*grammar, nt_id, variant),
+					body_length(*grammar, nt_id, variant));
+	} while (changed);
+}
+
+/* Returns true if any production body is directly left-recursive. */
+static bool has_left_recursion(const struct rdesc_grammar *grammar)
+{
+	for (uint16_t nt_id = 0; nt_id < grammar->nt_count; nt_id++)
+		for (uint32_t variant = 0;
+		     variant < variant_count(*grammar, nt_id); variant++)
+			if (is_left_recursive(*grammar, nt_id, variant))
+				return true;
+
+	return false;
+}
+
+/* Computes grow sets of the left-recursive bodies from the FIRST sets of the
+ * symbols after their nonterminal, and empties their FIRST sets. Emptying
+ * does not change the FIRST sets of the other bodies, which are already at
+ * the fixed point. Bit 0 of the set of the first variant marks the
+ * nonterminals that grow. Returns false if a left-recursive body may match
+ * no token after its nonterminal, as it would grow forever. */
+static bool compute_grow_sets(const struct rdesc_grammar *grammar,
+			      uint8_t *first_sets, uint8_t *grow_sets)
+{
+	size_t set_size = (grammar->tk_count + 7) / 8;
+
+	for (uint16_t nt_id = 0; nt_id < grammar->nt_count; nt_id++) {
+		bool grows = false;
+
+		for (uint32_t variant = 0;
+		     variant < variant_count(*grammar, nt_id); variant++) {
+			uint8_t *set = set_row(*grammar, grow_sets, nt_id,
+					       variant);
+
+			if (!is_left_recursive(*grammar, nt_id, variant))
+				continue;
+
+			merge_body_first_set(
+				grammar, set,
+				&body_of(*grammar, nt_id, variant)[1],
+				body_length(*grammar, nt_id, variant) - 1);
+
+			if (set[0] & 1)
+				return false;
+
+			memset(set_row(*grammar, first_sets, nt_id, variant), 0,
+			       set_size);
+			grows = true;
+		}
+
+		if (grows)
+			set_row(*grammar, grow_sets, nt_id, 0)[0] |= 1;
+	}
+
+	return true;
+}
+
+/* Computes child capacities of the rows and the nonterminals, and the number
+ * of tokens. */
+static void compute_child_caps(struct rdesc_grammar *grammar,
+			       uint16_t *child_caps,
+			       uint16_t *variant_child_caps)
+{
+	grammar->tk_count = 1;
+
+	for (uint16_t nt_id = 0; nt_id < grammar->nt_count; nt_id++) {
+		uint32_t count = variant_count(*grammar, nt_id);
+		bool left_recursive = false;
+
+		/* The end-of-construct row holds error nodes, which refer to
+		 * the first and the last token they have skipped. */
+		variant_child_caps[row_of(*grammar, nt_id, count)] = 2;
+		child_caps[nt_id] = 2;
+
+		for (uint32_t variant = 0; variant < count; variant++) {
+			const uint16_t *body = body_of(*grammar, nt_id,
+						       variant);
+			uint16_t len = body_length(*grammar, nt_id, variant);
+
+			for (uint16_t i = 0; i < len; i++)
+				if (!is_nt_symbol(body[i]) &&
+				    body[i] >= grammar->tk_count)
+					grammar->tk_count = body[i] + 1;
+
+			variant_child_caps[row_of(*grammar, nt_id, variant)] =
+				len;
+			left_recursive |= is_left_recursive(*grammar, nt_id,
+							    variant);
+
+			if (len > child_caps[nt_id])
+				child_caps[nt_id] = len;
+		}
+
+		/* A left-recursive match grows in place from one variant into
+		 * another, all of them reserve the same capacity. */
+		if (left_recursive)
+			for (uint32_t variant = 0; variant < count; variant++)
+				variant_child_caps[row_of(*grammar, nt_id,
+							  variant)] =
+					child_caps[nt_id];
+	}
+}
+
+/* Allocates the tables derived from the rules. Destroys the grammar and
+ * returns non-zero if allocation fails or a left-recursive body may match no
+ * token after its nonterminal. */
+static int init_tables(struct rdesc_grammar *grammar)
+{
+	const struct rdesc_allocator *allocator = grammar->allocator;
+	uint16_t *child_caps, *variant_child_caps;
+	uint8_t *first_sets, *grow_sets;
+
+	grammar->child_caps = child_caps =
+		xmalloc(allocator, child_caps_size(*grammar));
+	grammar->variant_child_caps = variant_child_caps =
+		xmalloc(allocator, variant_child_caps_size(*grammar));
+
+	if (!child_caps || !variant_child_caps) {
+		rdesc_grammar_destroy(grammar);
+
+		return 1;
+	}
+
+	compute_child_caps(grammar, child_caps, variant_child_caps);
+
+	grammar->first_sets = first_sets =
+		xmalloc(allocator, first_sets_size(*grammar));
+
+	if (!first_sets) {
+		rdesc_grammar_destroy(grammar);
+
+		return 1;
+	}
+
+	memset(first_sets, 0, first_sets_size(*grammar));
+	compute_first_sets(grammar, first_sets);
+
+	if (has_left_recursion(grammar)) {
+		grammar->grow_sets = grow_sets =
+			xmalloc(allocator, first_sets_size(*grammar));
+
+		if (!grow_sets) {
+			rdesc_grammar_destroy(grammar);
+
+			return 1;
+		}
+
+		memset(grow_sets, 0, first_sets_size(*grammar));
+
+		if (!compute_grow_sets(grammar, first_sets, grow_sets)) {
+			rdesc_grammar_destroy(grammar);
+
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/* Resets the pointers of the grammar, so that a partially initialized
+ * grammar can be destroyed. */
+static void clear_grammar(struct rdesc_grammar *grammar, uint16_t nt_count,
+			  const struct rdesc_allocator *allocator)
+{
+	grammar->variants = NULL;
+	grammar->bodies = NULL;
+	grammar->symbols = NULL;
+	grammar->nt_count = nt_count;
+	grammar->owns_rules = true;
+
+	grammar->rules = NULL;
+	grammar->nt_variant_count = 0;
+	grammar->nt_body_length = 0;
+
+	grammar->child_caps = NULL;
+	grammar->variant_child_caps = NULL;
+	grammar->first_sets = NULL;
+	grammar->grow_sets = NULL;
+	grammar->cuts = NULL;
+
+	grammar->allocator = allocator_or_libc(allocator);
+}
+
+/* Allocates the bodies and the symbols of the rules, and the cut table if
+ * `has_cuts`, after the variants are counted into `variants`. `cuts` is left
+ * NULL without cuts. */
+static int alloc_rules(struct rdesc_grammar *grammar, uint32_t *variants,
+		       size_t symbol_count, bool has_cuts,
+		       uint32_t **bodies, uint16_t **symbols, uint16_t **cuts)
+{
+	const struct rdesc_allocator *allocator = grammar->allocator;
+
+	grammar->variants = variants;
+	grammar->bodies = *bodies = xmalloc(allocator, bodies_size(*grammar));
+
+	if (!*bodies)
+		return 1;
+
+	(*bodies)[variants[grammar->nt_count]] = symbol_count;
+
+	grammar->symbols = *symbols = xmalloc(allocator,
+					      symbols_size(*grammar));
+
+	if (!*symbols)
+		return 1;
+
+	*cuts = NULL;
+
+	if (has_cuts) {
+		grammar->cuts = *cuts = xmalloc(allocator, cuts_size(*grammar));
+
+		if (!*cuts)
+			return 1;
+
+		for (size_t row = 0; row < row_count(*grammar); row++)
+			(*cuts)[row] = UINT16_MAX;
+	}
+
+	return 0;
+}
+
+/* Returns true if a dense symbol is a token or a nonterminal of the grammar,
+ * or a cut. */
+static bool is_valid_dense(struct rdesc_grammar_symbol sym, uint16_t nt_count)
+{
+	switch (sym.ty) {
+	case RDESC_TOKEN:
+		return sym.id >= 0 && sym.id < RDESC_SYMBOL_NONTERMINAL;
+	case RDESC_NONTERMINAL:
+		return sym.id >= 0 && sym.id < nt_count;
+	default:
+		return is_cut(sym);
+	}
+}
+
+/* Returns true if the offsets of sparse rules do not decrease, their
+ * nonterminals are in range, and their bodies have at most one cut and fewer
+ * than `UINT16_MAX` symbols. */
+static bool is_valid_sparse(uint16_t nt_count, const uint32_t *variants,
+			    const uint32_t *bodies, const uint16_t *symbols)
+{
+	if (nt_count > RDESC_NONTERMINAL_COUNT_MAX || variants[0] != 0)
+		return false;
+
+	for (uint16_t nt_id = 0; nt_id < nt_count; nt_id++)
+		if (variants[nt_id + 1] < variants[nt_id])
+			return false;
+
+	for (size_t b = 0; b < variants[nt_count]; b++) {
+		int cut_count = 0;
+
+		if (bodies[b + 1] < bodies[b] ||
+		    bodies[b + 1] - bodies[b] >= UINT16_MAX)
+			return false;
+
+		for (size_t i = bodies[b]; i < bodies[b + 1]; i++) {
+			if (symbols[i] == RDESC_SYMBOL_CUT)
+				cut_count++;
+			else if (symbols[i] & RDESC_SYMBOL_NONTERMINAL &&
+				 (symbols[i] & ~RDESC_SYMBOL_NONTERMINAL) >=
+				 nt_count)
+				return false;
+		}
+
+		if (cut_count > 1)
+			return false;
+	}
+
+	return true;
+}
+
 int rdesc_grammar_init(struct rdesc_grammar *grammar,
 		       uint16_t nt_count,
 		       uint16_t nt_variant_count,
 		       uint16_t nt_body_length,
 		       const struct rdesc_grammar_symbol *rules)
 {
-	grammar->rules = rules;
+	return rdesc_grammar_init_with_allocator(grammar, nt_count,
+						 nt_variant_count,
+						 nt_body_length, rules, NULL);
+}
 
-	grammar->nt_count = nt_count;
+/* tight coupled with: tests/integration/error_recovery.c:main
+ * Check grammar initialization fail tests after a change in this function. */
+int rdesc_grammar_init_with_allocator(struct rdesc_grammar *grammar,
+				      uint16_t nt_count,
+				      uint16_t nt_variant_count,
+				      uint16_t nt_body_length,
+				      const struct rdesc_grammar_symbol *rules,
+				      const struct rdesc_allocator *allocator)
+{
+	uint32_t *variants, *bodies;
+	uint16_t *symbols, *cuts;
+	size_t symbol_count = 0;
+	bool has_cuts = false;
+
+	clear_grammar(grammar, nt_count, allocator);
+
+	if (nt_count > RDESC_NONTERMINAL_COUNT_MAX)
+		return 1;
+
+	grammar->rules = rules;
 	grammar->nt_variant_count = nt_variant_count;
 	grammar->nt_body_length = nt_body_length;
 
-	grammar->child_caps = xmalloc(sizeof(size_t) * nt_count);
+	variants = xmalloc(grammar->allocator, variants_size(*grammar));
 
-	if (!grammar->child_caps)
+	if (!variants)
 		return 1;
 
-	for (size_t nt_id = 0; nt_id < nt_count; nt_id++) {
-		grammar->child_caps[nt_id] = 0;
+	/* Count the bodies of the nonterminals, and their symbols except
+	 * cuts. */
+	variants[0] = 0;
+
+	for (uint16_t nt_id = 0; nt_id < nt_count; nt_id++) {
+		uint16_t variant = 0;
+
+		for (; variant < nt_variant_count &&
+		     dense_symbol(rules, nt_variant_count, nt_body_length,
+				  nt_id, variant, 0).id != EOC; variant++) {
+			int cut_count = 0;
+
+			for (uint16_t i = 0; i < nt_body_length; i++) {
+				struct rdesc_grammar_symbol sym = dense_symbol(
+					rules, nt_variant_count, nt_body_length,
+					nt_id, variant, i);
 
-		for (size_t variant = 0; variant < nt_variant_count; variant++) {
-			size_t len;
-			struct rdesc_grammar_symbol sym;
+				if (sym.ty == RDESC_SENTINEL && sym.id == EOB)
+					break;
 
-			for (len = 0;
-				(sym = productions(*grammar)[nt_id][variant][len]).ty !=
-				RDESC_SENTINEL;
-				len++);
+				if (!is_valid_dense(sym, nt_count) ||
+				    (cut_count += is_cut(sym)) > 1) {
+					xfree(grammar->allocator, variants,
+					      variants_size(*grammar));
 
-			if (len > grammar->child_caps[nt_id])
-				grammar->child_caps[nt_id] = len;
+					return 1;
+				}
 
-			if (sym.id == EOC)
-				break;
+				symbol_count += !is_cut(sym);
+			}
+
+			has_cuts |= cut_count;
 		}
+
+		variants[nt_id + 1] = variants[nt_id] + variant;
 	}
 
-	return 0;
+	if (alloc_rules(grammar, variants, symbol_count, has_cuts, &bodies,
+			&symbols, &cuts)) {
+		rdesc_grammar_destroy(grammar);
+
+		return 1;
+	}
+
+	/* Pack the symbols, recording the position of the cut in each
+	 * body. */
+	symbol_count = 0;
+
+	for (uint16_t nt_id = 0; nt_id < nt_count; nt_id++)
+		for (uint32_t variant = 0;
+		     variant < variant_count(*grammar, nt_id); variant++) {
+			bodies[body_index(*grammar, nt_id, variant)] =
+				symbol_count;
+
+			for (uint16_t i = 0; i < nt_body_length; i++) {
+				struct rdesc_grammar_symbol sym = dense_symbol(
+					rules, nt_variant_count, nt_body_length,
+					nt_id, variant, i);
+
+				if (sym.ty == RDESC_SENTINEL && sym.id == EOB)
+					break;
+
+				if (is_cut(sym)) {
+					cuts[row_of(*grammar, nt_id,
+						    variant)] =
+						symbol_count - bodies[body_index(
+							*grammar, nt_id,
+							variant)];
+
+					continue;
+				}
+
+				symbols[symbol_count++] = sym.id |
+					(sym.ty == RDESC_NONTERMINAL ?
+					 RDESC_SYMBOL_NONTERMINAL : 0);
+			}
+		}
+
+	return init_tables(grammar);
+}
+
+int rdesc_grammar_init_sparse(struct rdesc_grammar *grammar,
+			      uint16_t nt_count,
+			      const uint32_t *variants,
+			      const uint32_t *bodies,
+			      const uint16_t *symbols)
+{
+	return rdesc_grammar_init_sparse_with_allocator(grammar, nt_count,
+							variants, bodies,
+							symbols, NULL);
+}
+
+/* tight coupled with: tests/integration/error_recovery.c:main
+ * Check grammar initialization fail tests after a change in this function. */
+int rdesc_grammar_init_sparse_with_allocator(struct rdesc_grammar *grammar,
+					     uint16_t nt_count,
+					     const uint32_t *variants,
+					     const uint32_t *bodies,
+					     const uint16_t *symbols,
+					     const struct rdesc_allocator *allocator)
+{
+	uint32_t *copied_variants, *copied_bodies;
+	uint16_t *copied_symbols, *cuts;
+	size_t body_count, cut_count = 0;
+
+	clear_grammar(grammar, nt_count, allocator);
+
+	if (!is_valid_sparse(nt_count, variants, bodies, symbols))
+		return 1;
+
+	body_count = variants[nt_count];
+
+	for (size_t i = bodies[0]; i < bodies[body_count]; i++)
+		cut_count += symbols[i] == RDESC_SYMBOL_CUT;
+
+	if (cut_count == 0) {
+		grammar->variants = variants;
+		grammar->bodies = bodies;
+		grammar->symbols = symbols;
+		grammar->owns_rules = false;
+
+		return init_tables(grammar);
+	}
+
+	/* Copy the rules without cuts. */
+	copied_variants = xmalloc(grammar->allocator, variants_size(*grammar));
+
+	if (!copied_variants)
+		return 1;
+
+	memcpy(copied_variants, variants, variants_size(*grammar));
+	grammar->variants = copied_variants;
+
+	if (alloc_rules(grammar, copied_variants,
+			bodies[body_count] - bodies[0] - cut_count, true,
+			&copied_bodies, &copied_symbols, &cuts)) {
+		rdesc_grammar_destroy(grammar);
+
+		return 1;
+	}
+
+	cut_count = 0;
+
+	for (uint16_t nt_id = 0; nt_id < nt_count; nt_id++)
+		for (uint32_t variant = 0;
+		     variant < variant_count(*grammar, nt_id); variant++) {
+			size_t b = body_index(*grammar, nt_id, variant);
+
+			copied_bodies[b] = bodies[b] - bodies[0] - cut_count;
+
+			for (size_t i = bodies[b]; i < bodies[b + 1]; i++) {
+				if (symbols[i] != RDESC_SYMBOL_CUT) {
+					copied_symbols[i - bodies[0] -
+						       cut_count] = symbols[i];
+
+					continue;
+				}
+
+				cuts[row_of(*grammar, nt_id, variant)] =
+					i - bodies[b];
+				cut_count++;
+			}
+		}
+
+	return init_tables(grammar);
 }
 
 void rdesc_grammar_destroy(struct rdesc_grammar *grammar)
 {
-	free(grammar->child_caps);
+	const struct rdesc_allocator *allocator = grammar->allocator;
+
+	if (grammar->child_caps != NULL)
+		xfree(allocator, cast(void *, grammar->child_caps),
+		      child_caps_size(*grammar));
+
+	if (grammar->variant_child_caps != NULL)
+		xfree(allocator, cast(void *, grammar->variant_child_caps),
+		      variant_child_caps_size(*grammar));
+
+	if (grammar->first_sets != NULL)
+		xfree(allocator, cast(void *, grammar->first_sets),
+		      first_sets_size(*grammar));
+
+	if (grammar->grow_sets != NULL)
+		xfree(allocator, cast(void *, grammar->grow_sets),
+		      first_sets_size(*grammar));
+
+	if (grammar->cuts != NULL)
+		xfree(allocator, cast(void *, grammar->cuts),
+		      cuts_size(*grammar));
+
+	if (!grammar->owns_rules)
+		return;
+
+	/* Sizes depend on the tables freed after them. */
+	if (grammar->symbols != NULL)
+		xfree(allocator, cast(void *, grammar->symbols),
+		      symbols_size(*grammar));
+
+	if (grammar->bodies != NULL)
+		xfree(allocator, cast(void *, grammar->bodies),
+		      bodies_size(*grammar));
+
+	if (grammar->variants != NULL)
+		xfree(allocator, cast(void *, grammar->variants),
+		      variants_size(*grammar));
 }
@@ -0,0 +1,215 @@
+#include "../include/cst_macros.h"
+#include "../include/grammar.h"
+#include "../include/iter.h"
+#include "../include/rdesc.h"
+#include "../include/stack.h"
+#include "common.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+#define node_at(it, idx) (cast(node_t *, (it)->nodes) + (idx))
+
+
+/* Position of the child in the child list of its parent. */
+static inline uint16_t child_position(const node_t *parent, size_t child_idx)
+{
+	uint16_t i = 0;
+
+	while (widen_idx(_rdesc_priv_child_idx(parent, i)) != child_idx)
+		i++;
+
+	return i;
+}
+
+static inline void push_frame(struct rdesc_iter *it, size_t parent_idx,
+			      uint16_t position)
+{
+	it->top = (it->top + 1) % RDESC_ITER_FRAMES;
+	it->frames[it->top] = parent_idx;
+	it->positions[it->top] = position;
+
+	if (it->cached < RDESC_ITER_FRAMES)
+		it->cached++;
+}
+
+static inline void pop_frame(struct rdesc_iter *it)
+{
+	it->top = (it->top + RDESC_ITER_FRAMES - 1) % RDESC_ITER_FRAMES;
+	it->cached--;
+}
+
+/* Makes sure the parent of the node, which is not the subtree root, is on top
+ * of the path. Ancestors deeper than the ring are overwritten while
+ * descending, they are found again through the parent index. */
+static inline void climb_frame(struct rdesc_iter *it, size_t idx)
+{
+	if (it->cached > 0)
+		return;
+
+	size_t parent_idx = widen_idx(_rdesc_priv_parent_idx(node_at(it, idx)));
+
+	push_frame(it, parent_idx,
+		   child_position(node_at(it, parent_idx), idx));
+}
+
+/* Descends through first children to the first node of the subtree in
+ * post-order. */
+static size_t leftmost(struct rdesc_iter *it, size_t idx)
+{
+	node_t *n = node_at(it, idx);
+
+	while (rtype(n) == RDESC_NONTERMINAL && rchild_count(n) > 0) {
+		push_frame(it, idx, 0);
+
+		idx = _rdesc_priv_child_idx(n, 0);
+		n = node_at(it, idx);
+	}
+
+	return idx;
+}
+
+/* Climbs from the node to the first ancestor that has a next sibling, and
+ * returns that sibling. Returns SIZE_MAX if the subtree root is reached. */
+static size_t next_sibling_up(struct rdesc_iter *it, size_t idx)
+{
+	while (idx != it->root) {
+		climb_frame(it, idx);
+
+		size_t parent_idx = it->frames[it->top];
+		node_t *parent = node_at(it, parent_idx);
+		uint16_t i = it->positions[it->top];
+
+		if (i + 1 < rchild_count(parent)) {
+			it->positions[it->top] = i + 1;
+
+			return _rdesc_priv_child_idx(parent, i + 1);
+		}
+
+		pop_frame(it);
+		idx = parent_idx;
+	}
+
+	return SIZE_MAX;
+}
+
+static size_t preorder_next(struct rdesc_iter *it, size_t idx)
+{
+	node_t *n = node_at(it, idx);
+
+	if (rtype(n) == RDESC_NONTERMINAL && rchild_count(n) > 0) {
+		push_frame(it, idx, 0);
+
+		return _rdesc_priv_child_idx(n, 0);
+	}
+
+	return next_sibling_up(it, idx);
+}
+
+static size_t postorder_next(struct rdesc_iter *it, size_t idx)
+{
+	if (idx == it->root)
+		return SIZE_MAX;
+
+	climb_frame(it, idx);
+
+	size_t parent_idx = it->frames[it->top];
+	node_t *parent = node_at(it, parent_idx);
+	uint16_t i = it->positions[it->top];
+
+	if (i + 1 < rchild_count(parent)) {
+		it->positions[it->top] = i + 1;
+
+		return leftmost(it, _rdesc_priv_child_idx(parent, i + 1));
+	}
+
+	pop_frame(it);
+
+	return parent_idx;
+}
+
+/* Skips nonterminals in pre-order, starting from the node. */
+static size_t next_leaf(struct rdesc_iter *it, size_t idx)
+{
+	while (idx != SIZE_MAX && rtype(node_at(it, idx)) != RDESC_TOKEN)
+		idx = preorder_next(it, idx);
+
+	return idx;
+}
+
+static void iter_init(struct rdesc_iter *it, struct rdesc_stack *nodes,
+		      struct rdesc_node *root, enum rdesc_iter_order order)
+{
+	it->order = order;
+	it->top = it->cached = 0;
+
+	if (rdesc_stack_len(nodes) == 0) {
+		it->nodes = NULL;
+		it->root = it->next = SIZE_MAX;
+
+		return;
+	}
+
+	it->nodes = rdesc_stack_at(nodes, 0);
+	it->root = root == NULL ? 0 :
+		(size_t) (cast(node_t *, root) - node_at(it, 0));
+
+	switch (order) {
+	case RDESC_PREORDER:
+		it->next = it->root;
+		break;
+
+	case RDESC_POSTORDER:
+		it->next = leftmost(it, it->root);
+		break;
+
+	case RDESC_LEAVES:
+		it->next = next_leaf(it, it->root);
+		break;
+
+	default: unreachable();
+	}
+}
+
+void rdesc_iter_init(struct rdesc_iter *it,
+		     const struct rdesc *p,
+		     struct rdesc_node *root,
+		     enum rdesc_iter_order order)
+{
+	iter_init(it, p->cst_stack, root, order);
+}
+
+void rdesc_cst_iter_init(struct rdesc_iter *it,
+			 const struct rdesc_cst *cst,
+			 struct rdesc_node *root,
+			 enum rdesc_iter_order order)
+{
+	iter_init(it, cst->nodes, root, order);
+}
+
+struct rdesc_node *rdesc_iter_next(struct rdesc_iter *it)
+{
+	size_t idx = it->next;
+
+	if (idx == SIZE_MAX)
+		return NULL;
+
+	switch (it->order) {
+	case RDESC_PREORDER:
+		it->next = preorder_next(it, idx);
+		break;
+
+	case RDESC_POSTORDER:
+		it->next = postorder_next(it, idx);
+		break;
+
+	case RDESC_LEAVES:
+		it->next = next_leaf(it, preorder_next(it, idx));
+		break;
+
+	default: unreachable();
+	}
+
+	return cast(struct rdesc_node *, node_at(it, idx));
+}
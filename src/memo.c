@@ -0,0 +1,179 @@
+#include "memo.h"
+#include "common.h"
+#include "test_instruments.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/* The table itself may use at most 1/MEMO_TABLE_SHARE of the memory limit,
+ * the rest is reserved for subtree snapshots. */
+#define MEMO_TABLE_SHARE 4
+
+#define MEMO_MIN_CAP 8
+
+
+static inline size_t slot_of(const struct rdesc_memo *memo,
+			     uint16_t nt_id, size_t position)
+{
+	size_t h = position * 2654435761u + nt_id * 40503u;
+
+	return (h ^ (h >> 15)) & (memo->cap - 1);
+}
+
+static void evict(struct rdesc_memo *memo, struct rdesc_memo_entry *e)
+{
+	if (e->state == RDESC_MEMO_MATCHED)
+		rdesc_memo_release(memo, e->snapshot);
+
+	e->state = RDESC_MEMO_EMPTY;
+}
+
+/* Size in bytes of a table with `cap` entries. */
+#define table_size(cap) \
+	(sizeof(struct rdesc_memo) + (cap) * sizeof(struct rdesc_memo_entry))
+
+struct rdesc_memo *rdesc_memo_new(size_t memory_limit,
+				  const struct rdesc_allocator *allocator)
+{
+	size_t cap = MEMO_MIN_CAP;
+
+	while (cap * 2 * sizeof(struct rdesc_memo_entry) <=
+	       memory_limit / MEMO_TABLE_SHARE)
+		cap *= 2;
+
+	struct rdesc_memo *memo = xmalloc(allocator, table_size(cap));
+
+	if (memo == NULL)
+		return NULL;
+
+	memo->allocator = allocator;
+	memo->memory_limit = memory_limit;
+	memo->memory_used = table_size(cap);
+	memo->cap = cap;
+	memo->hand = 0;
+	memo->generation = 0;
+
+	for (size_t i = 0; i < cap; i++)
+		memo->entries[i].state = RDESC_MEMO_EMPTY;
+
+	return memo;
+}
+
+void rdesc_memo_destroy(struct rdesc_memo *memo)
+{
+	for (size_t i = 0; i < memo->cap; i++)
+		evict(memo, &memo->entries[i]);
+
+	xfree(memo->allocator, memo, table_size(memo->cap));
+}
+
+void rdesc_memo_clear(struct rdesc_memo *memo)
+{
+	memo->generation++;
+}
+
+const struct rdesc_memo_entry *rdesc_memo_lookup(const struct rdesc_memo *memo,
+						 uint16_t nt_id,
+						 size_t position)
+{
+	const struct rdesc_memo_entry *e =
+		&memo->entries[slot_of(memo, nt_id, position)];
+
+	if (e->state == RDESC_MEMO_EMPTY || e->generation != memo->generation ||
+	    e->nt_id != nt_id || e->position != position)
+		return NULL;
+
+	return e;
+}
+
+void rdesc_memo_failed(struct rdesc_memo *memo,
+		       uint16_t nt_id,
+		       size_t position)
+{
+	struct rdesc_memo_entry *e =
+		&memo->entries[slot_of(memo, nt_id, position)];
+
+	evict(memo, e);
+
+	e->position = position;
+	e->nt_id = nt_id;
+	e->state = RDESC_MEMO_FAILED;
+	e->generation = memo->generation;
+}
+
+struct rdesc_memo_snapshot *rdesc_memo_snapshot(struct rdesc_memo *memo,
+						const void *nodes,
+						size_t size)
+{
+	size += sizeof(struct rdesc_memo_snapshot);
+
+	/* Do not flush the table for a snapshot that can never fit. */
+	if (table_size(memo->cap) + size > memo->memory_limit)
+		return NULL;
+
+	/* Sweep the table with the clock hand until the snapshot fits. A full
+	 * revolution releases every reference. */
+	for (size_t swept = 0;
+	     memo->memory_used + size > memo->memory_limit && swept < memo->cap;
+	     swept++) {
+		evict(memo, &memo->entries[memo->hand]);
+
+		memo->hand = (memo->hand + 1) & (memo->cap - 1);
+	}
+
+	if (memo->memory_used + size > memo->memory_limit)
+		return NULL;
+
+	struct rdesc_memo_snapshot *snapshot = xmalloc(memo->allocator, size);
+	if (snapshot == NULL)
+		return NULL;  /* Memoization is best-effort. */
+
+	snapshot->refcount = 1;
+	snapshot->size = size;
+	memcpy(snapshot->nodes, nodes, size - sizeof(struct rdesc_memo_snapshot));
+
+	memo->memory_used += size;
+
+	return snapshot;
+}
+
+void rdesc_memo_release(struct rdesc_memo *memo,
+			struct rdesc_memo_snapshot *snapshot)
+{
+	if (--snapshot->refcount == 0) {
+		memo->memory_used -= snapshot->size;
+
+		xfree(memo->allocator, snapshot, snapshot->size);
+	}
+}
+
+void rdesc_memo_matched(struct rdesc_memo *memo,
+			struct rdesc_memo_snapshot *snapshot,
+			const void *nodes,
+			uint16_t nt_id,
+			size_t position,
+			size_t span,
+			size_t root_idx,
+			size_t node_count)
+{
+	struct rdesc_memo_entry *e =
+		&memo->entries[slot_of(memo, nt_id, position)];
+
+	evict(memo, e);
+
+	snapshot->refcount++;
+
+	e->position = position;
+	e->nt_id = nt_id;
+	e->state = RDESC_MEMO_MATCHED;
+	e->generation = memo->generation;
+
+	e->span = span;
+	e->root_idx = root_idx;
+	e->node_count = node_count;
+	e->nodes = nodes;
+	e->snapshot = snapshot;
+}
@@ -0,0 +1,138 @@
+/**
+ * @file memo.h
+ * @brief Packrat memoization table used by the pump.
+ *
+ * Results of nonterminal expansions are keyed by (nonterminal id, token
+ * position). A failed expansion is recorded as a single flag, a matched one
+ * references a copy of the subtree so that the pump can graft it back instead
+ * of re-deriving it.
+ */
+
+#ifndef RDESC_MEMO_H
+#define RDESC_MEMO_H
+
+#include "../include/allocator.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/** @brief State of a memo table entry. */
+enum rdesc_memo_state {
+	RDESC_MEMO_EMPTY,
+	/** Nonterminal has no derivation at the position. */
+	RDESC_MEMO_FAILED,
+	/** Nonterminal matched, the subtree snapshot is available. */
+	RDESC_MEMO_MATCHED,
+};
+
+/**
+ * @brief Copy of a CST stack slice, shared by the entries of subtrees inside
+ * it.
+ */
+struct rdesc_memo_snapshot {
+	/** @cond */
+	size_t refcount;
+	size_t size  /* Size of the snapshot in bytes, including the header. */;
+	char nodes[];
+	/** @endcond */
+};
+
+/** @brief A memoized expansion result. */
+struct rdesc_memo_entry {
+	size_t position  /** Token position the nonterminal started at. */;
+	uint16_t nt_id;
+	uint16_t state  /** `enum rdesc_memo_state` */;
+
+	/** @cond */
+	size_t generation  /* Entries of previous generations are treated as
+			    * empty. */;
+	size_t span  /* Number of tokens the subtree consumed. */;
+	size_t root_idx  /* CST index the subtree was recorded at, used for
+			  * relocating parent and child indexes. */;
+	size_t node_count  /* Number of stack elements the subtree spans. */;
+	const void *nodes  /* Subtree root in the snapshot. */;
+	struct rdesc_memo_snapshot *snapshot;
+	/** @endcond */
+};
+
+/**
+ * @brief Bounded memoization table.
+ *
+ * The table is direct-mapped: an entry colliding with another one evicts it.
+ * Snapshots are accounted against `memory_limit`, when a new snapshot does not
+ * fit, a clock hand sweeps the table and releases entries until enough space
+ * is reclaimed.
+ *
+ * Clearing the table only advances its generation, snapshots of previous
+ * generations are released as their slots are reused or swept.
+ */
+struct rdesc_memo {
+	/** @cond */
+	const struct rdesc_allocator *allocator;
+
+	size_t memory_limit;
+	size_t memory_used  /* Including the table itself. */;
+
+	size_t cap  /* Number of entries, power of two. */;
+	size_t hand  /* Clock hand for eviction. */;
+	size_t generation;
+
+	struct rdesc_memo_entry entries[];
+	/** @endcond */
+};
+
+
+/**
+ * @brief Allocates a table that occupies at most `memory_limit` bytes, using
+ * the allocator for the table and its snapshots.
+ */
+struct rdesc_memo *rdesc_memo_new(size_t memory_limit,
+				  const struct rdesc_allocator *allocator);
+
+/** @brief Frees the table and all snapshots. */
+void rdesc_memo_destroy(struct rdesc_memo *memo);
+
+/** @brief Removes all entries, should be called when positions restart. */
+void rdesc_memo_clear(struct rdesc_memo *memo);
+
+/** @brief Returns the entry for the key, or NULL if not memoized. */
+const struct rdesc_memo_entry *rdesc_memo_lookup(const struct rdesc_memo *memo,
+						 uint16_t nt_id,
+						 size_t position);
+
+/** @brief Records that the nonterminal cannot be derived at the position. */
+void rdesc_memo_failed(struct rdesc_memo *memo,
+		       uint16_t nt_id,
+		       size_t position);
+
+/**
+ * @brief Copies `size` bytes of CST stack into a new snapshot.
+ *
+ * Returns NULL if the snapshot does not fit the memory limit or the
+ * allocation fails. The caller owns a reference to the snapshot, which should
+ * be dropped with `rdesc_memo_release` after recording matches in it.
+ */
+struct rdesc_memo_snapshot *rdesc_memo_snapshot(struct rdesc_memo *memo,
+						const void *nodes,
+						size_t size);
+
+/** @brief Drops a reference to the snapshot. */
+void rdesc_memo_release(struct rdesc_memo *memo,
+			struct rdesc_memo_snapshot *snapshot);
+
+/**
+ * @brief Records a matched subtree, which starts at `nodes` in the snapshot
+ * and spans `node_count` stack elements.
+ */
+void rdesc_memo_matched(struct rdesc_memo *memo,
+			struct rdesc_memo_snapshot *snapshot,
+			const void *nodes,
+			uint16_t nt_id,
+			size_t position,
+			size_t span,
+			size_t root_idx,
+			size_t node_count);
+
+
+#endif
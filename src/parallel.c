@@ -0,0 +1,421 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "../include/allocator.h"
+#include "../include/parallel.h"
+#include "../include/pool.h"
+#include "../include/rdesc.h"
+#include "common.h"
+#include "test_instruments.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if !defined(__GNUC__) && !defined(__clang__)
+#error "rdesc parallel parsing requires __atomic builtins"
+#endif
+
+
+/* Chunks each thread parses on average, more chunks balance the load better
+ * while adding boundaries that may be speculated wrong. */
+#define CHUNKS_PER_THREAD 4
+
+/* Fewest tokens in a chunk. */
+#define MIN_CHUNK_LENGTH 256
+
+/* Most threads started by a call, besides the calling one. */
+#define MAX_THREADS 64
+
+#define LIST_INITIAL_CAP 16
+
+#define seminfo_at(seminfos, size, i) \
+	((seminfos) == NULL ? NULL : \
+	 cast(const uint8_t *, seminfos) + (i) * (size))
+
+
+/* Tokens in [begin, end) parsed speculatively from `begin`. */
+struct chunk {
+	size_t begin, end;
+
+	/* Matches of the chunk, which end at `matched`. */
+	struct rdesc_cst_list list;
+	size_t matched;
+
+	/* RDESC_READY if the matches end at `end`, otherwise the result of the
+	 * match starting at `matched`. */
+	enum rdesc_result result;
+	size_t error_position;
+};
+
+struct job {
+	struct rdesc_pool *pool;
+	uint16_t start_symbol;
+	const uint16_t *ids;
+	const void *seminfos;
+	const uint16_t *separators;
+	size_t separator_count;
+
+	struct chunk *chunks;
+	size_t chunk_count;
+
+	/* Next chunk to parse, taken by threads atomically. */
+	size_t next;
+};
+
+
+static void list_init(struct rdesc_cst_list *list,
+		      const struct rdesc_allocator *allocator)
+{
+	list->csts = NULL;
+	list->count = 0;
+	list->cap = 0;
+	list->allocator = allocator;
+}
+
+static int list_push(struct rdesc_cst_list *list, struct rdesc_cst *cst)
+{
+	if (list->count == list->cap) {
+		size_t cap = list->cap ? list->cap * 2 : LIST_INITIAL_CAP;
+		struct rdesc_cst *csts;
+
+		if (list->csts == NULL)
+			csts = xmalloc(list->allocator, cap * sizeof(*csts));
+		else
+			csts = xrealloc(list->allocator, list->csts,
+					list->cap * sizeof(*csts),
+					cap * sizeof(*csts));
+
+		if (csts == NULL)
+			return 1;
+
+		list->csts = csts;
+		list->cap = cap;
+	}
+
+	list->csts[list->count++] = *cst;
+
+	return 0;
+}
+
+/* Frees the list, leaving its CSTs to their new owner. */
+static void list_free(struct rdesc_cst_list *list)
+{
+	if (list->csts != NULL)
+		xfree(list->allocator, list->csts,
+		      list->cap * sizeof(struct rdesc_cst));
+
+	list->csts = NULL;
+	list->count = list->cap = 0;
+}
+
+void rdesc_cst_list_destroy(struct rdesc_cst_list *list)
+{
+	for (size_t i = 0; i < list->count; i++)
+		rdesc_cst_destroy(&list->csts[i]);
+
+	list_free(list);
+}
+
+/* Parses one match from `begin`, the tokens end at `end`. The match is
+ * appended to the list and its end is stored in `matched` if it is ready,
+ * `error_position` is set if it fails. */
+static enum rdesc_result parse_match(struct rdesc *p, uint16_t start_symbol,
+				     const uint16_t *ids, const void *seminfos,
+				     size_t begin, size_t end,
+				     struct rdesc_cst_list *list,
+				     size_t *matched, size_t *error_position)
+{
+	struct rdesc_cst cst;
+	enum rdesc_result res;
+	size_t consumed;
+
+	if (rdesc_start(p, start_symbol))
+		return RDESC_ENOMEM;
+
+	res = rdesc_pump_many(p, &ids[begin],
+			      seminfo_at(seminfos, p->seminfo_size, begin),
+			      end - begin, &consumed);
+
+	if (res == RDESC_NOMATCH)
+		*error_position = begin + rdesc_error_position(p);
+	else if (res == RDESC_CONTINUE)
+		*error_position = begin;
+
+	if (res != RDESC_READY) {
+		rdesc_clear(p);
+
+		return res;
+	}
+
+	runtime_assertion(p->released + p->position > 0,
+			  "start symbol matches empty input");
+
+	/* Tokens pumped after the match, left in the parser for the next
+	 * start, are discarded with the clear and pumped again. */
+	*matched = begin + p->released + p->position;
+
+	if (rdesc_take_cst(p, &cst)) {
+		rdesc_clear(p);
+
+		return RDESC_ENOMEM;
+	}
+
+	rdesc_clear(p);
+
+	if (list_push(list, &cst)) {
+		rdesc_cst_destroy(&cst);
+
+		return RDESC_ENOMEM;
+	}
+
+	return RDESC_READY;
+}
+
+static bool is_separator(uint16_t id, const uint16_t *separators,
+			 size_t separator_count)
+{
+	for (size_t i = 0; i < separator_count; i++)
+		if (separators[i] == id)
+			return true;
+
+	return false;
+}
+
+/* Position after the first separator after `position`, `end` if there is
+ * none before it. */
+static size_t next_boundary(const struct job *job, size_t position,
+			    size_t end)
+{
+	while (++position < end &&
+	       !is_separator(job->ids[position - 1], job->separators,
+			     job->separator_count))
+		;
+
+	return position;
+}
+
+static void parse_chunk(struct rdesc *p, const struct job *job,
+			struct chunk *c)
+{
+	while (true) {
+		c->matched = c->begin;
+		c->result = RDESC_READY;
+
+		while (c->matched < c->end && c->result == RDESC_READY)
+			c->result = parse_match(p, job->start_symbol, job->ids,
+						job->seminfos, c->matched,
+						c->end, &c->list, &c->matched,
+						&c->error_position);
+
+		if (c->result != RDESC_NOMATCH)
+			return;
+
+		/* The chunk may start inside a match, which fails once it
+		 * leaves the enclosing one. It is speculated again after the
+		 * next separator. A real failure is found by the join, which
+		 * parses up to the new start. */
+		size_t begin = next_boundary(job, c->matched, c->end);
+
+		if (begin == c->end)
+			return;
+
+		rdesc_cst_list_destroy(&c->list);
+		c->begin = begin;
+	}
+}
+
+/* Parses chunks until none is left. */
+static void parse_chunks(struct rdesc *p, struct job *job)
+{
+	size_t i;
+
+	while ((i = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED)) <
+	       job->chunk_count)
+		parse_chunk(p, job, &job->chunks[i]);
+}
+
+/* Thread parsing chunks with a parser of its own. If the pool has none
+ * left, the other threads parse its chunks. */
+static void *work(void *arg)
+{
+	struct job *job = arg;
+	struct rdesc *p = rdesc_pool_acquire(job->pool);
+
+	if (p == NULL)
+		return NULL;
+
+	parse_chunks(p, job);
+	rdesc_pool_release(job->pool, p);
+
+	return NULL;
+}
+
+/* Splits the tokens into at most `count` chunks after separators, and
+ * returns the number of chunks. */
+static size_t split(struct job *job, size_t count, size_t n)
+{
+	size_t chunk_count = 0, begin = 0;
+
+	for (size_t i = 1; i <= count && begin < n; i++) {
+		size_t end = n * i / count;
+
+		if (end <= begin)
+			continue;
+
+		end = next_boundary(job, end - 1, n);
+
+		job->chunks[chunk_count].begin = begin;
+		job->chunks[chunk_count].end = end;
+		chunk_count++;
+
+		begin = end;
+	}
+
+	return chunk_count;
+}
+
+/* Joins the chunks in order, parsing the tokens between a match and the
+ * next chunk starting at its end on the parser. */
+static enum rdesc_result join(struct rdesc *p, struct job *job, size_t n,
+			      struct rdesc_cst_list *list,
+			      size_t *error_position)
+{
+	struct chunk *chunks = job->chunks;
+	size_t position = 0, i = 0;
+
+	while (position < n) {
+		enum rdesc_result res;
+
+		/* Chunks starting inside a match are speculated wrong. */
+		while (i < job->chunk_count && chunks[i].begin < position)
+			i++;
+
+		if (i < job->chunk_count && chunks[i].begin == position) {
+			struct chunk *c = &chunks[i++];
+
+			for (size_t j = 0; j < c->list.count; j++)
+				if (list_push(list, &c->list.csts[j])) {
+					while (j < c->list.count)
+						rdesc_cst_destroy(
+							&c->list.csts[j++]);
+
+					list_free(&c->list);
+
+					return RDESC_ENOMEM;
+				}
+
+			list_free(&c->list);
+			position = c->matched;
+
+			if (c->result == RDESC_READY)
+				continue;
+
+			/* A match crossing the chunk end is parsed again. */
+			if (c->result != RDESC_CONTINUE || c->end == n) {
+				*error_position = c->error_position;
+
+				return c->result;
+			}
+		}
+
+		res = parse_match(p, job->start_symbol, job->ids,
+				  job->seminfos, position, n, list, &position,
+				  error_position);
+
+		if (res != RDESC_READY)
+			return res;
+	}
+
+	return RDESC_READY;
+}
+
+enum rdesc_result rdesc_parse_parallel(struct rdesc_pool *pool,
+				       uint16_t start_symbol,
+				       const uint16_t *ids,
+				       const void *seminfos,
+				       size_t n,
+				       const uint16_t *separators,
+				       size_t separator_count,
+				       size_t thread_count,
+				       struct rdesc_cst_list *list,
+				       size_t *error_position)
+{
+	pthread_t threads[MAX_THREADS];
+	struct job job;
+	struct rdesc *p;
+	enum rdesc_result res;
+	size_t max_chunks, ignored_position, started = 0;
+
+	if (error_position == NULL)
+		error_position = &ignored_position;
+
+	if (thread_count > pool->size)
+		thread_count = pool->size;
+	if (thread_count > MAX_THREADS + 1)
+		thread_count = MAX_THREADS + 1;
+	if (thread_count == 0)
+		thread_count = 1;
+
+	max_chunks = thread_count * CHUNKS_PER_THREAD;
+	if (max_chunks > n / MIN_CHUNK_LENGTH)
+		max_chunks = n / MIN_CHUNK_LENGTH;
+	if (max_chunks == 0)
+		max_chunks = 1;
+
+	list_init(list, pool->allocator);
+
+	/* The calling thread parses chunks and joins them on the same
+	 * parser, it is not given back until the call returns. */
+	p = rdesc_pool_acquire(pool);
+
+	if (p == NULL)
+		return RDESC_ENOMEM;
+
+	runtime_assertion(p->token_destroyer == NULL,
+			  "speculative parses cannot own tokens");
+
+	job.pool = pool;
+	job.start_symbol = start_symbol;
+	job.ids = ids;
+	job.seminfos = seminfos;
+	job.separators = separators;
+	job.separator_count = separator_count;
+	job.next = 0;
+	job.chunks = xmalloc(pool->allocator, max_chunks * sizeof(struct chunk));
+
+	if (job.chunks == NULL) {
+		rdesc_pool_release(pool, p);
+
+		return RDESC_ENOMEM;
+	}
+
+	job.chunk_count = split(&job, max_chunks, n);
+
+	for (size_t i = 0; i < job.chunk_count; i++)
+		list_init(&job.chunks[i].list, pool->allocator);
+
+	/* Threads that cannot be created leave their chunks to the others. */
+	while (started + 1 < thread_count &&
+	       pthread_create(&threads[started], NULL, work, &job) == 0)
+		started++;
+
+	parse_chunks(p, &job);
+
+	for (size_t i = 0; i < started; i++)
+		pthread_join(threads[i], NULL);
+
+	res = join(p, &job, n, list, error_position);
+
+	rdesc_pool_release(pool, p);
+
+	for (size_t i = 0; i < job.chunk_count; i++)
+		rdesc_cst_list_destroy(&job.chunks[i].list);
+
+	xfree(pool->allocator, job.chunks, max_chunks * sizeof(struct chunk));
+
+	if (res == RDESC_ENOMEM)
+		rdesc_cst_list_destroy(list);
+
+	return res;
+}
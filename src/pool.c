@@ -0,0 +1,114 @@
+#include "../include/allocator.h"
+#include "../include/pool.h"
+#include "../include/rdesc.h"
+#include "allocator.h"
+#include "common.h"
+#include "test_instruments.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if !defined(__GNUC__) && !defined(__clang__)
+#error "rdesc pool requires __atomic builtins"
+#endif
+
+
+struct _rdesc_priv_pool_slot {
+	struct rdesc parser;
+
+	/* Non-zero while a thread owns the parser. Acquiring it synchronizes
+	 * with the release storing zero, so the new owner sees the parser as
+	 * the previous one left it. */
+	int acquired;
+};
+
+
+/* Destroys the parsers of the first `count` slots and frees the slots. */
+static void destroy_slots(struct rdesc_pool *pool, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		rdesc_destroy(&pool->slots[i].parser);
+
+	xfree(pool->allocator, pool->slots,
+	      pool->size * sizeof(struct _rdesc_priv_pool_slot));
+}
+
+int rdesc_pool_init(struct rdesc_pool *pool,
+		    size_t size,
+		    const struct rdesc_grammar *grammar,
+		    size_t seminfo_size,
+		    void (*token_destroyer)(uint16_t, void *),
+		    const struct rdesc_allocator *allocator)
+{
+	runtime_assertion(size > 0, "pool has no parsers");
+
+	pool->allocator = allocator_or_libc(allocator);
+	pool->size = size;
+	pool->next = 0;
+	pool->slots = xmalloc(pool->allocator,
+			      size * sizeof(struct _rdesc_priv_pool_slot));
+
+	if (pool->slots == NULL)
+		return 1;
+
+	for (size_t i = 0; i < size; i++) {
+		struct rdesc *p = &pool->slots[i].parser;
+
+		pool->slots[i].acquired = 0;
+
+		if (rdesc_init_with_allocator(p, grammar, seminfo_size,
+					      token_destroyer,
+					      pool->allocator)) {
+			destroy_slots(pool, i);
+
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+void rdesc_pool_destroy(struct rdesc_pool *pool)
+{
+	destroy_slots(pool, pool->size);
+}
+
+struct rdesc *rdesc_pool_acquire(struct rdesc_pool *pool)
+{
+	size_t start = __atomic_fetch_add(&pool->next, 1, __ATOMIC_RELAXED);
+
+	for (size_t i = 0; i < pool->size; i++) {
+		struct _rdesc_priv_pool_slot *slot =
+			&pool->slots[(start + i) % pool->size];
+
+		/* Read the flag before exchanging it, which keeps the cache
+		 * lines of acquired slots shared while looking for a free
+		 * one. */
+		if (__atomic_load_n(&slot->acquired, __ATOMIC_RELAXED))
+			continue;
+
+		if (!__atomic_exchange_n(&slot->acquired, 1, __ATOMIC_ACQUIRE))
+			return &slot->parser;
+	}
+
+	return NULL;
+}
+
+void rdesc_pool_release(struct rdesc_pool *pool, struct rdesc *p)
+{
+	struct _rdesc_priv_pool_slot *slot =
+		cast(struct _rdesc_priv_pool_slot *, p);
+
+	(void) pool;
+
+	runtime_assertion(slot >= pool->slots &&
+			  slot < pool->slots + pool->size,
+			  "parser is not from the pool");
+	runtime_assertion(__atomic_load_n(&slot->acquired, __ATOMIC_RELAXED),
+			  "parser is not acquired");
+
+	rdesc_clear(p);
+
+	__atomic_store_n(&slot->acquired, 0, __ATOMIC_RELEASE);
+}
@@ -1,11 +1,48 @@
+/* Sources generated by `rdesc_dump_c` include this file once more, with
+ * RDESC_AOT_GRAMMAR defined to a constant grammar. Public functions are
+ * renamed with RDESC_AOT_NAME to coexist with the library, and checked
+ * against their declarations in aot.h. tests/integration/aot_symbols.c
+ * expects every function of the library to be renamed. */
+#ifdef RDESC_AOT_GRAMMAR
+#define rdesc_destroy RDESC_AOT_NAME(destroy)
+#define rdesc_memoize RDESC_AOT_NAME(memoize)
+#define rdesc_seminfo_sizes RDESC_AOT_NAME(seminfo_sizes)
+#define rdesc_recover RDESC_AOT_NAME(recover)
+#define rdesc_start RDESC_AOT_NAME(start)
+#define rdesc_reparse RDESC_AOT_NAME(reparse)
+#define rdesc_stream RDESC_AOT_NAME(stream)
+#define rdesc_reset RDESC_AOT_NAME(reset)
+#define rdesc_clear RDESC_AOT_NAME(clear)
+#define rdesc_pump RDESC_AOT_NAME(pump)
+#define rdesc_pump_many RDESC_AOT_NAME(pump_many)
+#define rdesc_root RDESC_AOT_NAME(root)
+#define rdesc_read_stats RDESC_AOT_NAME(read_stats)
+#define rdesc_error_position RDESC_AOT_NAME(error_position)
+#define rdesc_expected_tokens RDESC_AOT_NAME(expected_tokens)
+#define rdesc_take_cst RDESC_AOT_NAME(take_cst)
+#define rdesc_cst_root RDESC_AOT_NAME(cst_root)
+#define rdesc_cst_destroy RDESC_AOT_NAME(cst_destroy)
+#define _rdesc_priv_cst_illegal_access RDESC_AOT_NAME(cst_illegal_access)
+#define _rdesc_priv_tape_seminfo RDESC_AOT_NAME(tape_seminfo)
+#define _rdesc_priv_cst_node RDESC_AOT_NAME(cst_node)
+#define _rdesc_priv_cst_seminfo RDESC_AOT_NAME(cst_seminfo)
+#endif
+
+#include "../include/allocator.h"
 #include "../include/cst_macros.h"
 #include "../include/grammar.h"
 #include "../include/rdesc.h"
 #include "../include/rule_macros.h"
 #include "../include/stack.h"
+#include "allocator.h"
 #include "common.h"
+#include "memo.h"
 #include "test_instruments.h"
 
+#ifdef RDESC_AOT_GRAMMAR
+#include "../include/aot.h"
+#endif
+
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -13,24 +50,83 @@
 #include <string.h>
 
 
-/* Additional space for child pointers in nonterminal. */
-#define rchild_list_cap(p, nt_id) \
-	((p).grammar->child_caps[nt_id] * sizeof(size_t) + sizeof_node(p) - 1) \
-		/ sizeof_node(p)
+/* Grammar the pump interprets. A constant grammar lets the compiler fold its
+ * dimensions and tables into the pump. */
+#ifdef RDESC_AOT_GRAMMAR
+#define pump_grammar(p) (*((void) (p), &(RDESC_AOT_GRAMMAR)))
+#else
+#define pump_grammar(p) (*(p)->grammar)
+#endif
+
+/* Additional space for child pointers in nonterminal, depends on the variant
+ * the nonterminal is at. */
+#define rchild_list_cap(p, nt_id, variant) \
+	((variant_child_cap(pump_grammar(&(p)), nt_id, variant) + \
+	  ((p).memo != NULL ? MEMO_SLOTS : 0)) * sizeof(_rdesc_priv_idx_t) \
+	 + sizeof_node(p) - 1) / sizeof_node(p)
+
+/* If memoization is enabled, nonterminals reserve extra slots after their
+ * child list:
+ * 0. Token position the nonterminal started at, shifted left by two. Lowest
+ *    bits hold MEMO_MATCHED and MEMO_STALE flags.
+ * 1. Number of stack elements its first match spans.
+ * 2. Number of tokens its first match consumed.
+ * 3. Number of tokens examined from its start position until its first match,
+ *    which the match depends on. */
+#define MEMO_SLOTS 4
+#define rmemo_slot(p, nt_node, i) \
+	_rdesc_priv_child_idx(nt_node, \
+			      variant_child_cap(pump_grammar(&(p)), \
+						rid(nt_node), \
+						rvariant(nt_node)) + (i))
+
+/* The nonterminal has matched at least once. */
+#define MEMO_MATCHED 1
+/* The first match of the nonterminal is memoized or destroyed. */
+#define MEMO_STALE 2
 
 /* Returns the previous node's unwind size (used to navigate backwards). */
 #define runwind_size(node) _rdesc_priv_node_deref(node).unwind_size
 
-
-/* Constructs nonterminal. Returns non-zero and rolls back to previous valid
- * state if construction fails. */
-static int new_nt_node(struct rdesc *p, uint16_t nt_id);
-/* Constructs token and returns 0 if the construction succeeded. */
-static int new_tk_node(struct rdesc *p, uint16_t tk_id, const void *seminfo);
-
-/* Destroys all tokens in CST and token stacks. */
+/* The nonterminal has a left-recursive variant, its matches grow. */
+#define grows(p, nt_id) \
+	(pump_grammar(&(p)).grow_sets != NULL && \
+	 (grow_set(pump_grammar(&(p)), nt_id, 0)[0] & 1))
+
+/* Size of the expected token bitset. */
+#define expected_size(p) (((size_t) pump_grammar(&(p)).tk_count + 7) / 8)
+
+/* Synchronization tokens of each nonterminal are two bitsets of the size of
+ * the expected token set, consumed and kept ones. Bit 0 of the consumed set
+ * marks the nonterminals that recover. */
+#define syncs_size(p) \
+	((size_t) pump_grammar(&(p)).nt_count * 2 * expected_size(p))
+#define sync_set(p, syncs, nt_id, kept) \
+	(&(syncs)[((size_t) (nt_id) * 2 + (kept)) * expected_size(p)])
+
+
+/* Constructs nonterminal starting from the variant. Returns non-zero and rolls
+ * back to previous valid state if construction fails. */
+static int new_nt_node(struct rdesc *p, uint16_t nt_id, uint16_t variant);
+/* Fills the nonterminal at `p->cur` in space already pushed for it and its
+ * children, and cannot fail. */
+static void init_nt_node(struct rdesc *p, size_t parent_idx, uint16_t nt_id,
+			 uint16_t variant, uint16_t child_list_cap);
+/* Constructs token node for the token at the current position and returns 0
+ * if the construction succeeded. */
+static int new_tk_node(struct rdesc *p, uint16_t tk_id);
+
+/* Appends the token to the tape, or saves it for retry and returns non-zero
+ * if memory allocation fails. */
+static int push_token(struct rdesc *p, uint16_t tk_id, const void *seminfo);
+
+/* Destroys all tokens in the tape and the saved token. */
 static void destroy_tokens(struct rdesc *p);
 
+/* Drops packed seminfo of the tokens before the tape index. */
+static void shift_seminfos(struct rdesc_stack *tape,
+			   struct rdesc_stack **seminfos, size_t index);
+
 /* Adds children to parent's child list using indexes. This function does not
  * fail even if realloc changed the stack pointer. */
 static inline void push_child(struct rdesc *p,
@@ -41,19 +137,39 @@ static inline void push_child(struct rdesc *p,
 static inline void pop_child(struct rdesc *p,
 			     size_t node_idx);
 
-int rdesc_init(struct rdesc *p,
-	       const struct rdesc_grammar *grammar,
-	       size_t seminfo_size,
-	       void (*token_destroyer)(uint16_t, void *))
+static int init_parser(struct rdesc *p,
+		       const struct rdesc_grammar *grammar,
+		       size_t seminfo_size,
+		       void (*token_destroyer)(uint16_t, void *),
+		       const struct rdesc_allocator *allocator)
 {
+	p->allocator = allocator_or_libc(allocator);
 	p->grammar = grammar;
 	p->seminfo_size = seminfo_size;
 	p->token_destroyer = token_destroyer;
 
 	p->cur = SIZE_MAX;
+	p->saved_tk = 0;
+	p->top_unwind = 0;
+	p->position = 0;
+	p->farthest = 0;
+	p->cut = 0;
+	p->released = 0;
+	p->released_nodes = 0;
+	p->error_position = 0;
+	p->expected = NULL;
+	p->syncs = NULL;
+	p->stats.backtracks = 0;
+	p->stats.rewound_tokens = 0;
+
+	p->memo = NULL;
+	p->consumer = NULL;
+
+	p->seminfo_sizes = NULL;
+	p->seminfos = NULL;
 
 	if (seminfo_size > 0) {
-		p->saved_seminfo = xmalloc(seminfo_size);
+		p->saved_seminfo = xmalloc(p->allocator, seminfo_size);
 
 		if (p->saved_seminfo == NULL)
 			return 1; /* Could not preallocate extra seminfo space. */
@@ -61,19 +177,21 @@ int rdesc_init(struct rdesc *p,
 		p->saved_seminfo = NULL;
 	}
 
-	rdesc_stack_init(&p->token_stack, sizeof_tk(*p));
-	if (p->token_stack == NULL) {
+	rdesc_stack_init_with_allocator(&p->tape, sizeof_tk(*p),
+					p->allocator);
+	if (p->tape == NULL) {
 		if (p->saved_seminfo != NULL)
-			free(p->saved_seminfo);
+			xfree(p->allocator, p->saved_seminfo, seminfo_size);
 
-		return 1;  /* Could not initialize token stack.  */
+		return 1;  /* Could not initialize token tape.  */
 	}
 
-	rdesc_stack_init(&p->cst_stack, sizeof_node(*p));
+	rdesc_stack_init_with_allocator(&p->cst_stack, sizeof_node(*p),
+					p->allocator);
 	if (p->cst_stack == NULL) {
 		if (p->saved_seminfo != NULL)
-			free(p->saved_seminfo);
-		rdesc_stack_destroy(p->token_stack);
+			xfree(p->allocator, p->saved_seminfo, seminfo_size);
+		rdesc_stack_destroy(p->tape);
 
 		return 1;  /* Could not intialize CST stack. */
 	}
@@ -81,451 +199,1961 @@ int rdesc_init(struct rdesc *p,
 	return 0;
 }
 
-void rdesc_destroy(struct rdesc *p)
+#ifdef RDESC_AOT_GRAMMAR
+/* The compiled parser takes no grammar, it only runs the one it is compiled
+ * against. */
+int RDESC_AOT_NAME(init)(struct rdesc *p,
+			 size_t seminfo_size,
+			 void (*token_destroyer)(uint16_t, void *))
 {
-	destroy_tokens(p);
-
-	rdesc_stack_destroy(p->token_stack);
-	rdesc_stack_destroy(p->cst_stack);
-
-	if (p->saved_seminfo != NULL)
-		free(p->saved_seminfo);
+	return init_parser(p, &RDESC_AOT_GRAMMAR, seminfo_size,
+			   token_destroyer, NULL);
 }
 
-int rdesc_start(struct rdesc *p, uint16_t start_symbol)
+int RDESC_AOT_NAME(init_with_allocator)(struct rdesc *p,
+					size_t seminfo_size,
+					void (*token_destroyer)(uint16_t,
+								void *),
+					const struct rdesc_allocator *allocator)
 {
-	runtime_assertion(p->cur == SIZE_MAX, "cannot start during parse");
-
-	p->saved_tk = 0;
-	p->top_unwind = 0;
-
-	rdesc_stack_reset(&p->cst_stack);
-
-	if (new_nt_node(p, start_symbol))
-		return 1;  /* Start symbol creation failed. */
+	return init_parser(p, &RDESC_AOT_GRAMMAR, seminfo_size,
+			   token_destroyer, allocator);
+}
+#else
+int rdesc_init(struct rdesc *p,
+	       const struct rdesc_grammar *grammar,
+	       size_t seminfo_size,
+	       void (*token_destroyer)(uint16_t, void *))
+{
+	return init_parser(p, grammar, seminfo_size, token_destroyer, NULL);
+}
 
-	return 0;
+int rdesc_init_with_allocator(struct rdesc *p,
+			      const struct rdesc_grammar *grammar,
+			      size_t seminfo_size,
+			      void (*token_destroyer)(uint16_t, void *),
+			      const struct rdesc_allocator *allocator)
+{
+	return init_parser(p, grammar, seminfo_size, token_destroyer,
+			   allocator);
 }
+#endif
 
-void rdesc_reset(struct rdesc *p)
+void rdesc_destroy(struct rdesc *p)
 {
 	destroy_tokens(p);
 
-	p->cur = SIZE_MAX;
+	rdesc_stack_destroy(p->tape);
+	rdesc_stack_destroy(p->cst_stack);
 
-	rdesc_stack_reset(&p->token_stack);
+	if (p->seminfos != NULL)
+		rdesc_stack_destroy(p->seminfos);
 
-	rdesc_stack_reset(&p->cst_stack);
+	if (p->saved_seminfo != NULL)
+		xfree(p->allocator, p->saved_seminfo, p->seminfo_size);
+
+	if (p->expected != NULL)
+		xfree(p->allocator, p->expected, expected_size(*p));
+
+	if (p->syncs != NULL)
+		xfree(p->allocator, p->syncs, syncs_size(*p));
+
+	if (p->memo != NULL)
+		rdesc_memo_destroy(p->memo);
 }
 
-static void destroy_tokens(struct rdesc *p)
+int rdesc_memoize(struct rdesc *p, size_t memory_limit)
 {
-	if (!p->token_destroyer)
-		return;
+	runtime_assertion(p->cur == SIZE_MAX,
+			  "cannot change memoization during parse");
 
-	if (p->saved_tk)
-		p->token_destroyer(p->saved_tk, p->saved_seminfo);
+	struct rdesc_memo *memo = NULL;
 
-	/* Destroy tokens in backtrack stack */
-	for (size_t i = 0; i < rdesc_stack_len(p->token_stack); i++) {
-		tk_t *tk = rdesc_stack_at(p->token_stack, i);
-		p->token_destroyer(tk->id, &tk->seminfo);
-	}
+	if (memory_limit > 0) {
+		memo = rdesc_memo_new(memory_limit, p->allocator);
 
-	if (rdesc_stack_len(p->cst_stack)) {
-		/* Walk CST backwards to destroy all embedded tokens */
-		uint16_t top_unwind = p->top_unwind;
+		if (memo == NULL)
+			return 1;
+	}
 
-		for (size_t top_idx = rdesc_stack_len(p->cst_stack) - top_unwind;
-		     top_idx > 0;  /* Termination: Cannot be a token */
-		     top_idx -= top_unwind) {
-			node_t *top = rdesc_stack_at(p->cst_stack, top_idx);
+	if (p->memo != NULL)
+		rdesc_memo_destroy(p->memo);
 
-			if (rtype(top) == RDESC_TOKEN)
-				p->token_destroyer(rid(top), rseminfo(top));
+	p->memo = memo;
 
-			top_unwind = runwind_size(top);
-		}
-	}
+	return 0;
 }
 
-/* - THE PUMP -------------------------------------------------------------- */
-#define current_variant_body(node) \
-	productions(*p->grammar)[rid(node)][rvariant(node)]
-#define next_symbol(node) \
-	current_variant_body(node)[rchild_count(node)]
+int rdesc_seminfo_sizes(struct rdesc *p, const size_t *sizes)
+{
+	runtime_assertion(p->cur == SIZE_MAX && rdesc_stack_len(p->tape) == 0,
+			  "cannot change seminfo layout of held tokens");
 
-#define is_body_complete(node) \
-	(next_symbol(node).id == EOB && \
-	 next_symbol(node).ty == RDESC_SENTINEL)
+	struct rdesc_stack *tape, *seminfos = NULL;
 
-#define is_construct_end(node) \
-	(current_variant_body(node)[0].id == EOC && \
-	 current_variant_body(node)[0].ty == RDESC_SENTINEL)
+	/* The layout of the tape depends on the seminfo buffer. */
+	if (sizes != NULL) {
+		rdesc_stack_init_with_allocator(&seminfos, 1, p->allocator);
+		if (seminfos == NULL)
+			return 1;
 
-/* Backtraces to the last nonterminal that is not completed, or teardowns the
- * entire CST. */
-static inline int nonterminal_failed(struct rdesc *p)
-{
-	size_t scan_idx = rdesc_stack_len(p->cst_stack) - p->top_unwind;
-	size_t tokens_pushed = 0;
+		rdesc_stack_init_with_allocator(&tape, sizeof(tk_t),
+						p->allocator);
+	} else {
+		rdesc_stack_init_with_allocator(&tape, sizeof(tk_t) -
+						sizeof(uint32_t) +
+						p->seminfo_size,
+						p->allocator);
+	}
 
-	/* FIRST traversal: Push tokens to backtracking stack. */
+	if (tape == NULL) {
+		if (seminfos != NULL)
+			rdesc_stack_destroy(seminfos);
 
-	/* Initialization: Start from the top. */
-	while (true) {
-		node_t *top = rdesc_stack_at(p->cst_stack, scan_idx);
+		return 1;
+	}
 
-		/* Maintenance: The slice from scan_idx to stack_len does not
-		 * contain a nonterminal that have unchecked variant. */
-		if (rtype(top) == RDESC_TOKEN) {
-			if (rdesc_stack_push(&p->token_stack, &top->n.tk) == NULL) {
-				/* Could not move token to token stack! Keep
-				 * existing token in CST and report error. :*/
+	rdesc_stack_destroy(p->tape);
+	if (p->seminfos != NULL)
+		rdesc_stack_destroy(p->seminfos);
 
-				rdesc_stack_multipop(&p->token_stack, tokens_pushed);
+	p->tape = tape;
+	p->seminfos = seminfos;
+	p->seminfo_sizes = sizes;
 
-				return 1;
-			}
-			tokens_pushed++;
-		} else /* RDESC_NONTERMINAL */ {
-			uint16_t saved_child_count = rchild_count(top);
-			rvariant(top)++;
-			rchild_count(top) = 0;
+	return 0;
+}
 
-			/* Termination: Found a nonterminal with remaining
-			 * variants. */
-			bool is_construct_not_end = !is_construct_end(top);
+int rdesc_recover(struct rdesc *p, const struct rdesc_sync *syncs,
+		  size_t count)
+{
+	runtime_assertion(p->cur == SIZE_MAX,
+			  "cannot change recovery during parse");
 
-			/* Rollback changes. The second loop will update the
-			 * nonterminal. */
-			rvariant(top)--;
-			rchild_count(top) = saved_child_count;
+	uint8_t *tables = NULL;
 
-			if (is_construct_not_end)
-				break;
-		}
+	if (count > 0) {
+		tables = xmalloc(p->allocator, syncs_size(*p));
 
-		scan_idx -= runwind_size(top);
+		if (tables == NULL)
+			return 1;
 
-		/* Parse operation fails if removed element does not belong to
-		 * any node, that is removing the node. */
-		if (_rdesc_priv_parent_idx(top) == SIZE_MAX)
-			break;
+		memset(tables, 0, syncs_size(*p));
 	}
 
-	/* Two loops exist to enable rollback to valid state in case of
-	 * memory allocation failure. After the first loop ensure all the
-	 * tokens pushed back to backtracking stack, the second one removes
-	 * elements of first stack. */
+	for (size_t i = 0; i < count; i++) {
+		const struct rdesc_sync *sync = &syncs[i];
+		uint8_t *set = sync_set(*p, tables, sync->nt_id,
+					!sync->consumed);
 
-	/* Now the traversal changes the parser state. From now on no memory
-	 * failure can occur. */
-	p->cur = rdesc_stack_len(p->cst_stack) - p->top_unwind;
-	/* Safety: p->cur changed, so p->top_unwind MUST BE CHANGED. This is
-	 * guaranteed in next loop: Before every break we update
-	 * p->top_unwind. */
+		runtime_assertion(sync->nt_id < pump_grammar(p).nt_count &&
+				  sync->tk_id != 0 &&
+				  sync->tk_id < pump_grammar(p).tk_count,
+				  "synchronization token is not in the grammar");
 
-	while (true) {
-		node_t *top = rdesc_stack_at(p->cst_stack, p->cur);
+		set[sync->tk_id / 8] |= 1 << (sync->tk_id % 8);
+		sync_set(*p, tables, sync->nt_id, 0)[0] |= 1;
+	}
 
-		if (rtype(top) == RDESC_NONTERMINAL) {
-			/* Be careful: All children have been removed, so the
-			 * nonterminal is now the topmost node. */
-			rvariant(top)++;
-			rchild_count(top) = 0;
+	if (p->syncs != NULL)
+		xfree(p->allocator, p->syncs, syncs_size(*p));
 
-			/* Found unfinished nonterminal. */
-			if (!is_construct_end(top)) {
-				p->top_unwind = 1 + rchild_list_cap(*p, rid(top));
+	p->syncs = tables;
 
-				break;
-			}
-		}
+	return 0;
+}
 
-		/* Remove element from parent's child pointer list. */
-		size_t parent_idx = _rdesc_priv_parent_idx(top);
-		if (parent_idx != SIZE_MAX)
-			pop_child(p, parent_idx);
+/* Starts a new match at the beginning of the tape. Capacity of the CST stack
+ * is kept. */
+static int start_match(struct rdesc *p, uint16_t start_symbol)
+{
+#ifdef RDESC_AOT_GRAMMAR
+	runtime_assertion(p->grammar == &RDESC_AOT_GRAMMAR,
+			  "parser is not initialized with the compiled grammar");
+#endif
+
+	/* Allocated on the first start, as the parser may be initialized
+	 * without a grammar. */
+	if (p->expected == NULL) {
+		p->expected = xmalloc(p->allocator, expected_size(*p));
+
+		if (p->expected == NULL)
+			return 1;
+	}
 
-		/* Exit case, explained in previous loop. */
-		if (parent_idx == SIZE_MAX) {
-			p->top_unwind = 0;
+	/* The start symbol takes the place of the previous CST. Its space is
+	 * reserved before anything changes, so that a failed start leaves the
+	 * previous CST as it was. */
+	uint16_t child_list_cap = rchild_list_cap(*p, start_symbol, 0);
+	size_t nodes = rdesc_stack_len(p->cst_stack);
 
-			break;
-		}
+	if (nodes < 1 + (size_t) child_list_cap &&
+	    rdesc_stack_multipush(&p->cst_stack, NULL,
+				  1 + child_list_cap - nodes) == NULL)
+		return 1;
 
-		p->cur -= runwind_size(top);
-	};
+	p->saved_tk = 0;
+	p->top_unwind = 0;
+	p->position = 0;
+	p->farthest = 0;
+	p->cut = 0;
+	p->released = 0;
+	p->released_nodes = 0;
+	p->error_position = 0;
+
+	/* Token positions restart, memoized results are no longer valid. */
+	if (p->memo != NULL)
+		rdesc_memo_clear(p->memo);
 
-	/* Remove nodes after the p->cur, which is the top. */
 	rdesc_stack_multipop(&p->cst_stack,
-			     rdesc_stack_len(p->cst_stack) - (p->cur + p->top_unwind));
+			     rdesc_stack_len(p->cst_stack) - 1 - child_list_cap);
+
+	p->cur = 0;
+	init_nt_node(p, SIZE_MAX, start_symbol, 0, child_list_cap);
 
 	return 0;
 }
 
-/* Internal pump state machine. Returns next action for outer pump loop.
- *
- * - EMEM: Provided token pushed to either CST stack or token stack, but memory
- *   allocation error occurred afterwards.
- *
- * - EMEM_TK_NOT_OWNED: Provided token was not pushed to token stack or CST,
- *   and it still belong to caller.
- *
- * - READY: Parse complete.
- *
- * - CONTINUE: Request the next token.
- *
- * - NOMATCH: Parse failed.
- *
- * - RETRY: Descend into nonterminal, caller should call this function again. */
-static inline enum internal_pump_state {
-	EMEM,
-	EMEM_TK_NOT_OWNED,
-	READY,
-	CONTINUE,
-	NOMATCH,
-	RETRY,
-} rdesc_pump_internal(struct rdesc *p, tk_t *tk)
+/* Drops the first `count` tokens of the tape, tokens after them move to its
+ * beginning. */
+static void drop_tokens(struct rdesc *p, size_t count)
 {
-	node_t *n = rdesc_stack_at(p->cst_stack, p->cur);
-
-	if (rdesc_stack_len(p->cst_stack) == 0) {
-		if (rdesc_stack_push(&p->token_stack, tk) == NULL) {
-			/* Token should be stored for next start, but could
-			 * not because of push error. */
-			return EMEM_TK_NOT_OWNED;
-		}
+	size_t pending = rdesc_stack_len(p->tape) - count;
 
-		return NOMATCH;
-	}
-
-	struct rdesc_grammar_symbol rule = next_symbol(n);
-
-	switch (rule.ty) {
-	case RDESC_TOKEN:
-		if (rule.id == tk->id) {
-			/* Match! Add the token to nonterminal's children. */
-			if (new_tk_node(p, tk->id, &tk->seminfo)) {
-				/* Could not add token to the current
-				 * nonterminal's children. */
-				return EMEM_TK_NOT_OWNED;
-			}
-		} else {
-			/* Push the token back to the token stack and continue
-			 * on the next variant. */
-			if (rdesc_stack_push(&p->token_stack, tk) == NULL) {
-				/* Could not push token back to backtracking
-				 * stack. */
-				return EMEM_TK_NOT_OWNED;
-			}
-
-			if (nonterminal_failed(p)) {
-				/* Memory error in backtracking. */
-				return EMEM;
-			}
-		}
+	if (p->seminfos != NULL)
+		shift_seminfos(p->tape, &p->seminfos, count);
 
-		/* Climb the tree if to find incomplete nonterminal to continue
-		 * parsing on. */
-		while (true) {
-			n = rdesc_stack_at(p->cst_stack, p->cur);
-			if (!is_body_complete(n))
-				break;
+	if (count > 0 && pending > 0)
+		memmove(rdesc_stack_at(p->tape, 0),
+			rdesc_stack_at(p->tape, count),
+			pending * sizeof_tk(*p));
 
-			p->cur = _rdesc_priv_parent_idx(n);
+	rdesc_stack_multipop(&p->tape, count);
+}
 
-			/* Every node, including the root is completed. Return
-			 * ready. */
-			if (p->cur == SIZE_MAX)
-				return READY;
-		}
+/* Starts a new match. Tokens after the previous match are kept. */
+static int restart(struct rdesc *p, uint16_t start_symbol)
+{
+	/* Tokens consumed by the previous match belong to its CST. Tokens
+	 * after them are kept for this match at the beginning of the tape. */
+	drop_tokens(p, p->position);
 
-		return CONTINUE;
+	return start_match(p, start_symbol);
+}
 
-	case RDESC_NONTERMINAL:
-		if (new_nt_node(p, rule.id)) {
-			/* An error occured before the token ever used. */
-			return EMEM_TK_NOT_OWNED;
-		}
+int rdesc_start(struct rdesc *p, uint16_t start_symbol)
+{
+	runtime_assertion(p->cur == SIZE_MAX, "cannot start during parse");
 
-		return RETRY;
+	p->consumer = NULL;
 
-	default: unreachable(); // GCOV_EXCL_LINE
-	} // GCOV_EXCL_LINE
+	return restart(p, start_symbol);
 }
 
-enum rdesc_result rdesc_pump(struct rdesc *p, uint16_t id, void *seminfo)
+int rdesc_stream(struct rdesc *p,
+		 uint16_t start_symbol,
+		 void (*consumer)(struct rdesc *, struct rdesc_node *, void *),
+		 void *ctx)
 {
-	runtime_assertion(p->cur != SIZE_MAX, "parser is not started");
+	runtime_assertion(p->cur == SIZE_MAX, "cannot start during parse");
 
-	uint8_t tk_[sizeof_tk(*p)];
-	tk_t *tk = cast(tk_t *, &tk_);
+	p->consumer = NULL;
 
-	bool has_token;
-	if (p->saved_tk) {
-		runtime_assertion(id == 0,
-				  "shall not provide new token during resume");
+	if (restart(p, start_symbol))
+		return 1;
 
-		has_token = true;
-		tk->id = p->saved_tk;
-		if (p->saved_seminfo != NULL)
-			memcpy(&tk->seminfo, p->saved_seminfo, p->seminfo_size);
+	p->consumer = consumer;
+	p->consumer_ctx = ctx;
+	p->start_symbol = start_symbol;
 
-		p->saved_tk = 0;
-	} else {
-		has_token = id != 0;
+	return 0;
+}
 
-		if (has_token) {
-			tk->id = id;
-			if (seminfo != NULL)
-				memcpy(&tk->seminfo, seminfo, p->seminfo_size);
-		}
-	}
+/* Ends the parse, the caller empties the stacks. */
+static void end_parse(struct rdesc *p)
+{
+	destroy_tokens(p);
 
-	while (true) {
-		if (!has_token && rdesc_stack_len(p->token_stack) > 0) {
-			has_token = true;
-			tk = rdesc_stack_pop(&p->token_stack);
-		}
+	p->cur = SIZE_MAX;
+	p->position = 0;
+	p->farthest = 0;
+	p->cut = 0;
+	p->released = 0;
+	p->released_nodes = 0;
+	p->error_position = 0;
+	p->consumer = NULL;
+
+	if (p->memo != NULL)
+		rdesc_memo_clear(p->memo);
+}
 
-		if (!has_token)
-			return RDESC_CONTINUE;
+/* Sets whether popping keeps the capacity of the stacks. */
+static void retain_stacks(struct rdesc *p, bool retain)
+{
+	rdesc_stack_retain(p->tape, retain);
 
-		enum internal_pump_state state;
-		do {
-			state = rdesc_pump_internal(p, tk);
-		} while (state == RETRY);
+	if (p->seminfos != NULL)
+		rdesc_stack_retain(p->seminfos, retain);
 
-		switch (state) {
-		case EMEM:
-			return RDESC_ENOMEM;
+	rdesc_stack_retain(p->cst_stack, retain);
+}
 
-		case EMEM_TK_NOT_OWNED:
-			p->saved_tk = tk->id;
-			memcpy(p->saved_seminfo, &tk->seminfo, p->seminfo_size);
+void rdesc_reset(struct rdesc *p)
+{
+	end_parse(p);
+	retain_stacks(p, false);
 
-			return RDESC_ENOMEM;
+	rdesc_stack_reset(&p->tape);
 
-		case CONTINUE:
-			has_token = false;
+	if (p->seminfos != NULL)
+		rdesc_stack_reset(&p->seminfos);
 
-			break;
+	rdesc_stack_reset(&p->cst_stack);
+}
 
-		case NOMATCH:
-			p->cur = SIZE_MAX;
+void rdesc_clear(struct rdesc *p)
+{
+	end_parse(p);
+	retain_stacks(p, true);
 
-			return RDESC_NOMATCH;
+	rdesc_stack_multipop(&p->tape, rdesc_stack_len(p->tape));
 
-		case READY:
-			return RDESC_READY;
+	if (p->seminfos != NULL)
+		rdesc_stack_multipop(&p->seminfos,
+				     rdesc_stack_len(p->seminfos));
 
-		default: unreachable();  // GCOVR_EXCL_LINE
-		}
-	}
+	rdesc_stack_multipop(&p->cst_stack, rdesc_stack_len(p->cst_stack));
 }
-/* ------------------------------------------------------------------------- */
 
-struct rdesc_node *rdesc_root(struct rdesc *p)
+/* Seminfo of the token at the tape index, held in the tape or in the packed
+ * seminfo buffer. */
+static inline void *token_seminfo(struct rdesc_stack *tape,
+				  struct rdesc_stack *seminfos, size_t index)
 {
-	if (rdesc_stack_len(p->cst_stack) == 0)
-		return NULL;
+	tk_t *tk = rdesc_stack_at(tape, index);
 
-	return rdesc_stack_at(p->cst_stack, 0);
+	if (seminfos == NULL)
+		return &tk->seminfo;
+
+	return rdesc_stack_at(seminfos, tk->seminfo);
 }
 
-struct rdesc_node *_rdesc_priv_cst_illegal_access(const struct rdesc *p,
-						  size_t index)
+/* Offset of the packed seminfo of the token at the tape index, the end of the
+ * buffer if there is no token. */
+static inline size_t seminfo_offset(struct rdesc_stack *tape,
+				    struct rdesc_stack *seminfos, size_t index)
 {
-	return index == SIZE_MAX ?
-		NULL : rdesc_stack_at(p->cst_stack, index);
+	if (index == rdesc_stack_len(tape))
+		return rdesc_stack_len(seminfos);
+
+	return cast(tk_t *, rdesc_stack_at(tape, index))->seminfo;
 }
 
-/* Makes the connection between parent and child, by adding `child_index` to
- * parent's children index list. */
-static inline void push_child(struct rdesc *p, size_t parent_idx, size_t child_idx)
+/* Removes packed seminfo of the tokens before the tape index, and rebases the
+ * offsets of the tokens from the index on. The caller removes the tokens. */
+static void shift_seminfos(struct rdesc_stack *tape,
+			   struct rdesc_stack **seminfos, size_t index)
 {
-	node_t *parent = rdesc_stack_at(p->cst_stack, parent_idx);
+	size_t offset = seminfo_offset(tape, *seminfos, index);
+	size_t bytes = rdesc_stack_len(*seminfos) - offset;
 
-	_rdesc_priv_child_idx(parent, rchild_count(parent)) = child_idx;
+	if (offset == 0)
+		return;
 
-	rchild_count(parent)++;
+	if (bytes > 0)
+		memmove(rdesc_stack_at(*seminfos, 0),
+			rdesc_stack_at(*seminfos, offset), bytes);
+
+	rdesc_stack_multipop(seminfos, offset);
+
+	for (size_t i = index; i < rdesc_stack_len(tape); i++)
+		cast(tk_t *, rdesc_stack_at(tape, i))->seminfo -= offset;
 }
 
-/* Removes the last child from node. */
-static inline void pop_child(struct rdesc *p, size_t node_idx)
+static void destroy_tokens(struct rdesc *p)
 {
-	node_t *parent = rdesc_stack_at(p->cst_stack, node_idx);
+	if (!p->token_destroyer)
+		return;
 
-	rchild_count(parent)--;
+	if (p->saved_tk)
+		p->token_destroyer(p->saved_tk, p->saved_seminfo);
+
+	/* Tokens in the CST are the consumed part of the tape. Like the saved
+	 * token, the latest ones are destroyed first. */
+	for (size_t i = rdesc_stack_len(p->tape); i > 0; i--) {
+		tk_t *tk = rdesc_stack_at(p->tape, i - 1);
+		p->token_destroyer(tk->id,
+				   token_seminfo(p->tape, p->seminfos, i - 1));
+	}
 }
 
-/* Pushes a new nonterminal to parser's CST stack and reserves space for its
+/* - THE PUMP -------------------------------------------------------------- */
+#define is_construct_end(nt_id, variant) \
+	((variant) == variant_count(pump_grammar(p), nt_id))
+
+#define next_symbol(node) \
+	body_of(pump_grammar(p), rid(node), rvariant(node))[rchild_count(node)]
+
+/* Error nodes, at the end-of-construct index, are not completed by their
  * children. */
-static int new_nt_node(struct rdesc *p, uint16_t nt_id)
+#define is_body_complete(node) \
+	(!is_construct_end(rid(node), rvariant(node)) && \
+	 rchild_count(node) == body_length(pump_grammar(p), rid(node), \
+					   rvariant(node)))
+
+/* Returns whether tokens expected at the tape position are recorded. The
+ * expected set is cleared if the position is farther than the farthest one a
+ * symbol has failed at so far. */
+static inline bool expects_at(struct rdesc *p, size_t position)
 {
-	/* allocate node pointer */
-	node_t *n = rdesc_stack_push(&p->cst_stack, NULL);
+	if (position + 1 < p->error_position)
+		return false;
 
-	if (n == NULL)
-		return 1;  /* node allocation failed */
-
-	/* the new node will be the p->cur, so that we need to hold parent_idx
-	 * in order to add it to its parent */
-	size_t parent_idx = p->cur;
-	p->cur = rdesc_stack_len(p->cst_stack) - 1;  /* index of the new node */
+	if (position + 1 > p->error_position) {
+		memset(p->expected, 0, expected_size(*p));
+		p->error_position = position + 1;
+	}
 
-	_rdesc_priv_parent_idx(n) = parent_idx;
-	runwind_size(n) = p->top_unwind;
-	rtype(n) = RDESC_NONTERMINAL;
+	return true;
+}
 
-	rid(n) = nt_id;
-	rvariant(n) = 0;
-	rchild_count(n) = 0;
+/* Returns the first variant of the nonterminal, starting from `variant`, whose
+ * FIRST set contains the token at the tape position or which can match empty
+ * input. Returns the end-of-construct index if no such variant exists.
+ *
+ * Skipped variants fail at the token, tokens in their FIRST sets are
+ * expected there. */
+static inline uint16_t next_viable_variant(struct rdesc *p,
+					   uint16_t nt_id, uint16_t variant,
+					   uint16_t tk_id, size_t position)
+{
+	for (; !is_construct_end(nt_id, variant); variant++) {
+		const uint8_t *set = first_set(pump_grammar(p), nt_id, variant);
 
-	uint16_t child_list_cap = rchild_list_cap(*p, nt_id);
-	if (rdesc_stack_multipush(&p->cst_stack, NULL, child_list_cap) == NULL) {
-		/* Rollback changes if nonterminal is partially constructed. */
+		if ((tk_id < pump_grammar(p).tk_count &&
+		     in_first_set(set, tk_id)) ||
+		    in_first_set(set, 0))
+			break;
 
-		rdesc_stack_pop(&p->cst_stack);  /* Pop the node. */
-		p->cur = parent_idx;  /* Rollback parent. */
+		if (expects_at(p, position))
+			for (size_t i = 0; i < expected_size(*p); i++)
+				p->expected[i] |= set[i];
+	}
 
-		return 1;  /* child list allocation failed */
-	} else {
-		p->top_unwind = 1 + child_list_cap;
+	return variant;
+}
 
-		if (parent_idx != SIZE_MAX)
-			push_child(p, parent_idx, p->cur);
+/* Id of the token at the tape position. */
+#define tape_id(p, position) \
+	cast(tk_t *, rdesc_stack_at((p)->tape, position))->id
 
-		return 0;
-	}
+/* Returns whether the nonterminal, whose variants have failed at the tape
+ * position, has synchronization tokens and its error node would skip a
+ * token. */
+static inline bool recovers(struct rdesc *p, uint16_t nt_id, size_t position)
+{
+	uint16_t tk_id = tape_id(p, position);
 
+	if (!(sync_set(*p, p->syncs, nt_id, 0)[0] & 1))
+		return false;
 
+	return p->error_position > position + 1 ||
+		tk_id >= pump_grammar(p).tk_count ||
+		!in_first_set(sync_set(*p, p->syncs, nt_id, 1), tk_id);
 }
 
-/* Creates a new node in parser's CST stack and copies `seminfo` into it. */
-static int new_tk_node(struct rdesc *p, uint16_t tk_id, const void *seminfo)
+/* Returns the first left-recursive variant of the nonterminal, starting from
+ * `variant`, whose body continues with the token at the tape position.
+ * Returns the end-of-construct index if no such variant exists.
+ *
+ * Skipped variants fail at the token, tokens in their grow sets are expected
+ * there. */
+static inline uint16_t next_growing_variant(struct rdesc *p, uint16_t nt_id,
+					    uint16_t variant, size_t position)
 {
-	node_t *n = rdesc_stack_push(&p->cst_stack, NULL);
+	uint16_t tk_id = tape_id(p, position);
+
+	for (; !is_construct_end(nt_id, variant); variant++) {
+		const uint8_t *set = grow_set(pump_grammar(p), nt_id, variant);
+
+		if (!is_left_recursive(pump_grammar(p), nt_id, variant))
+			continue;
+
+		if (tk_id < pump_grammar(p).tk_count &&
+		    in_first_set(set, tk_id))
+			break;
+
+		if (expects_at(p, position))
+			for (size_t i = 0; i < expected_size(*p); i++)
+				p->expected[i] |= set[i];
+	}
+
+	return variant;
+}
+
+/* Returns whether the nonterminal at the index is the match a left-recursive
+ * nonterminal has grown from, the first child of its parent at a
+ * left-recursive variant. */
+static inline bool is_grown_from(struct rdesc *p, size_t idx, const node_t *n)
+{
+	size_t parent_idx = widen_idx(_rdesc_priv_parent_idx(n));
+
+	if (pump_grammar(p).grow_sets == NULL || parent_idx == SIZE_MAX)
+		return false;
+
+	node_t *parent = rdesc_stack_at(p->cst_stack, parent_idx);
+
+	return rid(parent) == rid(n) &&
+		is_left_recursive(pump_grammar(p), rid(parent),
+				  rvariant(parent)) &&
+		widen_idx(_rdesc_priv_child_idx(parent, 0)) == idx;
+}
+
+/* Backtracking is about to remove the nodes after the nonterminal at
+ * `stopper_idx` and to reopen the completed nonterminals containing it. Their
+ * first matches are copied into a snapshot, so that they can be grafted back
+ * when retried at the same position. */
+static void memoize_discarded(struct rdesc *p, size_t stopper_idx)
+{
+	size_t lo = stopper_idx;
+
+	/* Find the outermost completed ancestor whose first match is still in
+	 * the CST. */
+	for (size_t i = stopper_idx; i != SIZE_MAX;) {
+		node_t *n = rdesc_stack_at(p->cst_stack, i);
+
+		/* Nonterminals whose tokens are released by a cut have no
+		 * position to be grafted at. */
+		if (!is_body_complete(n) || i < p->released_nodes)
+			break;
+
+		if (!(rmemo_slot(*p, n, 0) & MEMO_STALE))
+			lo = i;
+
+		i = widen_idx(_rdesc_priv_parent_idx(n));
+	}
+
+	size_t len = rdesc_stack_len(p->cst_stack);
+	struct rdesc_memo_snapshot *snapshot =
+		rdesc_memo_snapshot(p->memo, rdesc_stack_at(p->cst_stack, lo),
+				    (len - lo) * sizeof_node(*p));
+
+	for (size_t i = lo; i < len;) {
+		node_t *n = rdesc_stack_at(p->cst_stack, i);
+
+		if (rtype(n) == RDESC_TOKEN) {
+			i++;
+
+			continue;
+		}
+
+		size_t flags = rmemo_slot(*p, n, 0);
+
+		/* A nonterminal that matched and has not been reopened since,
+		 * keeps its first match. */
+		if ((flags & (MEMO_MATCHED | MEMO_STALE)) == MEMO_MATCHED) {
+			rmemo_slot(*p, n, 0) |= MEMO_STALE;
+
+			if (snapshot != NULL) {
+				node_t *copy = cast(node_t *, &snapshot->nodes
+					[(i - lo) * sizeof_node(*p)]);
+
+				rmemo_slot(*p, copy, 0) |= MEMO_STALE;
+
+				rdesc_memo_matched(p->memo, snapshot, copy,
+						   rid(n), flags >> 2,
+						   rmemo_slot(*p, n, 2), i,
+						   rmemo_slot(*p, n, 1));
+			}
+		}
+
+		i += 1 + rchild_list_cap(*p, rid(n), rvariant(n));
+	}
+
+	if (snapshot != NULL)
+		rdesc_memo_release(p->memo, snapshot);
+}
+
+/* Moves the topmost nonterminal, whose children are removed, to a later
+ * variant. Its child list is resized to the capacity of the variant by the
+ * caller, memo slots follow the end of the child list. */
+static inline void switch_variant(struct rdesc *p, node_t *n, uint16_t variant)
+{
+	if (p->memo != NULL)
+		memmove(&_rdesc_priv_child_idx(n, variant_child_cap(
+				pump_grammar(p), rid(n), variant)),
+			&_rdesc_priv_child_idx(n, variant_child_cap(
+				pump_grammar(p), rid(n), rvariant(n))),
+			MEMO_SLOTS * sizeof(_rdesc_priv_idx_t));
+
+	rvariant(n) = variant;
+	rchild_count(n) = 0;
+
+	p->top_unwind = 1 + rchild_list_cap(*p, rid(n), variant);
+}
+
+/* Records extent of the first match of the nonterminal, which is the entire
+ * stack slice starting from it. */
+static inline void record_match(struct rdesc *p, size_t nt_idx)
+{
+	node_t *n = rdesc_stack_at(p->cst_stack, nt_idx);
+
+	if (rmemo_slot(*p, n, 0) & MEMO_MATCHED)
+		return;  /* Nonterminal is re-matched after backtracking. */
+
+	rmemo_slot(*p, n, 0) |= MEMO_MATCHED;
+	rmemo_slot(*p, n, 1) = rdesc_stack_len(p->cst_stack) - nt_idx;
+	rmemo_slot(*p, n, 2) = p->position - (rmemo_slot(*p, n, 0) >> 2);
+	rmemo_slot(*p, n, 3) = p->farthest - (rmemo_slot(*p, n, 0) >> 2);
+}
+
+/* Ends the left-recursive variant that has failed after the match at p->cur,
+ * whose later nodes are removed. The nonterminal grown from the match moves
+ * to the next variant, or if there is none, the match is restored into it and
+ * the nonterminal completes without growing further. */
+static inline void end_growth(struct rdesc *p, uint16_t variant)
+{
+	size_t copy_idx = p->cur;
+	node_t *copy = rdesc_stack_at(p->cst_stack, copy_idx);
+	size_t nt_idx = widen_idx(_rdesc_priv_parent_idx(copy));
+	node_t *n = rdesc_stack_at(p->cst_stack, nt_idx);
+	size_t size = 1 + rchild_list_cap(*p, rid(copy), rvariant(copy));
+
+	if (!is_construct_end(rid(n), variant)) {
+		/* The match stays as the first child. */
+		rvariant(n) = variant;
+
+		p->cur = nt_idx;
+		p->top_unwind = size;
+
+		rdesc_stack_multipop(&p->cst_stack,
+				     rdesc_stack_len(p->cst_stack) -
+				     (copy_idx + size));
+
+		return;
+	}
+
+	/* The node keeps its parent, unwind size and memo slots, the copy has
+	 * the same child capacity. */
+	rvariant(n) = rvariant(copy);
+	rchild_count(n) = rchild_count(copy);
+
+	for (uint16_t c = 0; c < rchild_count(copy); c++) {
+		size_t child_idx = widen_idx(_rdesc_priv_child_idx(copy, c));
+
+		_rdesc_priv_child_idx(n, c) = child_idx;
+		_rdesc_priv_parent_idx(rdesc_stack_at(p->cst_stack,
+						      child_idx)) = nt_idx;
+	}
+
+	p->top_unwind = runwind_size(copy);
+	p->cur = widen_idx(_rdesc_priv_parent_idx(n));
+
+	rdesc_stack_multipop(&p->cst_stack,
+			     rdesc_stack_len(p->cst_stack) - copy_idx);
+
+	if (p->memo != NULL)
+		record_match(p, nt_idx);
+}
+
+/* Returns whether the nonterminal at `idx` has matched the symbols before
+ * the cut in its body, so that it is not moved to another variant. The last
+ * child of an open ancestor of p->cur is not matched yet. */
+static inline bool passed_cut(struct rdesc *p, size_t idx, const node_t *n)
+{
+	if (pump_grammar(p).cuts == NULL || is_construct_end(rid(n), rvariant(n)))
+		return false;
+
+	uint16_t cut = cut_of(pump_grammar(p), rid(n), rvariant(n));
+	bool open = idx != p->cur && !is_body_complete(n);
+
+	return cut != UINT16_MAX && rchild_count(n) >= cut + open;
+}
+
+/* Returns the index of the innermost nonterminal that has passed its cut with
+ * the node at `idx` before the cut, SIZE_MAX if there is none. Backtracking
+ * into the node fails the nonterminal as a whole. Nonterminals before p->cut
+ * cannot have nodes after it before their cuts, see commits_parse. */
+static size_t committed_by(struct rdesc *p, size_t idx)
+{
+	if (pump_grammar(p).cuts == NULL)
+		return SIZE_MAX;
+
+	size_t parent_idx = widen_idx(_rdesc_priv_parent_idx(
+		rdesc_stack_at(p->cst_stack, idx)));
+
+	while (parent_idx != SIZE_MAX && parent_idx >= p->cut) {
+		node_t *parent = rdesc_stack_at(p->cst_stack, parent_idx);
+
+		if (passed_cut(p, parent_idx, parent)) {
+			uint16_t cut = cut_of(pump_grammar(p), rid(parent),
+					      rvariant(parent));
+
+			/* Children are pushed in the order of their
+			 * indexes. */
+			if (rchild_count(parent) == cut ||
+			    idx < widen_idx(_rdesc_priv_child_idx(parent, cut)))
+				return parent_idx;
+		}
+
+		idx = parent_idx;
+		parent_idx = widen_idx(_rdesc_priv_parent_idx(parent));
+	}
+
+	return SIZE_MAX;
+}
+
+/* Backtraces to the last nonterminal that is not completed, or teardowns the
+ * entire CST. Returns non-zero and leaves the CST as is if the child list of
+ * the nonterminal could not be grown for its next variant. */
+static inline int nonterminal_failed(struct rdesc *p)
+{
+	size_t scan_idx = rdesc_stack_len(p->cst_stack) - p->top_unwind;
+	size_t position = p->position, failed_position = p->position;
+	size_t committed = SIZE_MAX;
+	uint16_t next_variant = 0;
+	bool teardown = false, grown = false;
+
+	/* FIRST traversal: Rewind the tape to find the nonterminal to retry. */
+
+	/* Initialization: Start from the top. */
+	while (true) {
+		/* Nodes before the cut are committed, the parse fails instead
+		 * of retrying them. */
+		if (scan_idx < p->cut) {
+			teardown = true;
+
+			break;
+		}
+
+		node_t *top = rdesc_stack_at(p->cst_stack, scan_idx);
+
+		/* Maintenance: The slice from scan_idx to stack_len does not
+		 * contain a nonterminal that have unchecked variant. */
+		if (rtype(top) == RDESC_TOKEN) {
+			/* Error nodes do not refer to every token they have
+			 * skipped, the position of the token is used. */
+			position = top->n.tk.index;
+		} else if (committed != SIZE_MAX) {
+			/* Nodes before the cut of the nonterminal at
+			 * `committed` are not retried, it fails as a
+			 * whole. */
+			if (scan_idx == committed)
+				committed = SIZE_MAX;
+		} else if (is_grown_from(p, scan_idx, top)) {
+			node_t *parent = rdesc_stack_at(
+				p->cst_stack,
+				_rdesc_priv_parent_idx(top));
+
+			/* Termination: The rest of the left-recursive
+			 * variant the match has grown into has failed at the
+			 * tape position. The second loop moves the parent to
+			 * the next variant that can grow there, or restores
+			 * the match. */
+			next_variant = next_growing_variant(p, rid(parent),
+							    rvariant(parent) + 1,
+							    position);
+
+			committed = committed_by(p, scan_idx);
+			if (committed == SIZE_MAX) {
+				grown = true;
+
+				break;
+			}
+		} else if (!is_construct_end(rid(top), rvariant(top)) &&
+			   !passed_cut(p, scan_idx, top)) {
+			/* RDESC_NONTERMINAL, other than an error node, which
+			 * has no variant after it, or one that has passed its
+			 * cut.
+			 *
+			 * All tokens the nonterminal consumed are rewound, so
+			 * the tape is at its start position. Variants that
+			 * cannot start with the token there are skipped. */
+			next_variant = next_viable_variant(p, rid(top),
+							   rvariant(top) + 1,
+							   tape_id(p, position),
+							   position);
+
+			/* Termination: Found a nonterminal with remaining
+			 * variants, or one that recovers at its error
+			 * variant, the end-of-construct index. The second
+			 * loop will update the nonterminal. */
+			if (!is_construct_end(rid(top), next_variant) ||
+			    (p->syncs != NULL &&
+			     recovers(p, rid(top), position))) {
+				committed = committed_by(p, scan_idx);
+
+				if (committed == SIZE_MAX) {
+					if (is_construct_end(rid(top),
+							     next_variant))
+						p->skip_end =
+							p->error_position >
+							position + 1 ?
+							p->error_position - 1 :
+							position;
+
+					break;
+				}
+			}
+		}
+
+		scan_idx -= runwind_size(top);
+
+		/* Parse operation fails if removed element does not belong to
+		 * any node, that is removing the node. */
+		if (widen_idx(_rdesc_priv_parent_idx(top)) == SIZE_MAX) {
+			teardown = true;
+
+			break;
+		}
+	}
+
+	if (p->memo != NULL && !teardown)
+		memoize_discarded(p, scan_idx);
+
+	/* Two loops exist so that the discarded subtrees are memoized before
+	 * the second one removes elements of the CST stack. */
+
+	size_t len = rdesc_stack_len(p->cst_stack);
+
+	/* Nonterminals reserve space for the children of their current
+	 * variant. The next variant may need more, which is the only
+	 * allocation here and happens before the CST is changed. */
+	if (!teardown && !grown) {
+		node_t *top = rdesc_stack_at(p->cst_stack, scan_idx);
+		size_t end = scan_idx + 1 +
+			rchild_list_cap(*p, rid(top), next_variant);
+
+		if (end > len &&
+		    rdesc_stack_multipush(&p->cst_stack, NULL, end - len) == NULL)
+			return 1;
+	}
+
+	/* Now the traversal changes the parser state. */
+	p->cur = len - p->top_unwind;
+	/* Safety: p->cur changed, so p->top_unwind MUST BE CHANGED. This is
+	 * guaranteed in next loop: Before every break we update
+	 * p->top_unwind. */
+
+	while (true) {
+		node_t *top = rdesc_stack_at(p->cst_stack, p->cur);
+
+		if (rtype(top) == RDESC_NONTERMINAL) {
+			/* Found the unfinished nonterminal the first loop
+			 * stopped at. Be careful: All children have been
+			 * removed, so the nonterminal is now the topmost
+			 * node. */
+			if (!teardown && p->cur == scan_idx) {
+				/* Nodes after the copy of the match are
+				 * removed by end_growth. */
+				p->stats.backtracks++;
+				p->stats.rewound_tokens +=
+					failed_position - p->position;
+
+				if (grown) {
+					end_growth(p, next_variant);
+
+					return 0;
+				}
+
+				switch_variant(p, top, next_variant);
+
+				break;
+			}
+
+			/* All variants are exhausted. If none of them ever
+			 * matched, the nonterminal cannot be derived at its
+			 * position. */
+			if (p->memo != NULL &&
+			    !(rmemo_slot(*p, top, 0) & MEMO_MATCHED))
+				rdesc_memo_failed(p->memo, rid(top),
+						  rmemo_slot(*p, top, 0) >> 2);
+		} else /* RDESC_TOKEN */ {
+			/* Tokens released by a cut are before the tape. */
+			p->position = top->n.tk.index == RELEASED_TOKEN ?
+				0 : top->n.tk.index;
+		}
+
+		/* Remove element from parent's child pointer list. */
+		size_t parent_idx = widen_idx(_rdesc_priv_parent_idx(top));
+		if (parent_idx != SIZE_MAX)
+			pop_child(p, parent_idx);
+
+		/* Exit case, explained in previous loop. */
+		if (parent_idx == SIZE_MAX) {
+			p->top_unwind = 0;
+
+			break;
+		}
+
+		p->cur -= runwind_size(top);
+	};
+
+	/* Remove nodes after the p->cur, which is the top. */
+	rdesc_stack_multipop(&p->cst_stack,
+			     rdesc_stack_len(p->cst_stack) - (p->cur + p->top_unwind));
+
+	return 0;
+}
+
+/* Next action for outer pump loop, returned by the internal pump state
+ * machine.
+ *
+ * - EMEM: Memory allocation error occurred, the token stays in the tape for
+ *   retry.
+ *
+ * - READY: Parse complete.
+ *
+ * - CONTINUE: Request the next token.
+ *
+ * - NOMATCH: Parse failed.
+ *
+ * - RETRY: Descend into nonterminal, caller should call this function again. */
+enum internal_pump_state {
+	EMEM,
+	READY,
+	CONTINUE,
+	NOMATCH,
+	RETRY,
+};
+
+/* Returns whether no node of the CST can be retried once the nonterminal at
+ * p->cur, which has matched the symbols before its cut, is committed. Each of
+ * its ancestors after p->cut shall have passed its cut with the child
+ * containing it right after the cut, so that the nodes after p->cut are
+ * before those cuts, or shall have no other variant to retry. */
+static bool commits_parse(struct rdesc *p)
+{
+	size_t idx = p->cur;
+
+	while (true) {
+		node_t *n = rdesc_stack_at(p->cst_stack, idx);
+		size_t parent_idx = widen_idx(_rdesc_priv_parent_idx(n));
+
+		if (parent_idx == SIZE_MAX)
+			return true;
+
+		node_t *parent = rdesc_stack_at(p->cst_stack, parent_idx);
+		uint16_t count = rchild_count(parent);
+
+		/* Children added to a committed nonterminal after the commit
+		 * can be retried. The open child is the last one. */
+		if (parent_idx < p->cut)
+			return count == 1 ||
+				widen_idx(_rdesc_priv_child_idx(
+					parent, count - 2)) < p->cut;
+
+		if (is_construct_end(rid(parent), rvariant(parent)))
+			return false;
+
+		/* An ancestor without a cut before the child cannot be
+		 * retried if it is at its last variant and does not recover,
+		 * with no child before the one containing the nonterminal. */
+		if (cut_of(pump_grammar(p), rid(parent), rvariant(parent)) !=
+		    count - 1 &&
+		    (count != 1 || p->syncs != NULL ||
+		     !is_construct_end(rid(parent), rvariant(parent) + 1u)))
+			return false;
+
+		idx = parent_idx;
+	}
+}
+
+/* Commits the CST built so far, its nodes are never retried. Tokens it has
+ * consumed are not pumped again, they are destroyed and dropped from the tape
+ * and their nodes are marked as released. Positions are rebased on the first
+ * token after them. */
+static void commit(struct rdesc *p)
+{
+	size_t len = rdesc_stack_len(p->cst_stack), count = p->position;
+
+	/* Nodes are marked from the top down to the ones the previous commit
+	 * has marked. */
+	for (size_t i = len - p->top_unwind; len > p->released_nodes;) {
+		node_t *n = rdesc_stack_at(p->cst_stack, i);
+
+		if (rtype(n) == RDESC_TOKEN)
+			n->n.tk.index = RELEASED_TOKEN;
+
+		if (i == p->released_nodes)
+			break;
+
+		i -= runwind_size(n);
+	}
+
+	/* Like in destroy_tokens, the latest tokens are destroyed first. */
+	for (size_t i = count; p->token_destroyer && i > 0; i--) {
+		tk_t *tk = rdesc_stack_at(p->tape, i - 1);
+		p->token_destroyer(tk->id,
+				   token_seminfo(p->tape, p->seminfos, i - 1));
+	}
+
+	drop_tokens(p, count);
+
+	p->released += count;
+	p->position = 0;
+	p->farthest -= count;
+	p->error_position = p->error_position > count ?
+		p->error_position - count : 0;
+	p->skip_end = p->skip_end > count ? p->skip_end - count : 0;
+	p->cut = p->released_nodes = len;
+
+	/* Memoized positions are no longer valid. */
+	if (p->memo != NULL)
+		rdesc_memo_clear(p->memo);
+}
+
+/* Commits the CST built so far if the nonterminal at p->cur has matched the
+ * symbols before the cut in its body and no node before them can be retried.
+ * Otherwise only the nonterminal is committed, see nonterminal_failed. */
+static inline void check_cut(struct rdesc *p, const node_t *n)
+{
+	if (pump_grammar(p).cuts == NULL ||
+	    rchild_count(n) != cut_of(pump_grammar(p), rid(n), rvariant(n)))
+		return;
+
+	if (commits_parse(p))
+		commit(p);
+}
+
+/* Grows the complete match of the nonterminal at p->cur into the
+ * left-recursive variant. The match is moved into a copy on top of the CST
+ * stack, which becomes the first child of the nonterminal, so that the node
+ * keeps its index in the child list of its parent. Returns non-zero and leaves
+ * the CST as is if memory allocation fails. */
+static int grow(struct rdesc *p, uint16_t variant)
+{
+	node_t *n = rdesc_stack_at(p->cst_stack, p->cur);
+	size_t size = 1 + rchild_list_cap(*p, rid(n), rvariant(n));
+	size_t copy_idx = rdesc_stack_len(p->cst_stack);
+
+	if (rdesc_stack_multipush(&p->cst_stack, NULL, size) == NULL)
+		return 1;
+
+	runtime_assertion(copy_idx < (_rdesc_priv_idx_t) -1,
+			  "CST exceeds the node index range");
+
+	/* The stack may have been reallocated. */
+	n = rdesc_stack_at(p->cst_stack, p->cur);
+	node_t *copy = rdesc_stack_at(p->cst_stack, copy_idx);
+
+	memcpy(copy, n, size * sizeof_node(*p));
+
+	_rdesc_priv_parent_idx(copy) = p->cur;
+	runwind_size(copy) = p->top_unwind;
+
+	for (uint16_t c = 0; c < rchild_count(copy); c++)
+		_rdesc_priv_parent_idx(rdesc_stack_at(
+			p->cst_stack,
+			_rdesc_priv_child_idx(copy, c))) = copy_idx;
+
+	/* The copy is a shorter match at the same position, which is neither
+	 * memoized nor reported as failed. */
+	if (p->memo != NULL)
+		rmemo_slot(*p, copy, 0) |= MEMO_MATCHED | MEMO_STALE;
+
+	rvariant(n) = variant;
+	rchild_count(n) = 1;
+	_rdesc_priv_child_idx(n, 0) = copy_idx;
+
+	p->top_unwind = size;
+
+	return 0;
+}
+
+/* Climbs the tree to find incomplete nonterminal to continue parsing on. */
+static inline enum internal_pump_state climb(struct rdesc *p)
+{
+	/* The CST is torn down, the next pump reports no match. */
+	if (rdesc_stack_len(p->cst_stack) == 0)
+		return CONTINUE;
+
+	/* The root has completed without growing further. */
+	if (p->cur == SIZE_MAX)
+		return READY;
+
+	while (true) {
+		node_t *n = rdesc_stack_at(p->cst_stack, p->cur);
+
+		check_cut(p, n);
+
+		if (!is_body_complete(n))
+			return CONTINUE;
+
+		if (grows(*p, rid(n))) {
+			/* The match is kept open until the token after it,
+			 * which decides whether it grows, is pumped. */
+			if (p->position == rdesc_stack_len(p->tape))
+				return CONTINUE;
+
+			if (p->position >= p->farthest)
+				p->farthest = p->position + 1;
+
+			uint16_t variant = next_growing_variant(p, rid(n), 0,
+								p->position);
+
+			if (!is_construct_end(rid(n), variant))
+				return grow(p, variant) ? EMEM : CONTINUE;
+		}
+
+		if (p->memo != NULL)
+			record_match(p, p->cur);
+
+		p->cur = widen_idx(_rdesc_priv_parent_idx(n));
+
+		/* Every node, including the root is completed. Return
+		 * ready. */
+		if (p->cur == SIZE_MAX)
+			return READY;
+	}
+}
+
+/* Matches the error node at p->cur, which is committed as if a cut were
+ * after it. */
+static inline enum internal_pump_state close_error(struct rdesc *p)
+{
+	if (p->memo != NULL)
+		record_match(p, p->cur);
+
+	p->cut = rdesc_stack_len(p->cst_stack);
+
+	if (p->memo != NULL)
+		rdesc_memo_clear(p->memo);
+
+	p->cur = widen_idx(_rdesc_priv_parent_idx(
+		rdesc_stack_at(p->cst_stack, p->cur)));
+
+	/* The start symbol has recovered. */
+	if (p->cur == SIZE_MAX)
+		return READY;
+
+	return climb(p);
+}
+
+/* Skips the token with the open error node at p->cur. The node refers to the
+ * first and the last token it has skipped, the token node of the latter is
+ * reused for each token after the first two. */
+static inline enum internal_pump_state skip_token(struct rdesc *p,
+						  const tk_t *tk)
+{
+	node_t *n = rdesc_stack_at(p->cst_stack, p->cur);
+	uint16_t nt_id = rid(n);
+	bool syncs = p->position >= p->skip_end &&
+		tk->id < pump_grammar(p).tk_count;
+
+	if (syncs && in_first_set(sync_set(*p, p->syncs, nt_id, 1), tk->id))
+		return close_error(p);
+
+	if (rchild_count(n) < 2) {
+		if (new_tk_node(p, tk->id))
+			return EMEM;
+	} else {
+		node_t *last = rdesc_stack_at(p->cst_stack,
+					      rdesc_stack_len(p->cst_stack) - 1);
+
+		runtime_assertion(p->position < RELEASED_TOKEN,
+				  "token position exceeds 32-bit tape index");
+
+		rid(last) = tk->id;
+		last->n.tk.index = p->position++;
+	}
+
+	if (syncs && in_first_set(sync_set(*p, p->syncs, nt_id, 0), tk->id))
+		return close_error(p);
+
+	return CONTINUE;
+}
+
+/* Copies a memoized subtree on top of the CST stack as the next child of
+ * p->cur and relocates its indexes, and its token positions if it is recorded
+ * at another position before an edit. Returns non-zero and leaves the CST as
+ * is if memory allocation fails. */
+static int graft(struct rdesc *p, const struct rdesc_memo_entry *e)
+{
+	size_t root_idx = rdesc_stack_len(p->cst_stack);
+
+	if (rdesc_stack_multipush(&p->cst_stack, cast(void *, e->nodes),
+				  e->node_count) == NULL)
+		return 1;
+
+	node_t *root = rdesc_stack_at(p->cst_stack, root_idx);
+
+	/* Modular arithmetic, works for subtrees recorded at higher indexes
+	 * or positions as well. */
+	size_t delta = root_idx - e->root_idx;
+	size_t shift = p->position - (rmemo_slot(*p, root, 0) >> 2);
+	size_t examined = rmemo_slot(*p, root, 3);
+	uint16_t last_node_size = 0;
+
+	for (size_t i = root_idx; i < root_idx + e->node_count;
+	     i += last_node_size) {
+		node_t *n = rdesc_stack_at(p->cst_stack, i);
+
+		_rdesc_priv_parent_idx(n) += delta;
+
+		if (rtype(n) == RDESC_TOKEN) {
+			n->n.tk.index += shift;
+			last_node_size = 1;
+
+			continue;
+		}
+
+		for (uint16_t c = 0; c < rchild_count(n); c++)
+			_rdesc_priv_child_idx(n, c) += delta;
+
+		rmemo_slot(*p, n, 0) += shift << 2;
+
+		last_node_size = 1 + rchild_list_cap(*p, rid(n), rvariant(n));
+	}
+
+	_rdesc_priv_parent_idx(root) = p->cur;
+	runwind_size(root) = p->top_unwind;
+
+	push_child(p, p->cur, root_idx);
+
+	/* The subtree looked at the same tokens when it was derived. */
+	if (p->position + examined > p->farthest)
+		p->farthest = p->position + examined;
+
+	p->top_unwind = last_node_size;
+	p->position += e->span;
+
+	return 0;
+}
+
+/* Rejects or grafts the nonterminal using its memoized result, instead of
+ * descending into it. Returns RETRY if the subtree could not be grafted, the
+ * caller should descend into the nonterminal as if it is not memoized. */
+static inline enum internal_pump_state
+memoized_nonterminal(struct rdesc *p, const struct rdesc_memo_entry *e)
+{
+	if (e->state == RDESC_MEMO_FAILED) {
+		if (nonterminal_failed(p))
+			return EMEM;
+
+		return climb(p);
+	}
+
+	/* The matched tokens are in the tape, as they have been pumped before
+	 * the nonterminal matched. Grafted token nodes refer to them. */
+	runtime_assertion(rdesc_stack_len(p->tape) - p->position >= e->span,
+			  "memoized tokens are missing");
+
+	if (graft(p, e))
+		return RETRY;
+
+	return climb(p);
+}
+
+/* Internal pump state machine. Returns next action for outer pump loop. */
+static inline enum internal_pump_state
+rdesc_pump_internal(struct rdesc *p, const tk_t *tk)
+{
+	node_t *n = rdesc_stack_at(p->cst_stack, p->cur);
+
+	/* The CST is torn down, the token stays in the tape for the next
+	 * start. */
+	if (rdesc_stack_len(p->cst_stack) == 0)
+		return NOMATCH;
+
+	/* Nonterminals are at the end-of-construct index only as error
+	 * nodes. */
+	if (p->syncs != NULL && is_construct_end(rid(n), rvariant(n)))
+		return skip_token(p, tk);
+
+	check_cut(p, n);
+
+	/* A commit moves the token to the beginning of the tape. */
+	tk = rdesc_stack_at(p->tape, p->position);
+
+	/* Descended into an epsilon variant, the token belongs to the symbols
+	 * after the nonterminal. */
+	if (is_body_complete(n))
+		return climb(p);
+
+	uint16_t rule = next_symbol(n), id = symbol_id(rule);
+
+	if (!is_nt_symbol(rule)) {
+		if (id == tk->id) {
+			/* Match! Add the token to nonterminal's children. */
+			if (new_tk_node(p, tk->id)) {
+				/* Could not add token to the current
+				 * nonterminal's children. */
+				return EMEM;
+			}
+		} else {
+			if (expects_at(p, p->position))
+				p->expected[id / 8] |= 1 << (id % 8);
+
+			/* Rewind the tape and continue on the next
+			 * variant. */
+			if (nonterminal_failed(p))
+				return EMEM;
+		}
+
+		return climb(p);
+	}
+
+	uint16_t variant = next_viable_variant(p, id, 0, tk->id, p->position);
+
+	/* None of the variants can start with the token, fail without
+	 * descending into the nonterminal. */
+	if (is_construct_end(id, variant)) {
+		if (nonterminal_failed(p))
+			return EMEM;
+
+		return climb(p);
+	}
+
+	if (p->memo != NULL) {
+		const struct rdesc_memo_entry *e =
+			rdesc_memo_lookup(p->memo, id, p->position);
+
+		/* Memoization is best-effort, a subtree that could not be
+		 * grafted is derived again. */
+		if (e != NULL) {
+			enum internal_pump_state state =
+				memoized_nonterminal(p, e);
+
+			if (state != RETRY)
+				return state;
+		}
+	}
+
+	if (new_nt_node(p, id, variant)) {
+		/* An error occured before the token ever used. */
+		return EMEM;
+	}
+
+	return RETRY;
+}
+
+/* Outer pump loop. Consumes tokens in the tape from the current position on,
+ * until the parser needs a new token or the parse ends. */
+static enum rdesc_result pump_tokens(struct rdesc *p)
+{
+	while (p->position < rdesc_stack_len(p->tape)) {
+		const tk_t *tk = rdesc_stack_at(p->tape, p->position);
+
+		if (p->position >= p->farthest)
+			p->farthest = p->position + 1;
+
+		switch (rdesc_pump_internal(p, tk)) {
+		case EMEM:
+			return RDESC_ENOMEM;
+
+		case CONTINUE:
+		case RETRY:
+			break;
+
+		case NOMATCH:
+			p->cur = SIZE_MAX;
+			p->consumer = NULL;
+
+			return RDESC_NOMATCH;
+
+		case READY:
+			if (p->consumer == NULL)
+				return RDESC_READY;
+
+			/* Streaming, hand the CST over and match the next
+			 * statement with the tokens left. */
+			p->consumer(p, rdesc_root(p), p->consumer_ctx);
+
+			if (restart(p, p->start_symbol))
+				return RDESC_ENOMEM;
+
+			break;
+
+		default: unreachable();  // GCOVR_EXCL_LINE
+		}
+	}
+
+	return RDESC_CONTINUE;
+}
+
+enum rdesc_result rdesc_pump(struct rdesc *p, uint16_t id, void *seminfo)
+{
+	/* The stream could not be restarted due to a memory error. */
+	bool restart_pending = p->cur == SIZE_MAX && p->consumer != NULL;
+
+	runtime_assertion(p->cur != SIZE_MAX || restart_pending,
+			  "parser is not started");
+
+	if (p->saved_tk) {
+		runtime_assertion(id == 0,
+				  "shall not provide new token during resume");
+
+		id = p->saved_tk;
+		seminfo = p->saved_seminfo;
+
+		p->saved_tk = 0;
+	}
+
+	if (id != 0 && push_token(p, id, seminfo))
+		return RDESC_ENOMEM;
+
+	if (restart_pending && restart(p, p->start_symbol))
+		return RDESC_ENOMEM;
+
+	return pump_tokens(p);
+}
+
+enum rdesc_result rdesc_pump_many(struct rdesc *p,
+				  const uint16_t *ids,
+				  const void *seminfos,
+				  size_t n,
+				  size_t *consumed)
+{
+	const uint8_t *seminfo = seminfos;
+
+	*consumed = 0;
+
+	/* Tokens left from the previous match or a memory error precede the
+	 * provided ones. */
+	enum rdesc_result res = rdesc_resume(p);
+
+	while (res == RDESC_CONTINUE && *consumed < n) {
+		size_t i = (*consumed)++;
+
+		runtime_assertion(ids[i] != 0,
+				  "token id 0 is reserved for resume");
+
+		/* The parser owns the token from now on, even if it could
+		 * not be appended to the tape. */
+		if (push_token(p, ids[i], seminfo != NULL ?
+			       seminfo + i * p->seminfo_size : NULL))
+			return RDESC_ENOMEM;
+
+		res = pump_tokens(p);
+	}
+
+	return res;
+}
+
+/* Records the subtrees of the previous CST, copied into the snapshot, that
+ * neither contain nor examined an edited token as matched at their positions
+ * in the edited tape. Subtrees of a recorded one are grafted with it, and are
+ * not recorded themselves. */
+static void memoize_unedited(struct rdesc *p,
+			     struct rdesc_memo_snapshot *snapshot,
+			     size_t len, size_t position, size_t removed,
+			     size_t inserted)
+{
+	for (size_t i = 0; i < len;) {
+		node_t *n = cast(node_t *, &snapshot->nodes[i * sizeof_node(*p)]);
+
+		if (rtype(n) == RDESC_TOKEN) {
+			i++;
+
+			continue;
+		}
+
+		size_t flags = rmemo_slot(*p, n, 0);
+		size_t start = flags >> 2;
+
+		/* Only first matches are memoized, later ones depend on why
+		 * the nonterminal has been reopened. */
+		if ((flags & (MEMO_MATCHED | MEMO_STALE)) == MEMO_MATCHED &&
+		    (start + rmemo_slot(*p, n, 3) <= position ||
+		     start >= position + removed)) {
+			rdesc_memo_matched(p->memo, snapshot, n, rid(n),
+					   start < position ?
+					   start : start - removed + inserted,
+					   rmemo_slot(*p, n, 2),
+					   i, rmemo_slot(*p, n, 1));
+
+			i += rmemo_slot(*p, n, 1);
+
+			continue;
+		}
+
+		i += 1 + rchild_list_cap(*p, rid(n), rvariant(n));
+	}
+}
+
+/* Writes the inserted tokens over the removed ones, into the space reserved
+ * at the end of the tape and the packed seminfo buffer. `len` and `bytes` are
+ * their lengths before the reservation. */
+static void edit_tape(struct rdesc *p, size_t position, size_t removed,
+		      const uint16_t *ids, const uint8_t *seminfos,
+		      size_t inserted, size_t len, size_t bytes)
+{
+	size_t tail = len - position - removed;
+	size_t offset = 0, removed_bytes = 0, inserted_bytes = 0;
+
+	/* Latest tokens are destroyed first, as in the rest of the tape. */
+	if (p->token_destroyer)
+		for (size_t i = position + removed; i > position; i--)
+			p->token_destroyer(cast(tk_t *, rdesc_stack_at(
+						p->tape, i - 1))->id,
+					   token_seminfo(p->tape, p->seminfos,
+							 i - 1));
+
+	if (p->seminfos != NULL) {
+		offset = position < len ? cast(tk_t *, rdesc_stack_at(
+				p->tape, position))->seminfo : bytes;
+		removed_bytes = (position + removed < len ?
+				 cast(tk_t *, rdesc_stack_at(
+					 p->tape, position + removed))->seminfo :
+				 bytes) - offset;
+
+		for (size_t i = 0; i < inserted; i++)
+			inserted_bytes += p->seminfo_sizes[ids[i]];
+
+		if (bytes - offset - removed_bytes > 0)
+			memmove(rdesc_stack_at(p->seminfos,
+					       offset + inserted_bytes),
+				rdesc_stack_at(p->seminfos,
+					       offset + removed_bytes),
+				bytes - offset - removed_bytes);
+
+		for (size_t i = position + removed; i < len; i++)
+			cast(tk_t *, rdesc_stack_at(p->tape, i))->seminfo +=
+				inserted_bytes - removed_bytes;
+	}
+
+	if (tail > 0 && inserted != removed)
+		memmove(rdesc_stack_at(p->tape, position + inserted),
+			rdesc_stack_at(p->tape, position + removed),
+			tail * sizeof_tk(*p));
+
+	for (size_t i = 0; i < inserted; i++) {
+		tk_t *tk = rdesc_stack_at(p->tape, position + i);
+		const void *seminfo = seminfos != NULL ?
+			seminfos + i * p->seminfo_size : NULL;
+
+		tk->id = ids[i];
+
+		if (p->seminfos != NULL) {
+			size_t size = p->seminfo_sizes[ids[i]];
+
+			tk->seminfo = offset;
+
+			if (seminfo != NULL && size > 0)
+				memcpy(rdesc_stack_at(p->seminfos, offset),
+				       seminfo, size);
+
+			offset += size;
+		} else if (seminfo != NULL) {
+			memcpy(&tk->seminfo, seminfo, p->seminfo_size);
+		}
+	}
+
+	if (removed > inserted)
+		rdesc_stack_multipop(&p->tape, removed - inserted);
+
+	/* The buffer is reserved for all inserted bytes. */
+	if (removed_bytes > 0)
+		rdesc_stack_multipop(&p->seminfos, removed_bytes);
+}
+
+int rdesc_reparse(struct rdesc *p,
+		  uint16_t start_symbol,
+		  size_t position,
+		  size_t removed,
+		  const uint16_t *ids,
+		  const void *seminfos,
+		  size_t inserted)
+{
+	runtime_assertion(p->consumer == NULL && p->saved_tk == 0,
+			  "cannot edit a stream or a pending token");
+	runtime_assertion(p->memo != NULL,
+			  "reparse grafts memoized subtrees, enable memoization");
+	runtime_assertion(p->released == 0,
+			  "cannot reparse a tape whose tokens a cut has released");
+
+	size_t len = rdesc_stack_len(p->tape);
+	size_t bytes = p->seminfos != NULL ? rdesc_stack_len(p->seminfos) : 0;
+	size_t grown_bytes = 0;
+
+	runtime_assertion(position <= len && removed <= len - position,
+			  "edited tokens are out of the tape");
+
+	if (p->seminfos != NULL) {
+		for (size_t i = 0; i < inserted; i++) {
+			runtime_assertion(p->seminfo_sizes[ids[i]] <=
+					  p->seminfo_size,
+					  "token seminfo exceeds seminfo size");
+
+			grown_bytes += p->seminfo_sizes[ids[i]];
+		}
+
+		runtime_assertion(bytes + grown_bytes <= UINT32_MAX,
+				  "seminfo exceeds 32-bit offset");
+	}
+
+	/* Reserve space for the inserted tokens before anything changes. */
+	if (inserted > removed &&
+	    rdesc_stack_multipush(&p->tape, NULL, inserted - removed) == NULL)
+		return 1;
+
+	if (grown_bytes > 0 &&
+	    rdesc_stack_multipush(&p->seminfos, NULL, grown_bytes) == NULL) {
+		if (inserted > removed)
+			rdesc_stack_multipop(&p->tape, inserted - removed);
+
+		return 1;
+	}
+
+	/* Copy the previous CST before the restart removes it. */
+	size_t nodes = rdesc_stack_len(p->cst_stack);
+	struct rdesc_memo_snapshot *snapshot = nodes > 0 ?
+		rdesc_memo_snapshot(p->memo, rdesc_stack_at(p->cst_stack, 0),
+				    nodes * sizeof_node(*p)) : NULL;
+
+	/* The whole tape is matched again. */
+	if (start_match(p, start_symbol)) {
+		if (inserted > removed)
+			rdesc_stack_multipop(&p->tape, inserted - removed);
+
+		if (grown_bytes > 0)
+			rdesc_stack_multipop(&p->seminfos, grown_bytes);
+
+		if (snapshot != NULL)
+			rdesc_memo_release(p->memo, snapshot);
+
+		return 1;
+	}
+
+	edit_tape(p, position, removed, ids, seminfos, inserted, len, bytes);
+
+	if (snapshot != NULL) {
+		memoize_unedited(p, snapshot, nodes, position, removed,
+				 inserted);
+		rdesc_memo_release(p->memo, snapshot);
+	}
+
+	return 0;
+}
+/* ------------------------------------------------------------------------- */
+
+struct rdesc_node *rdesc_root(struct rdesc *p)
+{
+	if (rdesc_stack_len(p->cst_stack) == 0)
+		return NULL;
+
+	return rdesc_stack_at(p->cst_stack, 0);
+}
+
+void rdesc_read_stats(const struct rdesc *p, struct rdesc_stats *stats)
+{
+	*stats = p->stats;
+}
+
+size_t rdesc_error_position(const struct rdesc *p)
+{
+	runtime_assertion(p->error_position > 0, "no symbol has failed");
+
+	return p->released + p->error_position - 1;
+}
+
+size_t rdesc_expected_tokens(const struct rdesc *p, uint16_t *ids, size_t max)
+{
+	size_t count = 0;
+
+	runtime_assertion(p->error_position > 0, "no symbol has failed");
+
+	/* Token id 0 is reserved. */
+	for (uint16_t id = 1; id < pump_grammar(p).tk_count; id++) {
+		if (!in_first_set(p->expected, id))
+			continue;
+
+		if (count < max)
+			ids[count] = id;
+
+		count++;
+	}
+
+	return count;
+}
+
+struct rdesc_node *_rdesc_priv_cst_illegal_access(const struct rdesc *p,
+						  size_t index)
+{
+	return widen_idx(index) == SIZE_MAX ?
+		NULL : rdesc_stack_at(p->cst_stack, index);
+}
+
+void *_rdesc_priv_tape_seminfo(const struct rdesc *p, size_t index)
+{
+	if (index == RELEASED_TOKEN)
+		return NULL;
+
+	return token_seminfo(p->tape, p->seminfos, index);
+}
+
+int rdesc_take_cst(struct rdesc *p, struct rdesc_cst *cst)
+{
+	runtime_assertion(p->cur == SIZE_MAX &&
+			  rdesc_stack_len(p->cst_stack) > 0,
+			  "no CST is matched");
+
+	struct rdesc_stack *cst_stack, *tape, *seminfos = NULL;
+	size_t pending = rdesc_stack_len(p->tape) - p->position;
+
+	rdesc_stack_init_with_allocator(&cst_stack, sizeof_node(*p),
+					p->allocator);
+	if (cst_stack == NULL)
+		return 1;
+
+	rdesc_stack_init_with_allocator(&tape, sizeof_tk(*p), p->allocator);
+	if (tape == NULL) {
+		rdesc_stack_destroy(cst_stack);
+
+		return 1;
+	}
+
+	if (p->seminfos != NULL) {
+		rdesc_stack_init_with_allocator(&seminfos, 1, p->allocator);
+		if (seminfos == NULL) {
+			rdesc_stack_destroy(cst_stack);
+			rdesc_stack_destroy(tape);
+
+			return 1;
+		}
+	}
+
+	size_t offset = 0, bytes = 0;
+
+	if (seminfos != NULL) {
+		offset = seminfo_offset(p->tape, p->seminfos, p->position);
+		bytes = rdesc_stack_len(p->seminfos) - offset;
+	}
+
+	/* Tokens after the match are the only ones copied, they stay with the
+	 * parser. */
+	if ((pending > 0 &&
+	     rdesc_stack_multipush(&tape, rdesc_stack_at(p->tape, p->position),
+				   pending) == NULL) ||
+	    (bytes > 0 &&
+	     rdesc_stack_multipush(&seminfos,
+				   rdesc_stack_at(p->seminfos, offset),
+				   bytes) == NULL)) {
+		rdesc_stack_destroy(cst_stack);
+		rdesc_stack_destroy(tape);
+		if (seminfos != NULL)
+			rdesc_stack_destroy(seminfos);
+
+		return 1;
+	}
+
+	if (seminfos != NULL) {
+		for (size_t i = 0; i < pending; i++)
+			cast(tk_t *, rdesc_stack_at(tape, i))->seminfo -= offset;
+
+		rdesc_stack_multipop(&p->seminfos, bytes);
+	}
+
+	rdesc_stack_multipop(&p->tape, pending);
+
+	cst->nodes = p->cst_stack;
+	cst->tape = p->tape;
+	cst->seminfos = p->seminfos;
+	cst->token_destroyer = p->token_destroyer;
+	cst->allocator = p->allocator;
+
+	p->cst_stack = cst_stack;
+	p->tape = tape;
+	p->seminfos = seminfos;
+	p->position = 0;
+
+	return 0;
+}
+
+struct rdesc_node *rdesc_cst_root(const struct rdesc_cst *cst)
+{
+	return rdesc_stack_at(cst->nodes, 0);
+}
+
+void rdesc_cst_destroy(struct rdesc_cst *cst)
+{
+	/* Latest tokens are destroyed first, as in the parser. */
+	if (cst->token_destroyer) {
+		for (size_t i = rdesc_stack_len(cst->tape); i > 0; i--) {
+			tk_t *tk = rdesc_stack_at(cst->tape, i - 1);
+			cst->token_destroyer(tk->id,
+					     token_seminfo(cst->tape,
+							   cst->seminfos,
+							   i - 1));
+		}
+	}
+
+	rdesc_stack_destroy(cst->nodes);
+	rdesc_stack_destroy(cst->tape);
+
+	if (cst->seminfos != NULL)
+		rdesc_stack_destroy(cst->seminfos);
+}
+
+struct rdesc_node *_rdesc_priv_cst_node(const struct rdesc_cst *cst,
+					size_t index)
+{
+	return widen_idx(index) == SIZE_MAX ?
+		NULL : rdesc_stack_at(cst->nodes, index);
+}
+
+void *_rdesc_priv_cst_seminfo(const struct rdesc_cst *cst, size_t index)
+{
+	if (index == RELEASED_TOKEN)
+		return NULL;
+
+	return token_seminfo(cst->tape, cst->seminfos, index);
+}
+
+/* Makes the connection between parent and child, by adding `child_index` to
+ * parent's children index list. */
+static inline void push_child(struct rdesc *p, size_t parent_idx, size_t child_idx)
+{
+	node_t *parent = rdesc_stack_at(p->cst_stack, parent_idx);
+
+	_rdesc_priv_child_idx(parent, rchild_count(parent)) = child_idx;
+
+	rchild_count(parent)++;
+}
+
+/* Removes the last child from node. */
+static inline void pop_child(struct rdesc *p, size_t node_idx)
+{
+	node_t *parent = rdesc_stack_at(p->cst_stack, node_idx);
+
+	rchild_count(parent)--;
+}
+
+/* Fills the nonterminal at `p->cur`, which is followed by space for its
+ * children, and adds it to its parent. */
+static void init_nt_node(struct rdesc *p, size_t parent_idx, uint16_t nt_id,
+			 uint16_t variant, uint16_t child_list_cap)
+{
+	node_t *n = rdesc_stack_at(p->cst_stack, p->cur);
+
+	runtime_assertion(p->cur < (_rdesc_priv_idx_t) -1,
+			  "CST exceeds the node index range");
+
+	_rdesc_priv_parent_idx(n) = parent_idx;
+	runwind_size(n) = p->top_unwind;
+	rtype(n) = RDESC_NONTERMINAL;
+
+	rid(n) = nt_id;
+	rvariant(n) = variant;
+	rchild_count(n) = 0;
+
+	p->top_unwind = 1 + child_list_cap;
+
+	if (parent_idx != SIZE_MAX)
+		push_child(p, parent_idx, p->cur);
+
+	if (p->memo != NULL) {
+		runtime_assertion(p->position <= (_rdesc_priv_idx_t) -1 >> 2,
+				  "token position exceeds memo slot");
+
+		rmemo_slot(*p, n, 0) = p->position << 2;
+	}
+}
+
+/* Pushes a new nonterminal to parser's CST stack and reserves space for its
+ * children. */
+static int new_nt_node(struct rdesc *p, uint16_t nt_id, uint16_t variant)
+{
+	/* allocate node pointer */
+	if (rdesc_stack_push(&p->cst_stack, NULL) == NULL)
+		return 1;  /* node allocation failed */
+
+	uint16_t child_list_cap = rchild_list_cap(*p, nt_id, variant);
+	if (rdesc_stack_multipush(&p->cst_stack, NULL, child_list_cap) == NULL) {
+		/* Rollback changes if nonterminal is partially constructed. */
+		rdesc_stack_pop(&p->cst_stack);  /* Pop the node. */
+
+		return 1;  /* child list allocation failed */
+	}
+
+	/* the new node will be the p->cur, so that we need to hold parent_idx
+	 * in order to add it to its parent */
+	size_t parent_idx = p->cur;
+	p->cur = rdesc_stack_len(p->cst_stack) - 1 - child_list_cap;
+
+	init_nt_node(p, parent_idx, nt_id, variant, child_list_cap);
+
+	return 0;
+}
+
+/* Creates a new node in parser's CST stack referring to the token at the
+ * current position. */
+static int new_tk_node(struct rdesc *p, uint16_t tk_id)
+{
+	node_t *n = rdesc_stack_push(&p->cst_stack, NULL);
 
 	if (n == NULL)
 		return 1;  /* node allocation failed */
 
 	size_t node_id = rdesc_stack_len(p->cst_stack) - 1;
 
+	runtime_assertion(node_id < (_rdesc_priv_idx_t) -1,
+			  "CST exceeds the node index range");
+
 	push_child(p, p->cur, node_id);
 
 	_rdesc_priv_parent_idx(n) = p->cur;
 	runwind_size(n) = p->top_unwind;
 	rtype(n) = RDESC_TOKEN;
 
-	rid(n) = tk_id;
+	runtime_assertion(p->position < RELEASED_TOKEN,
+			  "token position exceeds 32-bit tape index");
 
-	if (seminfo)
-		memcpy(rseminfo(n), seminfo, p->seminfo_size);
+	rid(n) = tk_id;
+	n->n.tk.index = p->position;
 
 	p->top_unwind = 1;
+	p->position++;
+
+	return 0;
+}
+
+/* Appends the token to the tape and copies `seminfo` into it, or into the
+ * packed seminfo buffer. */
+static int push_token(struct rdesc *p, uint16_t tk_id, const void *seminfo)
+{
+	size_t size = p->seminfo_size;
+	void *packed = NULL;
+	tk_t *tk;
+
+	if (p->seminfos != NULL) {
+		size = p->seminfo_sizes[tk_id];
+
+		runtime_assertion(size <= p->seminfo_size,
+				  "token seminfo exceeds seminfo size");
+		runtime_assertion(rdesc_stack_len(p->seminfos) <= UINT32_MAX,
+				  "seminfo exceeds 32-bit offset");
+
+		if (size > 0)
+			packed = rdesc_stack_multipush(&p->seminfos, NULL,
+						       size);
+	}
+
+	if ((size > 0 && p->seminfos != NULL && packed == NULL) ||
+	    (tk = rdesc_stack_push(&p->tape, NULL)) == NULL) {
+		if (packed != NULL)
+			rdesc_stack_multipop(&p->seminfos, size);
+
+		/* Keep the token for retry in the next pump call. */
+		p->saved_tk = tk_id;
+		if (seminfo != NULL && seminfo != p->saved_seminfo &&
+		    p->saved_seminfo != NULL)
+			memcpy(p->saved_seminfo, seminfo, size);
+
+		return 1;
+	}
+
+	tk->id = tk_id;
+
+	if (p->seminfos != NULL) {
+		tk->seminfo = rdesc_stack_len(p->seminfos) - size;
+
+		if (seminfo != NULL && size > 0)
+			memcpy(packed, seminfo, size);
+	} else if (seminfo != NULL) {
+		memcpy(&tk->seminfo, seminfo, size);
+	}
 
 	return 0;
 }
@@ -1,4 +1,6 @@
+#include "../include/allocator.h"
 #include "../include/stack.h"
+#include "allocator.h"
 #include "common.h"
 #include "test_instruments.h"
 
@@ -30,13 +32,28 @@
  *       definition of `struct rdesc_stack` compatible with your system.
  */
 struct rdesc_stack {
+	const struct rdesc_allocator *allocator /** allocator of the buffer */;
 	size_t len /** current number of elements in the stack */;
 	size_t cap /** allocated capacity of the buffer */;
 	size_t element_size /** size of a element in chars */;
+	size_t retain /** non-zero if popping keeps the capacity, as wide as
+			the fields above to keep the elements aligned */;
 	char elements[] /** the dynamic array buffer */;
 };
 
 
+/* Size in bytes of a stack with capacity of `cap` elements. */
+#define stack_size(element_size, cap) \
+	(sizeof(struct rdesc_stack) + (cap) * (element_size))
+
+/* Alignment of stack images. */
+#define IMAGE_ALIGN 16
+
+/* Size of a stack image holding `len` elements. */
+#define image_bytes(element_size, len) \
+	((stack_size(element_size, len) + IMAGE_ALIGN - 1) / IMAGE_ALIGN * \
+	 IMAGE_ALIGN)
+
 static inline void *elem_at(struct rdesc_stack *s, size_t i)
 {
 	runtime_assertion(s->len >= i, "range overflow");
@@ -48,7 +65,9 @@ static inline void *elem_at(struct rdesc_stack *s, size_t i)
 static inline int resize_stack(struct rdesc_stack **s, size_t cap)
 {
 	struct rdesc_stack *new =
-		xrealloc(*s, sizeof(struct rdesc_stack) + cap * (*s)->element_size);
+		xrealloc((*s)->allocator, *s,
+			 stack_size((*s)->element_size, (*s)->cap),
+			 stack_size((*s)->element_size, cap));
 
 	if (new != NULL) {
 		*s = new;
@@ -80,19 +99,30 @@ static int stack_reserve(struct rdesc_stack **s, size_t reserved_space)
 
 void rdesc_stack_init(struct rdesc_stack **s, size_t element_size)
 {
-	*s = xmalloc(sizeof(struct rdesc_stack) + STACK_INITIAL_CAP * element_size);
+	rdesc_stack_init_with_allocator(s, element_size, NULL);
+}
+
+void rdesc_stack_init_with_allocator(struct rdesc_stack **s,
+				     size_t element_size,
+				     const struct rdesc_allocator *allocator)
+{
+	allocator = allocator_or_libc(allocator);
+
+	*s = xmalloc(allocator, stack_size(element_size, STACK_INITIAL_CAP));
 
 	if (*s == NULL)
 		return;
 
+	(*s)->allocator = allocator;
 	(*s)->element_size = element_size;
 	(*s)->len = 0;
 	(*s)->cap = STACK_INITIAL_CAP;
+	(*s)->retain = 0;
 }
 
 void rdesc_stack_destroy(struct rdesc_stack *s)
 {
-	free(s);
+	xfree(s->allocator, s, stack_size(s->element_size, s->cap));
 }
 
 void rdesc_stack_reset(struct rdesc_stack **s)
@@ -135,7 +165,7 @@ void *rdesc_stack_multipop(struct rdesc_stack **s, size_t count)
 
 	size_t decreased_cap = (*s)->cap;
 
-	while ((*s)->len * 4 <= decreased_cap &&
+	while (!(*s)->retain && (*s)->len * 4 <= decreased_cap &&
 	       decreased_cap >= STACK_INITIAL_CAP * 2)
 		decreased_cap /= 2;
 
@@ -147,6 +177,11 @@ void *rdesc_stack_multipop(struct rdesc_stack **s, size_t count)
 	return elem_at(*s, (*s)->len);
 }
 
+void rdesc_stack_retain(struct rdesc_stack *s, bool retain)
+{
+	s->retain = retain;
+}
+
 void *rdesc_stack_top(struct rdesc_stack *s)
 {
 	return elem_at(s, s->len - 1);
@@ -161,3 +196,57 @@ size_t rdesc_stack_len(const struct rdesc_stack *s)
 {
 	return s->len;
 }
+
+size_t rdesc_stack_image_size(const struct rdesc_stack *s)
+{
+	return image_bytes(s->element_size, s->len);
+}
+
+int rdesc_stack_write_image(const struct rdesc_stack *s,
+			    int (*write)(const void *data, size_t size,
+					 void *ctx),
+			    void *ctx)
+{
+	static const char padding[IMAGE_ALIGN];
+
+	/* The image is a full stack, so that it can be viewed in place. It
+	 * has no allocator and no spare capacity. */
+	struct rdesc_stack header = {
+		.allocator = NULL,
+		.len = s->len,
+		.cap = s->len,
+		.element_size = s->element_size,
+	};
+	size_t padding_size = image_bytes(s->element_size, s->len) -
+		stack_size(s->element_size, s->len);
+
+	if (write(&header, sizeof(header), ctx) ||
+	    (s->len > 0 && write(s->elements, s->element_size * s->len, ctx)) ||
+	    (padding_size > 0 && write(padding, padding_size, ctx)))
+		return 1;
+
+	return 0;
+}
+
+struct rdesc_stack *rdesc_stack_view_image(void *image, size_t size,
+					   size_t *element_size,
+					   size_t *image_size)
+{
+	struct rdesc_stack *s = image;
+
+	if (size < sizeof(struct rdesc_stack) ||
+	    (uintptr_t) image % IMAGE_ALIGN != 0)
+		return NULL;
+
+	if (s->element_size == 0 || s->len != s->cap ||
+	    s->len > (size - sizeof(struct rdesc_stack)) / s->element_size)
+		return NULL;
+
+	if (image_bytes(s->element_size, s->len) > size)
+		return NULL;
+
+	*element_size = s->element_size;
+	*image_size = image_bytes(s->element_size, s->len);
+
+	return s;
+}
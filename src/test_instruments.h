@@ -15,19 +15,25 @@ extern int malloc_fail_at;
 
 bool rdesc_test_instruments_check_failure(int *state, int count);
 
-#define xmalloc(size) (rdesc_test_instruments_check_failure(&malloc_fail_at, 1) ? \
-	NULL : malloc(size))
+#define xmalloc(a, size) (rdesc_test_instruments_check_failure(&malloc_fail_at, 1) ? \
+	NULL : (a)->alloc((a)->ctx, size))
 
-#define xrealloc(ptr, size) (rdesc_test_instruments_check_failure(&realloc_fail_at, 1) ? \
-	NULL : realloc(ptr, size))
+#define xrealloc(a, ptr, old_size, size) \
+	(rdesc_test_instruments_check_failure(&realloc_fail_at, 1) ? \
+	 NULL : (a)->realloc((a)->ctx, ptr, old_size, size))
 
 #define xmultipush(c) rdesc_test_instruments_check_failure(&multipush_fail_at, c)
 
 #else
 
-#define xmalloc malloc
-#define xrealloc realloc
+#define xmalloc(a, size) ((a)->alloc((a)->ctx, size))
+#define xrealloc(a, ptr, old_size, size) \
+	((a)->realloc((a)->ctx, ptr, old_size, size))
 #define xmultipush(c) false
 
 #endif
+
+/* Allocations are released through the allocator they are made with. */
+#define xfree(a, ptr, size) ((a)->free((a)->ctx, ptr, size))
+
 #endif
@@ -0,0 +1,169 @@
+/* Parse random statements with a memoizing parser and a grammar that use a
+ * tracking allocator, and expect every block to be released with the size it
+ * has been allocated with. */
+
+#include "../../include/allocator.h"
+#include "../../include/grammar.h"
+#include "../../include/rdesc.h"
+#include "../../src/common.h"
+
+#include "../../examples/grammar/bc.h"
+
+#include "../lib/bc_fuzzer.c"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+
+#define MAX_TOKENS 512
+#define ITERATIONS 256
+#define MEMORY_LIMIT (1 << 16)
+
+
+/* Blocks are prefixed with their size. */
+struct header {
+	size_t size;
+	size_t magic;
+};
+
+#define MAGIC 0x7a11ec
+
+
+struct tracker {
+	size_t live_blocks, live_bytes;
+	size_t allocations;
+};
+
+
+static struct header *header_of(void *ptr, size_t size)
+{
+	struct header *h = cast(struct header *, ptr) - 1;
+
+	rdesc_assert(h->magic == MAGIC, "foreign block");
+	rdesc_assert(h->size == size, "block size mismatch");
+
+	return h;
+}
+
+static void *tracking_alloc(void *ctx, size_t size)
+{
+	struct tracker *t = ctx;
+	struct header *h = malloc(sizeof(struct header) + size);
+
+	if (h == NULL)
+		return NULL;
+
+	h->size = size;
+	h->magic = MAGIC;
+
+	t->live_blocks++;
+	t->live_bytes += size;
+	t->allocations++;
+
+	return h + 1;
+}
+
+static void *tracking_realloc(void *ctx, void *ptr, size_t old_size,
+			      size_t size)
+{
+	struct tracker *t = ctx;
+	struct header *h = realloc(header_of(ptr, old_size),
+				   sizeof(struct header) + size);
+
+	if (h == NULL)
+		return NULL;
+
+	h->size = size;
+
+	t->live_bytes += size - old_size;
+	t->allocations++;
+
+	return h + 1;
+}
+
+static void tracking_free(void *ctx, void *ptr, size_t size)
+{
+	struct tracker *t = ctx;
+
+	free(header_of(ptr, size));
+
+	t->live_blocks--;
+	t->live_bytes -= size;
+}
+
+
+int main(void)
+{
+	srand(time(NULL));
+
+	struct tracker grammar_tracker = { 0 }, parser_tracker = { 0 };
+	const struct rdesc_allocator grammar_allocator = {
+		.alloc = tracking_alloc,
+		.realloc = tracking_realloc,
+		.free = tracking_free,
+		.ctx = &grammar_tracker,
+	}, parser_allocator = {
+		.alloc = tracking_alloc,
+		.realloc = tracking_realloc,
+		.free = tracking_free,
+		.ctx = &parser_tracker,
+	};
+
+	struct rdesc_grammar grammar;
+	struct rdesc p;
+	uint16_t tks[MAX_TOKENS];
+	size_t matches = 0;
+
+	unwrap(rdesc_grammar_init_with_allocator(&grammar,
+						 BC_NT_COUNT,
+						 BC_NT_VARIANT_COUNT,
+						 BC_NT_BODY_LENGTH,
+						 (struct rdesc_grammar_symbol *)
+						 bc,
+						 &grammar_allocator));
+	rdesc_assert(grammar_tracker.live_blocks > 0,
+		     "grammar does not use its allocator");
+
+	unwrap(rdesc_init_with_allocator(&p, &grammar, sizeof(size_t), NULL,
+					 &parser_allocator));
+	unwrap(rdesc_memoize(&p, MEMORY_LIMIT));
+
+	for (int i = 0; i < ITERATIONS; i++) {
+		struct bc_grammar_generator g = BC_DEFAULT_GENERATOR;
+		enum rdesc_result res = RDESC_CONTINUE;
+		size_t len = 0;
+
+		while (len < MAX_TOKENS - 1 &&
+		       (tks[len] = bc_fuzzer_next_tk(&g)) != TK_ENDSYM) {
+			g.group_start_p *= 0.9;
+			len++;
+		}
+		tks[len++] = TK_ENDSYM;
+
+		unwrap(rdesc_start(&p, NT_STMT));
+
+		for (size_t j = 0; j < len && res == RDESC_CONTINUE; j++)
+			res = rdesc_pump(&p, tks[j], &j);
+
+		if (res == RDESC_READY)
+			matches++;
+
+		rdesc_reset(&p);
+	}
+
+	rdesc_assert(matches > 0, "no statement matched");
+	rdesc_assert(parser_tracker.allocations > parser_tracker.live_blocks,
+		     "parser buffers are not resized through the allocator");
+
+	rdesc_destroy(&p);
+	rdesc_grammar_destroy(&grammar);
+
+	rdesc_assert(parser_tracker.live_blocks == 0 &&
+		     parser_tracker.live_bytes == 0,
+		     "parser leaks memory");
+	rdesc_assert(grammar_tracker.live_blocks == 0 &&
+		     grammar_tracker.live_bytes == 0,
+		     "grammar leaks memory");
+}
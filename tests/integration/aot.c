@@ -0,0 +1,125 @@
+/* Parse the same inputs with the interpreted pump and the parser generated
+ * ahead-of-time from the same grammar, and expect identical results and
+ * CSTs. */
+
+#include "../../include/cst_macros.h"
+#include "../../include/grammar.h"
+#include "../../include/rdesc.h"
+#include "../../src/common.h"
+
+#include "../../examples/grammar/bc.h"
+
+#include "../lib/bc_fuzzer.c"
+#include "../lib/cst_compare.c"
+
+#include "bc_aot.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+
+#define MAX_TOKENS 512
+
+
+static size_t random_statement(uint16_t *tks)
+{
+	struct bc_grammar_generator g = BC_DEFAULT_GENERATOR;
+	size_t len = 0;
+	uint16_t tk;
+
+	while ((tk = bc_fuzzer_next_tk(&g)) != TK_ENDSYM &&
+	       len < MAX_TOKENS - 2) {
+		g.group_start_p *= 0.9;
+
+		tks[len++] = tk;
+	}
+
+	/* Occasionally break the statement to exercise failures. */
+	if (rand() % 4 == 0 && len > 0)
+		tks[rand() % len] = rand() % (BC_TK_COUNT - 1) + 1;
+
+	tks[len++] = TK_ENDSYM;
+
+	return len;
+}
+
+
+int main(void)
+{
+	srand(time(NULL));
+
+	struct rdesc_grammar grammar;
+	struct rdesc interpreted, compiled;
+	uint16_t tks[MAX_TOKENS];
+
+	unwrap(rdesc_grammar_init(&grammar,
+				  BC_NT_COUNT, BC_NT_VARIANT_COUNT, BC_NT_BODY_LENGTH,
+				  (struct rdesc_grammar_symbol *) bc));
+
+	rdesc_assert(bc_grammar->tk_count == grammar.tk_count &&
+		     memcmp(bc_grammar->child_caps, grammar.child_caps,
+			    BC_NT_COUNT * sizeof(uint16_t)) == 0 &&
+		     memcmp(bc_grammar->variant_child_caps,
+			    grammar.variant_child_caps,
+			    row_count(grammar) * sizeof(uint16_t)) == 0,
+		     "compiled grammar differs");
+	rdesc_assert(memcmp(bc_grammar->variants, grammar.variants,
+			    (BC_NT_COUNT + 1) * sizeof(uint32_t)) == 0 &&
+		     memcmp(bc_grammar->bodies, grammar.bodies,
+			    (grammar.variants[BC_NT_COUNT] + 1) *
+			    sizeof(uint32_t)) == 0 &&
+		     memcmp(bc_grammar->symbols, grammar.symbols,
+			    grammar.bodies[grammar.variants[BC_NT_COUNT]] *
+			    sizeof(uint16_t)) == 0,
+		     "compiled rules differ");
+
+	unwrap(rdesc_init(&interpreted, &grammar, sizeof(size_t), NULL));
+	unwrap(bc_init(&compiled, sizeof(size_t), NULL));
+
+	for (int _fuzz = 0; _fuzz < 256; _fuzz++) {
+		enum rdesc_result r1 = RDESC_CONTINUE, r2 = RDESC_CONTINUE;
+		size_t len = random_statement(tks);
+		size_t memo_limit = _fuzz % 2 ? 1024 * 1024 : 0;
+
+		/* Memoization is independent of the grammar. */
+		unwrap(bc_memoize(&compiled, memo_limit));
+
+		unwrap(rdesc_start(&interpreted, NT_STMT));
+		unwrap(bc_start(&compiled, NT_STMT));
+
+		for (size_t i = 0; i < len; i++) {
+			r1 = rdesc_pump(&interpreted, tks[i], &i);
+			r2 = bc_pump(&compiled, tks[i], &i);
+
+			rdesc_assert(r1 == r2, "pump results differ");
+
+			if (r1 != RDESC_CONTINUE)
+				break;
+		}
+
+		/* Half of the CSTs are detached from the compiled parser. */
+		if (r1 == RDESC_READY && _fuzz % 4 < 2) {
+			assert_same_cst(&interpreted, rdesc_root(&interpreted),
+					&compiled, bc_root(&compiled),
+					sizeof(size_t));
+		} else if (r1 == RDESC_READY) {
+			struct rdesc_cst cst;
+
+			unwrap(bc_take_cst(&compiled, &cst));
+			assert_same_taken_cst(&interpreted,
+					      rdesc_root(&interpreted), &cst,
+					      bc_cst_root(&cst), sizeof(size_t));
+			bc_cst_destroy(&cst);
+		}
+
+		rdesc_reset(&interpreted);
+		bc_reset(&compiled);
+	}
+
+	rdesc_destroy(&interpreted);
+	bc_destroy(&compiled);
+	rdesc_grammar_destroy(&grammar);
+}
@@ -0,0 +1,140 @@
+/* List the symbols of the parser generated ahead-of-time with `nm`, and
+ * expect each to carry the prefix of its grammar and each function of the
+ * library to have its renamed counterpart. A function missing from the
+ * rename list in rdesc.c would clash with the library at link time. */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "../../src/common.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#ifndef AOT_OBJECT
+#error "AOT_OBJECT shall be the path of the object generated from bc grammar"
+#endif
+
+#ifndef LIBRARY
+#error "LIBRARY shall be the path of the library archive"
+#endif
+
+#define MAX_SYMBOLS 256
+#define MAX_SYMBOL_LENGTH 128
+
+
+struct symbols {
+	char names[MAX_SYMBOLS][MAX_SYMBOL_LENGTH];
+	char types[MAX_SYMBOLS];
+	size_t count;
+};
+
+
+/* Collects the defined global symbols `nm` lists for `path`. If `member` is
+ * not NULL, only symbols of the archive member with that name are kept. */
+static void list_symbols(struct symbols *symbols,
+			 const char *path, const char *member)
+{
+	char command[512], line[512];
+	FILE *nm;
+
+	snprintf(command, sizeof(command), "nm -A -P -g '%s'", path);
+	nm = popen(command, "r");
+	rdesc_assert(nm, "could not run nm");
+
+	symbols->count = 0;
+
+	while (fgets(line, sizeof(line), nm)) {
+		/* Lines are "<file>[<member>]: <name> <type> ...". */
+		char *name = strstr(line, ": "), *type;
+
+		rdesc_assert(name, "unexpected nm output");
+		*name = '\0';
+		name += 2;
+
+		if (member) {
+			size_t member_length = strlen(member),
+			       file_length = strlen(line);
+
+			if (file_length < member_length + 2 ||
+			    line[file_length - 1] != ']' ||
+			    line[file_length - member_length - 2] != '[' ||
+			    strncmp(&line[file_length - member_length - 1],
+				    member, member_length))
+				continue;
+		}
+
+		type = strchr(name, ' ');
+		rdesc_assert(type, "unexpected nm output");
+		*type++ = '\0';
+
+		/* Undefined and weak undefined symbols are not defined here.
+		 * Reserved names, such as those sanitizers add, are not ours. */
+		if (*type == 'U' || *type == 'w' || *type == 'v' ||
+		    strncmp(name, "__", 2) == 0)
+			continue;
+
+		rdesc_assert(symbols->count < MAX_SYMBOLS &&
+			     strlen(name) < MAX_SYMBOL_LENGTH,
+			     "too many symbols");
+		strcpy(symbols->names[symbols->count], name);
+		symbols->types[symbols->count++] = *type;
+	}
+
+	rdesc_assert(pclose(nm) == 0, "nm failed");
+}
+
+static bool has_symbol(const struct symbols *symbols, const char *name)
+{
+	for (size_t i = 0; i < symbols->count; i++)
+		if (strcmp(symbols->names[i], name) == 0)
+			return true;
+
+	return false;
+}
+
+/* Returns the name of a library function without its prefix, or NULL if it
+ * is not a function of the parser API. */
+static const char *unprefixed(const char *name)
+{
+	static const char *const prefixes[] = { "rdesc_", "_rdesc_priv_" };
+
+	for (size_t i = 0; i < sizeof(prefixes) / sizeof(prefixes[0]); i++)
+		if (strncmp(name, prefixes[i], strlen(prefixes[i])) == 0)
+			return name + strlen(prefixes[i]);
+
+	return NULL;
+}
+
+
+int main(void)
+{
+	static struct symbols aot, library;
+	char renamed[MAX_SYMBOL_LENGTH + 4];
+
+	list_symbols(&aot, AOT_OBJECT, NULL);
+	list_symbols(&library, LIBRARY, "rdesc.o");
+
+	rdesc_assert(aot.count > 0 && library.count > 0, "no symbols listed");
+
+	for (size_t i = 0; i < aot.count; i++)
+		if (strncmp(aot.names[i], "bc_", 3)) {
+			fprintf(stderr, "%s is not renamed\n", aot.names[i]);
+			rdesc_assert(0, "symbol of the aot parser is not renamed");
+		}
+
+	for (size_t i = 0; i < library.count; i++) {
+		const char *name = unprefixed(library.names[i]);
+
+		if (library.types[i] != 'T' || name == NULL)
+			continue;
+
+		snprintf(renamed, sizeof(renamed), "bc_%s", name);
+		if (!has_symbol(&aot, renamed)) {
+			fprintf(stderr, "%s is missing\n", renamed);
+			rdesc_assert(0, "function of the library is not renamed");
+		}
+	}
+}
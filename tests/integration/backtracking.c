@@ -38,8 +38,8 @@ int main(void)
 	rdesc_assert(rdesc_stack_len(p.cst_stack) == 0,
 	      "nomatch should teardown the CST");
 
-	rdesc_assert(rdesc_stack_len(p.token_stack) == 9,
-	      "tokens should be pushed back to stack due to teardown ");
+	rdesc_assert(p.position == 0 && rdesc_stack_len(p.tape) == 9,
+	      "tape should be rewound due to teardown");
 
 	rdesc_destroy(&p);
 	rdesc_grammar_destroy(&grammar);
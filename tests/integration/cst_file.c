@@ -0,0 +1,311 @@
+/* Save detached CSTs of random statements, with uniform and per-token seminfo
+ * sizes, open them back and expect them to match the saved trees node by
+ * node. Then expect damaged files, and files of corrupted trees, to be
+ * rejected. */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "../../include/cst_file.h"
+#include "../../include/cst_macros.h"
+#include "../../include/grammar.h"
+#include "../../include/rdesc.h"
+#include "../../include/stack.h"
+#include "../../src/common.h"
+
+#include "../../examples/grammar/bc.h"
+
+#include "../lib/bc_fuzzer.c"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+
+#define MAX_TOKENS 512
+#define ITERATIONS 128
+
+/* Large enough for a saved statement. */
+#define MAX_FILE_SIZE (1 << 20)
+
+
+/* Token ids cycle through sizes of 0, 1 and sizeof(size_t) bytes in the
+ * packed parser. */
+static size_t sizes[BC_TK_COUNT];
+
+static size_t seminfos[MAX_TOKENS];
+
+static char path[] = "/tmp/rdesc_cst_file_XXXXXX";
+
+static uint8_t file[MAX_FILE_SIZE];
+
+
+static void compare(const struct rdesc_cst *saved, struct rdesc_node *n,
+		    const struct rdesc_cst *opened, struct rdesc_node *on,
+		    bool packed)
+{
+	rdesc_assert(rtype(on) == rtype(n), "type mismatch");
+	rdesc_assert(rid(on) == rid(n), "id mismatch");
+
+	if (rtype(n) == RDESC_TOKEN) {
+		size_t size = packed ? sizes[rid(n)] : sizeof(size_t);
+
+		rdesc_assert(memcmp(rcst_seminfo(opened, on),
+				    rcst_seminfo(saved, n), size) == 0,
+			     "seminfo mismatch");
+
+		return;
+	}
+
+	rdesc_assert(rvariant(on) == rvariant(n), "variant mismatch");
+	rdesc_assert(rchild_count(on) == rchild_count(n),
+		     "child count mismatch");
+
+	for (uint16_t i = 0; i < rchild_count(n); i++) {
+		struct rdesc_node *child = rcst_child(opened, on, i);
+
+		rdesc_assert(rcst_parent(opened, child) == on,
+			     "broken parent link");
+
+		compare(saved, rcst_child(saved, n, i),
+			opened, child, packed);
+	}
+}
+
+static void save(const struct rdesc_cst *cst)
+{
+	FILE *out = fopen(path, "wb");
+
+	rdesc_assert(out != NULL, "could not create file");
+	unwrap(rdesc_cst_save(cst, out));
+	fclose(out);
+}
+
+static void save_and_compare(const struct rdesc_cst *cst, bool packed)
+{
+	struct rdesc_cst opened;
+
+	save(cst);
+	unwrap(rdesc_cst_open(&opened, path));
+
+	rdesc_assert(rcst_parent(&opened, rdesc_cst_root(&opened)) == NULL,
+		     "root has a parent");
+
+	compare(cst, rdesc_cst_root(cst),
+		&opened, rdesc_cst_root(&opened), packed);
+
+	rdesc_cst_close(&opened);
+}
+
+static void parse_and_save(struct rdesc *p, bool packed)
+{
+	uint16_t tks[MAX_TOKENS];
+	size_t matches = 0;
+
+	for (int i = 0; i < ITERATIONS; i++) {
+		struct bc_grammar_generator g = BC_DEFAULT_GENERATOR;
+		size_t len = 0, consumed;
+
+		while (len < MAX_TOKENS - 1 &&
+		       (tks[len] = bc_fuzzer_next_tk(&g)) != TK_ENDSYM) {
+			g.group_start_p *= 0.9;
+			len++;
+		}
+		tks[len++] = TK_ENDSYM;
+
+		unwrap(rdesc_start(p, NT_STMT));
+
+		if (rdesc_pump_many(p, tks, seminfos, len, &consumed) ==
+		    RDESC_READY) {
+			struct rdesc_cst cst;
+
+			matches++;
+
+			unwrap(rdesc_take_cst(p, &cst));
+			save_and_compare(&cst, packed);
+			rdesc_cst_destroy(&cst);
+		}
+
+		rdesc_reset(p);
+	}
+
+	rdesc_assert(matches > 0, "no statement matched");
+}
+
+/* Writes the first `size` bytes of the saved file back, with the byte at
+ * `damaged` flipped, and expects the file to be rejected. */
+static void check_rejected(size_t size, size_t damaged)
+{
+	struct rdesc_cst opened;
+	FILE *out = fopen(path, "wb");
+
+	rdesc_assert(out != NULL, "could not create file");
+
+	if (damaged < size)
+		file[damaged] ^= 0xff;
+
+	fwrite(file, 1, size, out);
+	fclose(out);
+
+	if (damaged < size)
+		file[damaged] ^= 0xff;
+
+	rdesc_assert(rdesc_cst_open(&opened, path) != 0,
+		     "damaged file is opened");
+}
+
+/* Saves the tree and expects the file to be rejected. */
+static void check_corrupted(const struct rdesc_cst *cst)
+{
+	struct rdesc_cst opened;
+
+	save(cst);
+	rdesc_assert(rdesc_cst_open(&opened, path) != 0,
+		     "corrupted tree is opened");
+}
+
+/* Returns the first token node of the subtree, NULL if it has none. */
+static struct rdesc_node *first_token(const struct rdesc_cst *cst,
+				      struct rdesc_node *n)
+{
+	if (rtype(n) == RDESC_TOKEN)
+		return n;
+
+	for (uint16_t i = 0; i < rchild_count(n); i++) {
+		struct rdesc_node *tk = first_token(cst, rcst_child(cst, n, i));
+
+		if (tk != NULL)
+			return tk;
+	}
+
+	return NULL;
+}
+
+/* Corrupts indices, counts and offsets of the tree one at a time, and expects
+ * each to be rejected instead of read out of the file. */
+static void check_corrupted_trees(struct rdesc_cst *cst)
+{
+	struct rdesc_node *root = rdesc_cst_root(cst),
+			  *child = rcst_child(cst, root, 0),
+			  *tk = first_token(cst, root);
+	_rdesc_priv_idx_t nodes = rdesc_stack_len(cst->nodes),
+			  tokens = rdesc_stack_len(cst->tape),
+			  child_idx = _rdesc_priv_child_idx(root, 0);
+	uint16_t child_count = rchild_count(root);
+	uint32_t tape_idx = _rdesc_priv_node_deref(tk).n.tk.index;
+
+	/* Root with a parent. */
+	_rdesc_priv_parent_idx(root) = 0;
+	check_corrupted(cst);
+	_rdesc_priv_parent_idx(root) = -1;
+
+	/* Child out of the node stack, the root as its own child, and a child
+	 * referring to another parent. */
+	_rdesc_priv_child_idx(root, 0) = nodes;
+	check_corrupted(cst);
+	_rdesc_priv_child_idx(root, 0) = 0;
+	check_corrupted(cst);
+	_rdesc_priv_child_idx(root, 0) = child_idx;
+
+	_rdesc_priv_parent_idx(child) = child_idx;
+	check_corrupted(cst);
+	_rdesc_priv_parent_idx(child) = 0;
+
+	/* Child list running past the node stack. */
+	rchild_count(root) = UINT16_MAX;
+	check_corrupted(cst);
+	rchild_count(root) = child_count;
+
+	/* Token out of the tape. */
+	_rdesc_priv_node_deref(tk).n.tk.index = tokens;
+	check_corrupted(cst);
+	_rdesc_priv_node_deref(tk).n.tk.index = tape_idx;
+
+	/* Packed seminfo out of the buffer. */
+	if (cst->seminfos != NULL) {
+		struct _rdesc_priv_tk *first = rdesc_stack_at(cst->tape, 0);
+		uint32_t offset = first->seminfo;
+
+		first->seminfo = rdesc_stack_len(cst->seminfos) + 1;
+		check_corrupted(cst);
+		first->seminfo = offset;
+	}
+}
+
+static void check_damaged(struct rdesc *p)
+{
+	uint16_t tks[] = { TK_NUM, TK_PLUS, TK_NUM, TK_ENDSYM };
+	struct rdesc_cst cst, opened;
+	size_t size, consumed;
+	FILE *in;
+
+	unwrap(rdesc_start(p, NT_STMT));
+	rdesc_assert(rdesc_pump_many(p, tks, seminfos, 4, &consumed) ==
+		     RDESC_READY, "could not match grammar");
+	unwrap(rdesc_take_cst(p, &cst));
+
+	save(&cst);
+
+	in = fopen(path, "rb");
+	rdesc_assert(in != NULL, "could not open file");
+	size = fread(file, 1, MAX_FILE_SIZE, in);
+	fclose(in);
+
+	/* Damaged magic, truncated, empty and extended files. */
+	check_rejected(size, 0);
+	check_rejected(size - 1, size);
+	check_rejected(0, size);
+
+	file[size] = 0;
+	check_rejected(size + 1, size);
+
+	check_corrupted_trees(&cst);
+
+	/* The original file is still accepted. */
+	save(&cst);
+	unwrap(rdesc_cst_open(&opened, path));
+	rdesc_cst_close(&opened);
+
+	rdesc_cst_destroy(&cst);
+
+	unlink(path);
+	rdesc_assert(rdesc_cst_open(&opened, path) != 0,
+		     "missing file is opened");
+}
+
+
+int main(void)
+{
+	srand(time(NULL));
+
+	struct rdesc_grammar grammar;
+	struct rdesc p;
+	int fd = mkstemp(path);
+
+	rdesc_assert(fd >= 0, "could not create temporary file");
+	close(fd);
+
+	for (size_t i = 0; i < MAX_TOKENS; i++)
+		seminfos[i] = i;
+
+	for (size_t i = 0; i < BC_TK_COUNT; i++)
+		sizes[i] = i % 3 == 0 ? 0 : i % 3 == 1 ? 1 : sizeof(size_t);
+
+	unwrap(rdesc_grammar_init(&grammar,
+				  BC_NT_COUNT, BC_NT_VARIANT_COUNT, BC_NT_BODY_LENGTH,
+				  (struct rdesc_grammar_symbol *) bc));
+	unwrap(rdesc_init(&p, &grammar, sizeof(size_t), NULL));
+
+	parse_and_save(&p, false);
+
+	unwrap(rdesc_seminfo_sizes(&p, sizes));
+	parse_and_save(&p, true);
+
+	check_damaged(&p);
+
+	rdesc_destroy(&p);
+	rdesc_grammar_destroy(&grammar);
+}
@@ -0,0 +1,247 @@
+/* Test the cut operator: variants before the cut are not retried, variants
+ * after it are, and the nonterminals containing the cut backtrack as usual.
+ * Pass a long list committing at each item, and expect its tokens to be
+ * released as it goes. */
+
+#include "../../include/cst_macros.h"
+#include "../../include/grammar.h"
+#include "../../include/rdesc.h"
+#include "../../include/rule_macros.h"
+#include "../../include/stack.h"
+#include "../../src/common.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+
+#define CUT_NT_COUNT 4
+#define CUT_NT_VARIANT_COUNT 4
+#define CUT_NT_BODY_LENGTH 5
+
+#define LIST_NT_COUNT 3
+#define LIST_NT_VARIANT_COUNT 3
+#define LIST_NT_BODY_LENGTH 5
+
+#define LIST_LENGTH 100000
+
+enum cut_tk {
+	TK_NOTOKEN,
+	TK_A, TK_B, TK_C, TK_D, TK_SEMI, TK_BANG,
+};
+
+enum cut_nt {
+	NT_TOP, NT_PAIR, NT_TAIL, NT_PLAIN_PAIR,
+};
+
+enum list_nt {
+	NT_LIST, NT_ITEMS, NT_ITEM,
+};
+
+static const struct rdesc_grammar_symbol
+cut[CUT_NT_COUNT][CUT_NT_VARIANT_COUNT][CUT_NT_BODY_LENGTH] = {
+	/* <top> ::= */ r(
+		NT(PAIR), TK(SEMI)
+	alt	NT(PLAIN_PAIR), TK(BANG)
+	alt	TK(A), TK(B), TK(C), TK(BANG)
+	),
+	/* <pair> ::= */ r(
+		TK(A), TK(B), CUT, NT(TAIL)
+	alt	TK(A), TK(C)
+	alt	TK(A), TK(B), TK(C), TK(C)
+	),
+	/* <tail> ::= */ r(
+		TK(C)
+	alt	TK(D)
+	alt	EPSILON
+	),
+	/* <plain_pair> ::= */ r(
+		TK(A), TK(C)
+	),
+};
+
+static const struct rdesc_grammar_symbol
+list[LIST_NT_COUNT][LIST_NT_VARIANT_COUNT][LIST_NT_BODY_LENGTH] = {
+	/* <list> ::= */ r(
+		NT(ITEMS), TK(BANG)
+	),
+	/* <items> ::= */ r(
+		NT(ITEM), CUT, NT(ITEMS)
+	alt	EPSILON
+	),
+	/* <item> ::= */ r(
+		TK(A), TK(B), TK(C), TK(SEMI)
+	alt	TK(A), TK(SEMI)
+	),
+};
+
+
+static size_t destroyed;
+
+static void count_destroyed(uint16_t id, void *seminfo)
+{
+	(void) id;
+	(void) seminfo;
+
+	destroyed++;
+}
+
+
+static enum rdesc_result parse(struct rdesc *p, const uint16_t *tks)
+{
+	enum rdesc_result res = RDESC_CONTINUE;
+
+	unwrap(rdesc_start(p, NT_TOP));
+
+	for (; *tks != TK_NOTOKEN && res == RDESC_CONTINUE; tks++)
+		res = rdesc_pump(p, *tks, NULL);
+
+	return res;
+}
+
+/* Pumps the list item by item, and expects the tape to keep the tokens of
+ * the last item alone. Ends the list with an item that does not match, if
+ * `broken`. */
+static void check_list(struct rdesc *p, bool broken)
+{
+	static const uint16_t short_item[] = { TK_A, TK_SEMI },
+			      long_item[] = { TK_A, TK_B, TK_C, TK_SEMI };
+	size_t pumped = 0;
+
+	destroyed = 0;
+	unwrap(rdesc_start(p, NT_LIST));
+
+	for (size_t i = 0; i < LIST_LENGTH; i++) {
+		const uint16_t *item = i % 2 ? long_item : short_item;
+		size_t length = i % 2 ? 4 : 2;
+
+		for (size_t j = 0; j < length; j++)
+			rdesc_assert(rdesc_pump(p, item[j], NULL) ==
+				     RDESC_CONTINUE,
+				     "could not match the item");
+
+		pumped += length;
+
+		rdesc_assert(rdesc_stack_len(p->tape) <= 2 * 4 &&
+			     destroyed + rdesc_stack_len(p->tape) == pumped,
+			     "committed tokens should be released");
+	}
+
+	if (broken) {
+		rdesc_assert(rdesc_pump(p, TK_A, NULL) == RDESC_CONTINUE &&
+			     rdesc_pump(p, TK_B, NULL) == RDESC_CONTINUE &&
+			     rdesc_pump(p, TK_SEMI, NULL) == RDESC_NOMATCH,
+			     "broken item matched");
+
+		/* The error position counts the released tokens. */
+		rdesc_assert(rdesc_error_position(p) == pumped + 2,
+			     "error position is not absolute");
+
+		rdesc_reset(p);
+		rdesc_assert(destroyed == pumped + 3,
+			     "tokens should be destroyed once");
+
+		return;
+	}
+
+	rdesc_assert(rdesc_pump(p, TK_BANG, NULL) == RDESC_READY,
+		     "could not match the list");
+
+	/* Nodes of the released tokens are kept without their seminfo. */
+	struct rdesc_node *items = rchild(p, rdesc_root(p), 0),
+			  *item = rchild(p, items, 0);
+
+	rdesc_assert(rchild_count(items) == 2 && rchild_count(item) == 2 &&
+		     rseminfo(p, rchild(p, item, 0)) == NULL,
+		     "released token should have no seminfo");
+
+	rdesc_reset(p);
+	rdesc_assert(destroyed == pumped + 1,
+		     "tokens should be destroyed once");
+}
+
+
+int main(void)
+{
+	srand(time(NULL));
+
+	struct rdesc_grammar grammar;
+	struct rdesc p;
+
+	unwrap(rdesc_grammar_init(&grammar,
+				  CUT_NT_COUNT, CUT_NT_VARIANT_COUNT,
+				  CUT_NT_BODY_LENGTH,
+				  (struct rdesc_grammar_symbol *) cut));
+
+	unwrap(rdesc_init(&p, &grammar, 0, NULL));
+
+	for (int memoized = 0; memoized < 2; memoized++) {
+		size_t memo_limit = memoized ? rand() % 65536 : 0;
+
+		unwrap(rdesc_memoize(&p, memo_limit));
+
+		/* Variants after the cut are retried. */
+		rdesc_assert(parse(&p, (uint16_t []) {
+			TK_A, TK_B, TK_D, TK_SEMI, TK_NOTOKEN
+		}) == RDESC_READY, "could not match after the cut");
+		rdesc_reset(&p);
+
+		rdesc_assert(parse(&p, (uint16_t []) {
+			TK_A, TK_B, TK_SEMI, TK_NOTOKEN
+		}) == RDESC_READY, "could not match after the cut");
+		rdesc_reset(&p);
+
+		/* Failures before the cut backtrack as usual. */
+		rdesc_assert(parse(&p, (uint16_t []) {
+			TK_A, TK_C, TK_SEMI, TK_NOTOKEN
+		}) == RDESC_READY, "could not match variant without cut");
+		rdesc_reset(&p);
+
+		rdesc_assert(parse(&p, (uint16_t []) {
+			TK_A, TK_C, TK_BANG, TK_NOTOKEN
+		}) == RDESC_READY, "could not match variant without cut");
+		rdesc_reset(&p);
+
+		/* <pair> fails as a whole, without retrying its later
+		 * variants, and <top>, which contains it, moves on. */
+		rdesc_assert(parse(&p, (uint16_t []) {
+			TK_A, TK_B, TK_C, TK_BANG, TK_NOTOKEN
+		}) == RDESC_READY, "could not match after the cut failed");
+		rdesc_reset(&p);
+
+		rdesc_assert(parse(&p, (uint16_t []) {
+			TK_A, TK_B, TK_C, TK_C, TK_SEMI, TK_NOTOKEN
+		}) == RDESC_NOMATCH, "variant before the cut retried");
+
+		rdesc_assert(p.position == 0 && rdesc_root(&p) == NULL,
+			     "nomatch should teardown the CST");
+		rdesc_reset(&p);
+	}
+
+	rdesc_destroy(&p);
+	rdesc_grammar_destroy(&grammar);
+
+	unwrap(rdesc_grammar_init(&grammar,
+				  LIST_NT_COUNT, LIST_NT_VARIANT_COUNT,
+				  LIST_NT_BODY_LENGTH,
+				  (struct rdesc_grammar_symbol *) list));
+
+	rdesc_assert(grammar.child_caps[NT_ITEMS] == 2,
+		     "cut should not take a child slot");
+
+	unwrap(rdesc_init(&p, &grammar, 0, count_destroyed));
+
+	for (int memoized = 0; memoized < 2; memoized++) {
+		size_t memo_limit = memoized ? rand() % 65536 : 0;
+
+		unwrap(rdesc_memoize(&p, memo_limit));
+
+		check_list(&p, false);
+		check_list(&p, true);
+	}
+
+	rdesc_destroy(&p);
+	rdesc_grammar_destroy(&grammar);
+}
@@ -0,0 +1,418 @@
+/* Edit random programs with token swaps, inserted and removed statements, and
+ * garbage undone by the next edit, reparsing with uniform and per-token
+ * seminfo sizes. After every edit, expect the match of the edited
+ * tape to be the one of a fresh parser, and every token to be destroyed
+ * once. */
+
+#include "../../include/cst_macros.h"
+#include "../../include/grammar.h"
+#include "../../include/rdesc.h"
+#include "../../include/rule_macros.h"
+#include "../../include/stack.h"
+#include "../../src/common.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define TEST_INSTRUMENTS
+
+#include "../../src/test_instruments.h"
+
+
+#define NT_COUNT 5
+#define NT_VARIANT_COUNT 5
+#define NT_BODY_LENGTH 5
+
+#define STATEMENT_COUNT 32
+#define MAX_TOKENS 4096
+#define MAX_EDIT 8
+#define EDITS 256
+#define MAX_SEMINFOS (MAX_TOKENS * 64)
+
+#define MEMORY_LIMIT (1 << 22)
+
+enum tk {
+	TK_NOTOKEN,
+	TK_ID, TK_NUM, TK_ASSIGN, TK_PLUS, TK_LPAREN, TK_RPAREN, TK_BANG,
+	TK_SEMI, TK_END,
+
+	TK_COUNT,
+};
+
+enum nt {
+	NT_PROGRAM, NT_STMTS, NT_STMT, NT_EXPR, NT_ATOM,
+};
+
+/* Statements and atoms backtrack, so that subtrees are memoized during the
+ * match as well. */
+static const struct rdesc_grammar_symbol
+program[NT_COUNT][NT_VARIANT_COUNT][NT_BODY_LENGTH] = {
+	/* <program> ::= */ r(
+		NT(STMTS), TK(END)
+	),
+	/* <stmts> ::= */ r(
+		NT(STMT), NT(STMTS)
+	alt	EPSILON
+	),
+	/* <stmt> ::= */ r(
+		TK(ID), TK(ASSIGN), NT(EXPR), TK(SEMI)
+	alt	NT(EXPR), TK(SEMI)
+	),
+	/* <expr> ::= */ r(
+		NT(ATOM), TK(PLUS), NT(EXPR)
+	alt	NT(ATOM)
+	),
+	/* <atom> ::= */ r(
+		TK(ID)
+	alt	TK(NUM)
+	alt	TK(LPAREN), NT(EXPR), TK(RPAREN), TK(BANG)
+	alt	TK(LPAREN), NT(EXPR), TK(RPAREN)
+	),
+};
+
+
+/* Tokens in the tape of the edited parser. Seminfo of each token is a serial
+ * number. */
+static uint16_t tks[MAX_TOKENS];
+static size_t seminfos[MAX_TOKENS];
+static size_t token_count;
+
+static size_t serial;
+static unsigned destroyed[MAX_SEMINFOS];
+
+/* Seminfo sizes of the packed parser. Serial numbers of tokens without a
+ * full seminfo are not checked. */
+static size_t sizes[TK_COUNT] = {
+	[TK_ID] = sizeof(size_t), [TK_NUM] = sizeof(size_t),
+	[TK_PLUS] = 1, [TK_SEMI] = 1,
+};
+
+static bool packed;
+
+
+static size_t seminfo_size(uint16_t id)
+{
+	return packed ? sizes[id] : sizeof(size_t);
+}
+
+static void token_destroyer(uint16_t id, void *seminfo)
+{
+	size_t i;
+
+	if (seminfo_size(id) < sizeof(size_t))
+		return;
+
+	memcpy(&i, seminfo, sizeof(size_t));
+
+	rdesc_assert(i < serial, "unknown token destroyed");
+	rdesc_assert(destroyed[i]++ == 0, "token destroyed twice");
+}
+
+static size_t generate_expr(uint16_t *out, size_t *out_seminfos, int depth);
+
+static size_t generate_atom(uint16_t *out, size_t *out_seminfos, int depth)
+{
+	size_t len = 0;
+
+	if (depth > 0 && rand() % 4 == 0) {
+		out[len++] = TK_LPAREN;
+		len += generate_expr(out + len, out_seminfos + len, depth - 1);
+		out[len++] = TK_RPAREN;
+
+		if (rand() % 2)
+			out[len++] = TK_BANG;
+	} else {
+		out[len++] = rand() % 2 ? TK_ID : TK_NUM;
+	}
+
+	return len;
+}
+
+static size_t generate_expr(uint16_t *out, size_t *out_seminfos, int depth)
+{
+	size_t len = generate_atom(out, out_seminfos, depth);
+
+	while (rand() % 3 == 0) {
+		out[len++] = TK_PLUS;
+		len += generate_atom(out + len, out_seminfos + len, depth);
+	}
+
+	return len;
+}
+
+/* Writes a statement with new serial numbers and returns its length. */
+static size_t generate_stmt(uint16_t *out, size_t *out_seminfos)
+{
+	size_t len = 0;
+
+	if (rand() % 2) {
+		out[len++] = TK_ID;
+		out[len++] = TK_ASSIGN;
+	}
+
+	len += generate_expr(out + len, out_seminfos + len, 3);
+	out[len++] = TK_SEMI;
+
+	for (size_t i = 0; i < len; i++)
+		out_seminfos[i] = serial++;
+
+	return len;
+}
+
+static void generate_program(void)
+{
+	token_count = 0;
+
+	for (int i = 0; i < STATEMENT_COUNT; i++)
+		token_count += generate_stmt(&tks[token_count],
+					     &seminfos[token_count]);
+
+	tks[token_count] = TK_END;
+	seminfos[token_count++] = serial++;
+}
+
+static void compare(struct rdesc *p, struct rdesc_node *n,
+		    struct rdesc *q, struct rdesc_node *qn)
+{
+	rdesc_assert(rtype(n) == rtype(qn), "type mismatch");
+	rdesc_assert(rid(n) == rid(qn), "id mismatch");
+
+	if (rtype(n) == RDESC_TOKEN) {
+		rdesc_assert(memcmp(rseminfo(p, n), rseminfo(q, qn),
+				    seminfo_size(rid(n))) == 0,
+			     "seminfo mismatch");
+
+		return;
+	}
+
+	rdesc_assert(rvariant(n) == rvariant(qn), "variant mismatch");
+	rdesc_assert(rchild_count(n) == rchild_count(qn),
+		     "child count mismatch");
+
+	for (uint16_t i = 0; i < rchild_count(n); i++) {
+		rdesc_assert(rparent(p, rchild(p, n, i)) == n,
+			     "broken parent link");
+
+		compare(p, rchild(p, n, i), q, rchild(q, qn, i));
+	}
+}
+
+/* Expects the tape of the edited parser to hold the tokens. */
+static void check_tape(struct rdesc *p)
+{
+	rdesc_assert(rdesc_stack_len(p->tape) == token_count,
+		     "tape length mismatch");
+
+	for (size_t i = 0; i < token_count; i++) {
+		tk_t *tk = rdesc_stack_at(p->tape, i);
+
+		rdesc_assert(tk->id == tks[i], "tape token mismatch");
+		rdesc_assert(memcmp(_rdesc_priv_tape_seminfo(p, i), &seminfos[i],
+				    seminfo_size(tks[i])) == 0,
+			     "tape seminfo mismatch");
+	}
+}
+
+/* Matches the edited tape, and the tokens with a fresh parser. */
+static void check_match(struct rdesc *p, struct rdesc *q)
+{
+	enum rdesc_result res = rdesc_resume(p), fresh;
+	size_t consumed;
+
+	check_tape(p);
+
+	unwrap(rdesc_start(q, NT_PROGRAM));
+	fresh = rdesc_pump_many(q, tks, seminfos, token_count, &consumed);
+
+	rdesc_assert(res == fresh, "result mismatch");
+
+	if (res == RDESC_READY)
+		compare(p, rdesc_root(p), q, rdesc_root(q));
+
+	rdesc_reset(q);
+}
+
+/* Replaces tokens in the tape and the model, with memory errors injected. */
+static void edit(struct rdesc *p, size_t position, size_t removed,
+		 const uint16_t *ids, const size_t *edit_seminfos,
+		 size_t inserted)
+{
+	size_t nodes = rdesc_stack_len(p->cst_stack);
+	node_t *cst = malloc(nodes * sizeof(node_t) + 1);
+
+	rdesc_assert(cst != NULL, "memory allocation failed");
+
+	if (nodes > 0)
+		memcpy(cst, rdesc_stack_at(p->cst_stack, 0),
+		       nodes * sizeof(node_t));
+
+	while (true) {
+		if (rand() % 4 == 0)
+			multipush_fail_at = rand() % 4;
+		else if (rand() % 8 == 0)
+			malloc_fail_at = 0;
+
+		if (rdesc_reparse(p, NT_PROGRAM, position, removed,
+				  ids, edit_seminfos, inserted) == 0)
+			break;
+
+		/* Nothing is edited, the CST is kept. */
+		check_tape(p);
+		rdesc_assert(rdesc_stack_len(p->cst_stack) == nodes &&
+			     (nodes == 0 ||
+			      memcmp(rdesc_stack_at(p->cst_stack, 0), cst,
+				     nodes * sizeof(node_t)) == 0),
+			     "failed edit changes the CST");
+	}
+
+	multipush_fail_at = malloc_fail_at = -1;
+	free(cst);
+
+	memmove(&tks[position + inserted], &tks[position + removed],
+		(token_count - position - removed) * sizeof(uint16_t));
+	memmove(&seminfos[position + inserted], &seminfos[position + removed],
+		(token_count - position - removed) * sizeof(size_t));
+	memcpy(&tks[position], ids, inserted * sizeof(uint16_t));
+	memcpy(&seminfos[position], edit_seminfos, inserted * sizeof(size_t));
+
+	token_count = token_count - removed + inserted;
+}
+
+/* Returns a random tape position after a statement. */
+static size_t statement_boundary(void)
+{
+	size_t position = rand() % token_count;
+
+	while (position > 0 && tks[position - 1] != TK_SEMI)
+		position--;
+
+	return position;
+}
+
+static void random_edit(struct rdesc *p, struct rdesc *q)
+{
+	uint16_t ids[MAX_TOKENS];
+	size_t edit_seminfos[MAX_TOKENS];
+	size_t position, removed = 0, inserted = 0;
+
+	switch (rand() % 4) {
+	case 0:  /* Swap a name and a number. */
+		position = rand() % token_count;
+
+		if (tks[position] != TK_ID && tks[position] != TK_NUM)
+			return;
+
+		ids[0] = tks[position] == TK_ID ? TK_NUM : TK_ID;
+		edit_seminfos[0] = serial++;
+		removed = inserted = 1;
+		break;
+
+	case 1:  /* Insert a statement. */
+		position = statement_boundary();
+		inserted = generate_stmt(ids, edit_seminfos);
+		break;
+
+	case 2:  /* Remove a statement. */
+		position = statement_boundary();
+
+		while (tks[position + removed] != TK_END &&
+		       tks[position + removed++] != TK_SEMI)
+			;
+		break;
+
+	case 3: {  /* Insert garbage and remove it in the next edit. */
+		size_t undo_seminfos[MAX_EDIT];
+		uint16_t undo[MAX_EDIT];
+
+		position = rand() % token_count;
+		removed = rand() % MAX_EDIT;
+		inserted = rand() % MAX_EDIT;
+
+		if (removed > token_count - 1 - position)
+			removed = token_count - 1 - position;
+
+		for (size_t i = 0; i < inserted; i++) {
+			ids[i] = TK_ID + rand() % (TK_END - TK_ID);
+			edit_seminfos[i] = serial++;
+		}
+
+		/* Removed tokens are destroyed, the undo inserts copies. */
+		for (size_t i = 0; i < removed; i++) {
+			undo[i] = tks[position + i];
+			undo_seminfos[i] = serial++;
+		}
+
+		edit(p, position, removed, ids, edit_seminfos, inserted);
+		check_match(p, q);
+
+		edit(p, position, inserted, undo, undo_seminfos, removed);
+		check_match(p, q);
+
+		return;
+	}
+
+	default: unreachable();
+	}
+
+	edit(p, position, removed, ids, edit_seminfos, inserted);
+	check_match(p, q);
+}
+
+static void check_edits(bool packed_seminfo)
+{
+	struct rdesc_grammar grammar;
+	struct rdesc p, q;
+	size_t consumed;
+
+	packed = packed_seminfo;
+	serial = 0;
+	memset(destroyed, 0, sizeof(destroyed));
+
+	unwrap(rdesc_grammar_init(&grammar,
+				  NT_COUNT, NT_VARIANT_COUNT, NT_BODY_LENGTH,
+				  (struct rdesc_grammar_symbol *) program));
+
+	unwrap(rdesc_init(&p, &grammar, sizeof(size_t), token_destroyer));
+	unwrap(rdesc_init(&q, &grammar, sizeof(size_t), NULL));
+
+	unwrap(rdesc_memoize(&p, MEMORY_LIMIT));
+	unwrap(rdesc_memoize(&q, MEMORY_LIMIT));
+
+	if (packed) {
+		unwrap(rdesc_seminfo_sizes(&p, sizes));
+		unwrap(rdesc_seminfo_sizes(&q, sizes));
+	}
+
+	generate_program();
+
+	unwrap(rdesc_start(&p, NT_PROGRAM));
+	rdesc_assert(rdesc_pump_many(&p, tks, seminfos, token_count,
+				     &consumed) == RDESC_READY,
+		     "could not match grammar");
+
+	for (int i = 0; i < EDITS; i++)
+		random_edit(&p, &q);
+
+	rdesc_destroy(&p);
+	rdesc_destroy(&q);
+	rdesc_grammar_destroy(&grammar);
+
+	/* Tokens in the tape are destroyed with the parser. */
+	for (size_t i = 0; i < token_count; i++)
+		if (seminfo_size(tks[i]) == sizeof(size_t))
+			rdesc_assert(destroyed[seminfos[i]] == 1,
+				     "token is not destroyed");
+}
+
+
+int main(void)
+{
+	srand(time(NULL));
+
+	check_edits(false);
+	check_edits(true);
+}
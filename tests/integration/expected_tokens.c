@@ -0,0 +1,170 @@
+/* Pump random statements with a damaged token until they fail, and expect the
+ * reported position to be the last token pumped, and a token to be expected
+ * there if and only if it is accepted in place of the failed one.
+ * Memoized and plain parsers, pumping one by one or many at once, are
+ * expected to report the same. */
+
+#include "../../include/grammar.h"
+#include "../../include/rdesc.h"
+#include "../../src/common.h"
+
+#include "../../examples/grammar/bc.h"
+
+#include "../lib/bc_fuzzer.c"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+
+#define MAX_TOKENS 512
+#define ITERATIONS 256
+
+
+static size_t seminfos[MAX_TOKENS];
+
+
+static size_t random_statement(uint16_t *tks)
+{
+	struct bc_grammar_generator g = BC_DEFAULT_GENERATOR;
+	size_t len = 0;
+
+	while (len < MAX_TOKENS - 1 &&
+	       (tks[len] = bc_fuzzer_next_tk(&g)) != TK_ENDSYM) {
+		g.group_start_p *= 0.9;
+		len++;
+	}
+	tks[len++] = TK_ENDSYM;
+
+	return len;
+}
+
+/* Pumps the tokens one by one, returns the number of tokens pumped. */
+static size_t pump(struct rdesc *p, const uint16_t *tks, size_t len,
+		   enum rdesc_result *res)
+{
+	size_t i = 0;
+
+	unwrap(rdesc_start(p, NT_STMT));
+
+	*res = RDESC_CONTINUE;
+
+	for (; i < len && *res == RDESC_CONTINUE; i++)
+		*res = rdesc_pump(p, tks[i], &seminfos[i]);
+
+	return i;
+}
+
+/* Returns whether the token is accepted after the tokens before the
+ * position. */
+static bool accepted(struct rdesc *p, uint16_t *tks, size_t position,
+		     uint16_t tk)
+{
+	uint16_t failed = tks[position];
+	enum rdesc_result res;
+
+	tks[position] = tk;
+	pump(p, tks, position + 1, &res);
+	tks[position] = failed;
+
+	rdesc_reset(p);
+
+	return res != RDESC_NOMATCH;
+}
+
+static void check_expected(struct rdesc *plain, struct rdesc *memoized,
+			   uint16_t *tks, size_t len)
+{
+	uint16_t expected[BC_TK_COUNT], other[BC_TK_COUNT];
+	size_t count, pumped, consumed, position;
+	enum rdesc_result res;
+
+	pumped = pump(plain, tks, len, &res);
+
+	if (res != RDESC_NOMATCH) {
+		rdesc_reset(plain);
+
+		return;
+	}
+
+	/* No path goes beyond the last token pumped. */
+	position = rdesc_error_position(plain);
+	rdesc_assert(position == pumped - 1, "error position mismatch");
+
+	count = rdesc_expected_tokens(plain, expected, BC_TK_COUNT);
+	rdesc_assert(count <= BC_TK_COUNT, "too many tokens expected");
+
+	for (size_t i = 1; i < count; i++)
+		rdesc_assert(expected[i - 1] < expected[i],
+			     "expected tokens are not ordered");
+
+	/* A short array receives the first tokens only. */
+	if (count > 0)
+		rdesc_assert(rdesc_expected_tokens(plain, other, 1) == count &&
+			     other[0] == expected[0],
+			     "expected token count mismatch");
+
+	rdesc_reset(plain);
+
+	for (uint16_t tk = 1, i = 0; tk < BC_TK_COUNT; tk++) {
+		bool is_expected = i < count && expected[i] == tk;
+
+		rdesc_assert(accepted(plain, tks, position, tk) == is_expected,
+			     "expected token mismatch");
+
+		i += is_expected;
+	}
+
+	/* The memoized parser grafts subtrees instead of deriving them, and
+	 * expects the same tokens. */
+	unwrap(rdesc_start(memoized, NT_STMT));
+	rdesc_assert(rdesc_pump_many(memoized, tks, seminfos, len,
+				     &consumed) == RDESC_NOMATCH,
+		     "memoized parser matched");
+	rdesc_assert(rdesc_error_position(memoized) == position,
+		     "memoized error position mismatch");
+	rdesc_assert(rdesc_expected_tokens(memoized, other, BC_TK_COUNT) ==
+		     count && memcmp(other, expected,
+				     count * sizeof(uint16_t)) == 0,
+		     "memoized expected tokens mismatch");
+
+	rdesc_reset(memoized);
+}
+
+
+int main(void)
+{
+	srand(time(NULL));
+
+	struct rdesc_grammar grammar;
+	struct rdesc plain, memoized;
+	uint16_t tks[MAX_TOKENS];
+
+	unwrap(rdesc_grammar_init(&grammar,
+				  BC_NT_COUNT, BC_NT_VARIANT_COUNT, BC_NT_BODY_LENGTH,
+				  (struct rdesc_grammar_symbol *) bc));
+
+	unwrap(rdesc_init(&plain, &grammar, sizeof(size_t), NULL));
+	unwrap(rdesc_init(&memoized, &grammar, sizeof(size_t), NULL));
+	unwrap(rdesc_memoize(&memoized, 1 << 20));
+
+	for (int i = 0; i < ITERATIONS; i++) {
+		size_t len = random_statement(tks);
+
+		/* Damage a token, the statement may still match. */
+		tks[rand() % len] = 1 + rand() % (BC_TK_COUNT - 1);
+
+		check_expected(&plain, &memoized, tks, len);
+	}
+
+	/* Statements cannot start with a closing parenthesis. */
+	tks[0] = TK_RPAREN;
+	check_expected(&plain, &memoized, tks, 1);
+
+	rdesc_destroy(&plain);
+	rdesc_destroy(&memoized);
+	rdesc_grammar_destroy(&grammar);
+}
@@ -1,3 +1,7 @@
+/* Rotate bc expressions, and expect nested lists of a grammar written with
+ * `rrr` to be rotated into the CST the same grammar written with `rlr`
+ * matches. */
+
 #include "../../include/cst_macros.h"
 #include "../../include/grammar.h"
 #include "../../include/rdesc.h"
@@ -6,13 +10,102 @@
 
 #include "../../examples/grammar/bc.h"
 
+#include "../lib/cst_compare.c"
+
 #include <stdint.h>
 
 
+#define SUM_NT_COUNT 4
+#define SUM_NT_VARIANT_COUNT 3
+#define SUM_NT_BODY_LENGTH 4
+
+/* Without <list_rest>. */
+#define LEFT_SUM_NT_COUNT 3
+
+enum sum_tk {
+	TK_SUM_NOTOKEN,
+	TK_SUM_NUM, TK_SUM_PLUS, TK_SUM_LPAREN, TK_SUM_RPAREN, TK_SUM_SEMI,
+};
+
+/* <list_rest> is the last one, so that both grammars number the others the
+ * same. */
+enum sum_nt {
+	NT_SUM_STMT, NT_SUM_ATOM, NT_SUM_LIST, NT_SUM_LIST_REST,
+};
+
+#undef PREFIX_TK
+#undef PREFIX_NT
+#define PREFIX_TK(tk) TK_SUM_ ## tk
+#define PREFIX_NT(nt) NT_SUM_ ## nt
+
+static const struct rdesc_grammar_symbol
+right[SUM_NT_COUNT][SUM_NT_VARIANT_COUNT][SUM_NT_BODY_LENGTH] = {
+	/* <stmt> ::= */ r(
+		NT(LIST), TK(SEMI)
+	),
+	/* <atom> ::= */ r(
+		TK(NUM)
+	alt	TK(LPAREN), NT(LIST), TK(RPAREN)
+	),
+	/* <list>, <list_rest> ::= */
+	rrr(LIST, (NT(ATOM)), (TK(PLUS), NT(ATOM))),
+};
+
+static const struct rdesc_grammar_symbol
+left[LEFT_SUM_NT_COUNT][SUM_NT_VARIANT_COUNT][SUM_NT_BODY_LENGTH] = {
+	/* <stmt> ::= */ r(
+		NT(LIST), TK(SEMI)
+	),
+	/* <atom> ::= */ r(
+		TK(NUM)
+	alt	TK(LPAREN), NT(LIST), TK(RPAREN)
+	),
+	/* <list> ::= */
+	rlr(LIST, (NT(ATOM)), (TK(PLUS), NT(ATOM))),
+};
+
+/* 1 + (2 + 3 + (4)) + 5; */
+static const uint16_t sum_tks[] = {
+	TK_SUM_NUM, TK_SUM_PLUS, TK_SUM_LPAREN, TK_SUM_NUM, TK_SUM_PLUS,
+	TK_SUM_NUM, TK_SUM_PLUS, TK_SUM_LPAREN, TK_SUM_NUM, TK_SUM_RPAREN,
+	TK_SUM_RPAREN, TK_SUM_PLUS, TK_SUM_NUM, TK_SUM_SEMI,
+};
+
+#define SUM_TOKEN_COUNT (sizeof(sum_tks) / sizeof(sum_tks[0]))
+
+
+/* Rotates the nested lists first, as the rotation renames continuation nodes
+ * of a list to its head. */
+static void flip_all(struct rdesc *p, struct rdesc_node *n)
+{
+	for (uint16_t i = 0; i < rchild_count(n); i++) {
+		struct rdesc_node *child = rchild(p, n, i);
+
+		if (rtype(child) == RDESC_TOKEN)
+			continue;
+
+		flip_all(p, child);
+
+		if (rid(child) == NT_SUM_LIST)
+			rdesc_flip_left(p, n, i);
+	}
+}
+
+static void parse_sum(struct rdesc *p)
+{
+	size_t consumed;
+
+	unwrap(rdesc_start(p, NT_SUM_STMT));
+	rdesc_assert(rdesc_pump_many(p, sum_tks, NULL, SUM_TOKEN_COUNT,
+				     &consumed) == RDESC_READY,
+		     "sum is not matched");
+}
+
+
 int main(void)
 {
-	struct rdesc_grammar grammar;
-	struct rdesc p;
+	struct rdesc_grammar grammar, right_grammar, left_grammar;
+	struct rdesc p, q;
 
 	unwrap(rdesc_grammar_init(&grammar,
 				  BC_NT_COUNT, BC_NT_VARIANT_COUNT, BC_NT_BODY_LENGTH,
@@ -35,4 +128,26 @@ int main(void)
 
 	rdesc_destroy(&p);
 	rdesc_grammar_destroy(&grammar);
+
+	/* The same list, written with rrr and with rlr. */
+	unwrap(rdesc_grammar_init(&right_grammar, SUM_NT_COUNT,
+				  SUM_NT_VARIANT_COUNT, SUM_NT_BODY_LENGTH,
+				  (struct rdesc_grammar_symbol *) right));
+	unwrap(rdesc_grammar_init(&left_grammar, LEFT_SUM_NT_COUNT,
+				  SUM_NT_VARIANT_COUNT, SUM_NT_BODY_LENGTH,
+				  (struct rdesc_grammar_symbol *) left));
+
+	unwrap(rdesc_init(&p, &right_grammar, 0, NULL));
+	unwrap(rdesc_init(&q, &left_grammar, 0, NULL));
+
+	parse_sum(&p);
+	parse_sum(&q);
+
+	flip_all(&p, rdesc_root(&p));
+	assert_same_cst(&p, rdesc_root(&p), &q, rdesc_root(&q), 0);
+
+	rdesc_destroy(&p);
+	rdesc_destroy(&q);
+	rdesc_grammar_destroy(&right_grammar);
+	rdesc_grammar_destroy(&left_grammar);
 }
@@ -0,0 +1,154 @@
+/* Freeze CSTs of random statements, in the parser and after detaching them,
+ * and expect the frozen trees to match the CSTs node by node. */
+
+#include "../../include/cst_macros.h"
+#include "../../include/freeze.h"
+#include "../../include/grammar.h"
+#include "../../include/rdesc.h"
+#include "../../src/common.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define TEST_INSTRUMENTS
+
+#include "../../examples/grammar/bc.h"
+#include "../../src/test_instruments.h"
+#include "../lib/bc_fuzzer.c"
+
+
+#define MAX_TOKENS 512
+#define ITERATIONS 256
+#define MEMORY_LIMIT (1 << 16)
+
+
+static size_t seminfos[MAX_TOKENS];
+
+/* Number of nodes visited by the last comparison. */
+static size_t visited;
+
+
+static void compare(struct rdesc *p, const struct rdesc_cst *cst,
+		    struct rdesc_node *n,
+		    const struct rdesc_frozen_cst *f, uint32_t fn)
+{
+	visited++;
+
+	rdesc_assert(rfrozen_type(f, fn) == rtype(n), "type mismatch");
+	rdesc_assert(rfrozen_id(f, fn) == rid(n), "id mismatch");
+
+	if (rtype(n) == RDESC_TOKEN) {
+		void *seminfo = cst != NULL ?
+			rfrozen_cst_seminfo(cst, f, fn) :
+			rfrozen_seminfo(p, f, fn);
+
+		rdesc_assert(seminfo == (cst != NULL ? rcst_seminfo(cst, n) :
+					 rseminfo(p, n)),
+			     "seminfo reference mismatch");
+
+		return;
+	}
+
+	rdesc_assert(rfrozen_variant(f, fn) == rvariant(n), "variant mismatch");
+	rdesc_assert(rfrozen_child_count(f, fn) == rchild_count(n),
+		     "child count mismatch");
+
+	for (uint16_t i = 0; i < rchild_count(n); i++) {
+		uint32_t child = rfrozen_child(f, fn, i);
+
+		/* Children follow the nodes before them in breadth-first
+		 * order. */
+		rdesc_assert(child > fn && child < rfrozen_node_count(f),
+			     "child out of order");
+		rdesc_assert(rfrozen_parent(f, child) == fn,
+			     "broken parent link");
+
+		compare(p, cst, cst != NULL ? rcst_child(cst, n, i) :
+			rchild(p, n, i), f, child);
+	}
+}
+
+static void freeze_and_compare(struct rdesc *p, const struct rdesc_cst *cst)
+{
+	struct rdesc_frozen_cst f;
+
+	if (rand() % 4 == 0) {
+		malloc_fail_at = 0;
+
+		rdesc_assert((cst != NULL ? rdesc_cst_freeze(cst, &f) :
+			      rdesc_freeze(p, &f)) != 0,
+			     "freeze expected to fail due to allocation error");
+	}
+
+	unwrap(cst != NULL ? rdesc_cst_freeze(cst, &f) : rdesc_freeze(p, &f));
+
+	rdesc_assert(rfrozen_parent(&f, 0) == RDESC_FROZEN_NONE,
+		     "root has a parent");
+
+	visited = 0;
+	compare(p, cst, cst != NULL ? rdesc_cst_root(cst) : rdesc_root(p),
+		&f, 0);
+
+	rdesc_assert(visited == rfrozen_node_count(&f), "node count mismatch");
+
+	rdesc_frozen_destroy(&f);
+}
+
+
+int main(void)
+{
+	srand(time(NULL));
+
+	struct rdesc_grammar grammar;
+	struct rdesc p;
+	uint16_t tks[MAX_TOKENS];
+	size_t matches = 0;
+
+	for (size_t i = 0; i < MAX_TOKENS; i++)
+		seminfos[i] = i;
+
+	unwrap(rdesc_grammar_init(&grammar,
+				  BC_NT_COUNT, BC_NT_VARIANT_COUNT, BC_NT_BODY_LENGTH,
+				  (struct rdesc_grammar_symbol *) bc));
+
+	unwrap(rdesc_init(&p, &grammar, sizeof(size_t), NULL));
+	unwrap(rdesc_memoize(&p, MEMORY_LIMIT));
+
+	for (int i = 0; i < ITERATIONS; i++) {
+		struct bc_grammar_generator g = BC_DEFAULT_GENERATOR;
+		enum rdesc_result res;
+		size_t len = 0, consumed;
+
+		while (len < MAX_TOKENS - 1 &&
+		       (tks[len] = bc_fuzzer_next_tk(&g)) != TK_ENDSYM) {
+			g.group_start_p *= 0.9;
+			len++;
+		}
+		tks[len++] = TK_ENDSYM;
+
+		unwrap(rdesc_start(&p, NT_STMT));
+
+		res = rdesc_pump_many(&p, tks, seminfos, len, &consumed);
+
+		if (res == RDESC_READY) {
+			struct rdesc_cst cst;
+
+			matches++;
+
+			freeze_and_compare(&p, NULL);
+
+			unwrap(rdesc_take_cst(&p, &cst));
+			freeze_and_compare(NULL, &cst);
+			rdesc_cst_destroy(&cst);
+		}
+
+		rdesc_reset(&p);
+	}
+
+	rdesc_assert(matches > 0, "no statement matched");
+
+	rdesc_destroy(&p);
+	rdesc_grammar_destroy(&grammar);
+}
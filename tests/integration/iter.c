@@ -0,0 +1,240 @@
+/* Iterate CSTs of random statements and their subtrees in every order, in the
+ * parser and after detaching them, and expect the nodes recursive walks
+ * visit. Then iterate a list nested deeper than a recursive walk could. */
+
+#include "../../include/cst_macros.h"
+#include "../../include/grammar.h"
+#include "../../include/iter.h"
+#include "../../include/rdesc.h"
+#include "../../include/rule_macros.h"
+#include "../../src/common.h"
+
+#include "../../examples/grammar/bc.h"
+
+#include "../lib/bc_fuzzer.c"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+
+#define MAX_TOKENS 512
+#define ITERATIONS 256
+#define MAX_NODES (MAX_TOKENS * 16)
+
+#define LIST_NT_COUNT 2
+#define LIST_NT_VARIANT_COUNT 3
+#define LIST_NT_BODY_LENGTH 4
+
+#define LIST_LENGTH (1 << 18)
+
+enum list_tk {
+	TK_LIST_NOTOKEN,
+	TK_LIST_NUM, TK_LIST_COMMA, TK_LIST_SEMI,
+};
+
+enum list_nt {
+	NT_LIST, NT_LIST_REST,
+};
+
+/* Every element nests the rest of the list one level deeper. */
+static const struct rdesc_grammar_symbol
+list[LIST_NT_COUNT][LIST_NT_VARIANT_COUNT][LIST_NT_BODY_LENGTH] = {
+	/* <list> ::= */ r(
+		TK(LIST_NUM), NT(LIST_REST)
+	),
+	/* <list_rest> ::= */ r(
+		TK(LIST_COMMA), TK(LIST_NUM), NT(LIST_REST)
+	alt	TK(LIST_SEMI)
+	),
+};
+
+
+struct walk {
+	struct rdesc_node *nodes[MAX_NODES];
+	size_t len;
+};
+
+static struct walk expected;
+
+
+static struct rdesc_node *child_of(struct rdesc *p,
+				   const struct rdesc_cst *cst,
+				   struct rdesc_node *n, uint16_t i)
+{
+	return cst != NULL ? rcst_child(cst, n, i) : rchild(p, n, i);
+}
+
+static void walk(struct rdesc *p, const struct rdesc_cst *cst,
+		 struct rdesc_node *n, enum rdesc_iter_order order)
+{
+	if (order == RDESC_PREORDER ||
+	    (order == RDESC_LEAVES && rtype(n) == RDESC_TOKEN)) {
+		rdesc_assert(expected.len < MAX_NODES, "walk overflow");
+		expected.nodes[expected.len++] = n;
+	}
+
+	if (rtype(n) == RDESC_NONTERMINAL)
+		for (uint16_t i = 0; i < rchild_count(n); i++)
+			walk(p, cst, child_of(p, cst, n, i), order);
+
+	if (order == RDESC_POSTORDER) {
+		rdesc_assert(expected.len < MAX_NODES, "walk overflow");
+		expected.nodes[expected.len++] = n;
+	}
+}
+
+static void check_iter(struct rdesc *p, const struct rdesc_cst *cst,
+		       struct rdesc_node *root, enum rdesc_iter_order order)
+{
+	struct rdesc_iter it;
+	struct rdesc_node *n;
+	size_t i = 0;
+
+	expected.len = 0;
+	walk(p, cst, root != NULL ? root :
+	     cst != NULL ? rdesc_cst_root(cst) : rdesc_root(p), order);
+
+	if (cst != NULL)
+		rdesc_cst_iter_init(&it, cst, root, order);
+	else
+		rdesc_iter_init(&it, p, root, order);
+
+	while ((n = rdesc_iter_next(&it)) != NULL) {
+		rdesc_assert(i < expected.len, "iterator visits extra nodes");
+		rdesc_assert(n == expected.nodes[i], "iteration order mismatch");
+		i++;
+	}
+
+	rdesc_assert(i == expected.len, "iterator misses nodes");
+	rdesc_assert(rdesc_iter_next(&it) == NULL, "iterator restarted");
+}
+
+/* Checks every order for the whole tree and a random subtree. */
+static void check_tree(struct rdesc *p, const struct rdesc_cst *cst)
+{
+	struct rdesc_node *root = cst != NULL ?
+		rdesc_cst_root(cst) : rdesc_root(p);
+	struct rdesc_node *subtree = root;
+
+	while (rtype(subtree) == RDESC_NONTERMINAL &&
+	       rchild_count(subtree) > 0 && rand() % 4)
+		subtree = child_of(p, cst, subtree,
+				   rand() % rchild_count(subtree));
+
+	for (int order = RDESC_PREORDER; order <= RDESC_LEAVES; order++) {
+		check_iter(p, cst, NULL, order);
+		check_iter(p, cst, root, order);
+		check_iter(p, cst, subtree, order);
+	}
+}
+
+static void check_statements(void)
+{
+	struct rdesc_grammar grammar;
+	struct rdesc p;
+	uint16_t tks[MAX_TOKENS];
+	size_t matches = 0;
+
+	unwrap(rdesc_grammar_init(&grammar,
+				  BC_NT_COUNT, BC_NT_VARIANT_COUNT, BC_NT_BODY_LENGTH,
+				  (struct rdesc_grammar_symbol *) bc));
+	unwrap(rdesc_init(&p, &grammar, 0, NULL));
+
+	for (int i = 0; i < ITERATIONS; i++) {
+		struct bc_grammar_generator g = BC_DEFAULT_GENERATOR;
+		size_t len = 0, consumed;
+
+		while (len < MAX_TOKENS - 1 &&
+		       (tks[len] = bc_fuzzer_next_tk(&g)) != TK_ENDSYM) {
+			g.group_start_p *= 0.9;
+			len++;
+		}
+		tks[len++] = TK_ENDSYM;
+
+		unwrap(rdesc_start(&p, NT_STMT));
+
+		if (rdesc_pump_many(&p, tks, NULL, len, &consumed) ==
+		    RDESC_READY) {
+			struct rdesc_cst cst;
+
+			matches++;
+
+			check_tree(&p, NULL);
+
+			unwrap(rdesc_take_cst(&p, &cst));
+			check_tree(NULL, &cst);
+			rdesc_cst_destroy(&cst);
+		}
+
+		rdesc_reset(&p);
+	}
+
+	rdesc_assert(matches > 0, "no statement matched");
+
+	rdesc_destroy(&p);
+	rdesc_grammar_destroy(&grammar);
+}
+
+static void check_deep_list(void)
+{
+	struct rdesc_grammar grammar;
+	struct rdesc p;
+	struct rdesc_iter it;
+	struct rdesc_node *n, *last = NULL;
+	size_t count = 0;
+
+	unwrap(rdesc_grammar_init(&grammar,
+				  LIST_NT_COUNT, LIST_NT_VARIANT_COUNT,
+				  LIST_NT_BODY_LENGTH,
+				  (struct rdesc_grammar_symbol *) list));
+	unwrap(rdesc_init(&p, &grammar, 0, NULL));
+
+	unwrap(rdesc_start(&p, NT_LIST));
+	rdesc_assert(rdesc_pump(&p, TK_LIST_NUM, NULL) == RDESC_CONTINUE,
+		     "could not match grammar");
+
+	for (size_t i = 1; i < LIST_LENGTH; i++) {
+		rdesc_assert(rdesc_pump(&p, TK_LIST_COMMA, NULL) ==
+			     RDESC_CONTINUE, "could not match grammar");
+		rdesc_assert(rdesc_pump(&p, TK_LIST_NUM, NULL) ==
+			     RDESC_CONTINUE, "could not match grammar");
+	}
+
+	rdesc_assert(rdesc_pump(&p, TK_LIST_SEMI, NULL) == RDESC_READY,
+		     "could not match grammar");
+
+	/* The deepest token comes last in input order. */
+	rdesc_iter_init(&it, &p, NULL, RDESC_LEAVES);
+	while ((n = rdesc_iter_next(&it)) != NULL) {
+		last = n;
+		count++;
+	}
+
+	rdesc_assert(count == LIST_LENGTH * 2, "token count mismatch");
+	rdesc_assert(rid(last) == TK_LIST_SEMI, "last token mismatch");
+
+	/* The root is visited last, after climbing the whole depth. */
+	count = 0;
+	rdesc_iter_init(&it, &p, NULL, RDESC_POSTORDER);
+	while ((n = rdesc_iter_next(&it)) != NULL) {
+		last = n;
+		count++;
+	}
+
+	rdesc_assert(count == LIST_LENGTH * 3 + 1, "node count mismatch");
+	rdesc_assert(last == rdesc_root(&p), "root is not visited last");
+
+	rdesc_destroy(&p);
+	rdesc_grammar_destroy(&grammar);
+}
+
+
+int main(void)
+{
+	srand(time(NULL));
+
+	check_statements();
+	check_deep_list();
+}
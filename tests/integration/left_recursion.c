@@ -0,0 +1,412 @@
+/* Parse random arithmetic expressions with a directly left-recursive grammar,
+ * and expect left-leaning CSTs without continuation nodes, evaluated to the
+ * value of the expression with left-associative operators. A memoized parser
+ * pumping in random batches interrupted by memory errors is expected to match
+ * the same CSTs. */
+
+#include "../../include/cst_macros.h"
+#include "../../include/grammar.h"
+#include "../../include/rdesc.h"
+#include "../../include/rule_macros.h"
+#include "../../src/common.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define TEST_INSTRUMENTS
+
+#include "../../src/test_instruments.h"
+
+
+#define LR_NT_COUNT 4
+#define LR_NT_VARIANT_COUNT 4
+#define LR_NT_BODY_LENGTH 5
+
+#define MAX_TOKENS 4096
+#define MAX_BATCH 8
+#define ITERATIONS 256
+
+enum lr_tk {
+	TK_NOTOKEN,
+	TK_NUM, TK_PLUS, TK_MINUS, TK_STAR, TK_LPAREN, TK_RPAREN, TK_BANG,
+	TK_SEMI,
+};
+
+enum lr_nt {
+	NT_STMT, NT_EXPR, NT_TERM, NT_FACTOR,
+};
+
+/* The first variant of <stmt> makes <expr> give up a growth it has started,
+ * as a plus sign followed by a bang does not continue it. A single star
+ * makes <term> move to its next growing variant, which multiplies by the
+ * factor once instead of twice. */
+static const struct rdesc_grammar_symbol
+lr[LR_NT_COUNT][LR_NT_VARIANT_COUNT][LR_NT_BODY_LENGTH] = {
+	/* <stmt> ::= */ r(
+		NT(EXPR), TK(PLUS), TK(BANG), TK(SEMI)
+	alt	NT(EXPR), TK(SEMI)
+	),
+	/* <expr> ::= */ r(
+		NT(EXPR), TK(PLUS), NT(TERM)
+	alt	NT(EXPR), TK(MINUS), NT(TERM)
+	alt	NT(TERM)
+	),
+	/* <term> ::= */ r(
+		NT(TERM), TK(STAR), TK(STAR), NT(FACTOR)
+	alt	NT(TERM), TK(STAR), NT(FACTOR)
+	alt	NT(FACTOR)
+	),
+	/* <factor> ::= */ r(
+		TK(NUM)
+	alt	TK(LPAREN), NT(EXPR), TK(RPAREN)
+	),
+};
+
+
+struct statement {
+	uint16_t tks[MAX_TOKENS];
+	unsigned seminfos[MAX_TOKENS];
+	size_t len;
+
+	/* Expected number of nodes, one for each token and for each
+	 * nonterminal derived. */
+	size_t node_count;
+	unsigned value;
+};
+
+static struct statement s;
+
+static size_t digest[MAX_TOKENS * 4], digest_len;
+
+
+static void push_tk(uint16_t tk, unsigned seminfo)
+{
+	rdesc_assert(s.len < MAX_TOKENS, "statement is too long");
+
+	s.tks[s.len] = tk;
+	s.seminfos[s.len++] = seminfo;
+	s.node_count++;
+}
+
+static unsigned generate_expr(int depth);
+
+/* <factor>, and <term> at each factor */
+static unsigned generate_factor(int depth)
+{
+	unsigned value;
+
+	s.node_count += 2;
+
+	if (depth > 0 && rand() % 4 == 0) {
+		push_tk(TK_LPAREN, 0);
+		value = generate_expr(depth - 1);
+		push_tk(TK_RPAREN, 0);
+	} else {
+		value = rand() % 100;
+		push_tk(TK_NUM, value);
+	}
+
+	return value;
+}
+
+/* <expr> at each term */
+static unsigned generate_expr(int depth)
+{
+	unsigned value = 0;
+	uint16_t op = TK_PLUS;
+
+	do {
+		unsigned term;
+
+		s.node_count++;
+
+		term = generate_factor(depth);
+
+		while (rand() % 3 == 0) {
+			unsigned factor;
+			bool twice = rand() % 2;
+
+			push_tk(TK_STAR, 0);
+			if (twice)
+				push_tk(TK_STAR, 0);
+
+			factor = generate_factor(depth);
+			term *= twice ? factor * factor : factor;
+		}
+
+		value = op == TK_PLUS ? value + term : value - term;
+
+		if (rand() % 2 == 0)
+			break;
+
+		op = rand() % 2 ? TK_PLUS : TK_MINUS;
+		push_tk(op, 0);
+	} while (true);
+
+	return value;
+}
+
+static void generate_statement(bool bang)
+{
+	s.len = 0;
+	s.node_count = 1;  /* <stmt> */
+
+	s.value = generate_expr(3);
+
+	if (bang) {
+		push_tk(TK_PLUS, 0);
+		push_tk(TK_BANG, 0);
+	}
+
+	push_tk(TK_SEMI, 0);
+}
+
+static size_t count_nodes(struct rdesc *p, struct rdesc_node *n)
+{
+	size_t count = 1;
+
+	if (rtype(n) == RDESC_NONTERMINAL)
+		for (uint16_t i = 0; i < rchild_count(n); i++)
+			count += count_nodes(p, rchild(p, n, i));
+
+	return count;
+}
+
+static unsigned eval(struct rdesc *p, struct rdesc_node *n)
+{
+	unsigned lhs, rhs;
+
+	switch (rid(n)) {
+	case NT_STMT:
+		return eval(p, rchild(p, n, 0));
+
+	case NT_FACTOR:
+		if (rvariant(n) == 0) {
+			unsigned value;
+
+			memcpy(&value, rseminfo(p, rchild(p, n, 0)),
+			       sizeof(value));
+
+			return value;
+		}
+
+		return eval(p, rchild(p, n, 1));
+
+	default: /* NT_EXPR, NT_TERM */
+		if (rchild_count(n) == 1)
+			return eval(p, rchild(p, n, 0));
+
+		rdesc_assert(rchild_count(n) >= 3 &&
+			     rid(rchild(p, n, 0)) == rid(n),
+			     "CST is not left-leaning");
+
+		lhs = eval(p, rchild(p, n, 0));
+		rhs = eval(p, rchild(p, n, rchild_count(n) - 1));
+
+		switch (rid(rchild(p, n, 1))) {
+		case TK_PLUS: return lhs + rhs;
+		case TK_MINUS: return lhs - rhs;
+		default: return rchild_count(n) == 4 ?
+			lhs * rhs * rhs : lhs * rhs;
+		}
+	}
+}
+
+static void flatten(struct rdesc *p, struct rdesc_node *n)
+{
+	rdesc_assert(digest_len + 3 <= sizeof(digest) / sizeof(digest[0]),
+		     "digest overflow");
+
+	digest[digest_len++] = rtype(n);
+	digest[digest_len++] = rid(n);
+
+	if (rtype(n) == RDESC_TOKEN) {
+		unsigned seminfo;
+
+		memcpy(&seminfo, rseminfo(p, n), sizeof(seminfo));
+		digest[digest_len++] = seminfo;
+
+		return;
+	}
+
+	digest[digest_len++] = rvariant(n);
+
+	for (uint16_t i = 0; i < rchild_count(n); i++)
+		flatten(p, rchild(p, n, i));
+}
+
+static bool same_digest(struct rdesc *p, struct rdesc_node *n)
+{
+	size_t len = digest_len;
+	bool same = true;
+
+	flatten(p, n);
+
+	for (size_t i = 0; i < len && same; i++)
+		same = digest[i] == digest[len + i];
+
+	same &= digest_len == 2 * len;
+	digest_len = len;
+
+	return same;
+}
+
+static void parse(struct rdesc *p, bool bang)
+{
+	enum rdesc_result res = RDESC_CONTINUE;
+
+	unwrap(rdesc_start(p, NT_STMT));
+
+	for (size_t i = 0; i < s.len && res == RDESC_CONTINUE; i++)
+		res = rdesc_pump(p, s.tks[i], &s.seminfos[i]);
+
+	rdesc_assert(res == RDESC_READY, "statement is not matched");
+	rdesc_assert(rvariant(rdesc_root(p)) == !bang, "stmt variant mismatch");
+	rdesc_assert(eval(p, rdesc_root(p)) == s.value, "value mismatch");
+	rdesc_assert(count_nodes(p, rdesc_root(p)) == s.node_count,
+		     "node count mismatch");
+
+	digest_len = 0;
+	flatten(p, rdesc_root(p));
+
+	rdesc_reset(p);
+}
+
+static void parse_batches(struct rdesc *p)
+{
+	size_t cur = 0;
+	enum rdesc_result res = RDESC_CONTINUE;
+
+	unwrap(rdesc_start(p, NT_STMT));
+
+	while (cur < s.len && res != RDESC_READY) {
+		size_t n = rand() % (MAX_BATCH + 1), consumed;
+
+		if (n > s.len - cur)
+			n = s.len - cur;
+
+		if (rand() % 4 == 0)
+			multipush_fail_at = rand() % 8;
+		if (rand() % 8 == 0)
+			realloc_fail_at = rand() % 4;
+
+		res = rdesc_pump_many(p, &s.tks[cur], &s.seminfos[cur], n,
+				      &consumed);
+
+		multipush_fail_at = realloc_fail_at = -1;
+
+		rdesc_assert(res != RDESC_NOMATCH, "statement is not matched");
+
+		cur += consumed;
+	}
+
+	while (res == RDESC_ENOMEM)
+		res = rdesc_resume(p);
+
+	rdesc_assert(res == RDESC_READY, "statement is not matched");
+	rdesc_assert(same_digest(p, rdesc_root(p)), "cst mismatch");
+
+	rdesc_reset(p);
+}
+
+/* Expects the statement to fail at its last token, where exactly the tokens
+ * in `expected` are expected. */
+static void assert_fails(struct rdesc *p, const uint16_t *tks,
+			 const uint16_t *expected)
+{
+	enum rdesc_result res = RDESC_CONTINUE;
+	uint16_t ids[LR_NT_COUNT * 4];
+	size_t i = 0, count;
+
+	unwrap(rdesc_start(p, NT_STMT));
+
+	for (; tks[i] != TK_NOTOKEN && res == RDESC_CONTINUE; i++)
+		res = rdesc_pump(p, tks[i], NULL);
+
+	rdesc_assert(res == RDESC_NOMATCH && tks[i] == TK_NOTOKEN,
+		     "statement is matched");
+	rdesc_assert(rdesc_error_position(p) == i - 1,
+		     "error position mismatch");
+
+	count = rdesc_expected_tokens(p, ids, sizeof(ids) / sizeof(ids[0]));
+
+	for (i = 0; expected[i] != TK_NOTOKEN; i++)
+		rdesc_assert(i < count && ids[i] == expected[i],
+			     "expected token mismatch");
+
+	rdesc_assert(i == count, "expected token count mismatch");
+
+	rdesc_reset(p);
+}
+
+/* <stmt> ::= <stmt> <expr> / "num", with <expr> ::= ";" / E, α of which may
+ * match no token. */
+static const struct rdesc_grammar_symbol
+nullable_suffix[2][3][3] = {
+	/* <stmt> ::= */ r(
+		NT(STMT), NT(EXPR)
+	alt	TK(NUM)
+	),
+	/* <expr> ::= */ r(
+		TK(SEMI)
+	alt	EPSILON
+	),
+};
+
+
+int main(void)
+{
+	srand(time(NULL));
+
+	struct rdesc_grammar grammar;
+	struct rdesc p, memoized;
+
+	rdesc_assert(rdesc_grammar_init(&grammar, 2, 3, 3,
+					(struct rdesc_grammar_symbol *)
+					nullable_suffix) == 1,
+		     "grammar init expected to fail due to nullable suffix");
+
+	unwrap(rdesc_grammar_init(&grammar,
+				  LR_NT_COUNT, LR_NT_VARIANT_COUNT,
+				  LR_NT_BODY_LENGTH,
+				  (struct rdesc_grammar_symbol *) lr));
+
+	rdesc_assert(grammar.grow_sets != NULL, "grow sets are missing");
+	rdesc_assert(variant_child_cap(grammar, NT_EXPR, 2) == 3 &&
+		     variant_child_cap(grammar, NT_TERM, 2) == 4,
+		     "left-recursive variants should share child capacity");
+
+	unwrap(rdesc_init(&p, &grammar, sizeof(unsigned), NULL));
+	unwrap(rdesc_init(&memoized, &grammar, sizeof(unsigned), NULL));
+	unwrap(rdesc_memoize(&memoized, 1 << 20));
+
+	for (int i = 0; i < ITERATIONS; i++) {
+		bool bang = rand() % 4 == 0;
+
+		generate_statement(bang);
+
+		parse(&p, bang);
+		parse_batches(&memoized);
+	}
+
+	/* Operators continuing <term> and <expr> are expected after a
+	 * factor. */
+	assert_fails(&p, (uint16_t []) { TK_NUM, TK_RPAREN, TK_NOTOKEN },
+		     (uint16_t []) { TK_PLUS, TK_MINUS, TK_STAR, TK_SEMI,
+		     TK_NOTOKEN });
+	assert_fails(&p, (uint16_t []) { TK_LPAREN, TK_NUM, TK_SEMI,
+		     TK_NOTOKEN },
+		     (uint16_t []) { TK_PLUS, TK_MINUS, TK_STAR, TK_RPAREN,
+		     TK_NOTOKEN });
+	assert_fails(&memoized, (uint16_t []) { TK_NUM, TK_PLUS, TK_SEMI,
+		     TK_NOTOKEN },
+		     (uint16_t []) { TK_NUM, TK_LPAREN, TK_BANG, TK_NOTOKEN });
+
+	rdesc_destroy(&p);
+	rdesc_destroy(&memoized);
+	rdesc_grammar_destroy(&grammar);
+}
@@ -0,0 +1,197 @@
+/* Parse the same inputs with and without packrat memoization, and expect
+ * identical results and CSTs. */
+
+#include "../../include/cst_macros.h"
+#include "../../include/grammar.h"
+#include "../../include/rdesc.h"
+#include "../../src/common.h"
+
+#include "../../examples/grammar/bc.h"
+
+#include "../lib/bc_fuzzer.c"
+#include "../lib/cst_compare.c"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define TEST_INSTRUMENTS
+
+#include "../../src/test_instruments.h"
+
+#define MAX_TOKENS 512
+
+
+/* Pumps the same tokens to both parsers, expecting the same results. */
+static void compare(struct rdesc *plain, struct rdesc *memoized,
+		    const uint16_t *tks, size_t tk_count)
+{
+	enum rdesc_result r1 = RDESC_CONTINUE, r2 = RDESC_CONTINUE;
+
+	unwrap(rdesc_start(plain, NT_STMT));
+	unwrap(rdesc_start(memoized, NT_STMT));
+
+	for (size_t i = 0; i < tk_count; i++) {
+		r1 = rdesc_pump(plain, tks[i], &i);
+		r2 = rdesc_pump(memoized, tks[i], &i);
+
+		rdesc_assert(r1 == r2, "pump results differ");
+
+		if (r1 != RDESC_CONTINUE)
+			break;
+	}
+
+	if (r1 == RDESC_READY)
+		assert_same_cst(plain, rdesc_root(plain),
+				memoized, rdesc_root(memoized),
+				sizeof(size_t));
+
+	rdesc_reset(plain);
+	rdesc_reset(memoized);
+}
+
+/* Pumps the tokens to the memoized parser failing allocations at fixed
+ * points, resuming after each failure, and compares the CST with the one of
+ * the plain parser. */
+static void compare_recovered(struct rdesc *plain, struct rdesc *memoized,
+			      const uint16_t *tks, size_t tk_count)
+{
+	enum rdesc_result r1 = RDESC_CONTINUE, r2 = RDESC_CONTINUE;
+
+	unwrap(rdesc_start(plain, NT_STMT));
+	unwrap(rdesc_start(memoized, NT_STMT));
+
+	for (size_t i = 0; i < tk_count; i++) {
+		r1 = rdesc_pump(plain, tks[i], &i);
+
+		multipush_fail_at = i % 3;
+		realloc_fail_at = i % 5;
+
+		r2 = rdesc_pump(memoized, tks[i], &i);
+
+		multipush_fail_at = realloc_fail_at = -1;
+
+		while (r2 == RDESC_ENOMEM)
+			r2 = rdesc_resume(memoized);
+
+		rdesc_assert(r1 == r2, "pump results differ after recovery");
+
+		if (r1 != RDESC_CONTINUE)
+			break;
+	}
+
+	if (r1 == RDESC_READY)
+		assert_same_cst(plain, rdesc_root(plain),
+				memoized, rdesc_root(memoized),
+				sizeof(size_t));
+
+	rdesc_reset(plain);
+	rdesc_reset(memoized);
+}
+
+static size_t random_statement(uint16_t *tks)
+{
+	struct bc_grammar_generator g = BC_DEFAULT_GENERATOR;
+	size_t len = 0;
+	uint16_t tk;
+
+	while ((tk = bc_fuzzer_next_tk(&g)) != TK_ENDSYM &&
+	       len < MAX_TOKENS - 2) {
+		g.group_start_p *= 0.9;
+
+		tks[len++] = tk;
+	}
+
+	/* Occasionally break the statement to exercise failures. */
+	if (rand() % 4 == 0 && len > 0)
+		tks[rand() % len] = rand() % (BC_TK_COUNT - 1) + 1;
+
+	tks[len++] = TK_ENDSYM;
+
+	return len;
+}
+
+/* Nested groups followed by an ambiguity trigger, which is retried at every
+ * level without memoization. */
+static size_t nested_statement(uint16_t *tks, size_t depth, bool valid)
+{
+	size_t len = 0;
+
+	for (size_t i = 0; i < depth; i++)
+		tks[len++] = TK_LPAREN;
+
+	tks[len++] = TK_NUM;
+
+	for (size_t i = 0; i < depth; i++) {
+		tks[len++] = TK_RPAREN;
+		tks[len++] = TK_DUMMY_AMBIGUITY_TRIGGER;
+	}
+
+	tks[len++] = valid ? TK_ENDSYM : TK_RPAREN;
+
+	return len;
+}
+
+
+int main(void)
+{
+	srand(time(NULL));
+
+	struct rdesc_grammar grammar;
+	struct rdesc plain, memoized;
+	uint16_t tks[MAX_TOKENS];
+
+	unwrap(rdesc_grammar_init(&grammar,
+				  BC_NT_COUNT, BC_NT_VARIANT_COUNT, BC_NT_BODY_LENGTH,
+				  (struct rdesc_grammar_symbol *) bc));
+
+	unwrap(rdesc_init(&plain, &grammar, sizeof(size_t), NULL));
+	unwrap(rdesc_init(&memoized, &grammar, sizeof(size_t), NULL));
+
+	/* Tiny limits force evictions. */
+	const size_t limits[] = { 1, 1024, 16 * 1024, 1024 * 1024 };
+
+	for (int _fuzz = 0; _fuzz < 256; _fuzz++) {
+		size_t limit = limits[_fuzz % 4];
+
+		unwrap(rdesc_memoize(&memoized, limit));
+
+		compare(&plain, &memoized, tks, random_statement(tks));
+	}
+
+	for (size_t depth = 1; depth < 12; depth++) {
+		compare(&plain, &memoized, tks,
+			nested_statement(tks, depth, true));
+		compare(&plain, &memoized, tks,
+			nested_statement(tks, depth, false));
+	}
+
+	/* Failed allocations leave the memo consistent. */
+	unwrap(rdesc_memoize(&memoized, 16 * 1024));
+
+	for (size_t depth = 1; depth < 12; depth++) {
+		compare_recovered(&plain, &memoized, tks,
+				  nested_statement(tks, depth, true));
+		compare_recovered(&plain, &memoized, tks,
+				  nested_statement(tks, depth, false));
+	}
+
+	rdesc_destroy(&plain);
+
+	/* Only linear in depth with memoization. */
+	unwrap(rdesc_memoize(&memoized, 64 * 1024 * 1024));
+
+	size_t len = nested_statement(tks, (MAX_TOKENS - 3) / 3, false);
+
+	unwrap(rdesc_start(&memoized, NT_STMT));
+	for (size_t i = 0; i < len - 1; i++)
+		rdesc_assert(rdesc_pump(&memoized, tks[i], &i) == RDESC_CONTINUE,);
+	rdesc_assert(rdesc_pump(&memoized, tks[len - 1], NULL) == RDESC_NOMATCH,);
+
+	unwrap(rdesc_memoize(&memoized, 0));
+
+	rdesc_destroy(&memoized);
+	rdesc_grammar_destroy(&grammar);
+}
@@ -0,0 +1,251 @@
+/* Parse a long input of boolean algebra statements in parallel, split at `;`
+ * which also ends statements nested in blocks, and expect the same CSTs as
+ * parsing the statements one after another, also when other threads hold
+ * parsers of the pool. Then expect a broken statement and a truncated input
+ * to be reported at the same positions, and every allocation failure to be
+ * reported. */
+
+#include "../../include/cst_macros.h"
+#include "../../include/grammar.h"
+#include "../../include/parallel.h"
+#include "../../include/pool.h"
+#include "../../include/rdesc.h"
+#include "../../src/common.h"
+
+#include "../../examples/grammar/boolean_algebra.h"
+
+#include "../lib/cst_compare.c"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define TEST_INSTRUMENTS
+
+#include "../../src/test_instruments.h"
+
+
+#define MAX_TOKENS 16384
+#define POOL_SIZE 4
+
+/* Statements in a long block, which spans chunks of the split. Chunks
+ * starting in it parse to their end without failing. */
+#define LONG_BLOCK_LENGTH 256
+
+/* Tokens parsed for each allocation failure. */
+#define FAILURE_TOKEN_COUNT 1024
+
+#define TEMPLATE_COUNT (sizeof(templates) / sizeof(templates[0]))
+
+/* x = a | !b; */
+static const uint16_t asgn[] = {
+	TK_IDENT, TK_EQ, TK_IDENT, TK_PIPE, TK_EXCL, TK_IDENT, TK_SEMI, 0,
+};
+
+/* f(a, (b = 1)); */
+static const uint16_t call[] = {
+	TK_IDENT, TK_LPAREN, TK_IDENT, TK_COMMA,
+	TK_LPAREN, TK_IDENT, TK_EQ, TK_TRUE, TK_RPAREN, TK_RPAREN, TK_SEMI, 0,
+};
+
+/* { x, y = 0, a & b; { ; } g(); } */
+static const uint16_t block[] = {
+	TK_LCURLY,
+	TK_IDENT, TK_COMMA, TK_IDENT, TK_EQ, TK_FALSE, TK_COMMA,
+	TK_IDENT, TK_AMP, TK_IDENT, TK_SEMI,
+	TK_LCURLY, TK_SEMI, TK_RCURLY,
+	TK_IDENT, TK_LPAREN, TK_RPAREN, TK_SEMI,
+	TK_RCURLY, 0,
+};
+
+static const uint16_t *const templates[] = { asgn, call, block };
+
+static uint16_t tks[MAX_TOKENS];
+static size_t seminfos[MAX_TOKENS];
+static size_t token_count;
+
+static const uint16_t separators[] = { TK_SEMI };
+
+
+static bool push_template(const uint16_t *t)
+{
+	size_t len = 0;
+
+	while (t[len] != 0)
+		len++;
+
+	if (token_count + len > MAX_TOKENS)
+		return false;
+
+	for (size_t i = 0; i < len; i++) {
+		seminfos[token_count] = token_count;
+		tks[token_count++] = t[i];
+	}
+
+	return true;
+}
+
+static void generate_input(void)
+{
+	static const uint16_t lcurly[] = { TK_LCURLY, 0 };
+	static const uint16_t rcurly[] = { TK_RCURLY, 0 };
+
+	token_count = 0;
+
+	while (true) {
+		size_t start = token_count;
+		bool pushed = true;
+
+		if (rand() % 16 != 0) {
+			if (!push_template(templates[rand() % TEMPLATE_COUNT]))
+				break;
+
+			continue;
+		}
+
+		pushed = push_template(lcurly);
+
+		for (int i = 0; i < LONG_BLOCK_LENGTH && pushed; i++)
+			pushed = push_template(asgn);
+
+		if (!pushed || !push_template(rcurly)) {
+			token_count = start;
+
+			break;
+		}
+	}
+}
+
+/* Parses the first `n` tokens statement by statement, expecting the list to
+ * hold the same CSTs, and returns the result and the error position. */
+static enum rdesc_result assert_sequential(struct rdesc *p, size_t n,
+					   const struct rdesc_cst_list *list,
+					   size_t *error_position)
+{
+	size_t position = 0, count = 0;
+
+	while (position < n) {
+		enum rdesc_result res;
+		size_t consumed;
+
+		unwrap(rdesc_start(p, NT_STMT));
+
+		res = rdesc_pump_many(p, &tks[position], &seminfos[position],
+				      n - position, &consumed);
+
+		if (res != RDESC_READY) {
+			*error_position = res == RDESC_NOMATCH ?
+				position + rdesc_error_position(p) : position;
+
+			rdesc_reset(p);
+			rdesc_assert(count == list->count, "CST count mismatch");
+
+			return res;
+		}
+
+		rdesc_assert(count < list->count, "CST count mismatch");
+		assert_same_taken_cst(p, rdesc_root(p), &list->csts[count],
+				      rdesc_cst_root(&list->csts[count]),
+				      sizeof(size_t));
+
+		count++;
+		position += consumed;
+
+		rdesc_reset(p);
+	}
+
+	rdesc_assert(count == list->count, "CST count mismatch");
+
+	return RDESC_READY;
+}
+
+static void assert_parallel(struct rdesc_pool *pool, struct rdesc *p,
+			    size_t n, size_t thread_count)
+{
+	struct rdesc_cst_list list;
+	size_t error_position = 0, expected_position = 0;
+	enum rdesc_result res;
+
+	res = rdesc_parse_parallel(pool, NT_STMT, tks, seminfos, n,
+				   separators, 1, thread_count, &list,
+				   &error_position);
+
+	rdesc_assert(res != RDESC_ENOMEM, "memory allocation failed");
+	rdesc_assert(assert_sequential(p, n, &list, &expected_position) ==
+		     res, "result mismatch");
+	rdesc_assert(res == RDESC_READY || error_position == expected_position,
+		     "error position mismatch");
+
+	rdesc_cst_list_destroy(&list);
+}
+
+
+int main(void)
+{
+	struct rdesc_grammar grammar;
+	struct rdesc_pool pool;
+	struct rdesc reference;
+	struct rdesc_cst_list list;
+	struct rdesc *held[POOL_SIZE];
+	size_t broken;
+
+	srand(time(NULL));
+	generate_input();
+
+	unwrap(rdesc_grammar_init(&grammar,
+				  BALG_NT_COUNT, BALG_NT_VARIANT_COUNT,
+				  BALG_NT_BODY_LENGTH,
+				  (struct rdesc_grammar_symbol *) balg));
+	unwrap(rdesc_init(&reference, &grammar, sizeof(size_t), NULL));
+	unwrap(rdesc_pool_init(&pool, POOL_SIZE, &grammar, sizeof(size_t),
+			       NULL, NULL));
+
+	for (size_t threads = 1; threads <= POOL_SIZE * 2; threads *= 2)
+		assert_parallel(&pool, &reference, token_count, threads);
+
+	/* Threads finding the pool exhausted leave their chunks to the calling
+	 * one, which cannot parse without a parser. */
+	for (int i = 0; i < POOL_SIZE - 1; i++)
+		held[i] = rdesc_pool_acquire(&pool);
+
+	assert_parallel(&pool, &reference, token_count, POOL_SIZE);
+
+	held[POOL_SIZE - 1] = rdesc_pool_acquire(&pool);
+
+	rdesc_assert(rdesc_parse_parallel(&pool, NT_STMT, tks, seminfos,
+					  token_count, separators, 1, POOL_SIZE,
+					  &list, NULL) == RDESC_ENOMEM,
+		     "parsed without a parser");
+
+	for (int i = 0; i < POOL_SIZE; i++)
+		rdesc_pool_release(&pool, held[i]);
+
+	/* The input ends in a statement. */
+	assert_parallel(&pool, &reference, token_count - 1, POOL_SIZE);
+
+	/* A statement in the middle is broken. */
+	broken = token_count / 2 + rand() % (token_count / 4);
+	tks[broken] = tks[broken] == TK_EQ ? TK_AMP : TK_EQ;
+
+	assert_parallel(&pool, &reference, token_count, POOL_SIZE);
+
+	/* Single-threaded, allocation failures are counted in order. */
+	for (int i = 0;; i++) {
+		malloc_fail_at = i;
+
+		if (rdesc_parse_parallel(&pool, NT_STMT, tks, seminfos,
+					 FAILURE_TOKEN_COUNT, separators, 1, 1,
+					 &list, NULL) != RDESC_ENOMEM)
+			break;
+	}
+
+	malloc_fail_at = -1;
+
+	rdesc_cst_list_destroy(&list);
+	rdesc_pool_destroy(&pool);
+	rdesc_destroy(&reference);
+	rdesc_grammar_destroy(&grammar);
+}
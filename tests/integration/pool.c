@@ -0,0 +1,261 @@
+/* Parse random statements from several threads sharing a pool smaller than the
+ * thread count, and expect the same CSTs as a single parser produces. Also
+ * expect every parser to be handed out once, to keep its buffers across
+ * acquisitions, and every allocation failure during the pool initialization
+ * to be reported. */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "../../include/allocator.h"
+#include "../../include/cst_macros.h"
+#include "../../include/grammar.h"
+#include "../../include/pool.h"
+#include "../../include/rdesc.h"
+#include "../../src/common.h"
+
+#include "../../examples/grammar/bc.h"
+
+#include "../lib/bc_fuzzer.c"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define TEST_INSTRUMENTS
+
+#include "../../src/test_instruments.h"
+
+
+#define MAX_TOKENS 256
+#define STATEMENT_COUNT 512
+#define THREAD_COUNT 4
+#define POOL_SIZE 2
+#define ROUNDS 8
+
+
+static uint16_t statements[STATEMENT_COUNT][MAX_TOKENS];
+static size_t lengths[STATEMENT_COUNT];
+
+/* Digest of the CST of each statement, 0 if it is not matched. */
+static uint64_t digests[STATEMENT_COUNT];
+
+static struct rdesc_grammar grammar;
+static struct rdesc_pool pool;
+
+/* Set while no buffer may be allocated or grown, unlike the failure
+ * counters of test instruments, every attempt fails. */
+static bool growth_denied;
+
+
+static uint64_t digest(struct rdesc *p, struct rdesc_node *n, uint64_t h)
+{
+	h = h * 31 + rtype(n);
+	h = h * 31 + rid(n);
+
+	if (rtype(n) == RDESC_TOKEN) {
+		size_t seminfo;
+
+		memcpy(&seminfo, rseminfo(p, n), sizeof(seminfo));
+
+		return h * 31 + seminfo;
+	}
+
+	h = h * 31 + rvariant(n);
+
+	for (uint16_t i = 0; i < rchild_count(n); i++)
+		h = digest(p, rchild(p, n, i), h);
+
+	return h;
+}
+
+static void *deny_alloc(void *ctx, size_t size)
+{
+	(void) ctx;
+
+	return growth_denied ? NULL : malloc(size);
+}
+
+static void *deny_realloc(void *ctx, void *ptr, size_t old_size, size_t size)
+{
+	(void) ctx;
+
+	return growth_denied && size > old_size ? NULL : realloc(ptr, size);
+}
+
+static void deny_free(void *ctx, void *ptr, size_t size)
+{
+	(void) ctx;
+	(void) size;
+
+	free(ptr);
+}
+
+static const struct rdesc_allocator deny_allocator = {
+	.alloc = deny_alloc,
+	.realloc = deny_realloc,
+	.free = deny_free,
+};
+
+
+static uint64_t parse(struct rdesc *p, size_t s)
+{
+	enum rdesc_result res = RDESC_CONTINUE;
+
+	unwrap(rdesc_start(p, NT_STMT));
+
+	for (size_t i = 0; i < lengths[s] && res == RDESC_CONTINUE; i++)
+		res = rdesc_pump(p, statements[s][i], &i);
+
+	if (res != RDESC_READY)
+		return 0;
+
+	return digest(p, rdesc_root(p), 1);
+}
+
+static void generate_statements(void)
+{
+	for (size_t s = 0; s < STATEMENT_COUNT; s++) {
+		struct bc_grammar_generator g = BC_DEFAULT_GENERATOR;
+		size_t len = 0;
+		uint16_t tk;
+
+		while ((tk = bc_fuzzer_next_tk(&g)) != TK_ENDSYM &&
+		       len < MAX_TOKENS - 2) {
+			g.group_start_p *= 0.9;
+
+			statements[s][len++] = tk;
+		}
+
+		/* Occasionally break the statement to exercise failures. */
+		if (rand() % 4 == 0 && len > 0)
+			statements[s][rand() % len] =
+				rand() % (BC_TK_COUNT - 1) + 1;
+
+		statements[s][len++] = TK_ENDSYM;
+		lengths[s] = len;
+	}
+}
+
+static void *worker(void *arg)
+{
+	size_t offset = *(size_t *) arg;
+
+	for (size_t i = 0; i < ROUNDS * STATEMENT_COUNT / THREAD_COUNT; i++) {
+		size_t s = (offset + i * THREAD_COUNT) % STATEMENT_COUNT;
+		struct rdesc *p;
+
+		while ((p = rdesc_pool_acquire(&pool)) == NULL)
+			;
+
+		rdesc_assert(parse(p, s) == digests[s], "CST mismatch");
+
+		rdesc_pool_release(&pool, p);
+	}
+
+	return NULL;
+}
+
+
+int main(void)
+{
+	pthread_t threads[THREAD_COUNT];
+	size_t offsets[THREAD_COUNT];
+	struct rdesc *acquired[POOL_SIZE];
+	struct rdesc reference;
+	size_t longest = 0;
+
+	srand(time(NULL));
+	generate_statements();
+
+	unwrap(rdesc_grammar_init(&grammar,
+				  BC_NT_COUNT, BC_NT_VARIANT_COUNT, BC_NT_BODY_LENGTH,
+				  (struct rdesc_grammar_symbol *) bc));
+	unwrap(rdesc_init(&reference, &grammar, sizeof(size_t), NULL));
+
+	for (size_t s = 0; s < STATEMENT_COUNT; s++) {
+		digests[s] = parse(&reference, s);
+
+		rdesc_reset(&reference);
+
+		if (digests[s] != 0 && lengths[s] > lengths[longest])
+			longest = s;
+	}
+
+	rdesc_destroy(&reference);
+
+	unwrap(rdesc_pool_init(&pool, POOL_SIZE, &grammar, sizeof(size_t),
+			       NULL, &deny_allocator));
+
+	/* Each parser is handed out once until it is released. */
+	for (int i = 0; i < POOL_SIZE; i++) {
+		acquired[i] = rdesc_pool_acquire(&pool);
+
+		rdesc_assert(acquired[i] != NULL, "pool is exhausted early");
+
+		for (int j = 0; j < i; j++)
+			rdesc_assert(acquired[i] != acquired[j],
+				     "parser is acquired twice");
+	}
+
+	rdesc_assert(rdesc_pool_acquire(&pool) == NULL,
+		     "acquired parser is handed out");
+
+	/* A parser released during a parse is reset. */
+	unwrap(rdesc_start(acquired[0], NT_STMT));
+	rdesc_pool_release(&pool, acquired[0]);
+
+	rdesc_assert(rdesc_pool_acquire(&pool) == acquired[0],
+		     "released parser is not handed out");
+
+	for (int i = 0; i < POOL_SIZE; i++)
+		rdesc_pool_release(&pool, acquired[i]);
+
+	/* After a release, parsing the longest statement again allocates
+	 * nothing. */
+	for (int round = 0; round < 2; round++) {
+		for (int i = 0; i < POOL_SIZE; i++)
+			acquired[i] = rdesc_pool_acquire(&pool);
+
+		growth_denied = round == 1;
+
+		for (int i = 0; i < POOL_SIZE; i++)
+			rdesc_assert(parse(acquired[i], longest) ==
+				     digests[longest],
+				     "released parser has lost its buffers");
+
+		growth_denied = false;
+
+		for (int i = 0; i < POOL_SIZE; i++)
+			rdesc_pool_release(&pool, acquired[i]);
+	}
+
+	for (size_t t = 0; t < THREAD_COUNT; t++) {
+		offsets[t] = t;
+
+		rdesc_assert(pthread_create(&threads[t], NULL, worker,
+					    &offsets[t]) == 0,
+			     "could not create thread");
+	}
+
+	for (size_t t = 0; t < THREAD_COUNT; t++)
+		pthread_join(threads[t], NULL);
+
+	rdesc_pool_destroy(&pool);
+
+	for (int i = 0;; i++) {
+		malloc_fail_at = i;
+
+		if (!rdesc_pool_init(&pool, POOL_SIZE, &grammar, sizeof(size_t),
+				     NULL, NULL))
+			break;
+	}
+
+	malloc_fail_at = -1;
+
+	rdesc_pool_destroy(&pool);
+	rdesc_grammar_destroy(&grammar);
+}
@@ -0,0 +1,141 @@
+/* Pump a stream of statements one token at a time and in random batches with
+ * `rdesc_pump_many`, and expect identical results and CSTs, also when batches
+ * are interrupted by memory errors. */
+
+#include "../../include/cst_macros.h"
+#include "../../include/grammar.h"
+#include "../../include/rdesc.h"
+#include "../../src/common.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define TEST_INSTRUMENTS
+
+#include "../../examples/grammar/bc.h"
+#include "../../src/test_instruments.h"
+#include "../lib/bc_fuzzer.c"
+#include "../lib/cst_compare.c"
+
+
+#define STREAM_LENGTH 8192
+#define MAX_TOKENS 256
+#define MAX_BATCH 16
+
+
+static uint16_t tks[STREAM_LENGTH];
+static size_t seminfos[STREAM_LENGTH];
+static size_t token_count;
+
+
+/* Statements, some of which are broken. */
+static void generate_stream(void)
+{
+	while (token_count + MAX_TOKENS <= STREAM_LENGTH) {
+		size_t len = bc_fuzzer_statement(&tks[token_count], MAX_TOKENS);
+
+		if (len > 0 && rand() % 8 == 0)
+			tks[token_count + rand() % len] =
+				rand() % (BC_TK_COUNT - 1) + 1;
+
+		token_count += len;
+	}
+
+	for (size_t i = 0; i < token_count; i++)
+		seminfos[i] = i;
+}
+
+static enum rdesc_result pump_one_by_one(struct rdesc *p, size_t *cur)
+{
+	enum rdesc_result res = rdesc_resume(p);
+
+	while (res == RDESC_CONTINUE && *cur < token_count) {
+		res = rdesc_pump(p, tks[*cur], &seminfos[*cur]);
+
+		(*cur)++;
+	}
+
+	return res;
+}
+
+static enum rdesc_result pump_in_batches(struct rdesc *p, size_t *cur)
+{
+	enum rdesc_result res;
+
+	do {
+		size_t n = rand() % (MAX_BATCH + 1), consumed;
+
+		if (n > token_count - *cur)
+			n = token_count - *cur;
+
+		if (rand() % 4 == 0)
+			multipush_fail_at = rand() % 8;
+
+		res = rdesc_pump_many(p, &tks[*cur], &seminfos[*cur], n,
+				      &consumed);
+
+		multipush_fail_at = -1;
+
+		rdesc_assert(consumed <= n, "consumed more than provided");
+		rdesc_assert(res != RDESC_CONTINUE || consumed == n,
+			     "batch is not consumed completely");
+
+		*cur += consumed;
+	} while ((res == RDESC_CONTINUE && *cur < token_count) ||
+		 res == RDESC_ENOMEM);
+
+	return res;
+}
+
+
+int main(void)
+{
+	srand(time(NULL));
+
+	struct rdesc_grammar grammar;
+	struct rdesc single, batched;
+	size_t single_cur = 0, batched_cur = 0;
+	size_t matches = 0;
+
+	generate_stream();
+
+	unwrap(rdesc_grammar_init(&grammar,
+				  BC_NT_COUNT, BC_NT_VARIANT_COUNT, BC_NT_BODY_LENGTH,
+				  (struct rdesc_grammar_symbol *) bc));
+
+	unwrap(rdesc_init(&single, &grammar, sizeof(size_t), NULL));
+	unwrap(rdesc_init(&batched, &grammar, sizeof(size_t), NULL));
+
+	while (single_cur < token_count) {
+		unwrap(rdesc_start(&single, NT_STMT));
+		unwrap(rdesc_start(&batched, NT_STMT));
+
+		enum rdesc_result res = pump_one_by_one(&single, &single_cur);
+
+		rdesc_assert(pump_in_batches(&batched, &batched_cur) == res,
+			     "result mismatch");
+		rdesc_assert(single_cur == batched_cur,
+			     "consumed token count mismatch");
+
+		if (res == RDESC_READY) {
+			assert_same_cst(&single, rdesc_root(&single),
+					&batched, rdesc_root(&batched),
+					sizeof(size_t));
+
+			matches++;
+		}
+
+		/* Tokens of a failed statement would fail again. */
+		rdesc_reset(&single);
+		rdesc_reset(&batched);
+	}
+
+	rdesc_assert(matches > 0, "no statement matched");
+
+	rdesc_destroy(&single);
+	rdesc_destroy(&batched);
+	rdesc_grammar_destroy(&grammar);
+}
@@ -0,0 +1,226 @@
+/* Stream statements of the boolean algebra grammar, some of which are broken,
+ * with panic-mode recovery at semicolons and closing braces. Expect each
+ * broken statement to be matched with an error node skipping its tokens, and
+ * the same CSTs from a memoized parser pumping in random batches interrupted
+ * by memory errors. */
+
+#include "../../include/cst_macros.h"
+#include "../../include/grammar.h"
+#include "../../include/rdesc.h"
+#include "../../src/common.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define TEST_INSTRUMENTS
+
+#include "../../examples/grammar/boolean_algebra.h"
+#include "../../src/test_instruments.h"
+
+
+#define MAX_BATCH 8
+
+/* Error nodes of <stmt> are at its end-of-construct index. */
+#define STMT_ERROR 4
+
+#define MAX_ERRORS 8
+#define DIGEST_LENGTH 1024
+
+#include "../lib/cst_digest.c"
+
+
+static const uint16_t tks[] = {
+	/* a = 1; */
+	TK_IDENT, TK_EQ, TK_TRUE, TK_SEMI,
+	/* b = &; */
+	TK_IDENT, TK_EQ, TK_AMP, TK_SEMI,
+	/* { c = 1; d = |; e = 0; } */
+	TK_LCURLY, TK_IDENT, TK_EQ, TK_TRUE, TK_SEMI,
+	TK_IDENT, TK_EQ, TK_PIPE, TK_SEMI,
+	TK_IDENT, TK_EQ, TK_FALSE, TK_SEMI, TK_RCURLY,
+	/* { g = & } */
+	TK_LCURLY, TK_IDENT, TK_EQ, TK_AMP, TK_RCURLY,
+	/* ); */
+	TK_RPAREN, TK_SEMI,
+	/* f(1); */
+	TK_IDENT, TK_LPAREN, TK_TRUE, TK_RPAREN, TK_SEMI,
+};
+
+#define TOKEN_COUNT (sizeof(tks) / sizeof(tks[0]))
+#define STATEMENT_COUNT 6
+
+/* First and last token of the error nodes. */
+static const size_t error_spans[][2] = {
+	{ 4, 7 }, { 13, 16 }, { 23, 25 }, { 27, 28 },
+};
+
+#define ERROR_COUNT (sizeof(error_spans) / sizeof(error_spans[0]))
+
+static const struct rdesc_sync syncs[] = {
+	{ .nt_id = NT_STMT, .tk_id = TK_SEMI, .consumed = true },
+	{ .nt_id = NT_STMT, .tk_id = TK_RCURLY, .consumed = false },
+};
+
+static size_t seminfos[TOKEN_COUNT];
+
+struct digest {
+	struct cst_digest cst;
+	size_t statements;
+
+	size_t errors[MAX_ERRORS][2];
+	size_t error_count;
+};
+
+static struct digest expected, streamed, unrecovered;
+
+
+/* Records the first and last token of the error nodes in pre-order. */
+static void find_errors(struct rdesc *p, struct rdesc_node *n, struct digest *d)
+{
+	if (rtype(n) == RDESC_TOKEN)
+		return;
+
+	if (rid(n) == NT_STMT && rvariant(n) == STMT_ERROR) {
+		struct rdesc_node *last = rchild(p, n, rchild_count(n) - 1);
+
+		rdesc_assert(d->error_count < MAX_ERRORS, "too many errors");
+
+		memcpy(&d->errors[d->error_count][0],
+		       rseminfo(p, rchild(p, n, 0)), sizeof(size_t));
+		memcpy(&d->errors[d->error_count][1], rseminfo(p, last),
+		       sizeof(size_t));
+		d->error_count++;
+	}
+
+	for (uint16_t i = 0; i < rchild_count(n); i++)
+		find_errors(p, rchild(p, n, i), d);
+}
+
+static void consume(struct rdesc *p, struct rdesc_node *root, void *ctx)
+{
+	struct digest *d = ctx;
+
+	digest_flatten(p, root, &d->cst);
+	find_errors(p, root, d);
+	d->statements++;
+}
+
+/* Pumps the tokens one by one, and a stray closing brace, which no statement
+ * can start with or recover at. */
+static void parse_stream(struct rdesc *p)
+{
+	size_t seminfo = TOKEN_COUNT;
+
+	unwrap(rdesc_stream(p, NT_STMT, consume, &expected));
+
+	for (size_t i = 0; i < TOKEN_COUNT; i++)
+		rdesc_assert(rdesc_pump(p, tks[i], &seminfos[i]) ==
+			     RDESC_CONTINUE, "stream is interrupted");
+
+	rdesc_assert(rdesc_pump(p, TK_RCURLY, &seminfo) == RDESC_NOMATCH,
+		     "stray closing brace is matched");
+}
+
+static void parse_batches(struct rdesc *p)
+{
+	size_t cur = 0, seminfo = TOKEN_COUNT;
+	enum rdesc_result res;
+
+	unwrap(rdesc_stream(p, NT_STMT, consume, &streamed));
+
+	while (cur < TOKEN_COUNT) {
+		size_t n = rand() % (MAX_BATCH + 1), consumed;
+
+		if (n > TOKEN_COUNT - cur)
+			n = TOKEN_COUNT - cur;
+
+		if (rand() % 4 == 0)
+			multipush_fail_at = rand() % 8;
+		if (rand() % 8 == 0)
+			realloc_fail_at = rand() % 4;
+
+		res = rdesc_pump_many(p, &tks[cur], &seminfos[cur], n,
+				      &consumed);
+
+		multipush_fail_at = realloc_fail_at = -1;
+
+		rdesc_assert(res == RDESC_CONTINUE || res == RDESC_ENOMEM,
+			     "stream is interrupted");
+
+		cur += consumed;
+	}
+
+	while ((res = rdesc_resume(p)) == RDESC_ENOMEM)
+		;
+
+	rdesc_assert(res == RDESC_CONTINUE, "stream is interrupted");
+	rdesc_assert(rdesc_pump(p, TK_RCURLY, &seminfo) == RDESC_NOMATCH,
+		     "stray closing brace is matched");
+}
+
+
+int main(void)
+{
+	srand(time(NULL));
+
+	struct rdesc_grammar grammar;
+	struct rdesc p, memoized;
+
+	for (size_t i = 0; i < TOKEN_COUNT; i++)
+		seminfos[i] = i;
+
+	unwrap(rdesc_grammar_init(&grammar,
+				  BALG_NT_COUNT, BALG_NT_VARIANT_COUNT,
+				  BALG_NT_BODY_LENGTH,
+				  cast(struct rdesc_grammar_symbol *, balg)));
+
+	unwrap(rdesc_init(&p, &grammar, sizeof(size_t), NULL));
+	unwrap(rdesc_recover(&p, syncs, sizeof(syncs) / sizeof(syncs[0])));
+
+	parse_stream(&p);
+
+	rdesc_assert(expected.statements == STATEMENT_COUNT,
+		     "statement count mismatch");
+	rdesc_assert(expected.error_count == ERROR_COUNT,
+		     "error count mismatch");
+
+	for (size_t i = 0; i < ERROR_COUNT; i++)
+		rdesc_assert(expected.errors[i][0] == error_spans[i][0] &&
+			     expected.errors[i][1] == error_spans[i][1],
+			     "error span mismatch");
+
+	/* Without recovery, the first broken statement ends the stream. */
+	unwrap(rdesc_recover(&p, NULL, 0));
+	rdesc_reset(&p);
+
+	unwrap(rdesc_stream(&p, NT_STMT, consume, &unrecovered));
+
+	enum rdesc_result res = RDESC_CONTINUE;
+
+	for (size_t i = 0; i < TOKEN_COUNT && res == RDESC_CONTINUE; i++)
+		res = rdesc_pump(&p, tks[i], &seminfos[i]);
+
+	rdesc_assert(res == RDESC_NOMATCH && unrecovered.statements == 1,
+		     "broken statement is matched without recovery");
+
+	rdesc_destroy(&p);
+
+	/* Memoized parser pumping in batches matches the same CSTs. */
+	unwrap(rdesc_init(&memoized, &grammar, sizeof(size_t), NULL));
+	unwrap(rdesc_memoize(&memoized, 1 << 16));
+	unwrap(rdesc_recover(&memoized, syncs,
+			     sizeof(syncs) / sizeof(syncs[0])));
+
+	parse_batches(&memoized);
+
+	rdesc_assert(streamed.statements == STATEMENT_COUNT,
+		     "streamed statement count mismatch");
+	assert_same_digest(&streamed.cst, &expected.cst);
+
+	rdesc_destroy(&memoized);
+	rdesc_grammar_destroy(&grammar);
+}
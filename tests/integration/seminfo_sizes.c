@@ -0,0 +1,204 @@
+/* Stream random statements to a memoizing parser whose tokens have their own
+ * seminfo sizes, detach the CSTs with memory errors injected, and expect the
+ * seminfo of each token to survive restarts and detaching, and every token to
+ * be destroyed once. */
+
+#include "../../include/cst_macros.h"
+#include "../../include/grammar.h"
+#include "../../include/rdesc.h"
+#include "../../src/common.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define TEST_INSTRUMENTS
+
+#include "../../examples/grammar/bc.h"
+#include "../../src/test_instruments.h"
+#include "../lib/bc_fuzzer.c"
+
+
+#define STREAM_LENGTH 8192
+#define MAX_TOKENS 64
+#define MAX_BATCH 16
+#define MAX_STATEMENTS STREAM_LENGTH
+
+#define MEMORY_LIMIT (1 << 16)
+
+
+/* Token ids cycle through sizes of 0, 1 and sizeof(size_t) bytes. */
+static size_t sizes[BC_TK_COUNT];
+
+static uint16_t tks[STREAM_LENGTH];
+static size_t seminfos[STREAM_LENGTH];
+static size_t token_count;
+
+static size_t expected_destroyed[BC_TK_COUNT], destroyed[BC_TK_COUNT];
+static unsigned destroyed_by_index[STREAM_LENGTH];
+
+static struct rdesc_cst csts[MAX_STATEMENTS];
+static size_t cst_count;
+
+/* Tape position of the next token of the walked CSTs. */
+static size_t walked;
+
+
+/* Seminfo holds the stream index of the token, cut to the token's size. */
+static void check_seminfo(uint16_t id, const void *seminfo, size_t i)
+{
+	rdesc_assert(tks[i] == id, "token id mismatch");
+	rdesc_assert(memcmp(seminfo, &seminfos[i], sizes[id]) == 0,
+		     "seminfo mismatch");
+}
+
+static void token_destroyer(uint16_t id, void *seminfo)
+{
+	destroyed[id]++;
+
+	if (sizes[id] == sizeof(size_t)) {
+		size_t i;
+
+		memcpy(&i, seminfo, sizeof(size_t));
+		check_seminfo(id, seminfo, i);
+
+		rdesc_assert(destroyed_by_index[i]++ == 0,
+			     "token destroyed twice");
+	}
+}
+
+static void walk(struct rdesc *p, struct rdesc_node *n)
+{
+	if (rtype(n) == RDESC_TOKEN) {
+		check_seminfo(rid(n), rseminfo(p, n), walked++);
+
+		return;
+	}
+
+	for (uint16_t i = 0; i < rchild_count(n); i++)
+		walk(p, rchild(p, n, i));
+}
+
+static void walk_cst(const struct rdesc_cst *cst, struct rdesc_node *n)
+{
+	if (rtype(n) == RDESC_TOKEN) {
+		check_seminfo(rid(n), rcst_seminfo(cst, n), walked++);
+
+		return;
+	}
+
+	for (uint16_t i = 0; i < rchild_count(n); i++)
+		walk_cst(cst, rcst_child(cst, n, i));
+}
+
+/* Checks the tree in the parser and moves it out, retrying failed
+ * allocations. */
+static void consume(struct rdesc *p, struct rdesc_node *root, void *ctx)
+{
+	(void) ctx;
+
+	walk(p, root);
+
+	if (rand() % 4 == 0)
+		malloc_fail_at = rand() % 4;
+
+	while (rdesc_take_cst(p, &csts[cst_count]))
+		;
+
+	malloc_fail_at = -1;
+
+	cst_count++;
+}
+
+static void generate_stream(void)
+{
+	token_count = bc_fuzzer_stream(tks, STREAM_LENGTH, MAX_TOKENS, NULL);
+
+	for (size_t i = 0; i < token_count; i++) {
+		seminfos[i] = i;
+		expected_destroyed[tks[i]]++;
+	}
+}
+
+static void parse_stream(struct rdesc *p)
+{
+	size_t cur = 0;
+
+	unwrap(rdesc_stream(p, NT_STMT, consume, NULL));
+
+	while (cur < token_count) {
+		size_t n = rand() % (MAX_BATCH + 1), consumed;
+		enum rdesc_result res;
+
+		if (n > token_count - cur)
+			n = token_count - cur;
+
+		if (rand() % 4 == 0)
+			multipush_fail_at = rand() % 8;
+		if (rand() % 8 == 0)
+			realloc_fail_at = rand() % 4;
+
+		res = rdesc_pump_many(p, &tks[cur], &seminfos[cur], n,
+				      &consumed);
+
+		multipush_fail_at = realloc_fail_at = -1;
+
+		rdesc_assert(res == RDESC_CONTINUE || res == RDESC_ENOMEM,
+			     "stream is interrupted");
+
+		cur += consumed;
+	}
+
+	/* Retry the last statement if its restart failed. */
+	while (rdesc_resume(p) == RDESC_ENOMEM)
+		;
+}
+
+
+int main(void)
+{
+	srand(time(NULL));
+
+	struct rdesc_grammar grammar;
+	struct rdesc p;
+
+	for (uint16_t id = 0; id < BC_TK_COUNT; id++)
+		sizes[id] = id % 3 == 0 ? 0 : id % 3 == 1 ? 1 : sizeof(size_t);
+
+	generate_stream();
+
+	unwrap(rdesc_grammar_init(&grammar,
+				  BC_NT_COUNT, BC_NT_VARIANT_COUNT, BC_NT_BODY_LENGTH,
+				  (struct rdesc_grammar_symbol *) bc));
+
+	unwrap(rdesc_init(&p, &grammar, sizeof(size_t), token_destroyer));
+	unwrap(rdesc_memoize(&p, MEMORY_LIMIT));
+	unwrap(rdesc_seminfo_sizes(&p, sizes));
+
+	parse_stream(&p);
+
+	rdesc_assert(walked == token_count, "stream is not parsed completely");
+
+	walked = 0;
+
+	for (size_t i = 0; i < cst_count; i++) {
+		walk_cst(&csts[i], rdesc_cst_root(&csts[i]));
+		rdesc_cst_destroy(&csts[i]);
+	}
+
+	rdesc_assert(walked == token_count, "detached trees lost tokens");
+
+	for (uint16_t id = 0; id < BC_TK_COUNT; id++)
+		rdesc_assert(destroyed[id] == expected_destroyed[id],
+			     "token destroy count mismatch");
+
+	/* Tokens get the parser's seminfo size again. */
+	rdesc_reset(&p);
+	unwrap(rdesc_seminfo_sizes(&p, NULL));
+	rdesc_assert(p.seminfos == NULL, "packed seminfo is not released");
+
+	rdesc_destroy(&p);
+	rdesc_grammar_destroy(&grammar);
+}
@@ -0,0 +1,310 @@
+/* Initialize a grammar from dense rules and from the same rules in sparse
+ * form, and expect the same tables, the same CSTs, and rdesc_dump_sparse to
+ * convert the dense rules into the sparse ones. Sparse rules without cuts are
+ * expected to be used in place, and malformed rules and every allocation
+ * failure during the initialization to be reported. */
+
+#include "../../include/cst_macros.h"
+#include "../../include/grammar.h"
+#include "../../include/rdesc.h"
+#include "../../include/rule_macros.h"
+#include "../../include/util.h"
+#include "../../src/common.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define TEST_INSTRUMENTS
+
+#include "../../src/test_instruments.h"
+#include "../lib/cst_compare.c"
+
+
+#define LET_NT_COUNT 3
+#define LET_NT_VARIANT_COUNT 3
+#define LET_NT_BODY_LENGTH 7
+
+#define DUMP_LENGTH 1024
+
+enum let_tk {
+	TK_NOTOKEN,
+	TK_NUM, TK_IDENT, TK_PLUS, TK_LET, TK_EQ, TK_SEMI,
+};
+
+enum let_nt {
+	NT_STMT, NT_EXPR, NT_ATOM,
+};
+
+static const struct rdesc_grammar_symbol
+dense[LET_NT_COUNT][LET_NT_VARIANT_COUNT][LET_NT_BODY_LENGTH] = {
+	/* <stmt> ::= */ r(
+		TK(LET), CUT, TK(IDENT), TK(EQ), NT(EXPR), TK(SEMI)
+	alt	NT(EXPR), TK(SEMI)
+	),
+	/* <expr> ::= */ r(
+		NT(EXPR), TK(PLUS), NT(ATOM)
+	alt	NT(ATOM)
+	),
+	/* <atom> ::= */ r(
+		TK(NUM)
+	alt	TK(IDENT)
+	),
+};
+
+#define SNT(nt) (RDESC_SYMBOL_NONTERMINAL | NT_ ## nt)
+
+static const uint32_t sparse_variants[] = { 0, 2, 4, 6 };
+
+static const uint32_t sparse_bodies[] = { 0, 6, 8, 11, 12, 13, 14 };
+
+static const uint16_t sparse_symbols[] = {
+	TK_LET, RDESC_SYMBOL_CUT, TK_IDENT, TK_EQ, SNT(EXPR), TK_SEMI,
+	SNT(EXPR), TK_SEMI,
+	SNT(EXPR), TK_PLUS, SNT(ATOM),
+	SNT(ATOM),
+	TK_NUM,
+	TK_IDENT,
+};
+
+/* Malformed rules: an out of range nonterminal, two cuts in a body, and a
+ * body ending before it starts. */
+static const uint32_t bad_bodies[] = { 0, 2, 1 };
+
+static const uint16_t bad_symbols[] = {
+	SNT(ATOM), TK_NUM,
+};
+
+static const uint16_t two_cuts[] = {
+	TK_LET, RDESC_SYMBOL_CUT, TK_IDENT, RDESC_SYMBOL_CUT,
+};
+
+static const struct rdesc_grammar_symbol
+dense_two_cuts[1][2][6] = {
+	r(TK(LET), CUT, TK(IDENT), CUT, TK(SEMI)),
+};
+
+static const char *const expected_dump =
+	"/* Generated by rdesc_dump_sparse, do not edit. */\n"
+	"\n"
+	"#include \"grammar.h\"\n"
+	"\n"
+	"#include <stdint.h>\n"
+	"\n"
+	"\n"
+	"static const uint32_t let_variants[4] = {\n"
+	"\t0, 2, 4, 6,\n"
+	"};\n"
+	"\n"
+	"static const uint32_t let_bodies[7] = {\n"
+	"\t0, 6, 8, 11, 12, 13, 14,\n"
+	"};\n"
+	"\n"
+	"static const uint16_t let_symbols[14] = {\n"
+	"\t/* 0 */\n"
+	"\t 4, RDESC_SYMBOL_CUT, 2, 5, RDESC_SYMBOL_NONTERMINAL | 1, 6,\n"
+	"\t RDESC_SYMBOL_NONTERMINAL | 1, 6,\n"
+	"\t/* 1 */\n"
+	"\t RDESC_SYMBOL_NONTERMINAL | 1, 3, RDESC_SYMBOL_NONTERMINAL | 2,\n"
+	"\t RDESC_SYMBOL_NONTERMINAL | 2,\n"
+	"\t/* 2 */\n"
+	"\t 1,\n"
+	"\t 2,\n"
+	"};\n"
+	"\n";
+
+/* let x = 1 + y + 2; x; let 1 */
+static const uint16_t tks[] = {
+	TK_LET, TK_IDENT, TK_EQ, TK_NUM, TK_PLUS, TK_IDENT, TK_PLUS, TK_NUM,
+	TK_SEMI,
+	TK_IDENT, TK_SEMI,
+	TK_LET, TK_NUM,
+};
+
+#define TOKEN_COUNT (sizeof(tks) / sizeof(tks[0]))
+
+
+static void assert_same_tables(const struct rdesc_grammar *a,
+			       const struct rdesc_grammar *b)
+{
+	size_t rows = row_count(*a);
+	size_t body_count = a->variants[a->nt_count];
+
+	rdesc_assert(a->nt_count == b->nt_count && a->tk_count == b->tk_count,
+		     "grammar dimensions differ");
+	rdesc_assert(row_count(*b) == rows &&
+		     memcmp(a->variants, b->variants,
+			    (a->nt_count + 1) * sizeof(uint32_t)) == 0 &&
+		     memcmp(a->bodies, b->bodies,
+			    (body_count + 1) * sizeof(uint32_t)) == 0 &&
+		     memcmp(a->symbols, b->symbols,
+			    a->bodies[body_count] * sizeof(uint16_t)) == 0,
+		     "rules differ");
+	rdesc_assert(memcmp(a->child_caps, b->child_caps,
+			    a->nt_count * sizeof(uint16_t)) == 0 &&
+		     memcmp(a->variant_child_caps, b->variant_child_caps,
+			    rows * sizeof(uint16_t)) == 0,
+		     "child capacities differ");
+	rdesc_assert(memcmp(a->first_sets, b->first_sets,
+			    rows * ((a->tk_count + 7) / 8)) == 0 &&
+		     a->grow_sets != NULL && b->grow_sets != NULL &&
+		     memcmp(a->grow_sets, b->grow_sets,
+			    rows * ((a->tk_count + 7) / 8)) == 0,
+		     "FIRST sets differ");
+	rdesc_assert(a->cuts != NULL && b->cuts != NULL &&
+		     memcmp(a->cuts, b->cuts, rows * sizeof(uint16_t)) == 0 &&
+		     cut_of(*a, NT_STMT, 0) == 1,
+		     "cuts differ");
+}
+
+/* Pumps the statements with both parsers, the last one fails after its
+ * cut. */
+static void assert_same_parse(const struct rdesc_grammar *a,
+			      const struct rdesc_grammar *b)
+{
+	struct rdesc p, q;
+	size_t cur = 0, consumed;
+
+	unwrap(rdesc_init(&p, a, 0, NULL));
+	unwrap(rdesc_init(&q, b, 0, NULL));
+
+	for (int statement = 0; statement < 3; statement++) {
+		enum rdesc_result res;
+
+		unwrap(rdesc_start(&p, NT_STMT));
+		unwrap(rdesc_start(&q, NT_STMT));
+
+		res = rdesc_pump_many(&p, &tks[cur], NULL, TOKEN_COUNT - cur,
+				      &consumed);
+		rdesc_assert(rdesc_pump_many(&q, &tks[cur], NULL,
+					     TOKEN_COUNT - cur, &consumed) ==
+			     res, "result mismatch");
+
+		cur += consumed;
+
+		if (statement == 2) {
+			rdesc_assert(res == RDESC_NOMATCH,
+				     "statement is matched past the cut");
+
+			break;
+		}
+
+		rdesc_assert(res == RDESC_READY, "statement is not matched");
+		assert_same_cst(&p, rdesc_root(&p), &q, rdesc_root(&q), 0);
+
+		rdesc_reset(&p);
+		rdesc_reset(&q);
+	}
+
+	rdesc_destroy(&p);
+	rdesc_destroy(&q);
+}
+
+static void assert_dump(const struct rdesc_grammar *grammar)
+{
+	char dump[DUMP_LENGTH];
+	FILE *out = tmpfile();
+	size_t len;
+
+	rdesc_assert(out != NULL, "could not open a temporary file");
+
+	rdesc_dump_sparse(out, grammar, "let");
+	rewind(out);
+
+	len = fread(dump, 1, DUMP_LENGTH - 1, out);
+	dump[len] = '\0';
+	fclose(out);
+
+	rdesc_assert(strcmp(dump, expected_dump) == 0,
+		     "dump mismatch:\n%s", dump);
+}
+
+
+int main(void)
+{
+	struct rdesc_grammar from_dense, from_sparse, in_place;
+
+	unwrap(rdesc_grammar_init(&from_dense, LET_NT_COUNT,
+				  LET_NT_VARIANT_COUNT, LET_NT_BODY_LENGTH,
+				  (struct rdesc_grammar_symbol *) dense));
+	unwrap(rdesc_grammar_init_sparse(&from_sparse, LET_NT_COUNT,
+					 sparse_variants, sparse_bodies,
+					 sparse_symbols));
+
+	rdesc_assert(from_dense.rules ==
+		     (const struct rdesc_grammar_symbol *) dense &&
+		     from_dense.nt_variant_count == LET_NT_VARIANT_COUNT &&
+		     from_dense.nt_body_length == LET_NT_BODY_LENGTH &&
+		     from_sparse.rules == NULL,
+		     "dense rules are not kept");
+
+	assert_same_tables(&from_dense, &from_sparse);
+	assert_same_parse(&from_dense, &from_sparse);
+	assert_dump(&from_dense);
+
+	/* The stripped rules do not contain cuts, they are not copied. */
+	unwrap(rdesc_grammar_init_sparse(&in_place, from_dense.nt_count,
+					 from_dense.variants, from_dense.bodies,
+					 from_dense.symbols));
+
+	rdesc_assert(!in_place.owns_rules && in_place.cuts == NULL &&
+		     in_place.symbols == from_dense.symbols,
+		     "rules without cuts are copied");
+
+	rdesc_grammar_destroy(&in_place);
+
+	rdesc_assert(rdesc_grammar_init_sparse(&in_place, 2,
+					       (uint32_t []) { 0, 1, 1 },
+					       (uint32_t []) { 0, 2 },
+					       bad_symbols) == 1,
+		     "out of range nonterminal is accepted");
+	rdesc_assert(rdesc_grammar_init_sparse(&in_place, 1,
+					       (uint32_t []) { 0, 1 },
+					       (uint32_t []) { 0, 4 },
+					       two_cuts) == 1,
+		     "two cuts in a body are accepted");
+	rdesc_assert(rdesc_grammar_init_sparse(&in_place, 1,
+					       (uint32_t []) { 0, 2 },
+					       bad_bodies, bad_symbols) == 1,
+		     "decreasing body offsets are accepted");
+	rdesc_assert(rdesc_grammar_init_sparse(&in_place,
+					       RDESC_NONTERMINAL_COUNT_MAX + 1,
+					       sparse_variants, sparse_bodies,
+					       sparse_symbols) == 1,
+		     "nonterminal id of the cut is accepted");
+	rdesc_assert(rdesc_grammar_init(&in_place, 1, 2, 6,
+					(struct rdesc_grammar_symbol *)
+					dense_two_cuts) == 1,
+		     "two cuts in a dense body are accepted");
+
+	/* Every allocation of both initializations may fail, the grammar is
+	 * destroyed if one does. */
+	for (int i = 0;; i++) {
+		malloc_fail_at = i;
+
+		if (!rdesc_grammar_init(&in_place, LET_NT_COUNT,
+					LET_NT_VARIANT_COUNT,
+					LET_NT_BODY_LENGTH,
+					(struct rdesc_grammar_symbol *) dense))
+			break;
+	}
+
+	rdesc_grammar_destroy(&in_place);
+
+	for (int i = 0;; i++) {
+		malloc_fail_at = i;
+
+		if (!rdesc_grammar_init_sparse(&in_place, LET_NT_COUNT,
+					       sparse_variants, sparse_bodies,
+					       sparse_symbols))
+			break;
+	}
+
+	malloc_fail_at = -1;
+
+	rdesc_grammar_destroy(&in_place);
+	rdesc_grammar_destroy(&from_dense);
+	rdesc_grammar_destroy(&from_sparse);
+}
@@ -0,0 +1,105 @@
+/* Parse with the constant grammar generated by rdesc_dump_grammar and with the
+ * grammar initialized at runtime from the same rules, and expect identical
+ * tables, results and CSTs. */
+
+#include "../../include/cst_macros.h"
+#include "../../include/grammar.h"
+#include "../../include/rdesc.h"
+#include "../../src/common.h"
+
+#include "../../examples/grammar/boolean_algebra.h"
+
+#include "../lib/cst_compare.c"
+
+#include "balg_grammar.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+
+/* { x, y = f((a = 1), !b) | y & 0; ; } */
+static const uint16_t tks[] = {
+	TK_LCURLY,
+	TK_IDENT, TK_COMMA, TK_IDENT, TK_EQ,
+	TK_IDENT, TK_LPAREN,
+	TK_LPAREN, TK_IDENT, TK_EQ, TK_TRUE, TK_RPAREN, TK_COMMA,
+	TK_EXCL, TK_IDENT,
+	TK_RPAREN, TK_PIPE, TK_IDENT, TK_AMP, TK_FALSE, TK_SEMI,
+	TK_SEMI,
+	TK_RCURLY,
+};
+
+#define TOKEN_COUNT (sizeof(tks) / sizeof(tks[0]))
+
+
+static int same_table(const void *a, const void *b, size_t size)
+{
+	if (a == NULL || b == NULL)
+		return a == b;
+
+	return memcmp(a, b, size) == 0;
+}
+
+static void assert_same_tables(const struct rdesc_grammar *a,
+			       const struct rdesc_grammar *b)
+{
+	size_t rows = row_count(*a);
+	size_t body_count = a->variants[a->nt_count];
+	size_t set_size = rows * ((a->tk_count + 7) / 8);
+
+	rdesc_assert(a->nt_count == b->nt_count && a->tk_count == b->tk_count,
+		     "grammar dimensions differ");
+	rdesc_assert(memcmp(a->variants, b->variants,
+			    (a->nt_count + 1) * sizeof(uint32_t)) == 0 &&
+		     memcmp(a->bodies, b->bodies,
+			    (body_count + 1) * sizeof(uint32_t)) == 0 &&
+		     memcmp(a->symbols, b->symbols,
+			    a->bodies[body_count] * sizeof(uint16_t)) == 0,
+		     "rules differ");
+	rdesc_assert(memcmp(a->child_caps, b->child_caps,
+			    a->nt_count * sizeof(uint16_t)) == 0 &&
+		     memcmp(a->variant_child_caps, b->variant_child_caps,
+			    rows * sizeof(uint16_t)) == 0,
+		     "child capacities differ");
+	rdesc_assert(memcmp(a->first_sets, b->first_sets, set_size) == 0 &&
+		     same_table(a->grow_sets, b->grow_sets, set_size),
+		     "FIRST sets differ");
+	rdesc_assert(same_table(a->cuts, b->cuts, rows * sizeof(uint16_t)),
+		     "cuts differ");
+}
+
+
+int main(void)
+{
+	struct rdesc_grammar grammar;
+	struct rdesc interpreted, constant;
+	size_t consumed;
+
+	unwrap(rdesc_grammar_init(&grammar,
+				  BALG_NT_COUNT, BALG_NT_VARIANT_COUNT,
+				  BALG_NT_BODY_LENGTH,
+				  (struct rdesc_grammar_symbol *) balg));
+
+	assert_same_tables(&grammar, balg_grammar);
+
+	unwrap(rdesc_init(&interpreted, &grammar, 0, NULL));
+	unwrap(rdesc_init(&constant, balg_grammar, 0, NULL));
+
+	unwrap(rdesc_start(&interpreted, NT_STMT));
+	unwrap(rdesc_start(&constant, NT_STMT));
+
+	rdesc_assert(rdesc_pump_many(&interpreted, tks, NULL, TOKEN_COUNT,
+				     &consumed) == RDESC_READY &&
+		     rdesc_pump_many(&constant, tks, NULL, TOKEN_COUNT,
+				     &consumed) == RDESC_READY &&
+		     consumed == TOKEN_COUNT,
+		     "statement is not matched");
+
+	assert_same_cst(&interpreted, rdesc_root(&interpreted),
+			&constant, rdesc_root(&constant), 0);
+
+	rdesc_destroy(&interpreted);
+	rdesc_destroy(&constant);
+	rdesc_grammar_destroy(&grammar);
+}
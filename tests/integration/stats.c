@@ -0,0 +1,73 @@
+/* Pass an ambiguous call and expect the backtracking to be counted, and the
+ * counters to accumulate across matches and survive the reset. */
+
+#include "../../include/grammar.h"
+#include "../../include/rdesc.h"
+#include "../../src/common.h"
+
+#include "../../examples/grammar/boolean_algebra.h"
+
+#include <stdint.h>
+
+
+static const uint16_t call[] = {
+	TK_IDENT, TK_LPAREN, TK_LPAREN, TK_IDENT, TK_EQ, TK_IDENT, TK_RPAREN,
+	TK_RPAREN,
+};
+
+#define CALL_LENGTH (sizeof(call) / sizeof(call[0]))
+
+
+/* Pumps the call, which stays unfinished. */
+static void pump_call(struct rdesc *p)
+{
+	unwrap(rdesc_start(p, NT_STMT));
+
+	for (size_t i = 0; i < CALL_LENGTH; i++)
+		rdesc_assert(rdesc_pump(p, call[i], NULL) == RDESC_CONTINUE,
+			     "call is not matched");
+}
+
+
+int main(void)
+{
+	struct rdesc_grammar grammar;
+	struct rdesc_stats first, second, after_reset;
+	struct rdesc p;
+
+	unwrap(rdesc_grammar_init(&grammar,
+				  BALG_NT_COUNT, BALG_NT_VARIANT_COUNT, BALG_NT_BODY_LENGTH,
+				  cast(struct rdesc_grammar_symbol *, balg)));
+	unwrap(rdesc_init(&p, &grammar, sizeof(uint32_t), NULL));
+
+	rdesc_read_stats(&p, &first);
+	rdesc_assert(first.backtracks == 0 && first.rewound_tokens == 0,
+		     "counters should start at zero");
+
+	pump_call(&p);
+
+	rdesc_read_stats(&p, &first);
+	rdesc_assert(first.backtracks > 0 && first.rewound_tokens > 0,
+		     "ambiguous call should be backtracked");
+
+	rdesc_assert(rdesc_pump(&p, TK_RPAREN, NULL) == RDESC_NOMATCH,);
+	rdesc_reset(&p);
+
+	rdesc_read_stats(&p, &after_reset);
+	rdesc_assert(after_reset.backtracks >= first.backtracks &&
+		     after_reset.rewound_tokens >= first.rewound_tokens,
+		     "reset should keep the counters");
+
+	/* The same call backtracks the same way again. */
+	pump_call(&p);
+
+	rdesc_read_stats(&p, &second);
+	rdesc_assert(second.backtracks - after_reset.backtracks ==
+		     first.backtracks &&
+		     second.rewound_tokens - after_reset.rewound_tokens ==
+		     first.rewound_tokens,
+		     "counters should accumulate across matches");
+
+	rdesc_destroy(&p);
+	rdesc_grammar_destroy(&grammar);
+}
@@ -0,0 +1,159 @@
+/* Parse a stream of statements in streaming mode, in random batches
+ * interrupted by memory errors, and expect the same CSTs as starting the
+ * parser for each statement. */
+
+#include "../../include/cst_macros.h"
+#include "../../include/grammar.h"
+#include "../../include/rdesc.h"
+#include "../../src/common.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define TEST_INSTRUMENTS
+
+#include "../../examples/grammar/bc.h"
+#include "../../src/test_instruments.h"
+#include "../lib/bc_fuzzer.c"
+
+
+#define STREAM_LENGTH 8192
+#define MAX_TOKENS 64
+#define MAX_BATCH 16
+
+/* Each node is flattened into three words. */
+#define DIGEST_LENGTH (STREAM_LENGTH * 64)
+
+#include "../lib/cst_digest.c"
+
+
+static uint16_t tks[STREAM_LENGTH];
+static size_t seminfos[STREAM_LENGTH];
+static size_t token_count, statement_count;
+
+struct digest {
+	struct cst_digest cst;
+	size_t statements;
+};
+
+static struct digest expected, streamed;
+
+
+static void consume(struct rdesc *p, struct rdesc_node *root, void *ctx)
+{
+	struct digest *d = ctx;
+
+	digest_flatten(p, root, &d->cst);
+	d->statements++;
+}
+
+/* Valid statements, one after another. */
+static void generate_stream(void)
+{
+	token_count = bc_fuzzer_stream(tks, STREAM_LENGTH, MAX_TOKENS,
+				       &statement_count);
+
+	for (size_t i = 0; i < token_count; i++)
+		seminfos[i] = i;
+}
+
+static void parse_statements(struct rdesc *p)
+{
+	size_t cur = 0;
+
+	while (cur < token_count) {
+		enum rdesc_result res;
+
+		unwrap(rdesc_start(p, NT_STMT));
+
+		do {
+			res = rdesc_pump(p, tks[cur], &seminfos[cur]);
+			cur++;
+		} while (res == RDESC_CONTINUE);
+
+		rdesc_assert(res == RDESC_READY, "could not match grammar");
+
+		consume(p, rdesc_root(p), &expected);
+	}
+}
+
+static void parse_stream(struct rdesc *p)
+{
+	size_t cur = 0;
+
+	unwrap(rdesc_stream(p, NT_STMT, consume, &streamed));
+
+	while (cur < token_count) {
+		size_t n = rand() % (MAX_BATCH + 1), consumed;
+		enum rdesc_result res;
+
+		if (n > token_count - cur)
+			n = token_count - cur;
+
+		if (rand() % 4 == 0)
+			multipush_fail_at = rand() % 8;
+		if (rand() % 8 == 0)
+			realloc_fail_at = rand() % 4;
+
+		res = rdesc_pump_many(p, &tks[cur], &seminfos[cur], n,
+				      &consumed);
+
+		multipush_fail_at = realloc_fail_at = -1;
+
+		rdesc_assert(res == RDESC_CONTINUE || res == RDESC_ENOMEM,
+			     "stream is interrupted");
+		rdesc_assert(res != RDESC_CONTINUE || consumed == n,
+			     "batch is not consumed completely");
+
+		cur += consumed;
+	}
+
+	/* Retry the last statement if its restart failed. */
+	while (rdesc_resume(p) == RDESC_ENOMEM)
+		;
+}
+
+
+int main(void)
+{
+	srand(time(NULL));
+
+	struct rdesc_grammar grammar;
+	struct rdesc p;
+
+	generate_stream();
+
+	unwrap(rdesc_grammar_init(&grammar,
+				  BC_NT_COUNT, BC_NT_VARIANT_COUNT, BC_NT_BODY_LENGTH,
+				  (struct rdesc_grammar_symbol *) bc));
+
+	unwrap(rdesc_init(&p, &grammar, sizeof(size_t), NULL));
+
+	parse_statements(&p);
+	rdesc_reset(&p);
+
+	parse_stream(&p);
+
+	rdesc_assert(expected.statements == statement_count,
+		     "statement count mismatch");
+	rdesc_assert(streamed.statements == statement_count,
+		     "streamed statement count mismatch");
+	assert_same_digest(&streamed.cst, &expected.cst);
+
+	/* A statement cannot start with a closing parenthesis, no match ends
+	 * the stream. */
+	size_t seminfo = 0;
+
+	rdesc_assert(rdesc_pump(&p, TK_RPAREN, &seminfo) == RDESC_NOMATCH,
+		     "stream is not ended");
+	rdesc_assert(p.consumer == NULL, "consumer is not cleared");
+	rdesc_assert(streamed.statements == statement_count,
+		     "unexpected statement");
+
+	rdesc_reset(&p);
+
+	rdesc_destroy(&p);
+	rdesc_grammar_destroy(&grammar);
+}
@@ -0,0 +1,210 @@
+/* Detach CSTs from the parser after each match and in the consumer of a
+ * stream, walk them after the whole input is parsed, and expect the trees the
+ * parser had and every token to be destroyed once. */
+
+#include "../../include/cst_macros.h"
+#include "../../include/grammar.h"
+#include "../../include/rdesc.h"
+#include "../../include/rule_macros.h"
+#include "../../src/common.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define TEST_INSTRUMENTS
+
+#include "../../src/test_instruments.h"
+
+
+#define NT_COUNT 2
+#define NT_VARIANT_COUNT 3
+#define NT_BODY_LENGTH 4
+
+#define STATEMENT_COUNT 256
+#define MAX_LIST_LENGTH 8
+#define STREAM_LENGTH (STATEMENT_COUNT * MAX_LIST_LENGTH * 2 + 1)
+
+/* Each node is flattened into three words. */
+#define DIGEST_LENGTH (STREAM_LENGTH * 8)
+
+#include "../lib/cst_digest.c"
+
+enum tk {
+	TK_NOTOKEN,
+	TK_NUM, TK_COMMA, TK_END,
+};
+
+enum nt {
+	NT_LIST, NT_LIST_REST,
+};
+
+/* A list ends at the first token that is not a comma, which is the lookahead
+ * left in the parser. */
+static const struct rdesc_grammar_symbol
+list[NT_COUNT][NT_VARIANT_COUNT][NT_BODY_LENGTH] = {
+	/* <list> ::= */ r(
+		TK(NUM), NT(LIST_REST)
+	),
+	/* <list_rest> ::= */ r(
+		TK(COMMA), TK(NUM), NT(LIST_REST)
+	alt	EPSILON
+	),
+};
+
+
+static uint16_t tks[STREAM_LENGTH];
+static size_t seminfos[STREAM_LENGTH];
+static size_t token_count;
+
+static unsigned destroyed[STREAM_LENGTH];
+
+static struct cst_digest expected, detached;
+
+static struct rdesc_cst csts[STATEMENT_COUNT];
+static size_t cst_count;
+
+
+static void token_destroyer(uint16_t id, void *seminfo)
+{
+	size_t i;
+
+	memcpy(&i, seminfo, sizeof(i));
+
+	rdesc_assert(tks[i] == id, "token id mismatch");
+	rdesc_assert(destroyed[i]++ == 0, "token destroyed twice");
+}
+
+static void generate_stream(void)
+{
+	for (int s = 0; s < STATEMENT_COUNT; s++) {
+		int len = 1 + rand() % MAX_LIST_LENGTH;
+
+		tks[token_count++] = TK_NUM;
+
+		for (int i = 1; i < len; i++) {
+			tks[token_count++] = TK_COMMA;
+			tks[token_count++] = TK_NUM;
+		}
+	}
+
+	/* Ends the last list, and is left in the parser. */
+	tks[token_count++] = TK_END;
+
+	for (size_t i = 0; i < token_count; i++)
+		seminfos[i] = i;
+}
+
+/* Records the tree in the parser and moves it out, retrying failed
+ * allocations. */
+static void take(struct rdesc *p)
+{
+	digest_flatten(p, rdesc_root(p), &expected);
+
+	if (rand() % 4 == 0)
+		malloc_fail_at = rand() % 3;
+
+	while (rdesc_take_cst(p, &csts[cst_count]))
+		rdesc_assert(rdesc_root(p) != NULL,
+			     "failed take changed the parser");
+
+	malloc_fail_at = -1;
+
+	rdesc_assert(rdesc_root(p) == NULL, "parser kept the CST");
+
+	cst_count++;
+}
+
+static void consume(struct rdesc *p, struct rdesc_node *root, void *ctx)
+{
+	(void) root;
+	(void) ctx;
+
+	take(p);
+}
+
+static void parse_statements(struct rdesc *p)
+{
+	size_t cur = 0;
+
+	while (cur < token_count) {
+		enum rdesc_result res;
+
+		unwrap(rdesc_start(p, NT_LIST));
+
+		do {
+			res = rdesc_pump(p, tks[cur], &seminfos[cur]);
+			cur++;
+		} while (res == RDESC_CONTINUE && cur < token_count);
+
+		rdesc_assert(res == RDESC_READY, "could not match grammar");
+
+		take(p);
+	}
+}
+
+static void parse_stream(struct rdesc *p)
+{
+	size_t consumed;
+
+	unwrap(rdesc_stream(p, NT_LIST, consume, NULL));
+
+	rdesc_assert(rdesc_pump_many(p, tks, seminfos, token_count,
+				     &consumed) == RDESC_NOMATCH,
+		     "end token is not rejected");
+	rdesc_assert(consumed == token_count, "stream is not consumed");
+}
+
+/* Compares the detached trees with the recorded ones, and destroys them. */
+static void check(struct rdesc *p)
+{
+	rdesc_assert(cst_count == STATEMENT_COUNT, "statement count mismatch");
+
+	for (size_t i = 0; i < cst_count; i++) {
+		digest_flatten_taken(&csts[i], rdesc_cst_root(&csts[i]),
+				     &detached);
+		rdesc_cst_destroy(&csts[i]);
+	}
+
+	assert_same_digest(&detached, &expected);
+
+	/* The end token is left in the parser. */
+	rdesc_assert(destroyed[token_count - 1] == 0, "end token destroyed");
+	rdesc_reset(p);
+
+	for (size_t i = 0; i < token_count; i++) {
+		rdesc_assert(destroyed[i] == 1, "token is not destroyed");
+
+		destroyed[i] = 0;
+	}
+
+	expected.len = detached.len = cst_count = 0;
+}
+
+
+int main(void)
+{
+	srand(time(NULL));
+
+	struct rdesc_grammar grammar;
+	struct rdesc p;
+
+	generate_stream();
+
+	unwrap(rdesc_grammar_init(&grammar,
+				  NT_COUNT, NT_VARIANT_COUNT, NT_BODY_LENGTH,
+				  (struct rdesc_grammar_symbol *) list));
+
+	unwrap(rdesc_init(&p, &grammar, sizeof(size_t), token_destroyer));
+
+	parse_statements(&p);
+	check(&p);
+
+	parse_stream(&p);
+	check(&p);
+
+	rdesc_destroy(&p);
+	rdesc_grammar_destroy(&grammar);
+}
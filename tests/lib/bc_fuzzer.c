@@ -2,6 +2,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
 
 
@@ -98,3 +99,49 @@ enum bc_tk bc_fuzzer_next_tk(struct bc_grammar_generator *g)
 
 	return out;
 }
+
+/* Writes a random statement ending with TK_ENDSYM to `tks`, and returns its
+ * length. Statements longer than `max` tokens are dropped, 0 is returned. */
+size_t bc_fuzzer_statement(uint16_t *tks, size_t max)
+{
+	struct bc_grammar_generator g = BC_DEFAULT_GENERATOR;
+	size_t len = 0;
+	uint16_t tk;
+
+	while ((tk = bc_fuzzer_next_tk(&g)) != TK_ENDSYM && len < max - 1) {
+		g.group_start_p *= 0.9;
+
+		tks[len++] = tk;
+	}
+
+	if (tk != TK_ENDSYM)
+		return 0;
+
+	tks[len++] = TK_ENDSYM;
+
+	return len;
+}
+
+/* Fills `tks` with statements of at most `max` tokens while another one fits
+ * in `n` tokens. Returns the number of tokens, and stores the number of
+ * statements unless `statement_count` is NULL. */
+size_t bc_fuzzer_stream(uint16_t *tks, size_t n, size_t max,
+			size_t *statement_count)
+{
+	size_t token_count = 0, statements = 0;
+
+	while (token_count + max <= n) {
+		size_t len = bc_fuzzer_statement(&tks[token_count], max);
+
+		if (len == 0)
+			continue;
+
+		token_count += len;
+		statements++;
+	}
+
+	if (statement_count != NULL)
+		*statement_count = statements;
+
+	return token_count;
+}
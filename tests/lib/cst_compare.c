@@ -0,0 +1,78 @@
+/* Node by node comparison of CSTs, checking the parent links on the way. */
+
+#include "../../include/rdesc.h"
+#include "../../src/common.h"
+
+/* cst_macros.h undefines its macros when included a second time. */
+#ifndef RDESC_CST_MACROS
+#include "../../include/cst_macros.h"
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+
+/* Expects the CSTs under `n` of `p` and `m` of `q` to be the same. Seminfo
+ * of tokens is compared over `seminfo_size` bytes, 0 skips it. */
+void assert_same_cst(struct rdesc *p, struct rdesc_node *n,
+		     struct rdesc *q, struct rdesc_node *m,
+		     size_t seminfo_size)
+{
+	rdesc_assert(rtype(n) == rtype(m), "node type mismatch");
+	rdesc_assert(rid(n) == rid(m), "node id mismatch");
+
+	if (rtype(n) == RDESC_TOKEN) {
+		rdesc_assert(memcmp(rseminfo(p, n), rseminfo(q, m),
+				    seminfo_size) == 0,
+			     "seminfo mismatch");
+
+		return;
+	}
+
+	rdesc_assert(rvariant(n) == rvariant(m), "variant mismatch");
+	rdesc_assert(rchild_count(n) == rchild_count(m),
+		     "child count mismatch");
+
+	for (uint16_t i = 0; i < rchild_count(n); i++) {
+		rdesc_assert(rparent(p, rchild(p, n, i)) == n,
+			     "broken parent link");
+		rdesc_assert(rparent(q, rchild(q, m, i)) == m,
+			     "broken parent link");
+
+		assert_same_cst(p, rchild(p, n, i), q, rchild(q, m, i),
+				seminfo_size);
+	}
+}
+
+/* `assert_same_cst` for a CST `m` of `cst` detached with `rdesc_take_cst`. */
+void assert_same_taken_cst(struct rdesc *p, struct rdesc_node *n,
+			   const struct rdesc_cst *cst, struct rdesc_node *m,
+			   size_t seminfo_size)
+{
+	rdesc_assert(rtype(n) == rtype(m), "node type mismatch");
+	rdesc_assert(rid(n) == rid(m), "node id mismatch");
+
+	if (rtype(n) == RDESC_TOKEN) {
+		rdesc_assert(memcmp(rseminfo(p, n), rcst_seminfo(cst, m),
+				    seminfo_size) == 0,
+			     "seminfo mismatch");
+
+		return;
+	}
+
+	rdesc_assert(rvariant(n) == rvariant(m), "variant mismatch");
+	rdesc_assert(rchild_count(n) == rchild_count(m),
+		     "child count mismatch");
+
+	for (uint16_t i = 0; i < rchild_count(n); i++) {
+		rdesc_assert(rparent(p, rchild(p, n, i)) == n,
+			     "broken parent link");
+		rdesc_assert(rcst_parent(cst, rcst_child(cst, m, i)) == m,
+			     "broken parent link");
+
+		assert_same_taken_cst(p, rchild(p, n, i),
+				      cst, rcst_child(cst, m, i),
+				      seminfo_size);
+	}
+}
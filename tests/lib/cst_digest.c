@@ -0,0 +1,91 @@
+/* CSTs flattened into words, for comparing trees that no longer exist at the
+ * same time. Define DIGEST_LENGTH, the capacity in words, before including. */
+
+#include "../../include/rdesc.h"
+#include "../../src/common.h"
+
+/* cst_macros.h undefines its macros when included a second time. */
+#ifndef RDESC_CST_MACROS
+#include "../../include/cst_macros.h"
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifndef DIGEST_LENGTH
+#error "DIGEST_LENGTH is not defined"
+#endif
+
+
+struct cst_digest {
+	size_t words[DIGEST_LENGTH];
+	size_t len;
+};
+
+
+void digest_push(struct cst_digest *d, size_t word)
+{
+	rdesc_assert(d->len < DIGEST_LENGTH, "digest overflow");
+
+	d->words[d->len++] = word;
+}
+
+/* Appends three words for each node in pre-order, seminfo of tokens is a
+ * size_t. */
+void digest_flatten(struct rdesc *p, struct rdesc_node *n,
+		    struct cst_digest *d)
+{
+	digest_push(d, rtype(n));
+	digest_push(d, rid(n));
+
+	if (rtype(n) == RDESC_TOKEN) {
+		size_t seminfo;
+
+		memcpy(&seminfo, rseminfo(p, n), sizeof(seminfo));
+		digest_push(d, seminfo);
+
+		return;
+	}
+
+	digest_push(d, rvariant(n));
+
+	for (uint16_t i = 0; i < rchild_count(n); i++)
+		digest_flatten(p, rchild(p, n, i), d);
+}
+
+/* `digest_flatten` for a CST detached with `rdesc_take_cst`, checking its
+ * parent links. */
+void digest_flatten_taken(const struct rdesc_cst *cst, struct rdesc_node *n,
+			  struct cst_digest *d)
+{
+	digest_push(d, rtype(n));
+	digest_push(d, rid(n));
+
+	if (rtype(n) == RDESC_TOKEN) {
+		size_t seminfo;
+
+		memcpy(&seminfo, rcst_seminfo(cst, n), sizeof(seminfo));
+		digest_push(d, seminfo);
+
+		return;
+	}
+
+	digest_push(d, rvariant(n));
+
+	for (uint16_t i = 0; i < rchild_count(n); i++) {
+		struct rdesc_node *child = rcst_child(cst, n, i);
+
+		rdesc_assert(rcst_parent(cst, child) == n,
+			     "broken parent link");
+
+		digest_flatten_taken(cst, child, d);
+	}
+}
+
+void assert_same_digest(const struct cst_digest *a, const struct cst_digest *b)
+{
+	rdesc_assert(a->len == b->len, "digest length mismatch");
+	rdesc_assert(memcmp(a->words, b->words, a->len * sizeof(size_t)) == 0,
+		     "CST mismatch");
+}
@@ -0,0 +1,61 @@
+/* Validate child capacities computed by the grammar initialization. The
+ * end-of-construct row of each nonterminal holds error nodes of two
+ * children. */
+
+#include "../../include/grammar.h"
+#include "../../src/common.h"
+
+#include "../../src/allocator.c"
+#include "../../src/grammar.c"
+
+#include "../../examples/grammar/bc.h"
+
+#include <stdint.h>
+
+
+static void assert_child_caps(const struct rdesc_grammar *grammar,
+			      uint16_t nt_id, const uint16_t *caps)
+{
+	uint16_t max = 0;
+
+	for (uint32_t variant = 0;
+	     variant <= variant_count(*grammar, nt_id); variant++) {
+		rdesc_assert(variant_child_cap(*grammar, nt_id, variant) ==
+			     caps[variant],
+			     "variant child capacity mismatch");
+
+		if (caps[variant] > max)
+			max = caps[variant];
+	}
+
+	rdesc_assert(grammar->child_caps[nt_id] == max,
+		     "child capacity is not the maximum of the variants");
+}
+
+
+int main(void)
+{
+	struct rdesc_grammar grammar;
+
+	unwrap(rdesc_grammar_init(&grammar,
+				  BC_NT_COUNT, BC_NT_VARIANT_COUNT, BC_NT_BODY_LENGTH,
+				  (struct rdesc_grammar_symbol *) bc));
+
+	/* <unsigned_num> ::= NUM / "." NUM / NUM "." NUM */
+	assert_child_caps(&grammar, NT_UNSIGNED_NUM,
+			  (uint16_t []) { 1, 2, 3, 2 });
+
+	/* <optsign> ::= "-" / "+" / E */
+	assert_child_caps(&grammar, NT_OPTSIGN,
+			  (uint16_t []) { 1, 1, 0, 2 });
+
+	/* <atom> ::= <signed_num> / "(" <expr> ")" / "(" <expr> ")" "?" */
+	assert_child_caps(&grammar, NT_ATOM,
+			  (uint16_t []) { 1, 3, 4, 2 });
+
+	/* <stmt> ::= <expr> ";" */
+	assert_child_caps(&grammar, NT_STMT,
+			  (uint16_t []) { 2, 2 });
+
+	rdesc_grammar_destroy(&grammar);
+}
@@ -18,6 +18,9 @@ int main(void)
 #ifdef rchild_count
 	"macro should have undefined"--;
 #endif
+#ifdef rcst_child
+	"macro should have undefined"--;
+#endif
 
 #include "../../include/cst_macros.h"
 
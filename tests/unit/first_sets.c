@@ -0,0 +1,77 @@
+/* Validate FIRST sets and nullability computed by the grammar
+ * initialization. */
+
+#include "../../include/grammar.h"
+#include "../../src/common.h"
+
+#include "../../src/allocator.c"
+#include "../../src/grammar.c"
+
+#include "../../examples/grammar/bc.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+
+static void assert_first_set(const struct rdesc_grammar *grammar,
+			     uint16_t nt_id, uint16_t variant,
+			     bool nullable, const uint16_t *tks)
+{
+	const uint8_t *set = first_set(*grammar, nt_id, variant);
+	size_t count = 0;
+
+	bool is_nullable = in_first_set(set, 0);
+
+	rdesc_assert(is_nullable == nullable, "nullability mismatch");
+
+	for (; tks[count] != TK_NOTOKEN; count++) {
+		bool has_token = in_first_set(set, tks[count]);
+
+		rdesc_assert(has_token, "token missing in FIRST set");
+	}
+
+	for (uint16_t tk = 1; tk < grammar->tk_count; tk++)
+		count -= in_first_set(set, tk);
+
+	rdesc_assert(count == 0, "unexpected token in FIRST set");
+}
+
+
+int main(void)
+{
+	struct rdesc_grammar grammar;
+
+	unwrap(rdesc_grammar_init(&grammar,
+				  BC_NT_COUNT, BC_NT_VARIANT_COUNT, BC_NT_BODY_LENGTH,
+				  (struct rdesc_grammar_symbol *) bc));
+
+	rdesc_assert(grammar.tk_count == BC_TK_COUNT, "token count mismatch");
+
+	/* <optsign> ::= "-" / "+" / E */
+	assert_first_set(&grammar, NT_OPTSIGN, 0, false,
+			 (uint16_t []) { TK_MINUS, TK_NOTOKEN });
+	assert_first_set(&grammar, NT_OPTSIGN, 2, true,
+			 (uint16_t []) { TK_NOTOKEN });
+
+	/* <signed_num> ::= <optsign> <unsigned_num>, nullable prefix */
+	assert_first_set(&grammar, NT_SIGNED_NUM, 0, false,
+			 (uint16_t []) { TK_MINUS, TK_PLUS, TK_NUM, TK_DOT,
+			 TK_NOTOKEN });
+
+	/* <atom> ::= <signed_num> / "(" <expr> ")" / ... */
+	assert_first_set(&grammar, NT_ATOM, 1, false,
+			 (uint16_t []) { TK_LPAREN, TK_NOTOKEN });
+
+	/* <expr_rest> ::= <expr_op> <term> <expr_rest> / E */
+	assert_first_set(&grammar, NT_EXPR_REST, 0, false,
+			 (uint16_t []) { TK_PLUS, TK_MINUS, TK_NOTOKEN });
+	assert_first_set(&grammar, NT_EXPR_REST, 1, true,
+			 (uint16_t []) { TK_NOTOKEN });
+
+	/* Recursion through <term> and <factor> */
+	assert_first_set(&grammar, NT_STMT, 0, false,
+			 (uint16_t []) { TK_MINUS, TK_PLUS, TK_NUM, TK_DOT,
+			 TK_LPAREN, TK_NOTOKEN });
+
+	rdesc_grammar_destroy(&grammar);
+}
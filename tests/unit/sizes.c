@@ -4,6 +4,8 @@
 #include "../../include/rdesc.h"
 #include "../../src/common.h"
 
+#include "../../src/allocator.c"
+#include "../../src/memo.c"
 #include "../../src/rdesc.c"
 #include "../../src/stack.c"
 
@@ -26,13 +28,29 @@ int main(void)
 			- sizeof(uint32_t),
 			"token size mismatch");
 
-	/* nonterminal size will be bigger than the token size, it will be
-	 * used for union alignment */
+	/* token nodes refer to the tape, they are as big as nonterminals
+	 * without children */
+	rdesc_assert(sizeof(struct _rdesc_priv_tk_node) == sizeof(nt_t),
+		     "token node size mismatch");
 	rdesc_assert(sizeof_node(p) == sizeof(nt_t)
 			+ sizeof(uint16_t) /* plus size of offset to previous */
-			+ sizeof(size_t) /* plus size of parent pointer */,
+			+ sizeof(_rdesc_priv_idx_t) /* plus size of parent index */,
 			"node size mismatch");
 
+	/* child list holds one index per child */
+	rdesc_assert(sizeof_nt(3) == sizeof(nt_t)
+			+ 3 * sizeof(_rdesc_priv_idx_t),
+			"nonterminal size mismatch");
+
+#ifdef RDESC_COMPACT_INDEX
+	rdesc_assert(sizeof(_rdesc_priv_idx_t) == sizeof(uint32_t),
+		     "compact index is not 32-bit");
+	rdesc_assert(sizeof_node(p) == 12, "compact node size mismatch");
+#else
+	rdesc_assert(sizeof(_rdesc_priv_idx_t) == sizeof(size_t),
+		     "index is not size_t");
+#endif
+
 	rdesc_destroy(&p);
 
 	unwrap(rdesc_init(&p, NULL, 32, NULL));
@@ -42,11 +60,14 @@ int main(void)
 			+ 32 /* plus user-specified seminfo size */,
 			"token size mismatch");
 
-	/* now the token size is greater than the nonterminal size */
-	rdesc_assert(sizeof_node(p) == sizeof(tk_t)
-			- sizeof(uint32_t) + 32
-			+ sizeof(uint16_t) + sizeof(size_t),
+	/* seminfo is held in the tape, node size does not change */
+	rdesc_assert(sizeof_node(p) == sizeof(nt_t)
+			+ sizeof(uint16_t) + sizeof(_rdesc_priv_idx_t),
 			"node size mismatch");
 
+	/* with per token seminfo sizes, the tape holds seminfo offsets */
+	unwrap(rdesc_seminfo_sizes(&p, (size_t []) { 0, 32 }));
+	rdesc_assert(sizeof_tk(p) == sizeof(tk_t), "token size mismatch");
+
 	rdesc_destroy(&p);
 }
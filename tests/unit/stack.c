@@ -5,6 +5,7 @@
 
 #define STACK_INITIAL_CAP 2
 
+#include "../../src/allocator.c"
 #include "../../src/stack.c"
 
 #include <stdint.h>
@@ -91,12 +92,38 @@ void test_basic(void)
 	rdesc_stack_destroy(s);
 }
 
+/* Popping shrinks the stack unless it retains, reset always does. */
+void test_retain(void)
+{
+	struct rdesc_stack *s;
+	rdesc_stack_init(&s, 8);
+
+	rdesc_stack_multipush(&s, NULL, 1024);
+	rdesc_stack_multipop(&s, 1024);
+	rdesc_stack_multipop(&s, 0);
+	rdesc_assert(s->cap < 1024, "popping kept the capacity");
+
+	rdesc_stack_retain(s, true);
+
+	rdesc_stack_multipush(&s, NULL, 1024);
+	size_t cap = s->cap;
+	rdesc_stack_multipop(&s, 1024);
+	rdesc_stack_multipop(&s, 0);
+	rdesc_assert(s->cap == cap, "retaining stack is shrunk");
+
+	rdesc_stack_reset(&s);
+	rdesc_assert(s->cap == STACK_INITIAL_CAP, "reset kept the capacity");
+
+	rdesc_stack_destroy(s);
+}
+
 
 int main(void)
 {
 	srand(time(NULL));
 
 	test_basic();
+	test_retain();
 
 	for (int _fuzz = 0; _fuzz < 16; _fuzz++)
 		test_fuzz();
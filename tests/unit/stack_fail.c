@@ -6,6 +6,7 @@
 #define STACK_MAX_CAP STACK_INITIAL_CAP * 64
 #define TEST_INSTRUMENTS
 
+#include "../../src/allocator.c"
 #include "../../src/test_instruments.c"
 #include "../../src/stack.c"
 
@@ -0,0 +1,70 @@
+/* Ahead-of-time grammar compiler, writes a parser specialized to a grammar.
+ *
+ * Built by rdesc.mk for each grammar, with RDESC_AOT_HEADER set to the header
+ * declaring the production table and RDESC_AOT_RULES to its identifier.
+ *
+ * With -g, only the grammar is written as constant tables, see
+ * rdesc_dump_grammar.
+ *
+ * Usage: rdesc_aot [-g] <prefix> <source output> <header output> */
+
+#include "../include/grammar.h"
+#include "../include/util.h"
+
+#include RDESC_AOT_HEADER
+
+#include <stdio.h>
+#include <string.h>
+
+
+#define rules RDESC_AOT_RULES
+
+
+int main(int argc, char *argv[])
+{
+	struct rdesc_grammar grammar;
+	FILE *source, *header = NULL;
+	int res = 1, grammar_only = argc > 1 && strcmp(argv[1], "-g") == 0;
+
+	if (argc != 4 + grammar_only) {
+		fprintf(stderr, "usage: %s [-g] <prefix> <source> <header>\n",
+			argv[0]);
+
+		return 1;
+	}
+
+	argv += grammar_only;
+
+	if (rdesc_grammar_init(&grammar,
+			       sizeof(rules) / sizeof(rules[0]),
+			       sizeof(rules[0]) / sizeof(rules[0][0]),
+			       sizeof(rules[0][0]) / sizeof(rules[0][0][0]),
+			       &rules[0][0][0])) {
+		fputs("could not initialize grammar\n", stderr);
+
+		return 1;
+	}
+
+	if ((source = fopen(argv[2], "w")) == NULL)
+		perror(argv[2]);
+	else if ((header = fopen(argv[3], "w")) == NULL)
+		perror(argv[3]);
+	else if (grammar_only)
+		rdesc_dump_grammar(source, header, &grammar, argv[1]);
+	else
+		rdesc_dump_c(source, header, &grammar, argv[1]);
+
+	if (header != NULL) {
+		res = ferror(source) || ferror(header);
+
+		if (fclose(header))
+			res = 1;
+	}
+
+	if (source != NULL && fclose(source))
+		res = 1;
+
+	rdesc_grammar_destroy(&grammar);
+
+	return res;
+}